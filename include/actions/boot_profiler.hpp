@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <chrono>
+
+namespace actions {
+
+/**
+ * One segment of the boot timeline (device clock, ms since kernel start;
+ * the bootloader segment precedes the kernel and starts at a negative offset)
+ */
+struct BootPhase {
+    std::string name;
+    double start_ms = 0;
+    double duration_ms = 0;
+};
+
+/**
+ * Boot performance profile collected after a reboot
+ */
+struct BootProfile {
+    bool completed = false;                         // sys.boot_completed seen in time
+
+    // Host-side wall clock, measured from the reboot command
+    std::chrono::milliseconds to_adb_online{0};     // device visible to adb again
+    std::chrono::milliseconds to_boot_completed{0}; // sys.boot_completed=1
+
+    // Device-side timeline: bootloader, kernel, init, zygote, system_server, boot complete
+    std::vector<BootPhase> phases;
+
+    std::map<std::string, long long> boottime_props;   // ro.boottime.* (ns, or ms for durations)
+    std::map<std::string, long long> boot_progress;    // boot_progress_* (ms since boot)
+    double completed_uptime_ms = 0;                    // /proc/uptime when completion was seen
+    std::string error;
+};
+
+/**
+ * Boot-time profiler
+ * Polls sys.boot_completed over one persistent shell session, then pulls
+ * ro.boottime.* and the boot_progress_* events in a single batch and
+ * turns them into a phase timeline. Used to track boot-time regressions
+ * across ROM builds.
+ */
+class BootProfiler {
+public:
+    BootProfiler(const std::string& adb_path, const std::string& serial);
+
+    // Wait for boot completion on the current boot and collect the timeline
+    // (call once the device is back on adb; `reboot_sent` anchors the host-side timings)
+    BootProfile profile_current_boot(std::chrono::steady_clock::time_point reboot_sent,
+                                     std::chrono::milliseconds timeout) const;
+
+    // Build the timeline from the batch output ("getprop" subset + event log lines)
+    static void parse_timeline(std::string_view props, std::string_view events, BootProfile& profile);
+
+    static std::string format_profile(const BootProfile& profile);
+
+private:
+    std::string adb_path_;
+    std::string serial_;
+};
+
+} // namespace actions
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <string>
+#include <chrono>
+#include <future>
 #include "adb/adb_client.hpp"
 #include "device/device_info.hpp"
+#include "device/reboot_tracker.hpp"
+#include "actions/boot_profiler.hpp"
 
 namespace actions {
 
@@ -34,6 +38,21 @@ public:
     bool execute_reboot_recovery();
     bool execute_reboot_download();
 
+    /**
+     * Reboot and follow the device until it reaches the mode for `type`
+     * ("system", "bootloader", "recovery", "download").
+     * Tracking starts before the command is sent, so no transition is missed.
+     * The future resolves on arrival or after `timeout`, with per-phase timings.
+     */
+    std::future<device::RebootResult> execute_reboot_tracked(const std::string& type,
+                                                             std::chrono::milliseconds timeout);
+
+    /**
+     * "Reboot and profile": reboot to Android, wait for sys.boot_completed and
+     * return the boot timeline. Blocks until done; run it off the UI thread.
+     */
+    BootProfile execute_reboot_and_profile(std::chrono::milliseconds timeout);
+
     // Validation
     bool can_reboot() const;
 
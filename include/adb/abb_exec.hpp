@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <functional>
+
+namespace adb {
+
+/**
+ * Client for adbd's "abb_exec:" service (Android Binder Bridge)
+ * adbd calls the named system service's shell command handler from its
+ * own process, the same entry point `cmd <service>` reaches, so pm/am/cmd
+ * calls skip starting sh and the cmd binary on the device. The service is
+ * raw: stdout and stderr are not kept apart and no exit status is sent.
+ */
+class AbbExecClient {
+public:
+    // Return false to stop reading (the connection is closed)
+    using DataCallback = std::function<bool(std::string_view data)>;
+
+    explicit AbbExecClient(const std::string& serial);
+
+    // Service arguments for a plain pm/am/wm/settings/cmd command line
+    // ("pm list packages -f" -> {"package", "list", "packages", "-f"});
+    // nullopt if the command needs a shell (pipes, quoting, variables, ...)
+    // A trailing "2>/dev/null" is dropped.
+    static std::optional<std::vector<std::string>> translate(std::string_view command);
+
+    // Run and push output as it arrives. nullopt if the service could not
+    // be started or the device has no such binder service (nothing was
+    // delivered, the caller can use the shell); false if the command
+    // reported an error ("Error: ...", "Unknown option", an exception;
+    // nothing was delivered, the message is in last_error()) or the
+    // connection broke mid-output.
+    std::optional<bool> run(const std::vector<std::string>& args, const DataCallback& on_data,
+                            int timeout_ms = 10000);
+
+    // The last run failed because adbd refused the service (no abb_exec)
+    bool rejected() const { return rejected_; }
+    const std::string& last_error() const { return last_error_; }
+
+private:
+    std::string serial_;
+    bool rejected_ = false;
+    std::string last_error_;
+};
+
+} // namespace adb
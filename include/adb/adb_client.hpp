@@ -42,6 +42,8 @@ public:
     std::string get_build_fingerprint() const;
 
     // Safe reboot operations (require explicit user confirmation)
+    // Return as soon as adb accepted the command; use device::RebootTracker
+    // to wait for the device to actually reach the target mode
     bool reboot_system() const;           // adb reboot
     bool reboot_bootloader() const;       // adb reboot bootloader
     bool reboot_recovery() const;         // adb reboot recovery
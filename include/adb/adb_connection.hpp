@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <cstdint>
+
+namespace adb {
+
+/**
+ * Direct connection to the local adb server (smart socket protocol)
+ * Requests are "<4 hex digit length><service>", answered by OKAY or
+ * FAIL<hex length><message>. One connection serves one service; host
+ * services ("host:...") and device services (after switch_transport)
+ * both go through here instead of spawning the adb binary.
+ */
+class AdbConnection {
+public:
+    static constexpr uint16_t DEFAULT_SERVER_PORT = 5037;
+
+    AdbConnection() = default;
+    ~AdbConnection();
+
+    AdbConnection(const AdbConnection&) = delete;
+    AdbConnection& operator=(const AdbConnection&) = delete;
+    AdbConnection(AdbConnection&& other) noexcept;
+    AdbConnection& operator=(AdbConnection&& other) noexcept;
+
+    // Connect to the adb server (honours ANDROID_ADB_SERVER_PORT)
+    bool connect(int timeout_ms = 2000);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    // Send one service request and consume its OKAY/FAIL status
+    bool request(std::string_view service);
+
+    // Route this connection to a device ("host:transport:<serial>")
+    bool switch_transport(const std::string& serial);
+
+    // Read one "<4 hex length><payload>" message (host:track-devices etc.)
+    std::optional<std::string> read_length_prefixed();
+
+    // Read until the server closes the connection
+    std::optional<std::string> read_to_end();
+
+    // Raw I/O for device services (shell, sync)
+    bool write_all(const void* data, size_t size);
+    bool read_exact(void* data, size_t size);
+    long read_some(void* data, size_t size);
+
+    // Wait for data; false on timeout
+    bool wait_readable(int timeout_ms) const;
+
+    void set_timeout(int timeout_ms) { timeout_ms_ = timeout_ms; }
+    int fd() const { return fd_; }
+    std::string last_error() const { return last_error_; }
+
+    // Server port from ANDROID_ADB_SERVER_PORT, else 5037
+    static uint16_t server_port();
+
+private:
+    int fd_ = -1;
+    int timeout_ms_ = 10000;
+    std::string last_error_;
+
+    bool read_status();
+};
+
+} // namespace adb
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "adb/sync_compression.hpp"
+
+namespace adb {
+
+/**
+ * adb features that select a faster mechanism; usable only when both the
+ * adb server (host:features) and the device's adbd advertise them
+ */
+enum class Feature : uint32_t {
+    SHELL_V2 = 1u << 0,     // "shell,v2,raw:": separate stderr, exit status, binary safe
+    CMD = 1u << 1,          // the cmd binary (pm/am via cmd)
+    STAT_V2 = 1u << 2,      // sync STA2/LST2
+    LS_V2 = 1u << 3,        // sync LIS2
+    ABB = 1u << 4,          // Android Binder Bridge
+    ABB_EXEC = 1u << 5,     // "abb_exec:" (raw, no shell)
+    SENDRECV_V2 = 1u << 6,  // sync RCV2/SND2
+};
+
+// Name in the feature lists ("shell_v2", ...)
+const char* feature_name(Feature feature);
+
+/**
+ * What one device connection supports, probed once
+ */
+struct DeviceCapabilities {
+    std::string serial;
+    int transport_id = -1;              // connection the probe ran on (-1 if not reported)
+
+    std::vector<std::string> host_features;     // adb server
+    std::vector<std::string> device_features;   // adbd
+    uint32_t features = 0;                      // Feature bits both sides have
+    Compression sync_compression = Compression::NONE;   // best common sync v2 codec
+
+    int sdk = 0;                        // ro.build.version.sdk (0 if unknown)
+    std::set<std::string> applets;      // toybox applets; empty if toybox is missing
+    bool applets_probed = false;
+
+    bool has(Feature feature) const { return (features & static_cast<uint32_t>(feature)) != 0; }
+    bool has_applet(const std::string& name) const { return applets.count(name) != 0; }
+};
+
+/**
+ * Per-device capability cache
+ * Entries are probed on first use and kept until the device reconnects
+ * (another transport id), leaves the device list, reboots or is dropped
+ * explicitly. Mechanisms that fail at runtime despite being advertised
+ * are revoked from the cached entry, so the rest of the session skips
+ * them. Thread-safe; entries are immutable snapshots.
+ */
+class CapabilityCache {
+public:
+    using Entry = std::shared_ptr<const DeviceCapabilities>;
+
+    // Cached entry, probing on first use; nullptr if the adb server or
+    // device could not be reached (nothing is cached then)
+    Entry get(const std::string& serial);
+
+    // Cached entry only (never probes)
+    Entry peek(const std::string& serial) const;
+
+    // Query the adb server and device (three host requests and one shell call)
+    static Entry probe(const std::string& serial);
+
+    // Fill sdk and applets from the probe's shell output: the SDK line,
+    // a "--" line, then toybox's applet list
+    static void parse_probe_output(std::string_view output, DeviceCapabilities& caps);
+
+    // Keep entries only for devices still online on the same transport;
+    // `online` maps serial -> transport id from "adb devices -l"
+    void retain(const std::map<std::string, int>& online);
+
+    void invalidate(const std::string& serial);
+    void clear();
+
+    // Feature advertised but not working on this device; a revoked
+    // SENDRECV_V2 also drops the codec
+    void revoke(const std::string& serial, Feature feature);
+    void revoke_applet(const std::string& serial, const std::string& applet);
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_;
+
+    template <class Change>
+    void update(const std::string& serial, Change&& change);
+};
+
+} // namespace adb
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "adb/sync_compression.hpp"
+
+namespace adb {
+
+// Inflates the output of gzip_command(); nullptr if built without zlib
+// (LINECHECK_HAVE_ZLIB)
+std::unique_ptr<StreamDecoder> create_gzip_decoder();
+
+// `command` with its stdout piped through the device's gzip; the exit
+// status stays the command's own unless gzip itself fails (pipefail)
+std::string gzip_command(const std::string& command);
+
+/**
+ * Output sizes and timings of one command class for each way it ran:
+ * plain shell, shell through gzip, or abb_exec without a shell
+ */
+struct ShellClassStats {
+    uint64_t plain_runs = 0;
+    uint64_t plain_bytes = 0;
+    double plain_ms = 0;
+
+    uint64_t gzip_runs = 0;
+    uint64_t gzip_bytes = 0;        // inflated output
+    uint64_t gzip_wire_bytes = 0;   // compressed bytes received
+    double gzip_ms = 0;
+
+    uint64_t abb_runs = 0;
+    uint64_t abb_bytes = 0;
+    double abb_ms = 0;
+
+    uint64_t bytes_saved() const { return gzip_bytes > gzip_wire_bytes ? gzip_bytes - gzip_wire_bytes : 0; }
+
+    // Plain minus gzip time per MB of output; positive when gzip is faster,
+    // 0 until both ways have been measured
+    double net_ms_per_mb() const;
+
+    // Mean latency per run of each path (0 if it never ran)
+    double plain_mean_ms() const { return plain_runs > 0 ? plain_ms / static_cast<double>(plain_runs) : 0; }
+    double gzip_mean_ms() const { return gzip_runs > 0 ? gzip_ms / static_cast<double>(gzip_runs) : 0; }
+    double abb_mean_ms() const { return abb_runs > 0 ? abb_ms / static_cast<double>(abb_runs) : 0; }
+};
+
+/**
+ * Decides which shell commands run through on-device gzip
+ * Output size is only known afterwards, so the decision is made per
+ * command class ("dumpsys package", "pm list", "logcat", ...): a class
+ * whose last run produced at least `threshold` bytes is compressed the
+ * next time, and drops back to plain output if it shrinks below it.
+ * Thread-safe.
+ */
+class ShellCompressionPolicy {
+public:
+    static constexpr size_t DEFAULT_THRESHOLD = 256 * 1024;
+
+    explicit ShellCompressionPolicy(size_t threshold = DEFAULT_THRESHOLD) : threshold_(threshold) {}
+
+    // 0 turns compression off
+    void set_threshold(size_t bytes);
+    size_t threshold() const;
+
+    // Program plus its first non-option argument, up to any shell operator
+    static std::string command_class(std::string_view command);
+
+    bool should_compress(const std::string& command_class) const;
+
+    void record_plain(const std::string& command_class, uint64_t bytes, double ms);
+    void record_gzip(const std::string& command_class, uint64_t bytes, uint64_t wire_bytes, double ms);
+    void record_abb(const std::string& command_class, uint64_t bytes, double ms);
+
+    std::map<std::string, ShellClassStats> stats() const;
+
+private:
+    struct ClassState {
+        ShellClassStats stats;
+        uint64_t last_output = 0;
+    };
+
+    mutable std::mutex mutex_;
+    size_t threshold_;
+    std::map<std::string, ClassState> classes_;
+};
+
+} // namespace adb
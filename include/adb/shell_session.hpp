@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <functional>
+#include <sys/types.h>
+#include "parse/line_scanner.hpp"
+
+namespace adb {
+
+/**
+ * Persistent "adb shell" session
+ * One adb process and one device shell serve any number of commands, so
+ * polling loops and samplers skip the per-command process and transport
+ * setup. Each command is framed with a unique end marker carrying its
+ * exit status. stdin is a pipe, so no PTY (no CRLF, no echo).
+ */
+class ShellSession {
+public:
+    struct Result {
+        std::string output;
+        int exit_code = -1;
+    };
+
+    // Streaming consumer: return false to stop delivering lines
+    // (the command still runs to completion so the session stays in sync)
+    using LineCallback = std::function<bool(std::string_view line)>;
+
+    ShellSession(const std::string& adb_path, const std::string& serial);
+    ~ShellSession();
+
+    ShellSession(const ShellSession&) = delete;
+    ShellSession& operator=(const ShellSession&) = delete;
+
+    // Start the shell; false if adb could not be spawned
+    bool open();
+    void close();
+    bool is_open() const { return pid_ > 0; }
+
+    // Run one command and collect its stdout; nullopt on timeout or if the session died
+    std::optional<Result> run(const std::string& command, int timeout_ms = 10000);
+
+    // Run one command, pushing stdout lines as they arrive; returns the exit code
+    std::optional<int> run_lines(const std::string& command, const LineCallback& on_line,
+                                 int timeout_ms = 10000);
+
+    const std::string& serial() const { return serial_; }
+
+private:
+    std::string adb_path_;
+    std::string serial_;
+    pid_t pid_ = -1;
+    int stdin_fd_ = -1;
+    int stdout_fd_ = -1;
+    unsigned long sequence_ = 0;
+    std::string marker_;
+    std::string frame_;
+    parse::LineSplitter splitter_;  // holds the partial line between reads of one command
+
+    bool send(const std::string& data);
+};
+
+} // namespace adb
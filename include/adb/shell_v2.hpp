@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <functional>
+#include <cstdint>
+
+namespace adb {
+
+/**
+ * Result of one shell command with separate streams and a real exit status
+ */
+struct ShellResult {
+    std::string out;
+    std::string err;
+    int exit_code = -1;
+    bool protocol_v2 = false;   // false: legacy shell, err is empty and out may have been a PTY
+
+    bool succeeded() const { return exit_code == 0; }
+};
+
+/**
+ * Incremental decoder for shell protocol v2 packets
+ * Each packet is <1 byte id><4 byte little-endian length><payload>;
+ * feed() accepts arbitrary socket reads and reports complete payloads
+ * without copying them.
+ */
+class ShellPacketParser {
+public:
+    enum PacketId : uint8_t {
+        ID_STDIN = 0,
+        ID_STDOUT = 1,
+        ID_STDERR = 2,
+        ID_EXIT = 3,
+        ID_CLOSE_STDIN = 4,
+        ID_WINDOW_SIZE = 5,
+    };
+
+    // Return false to stop
+    using PacketCallback = std::function<bool(uint8_t id, std::string_view payload)>;
+
+    // False if the callback stopped or a packet was malformed
+    bool feed(std::string_view data, const PacketCallback& on_packet);
+
+    // Encode one packet (for stdin / close-stdin)
+    static std::string encode(uint8_t id, std::string_view payload);
+
+private:
+    std::string pending_;       // partial packet carried between reads
+};
+
+/**
+ * Native shell client over the adb server's smart socket
+ * Requests "shell,v2,raw:<command>": no PTY, so no CRLF translation or
+ * echo, stdout and stderr arrive as separate packets and the command's
+ * exit status arrives as its own packet. Devices whose adbd predates
+ * shell_v2 fall back to "shell:" with the status appended by an end
+ * marker; the client remembers that per device.
+ */
+class ShellV2Client {
+public:
+    enum class Stream {
+        OUT,
+        ERR
+    };
+
+    // Return false to stop reading (the connection is closed)
+    using StreamCallback = std::function<bool(Stream stream, std::string_view data)>;
+
+    // `try_v2` = false skips straight to the legacy protocol (device known to lack shell_v2)
+    explicit ShellV2Client(const std::string& serial, bool try_v2 = true);
+
+    // Run and collect; nullopt if the adb server or device is unreachable
+    std::optional<ShellResult> run(const std::string& command, int timeout_ms = 10000);
+
+    // Run and push output as it arrives; returns the exit code
+    // (-1 if stopped early), nullopt if the command could not be started
+    std::optional<int> run_streaming(const std::string& command, const StreamCallback& on_data,
+                                     int timeout_ms = 10000);
+
+    bool uses_v2() const { return v2_supported_; }
+    const std::string& last_error() const { return last_error_; }
+
+private:
+    std::string serial_;
+    bool v2_supported_ = true;
+    std::string last_error_;
+
+    std::optional<int> run_v2(const std::string& command, const StreamCallback& on_data,
+                              int timeout_ms, bool& unsupported);
+    std::optional<int> run_legacy(const std::string& command, const StreamCallback& on_data,
+                                  int timeout_ms);
+};
+
+} // namespace adb
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include "adb/adb_connection.hpp"
+#include "adb/sync_compression.hpp"
+
+namespace adb {
+
+/**
+ * File metadata as reported by the device's sync service
+ */
+struct FileStat {
+    uint32_t error = 0;     // errno on the device (0 = stat succeeded)
+    uint32_t mode = 0;      // st_mode; 0 if the path does not exist
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint32_t uid = 0;
+    uint32_t gid = 0;
+    uint64_t ino = 0;
+    uint32_t nlink = 0;
+
+    bool exists() const { return error == 0 && mode != 0; }
+    bool is_directory() const { return (mode & 0170000) == 0040000; }
+    bool is_regular() const { return (mode & 0170000) == 0100000; }
+    bool is_symlink() const { return (mode & 0170000) == 0120000; }
+};
+
+struct DirEntry {
+    std::string name;
+    FileStat stat;
+};
+
+/**
+ * Size and timing of one file transfer
+ */
+struct TransferStats {
+    uint64_t bytes = 0;         // file size (uncompressed)
+    uint64_t wire_bytes = 0;    // payload on the connection (compressed size)
+    Compression compression = Compression::NONE;
+    double first_byte_ms = 0;   // request written -> first payload byte received (pull) or sent (push)
+    double total_ms = 0;        // request written -> DONE / OKAY
+
+    // Effective throughput, in file bytes
+    double bytes_per_second() const { return total_ms > 0 ? static_cast<double>(bytes) * 1000.0 / total_ms : 0; }
+    double ratio() const { return wire_bytes > 0 ? static_cast<double>(bytes) / static_cast<double>(wire_bytes) : 1.0; }
+};
+
+/**
+ * One file of a bundle pull; times are measured from the start of the bundle
+ */
+struct BundleEntry {
+    std::string remote;
+    bool ok = false;
+    std::string error;          // why the file could not be read
+    TransferStats stats;
+};
+
+/**
+ * What a bundle pull fetched, in request order
+ */
+struct BundleManifest {
+    std::vector<BundleEntry> entries;
+    uint64_t total_bytes = 0;
+    double total_ms = 0;
+    size_t sessions = 0;        // sync sessions used (one more after each unreadable file)
+};
+
+/**
+ * How pull_to_file() moves payload into the destination
+ */
+enum class PullMode {
+    BUFFERED,   // 256 KB reads written from the receive buffer (fewest syscalls);
+                // always used for compressed transfers
+    SPLICE,     // socket -> pipe -> file inside the kernel (Linux; BUFFERED elsewhere),
+                // but two small header reads per 64 KB DATA chunk
+    MMAP        // size from a pipelined STAT, payload received straight into the mapped file
+};
+
+/**
+ * Native client for the adb sync service ("sync:")
+ * Stat and list requests are pipelined: a whole batch is written before
+ * the first response is read, so N probes cost one round trip instead of
+ * N shell invocations. Uses STA2/LST2/LIS2 (stat_v2, ls_v2) and falls
+ * back to STAT/LIST on devices whose adbd rejects them; the v1 replies
+ * carry no errno, only mode/size/mtime.
+ */
+class SyncClient {
+public:
+    // `use_v2` = false skips straight to STAT/LIST
+    explicit SyncClient(const std::string& serial, bool use_v2 = true);
+    ~SyncClient();
+
+    SyncClient(const SyncClient&) = delete;
+    SyncClient& operator=(const SyncClient&) = delete;
+
+    // Open the sync session; other calls open it on demand
+    bool open(int timeout_ms = 5000);
+    void close();
+    bool is_open() const { return connection_.is_open(); }
+
+    // One FileStat per path, in request order; nullopt if the session failed
+    // `follow_links` selects stat() over lstat() (v2 only)
+    std::optional<std::vector<FileStat>> stat(const std::vector<std::string>& paths,
+                                              bool follow_links = false);
+
+    // Entries of each directory ("." and ".." omitted), in request order;
+    // a missing or unreadable directory yields an empty list
+    std::optional<std::vector<std::vector<DirEntry>>> list(const std::vector<std::string>& dirs);
+
+    // Receive a file, handing payload to `on_data` straight from the receive
+    // buffer (return false to abort); nullopt if the file could not be read
+    using DataCallback = std::function<bool(std::string_view chunk)>;
+    std::optional<TransferStats> pull(const std::string& remote, const DataCallback& on_data);
+
+    // Receive a file into `local`, replacing it only once the whole file has
+    // arrived (an existing file survives a failed pull)
+    std::optional<TransferStats> pull_to_file(const std::string& remote, const std::string& local,
+                                              PullMode mode = PullMode::BUFFERED);
+
+    // Send a local file; `mode` holds the permission bits for the device copy
+    std::optional<TransferStats> push(const std::string& local, const std::string& remote,
+                                      uint32_t mode = 0644);
+
+    // Codec for pull/push/pull_to_file (RCV2/SND2); NONE uses RECV/SEND.
+    // Pick it with negotiate_compression() from the device features; if
+    // adbd rejects the v2 request anyway, the transfer is retried without
+    // compression, which then stays off for this client.
+    void set_compression(Compression method) { compression_ = method; }
+    Compression compression() const { return compression_; }
+
+    // Pull several files with their RECVs pipelined on one session, handing
+    // payload to on_data(index, chunk) as it lands (return false to skip the
+    // rest of that file). adbd ends the session on an unreadable file, so the
+    // remaining requests are resent on a new one. nullopt if no session opened.
+    // Always plain RECV: bundles are many small files, where a codec saves little.
+    using BundleCallback = std::function<bool(size_t index, std::string_view chunk)>;
+    std::optional<BundleManifest> pull_bundle(const std::vector<std::string>& remotes,
+                                              const BundleCallback& on_data);
+
+    bool uses_v2() const { return v2_; }
+    const std::string& last_error() const { return last_error_; }
+
+private:
+    std::string serial_;
+    bool v2_ = true;
+    bool v2_confirmed_ = false;     // a v2 reply was seen on this device
+    bool rejected_ = false;         // the last failure was a FAIL reply, not a lost connection
+    Compression compression_ = Compression::NONE;
+    std::unique_ptr<StreamDecoder> decoder_;    // active during a compressed receive
+    uint64_t decoded_bytes_ = 0;
+    AdbConnection connection_;
+    int timeout_ms_ = 5000;
+    std::string last_error_;
+
+    // Buffered response reader over the connection; with read-ahead off,
+    // only the bytes asked for are read so payload can bypass the buffer
+    std::vector<char> rbuf_;
+    size_t rpos_ = 0;
+    size_t rend_ = 0;
+    bool read_ahead_ = true;
+
+    size_t buffered() const { return rend_ - rpos_; }
+    bool fill(size_t n);
+    bool take(void* out, size_t n);
+    bool take_string(std::string& out, size_t n);
+    bool read_fail_message();
+
+    bool send_batch(const std::string& batch);
+    bool read_stat(FileStat& out);
+    bool read_listing(std::vector<DirEntry>& out);
+
+    // Replies to one RECV
+    enum class FileReply {
+        DONE,
+        FAILED,     // FAIL reply: the device closes the session
+        BROKEN      // connection lost or payload rejected mid-file
+    };
+    FileReply read_file(const std::function<bool(size_t)>& payload, TransferStats& stats,
+                        std::chrono::steady_clock::time_point start);
+
+    // Hand the next `size` payload bytes to `on_data` from the receive buffer,
+    // decompressing first during a compressed receive
+    bool deliver(size_t size, const DataCallback& on_data);
+
+    std::optional<TransferStats> send_file(int fd, const std::string& remote, uint32_t mode, uint32_t mtime);
+
+    // Send `prefix` requests and RECV in one write, let `read_prefix` consume
+    // their replies, then hand each DATA length to `payload`, which must
+    // consume exactly that many bytes
+    std::optional<TransferStats> receive(const std::string& remote, const std::string& prefix,
+                                         const std::function<bool()>& read_prefix,
+                                         const std::function<bool(size_t)>& payload);
+
+    template <class Result, class Request, class Read>
+    std::optional<std::vector<Result>> pipeline(const std::vector<std::string>& paths,
+                                                Request&& request, Read&& read);
+};
+
+} // namespace adb
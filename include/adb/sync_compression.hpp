@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+namespace adb {
+
+/**
+ * Stream compression for sync v2 transfers (RCV2/SND2)
+ * Values are the sync v2 flag bits. A codec is only usable when the
+ * build found its library (LINECHECK_HAVE_BROTLI / _LZ4 / _ZSTD) and the
+ * device advertises the matching "sendrecv_v2_*" feature.
+ */
+enum class Compression : uint32_t {
+    NONE = 0,
+    BROTLI = 1,
+    LZ4 = 2,
+    ZSTD = 4,
+};
+
+const char* compression_name(Compression method);
+
+// Codec compiled into this build
+bool compression_available(Compression method);
+
+// Device feature that announces the codec ("sendrecv_v2_zstd", ...)
+const char* compression_feature(Compression method);
+
+// Best codec both sides support, in order of preference (Zstd, LZ4,
+// Brotli); NONE without "sendrecv_v2" or a common codec
+Compression negotiate_compression(const std::vector<std::string>& device_features);
+
+// Receives encoder/decoder output; return false to stop
+using CodecSink = std::function<bool(std::string_view chunk)>;
+
+/**
+ * Incremental decoder: feed DATA payloads as they arrive
+ */
+class StreamDecoder {
+public:
+    virtual ~StreamDecoder() = default;
+
+    // False on corrupt input or when the sink stops
+    virtual bool feed(std::string_view input, const CodecSink& output) = 0;
+
+    // True if the compressed stream ended cleanly (not truncated)
+    virtual bool finished() const = 0;
+
+    // nullptr if the codec is not compiled in
+    static std::unique_ptr<StreamDecoder> create(Compression method);
+};
+
+/**
+ * Incremental encoder for pushes
+ */
+class StreamEncoder {
+public:
+    virtual ~StreamEncoder() = default;
+
+    virtual bool feed(std::string_view input, const CodecSink& output) = 0;
+
+    // Flush and end the stream
+    virtual bool finish(const CodecSink& output) = 0;
+
+    // nullptr if the codec is not compiled in
+    static std::unique_ptr<StreamEncoder> create(Compression method);
+};
+
+} // namespace adb
@@ -5,6 +5,14 @@
 #include <vector>
 #include <optional>
 #include <map>
+#include <functional>
+#include <string_view>
+#include <memory>
+#include "adb/shell_v2.hpp"
+#include "adb/sync_client.hpp"
+#include "adb/shell_compression.hpp"
+#include "adb/capabilities.hpp"
+#include "adb/abb_exec.hpp"
 
 // Device states from adb devices
 enum class DeviceState {
@@ -19,12 +27,23 @@ struct AdbDevice {
     std::string serial;
     DeviceState state;
     std::string state_string;
+
+    // Descriptors from "adb devices -l" (empty if not reported)
+    std::string usb;
+    std::string product;
+    std::string model;
+    std::string device;
+    int transport_id = -1;
 };
 
 // ADB Abstraction Layer
 // Handles all ADB communication with defensive parsing
 class AdbAbstraction {
 public:
+    // Streaming consumers: return false to stop reading early
+    using ChunkCallback = std::function<bool(std::string_view chunk)>;
+    using LineCallback = std::function<bool(std::string_view line)>;
+
     // Initialize with custom ADB path (empty string = auto-detect from PATH)
     explicit AdbAbstraction(const std::string& custom_adb_path = "");
 
@@ -34,21 +53,97 @@ public:
     // Get ADB executable path
     std::string get_adb_path() const;
 
-    // List connected devices
+    // List connected devices (with "-l" descriptors)
     std::vector<AdbDevice> list_devices() const;
 
     // Execute shell command on specific device
     // Returns output or empty string on error
+    // Plain pm/am/wm/settings/cmd calls go through abb_exec on devices that
+    // have it (no sh or cmd process on the device), else through the shell.
+    // abb sends no exit status and mixes in stderr, so an error message in
+    // place of output counts as a failed command and yields ""
     std::string shell_command(const std::string& serial, const std::string& command) const;
 
+    // Execute shell command and push raw output chunks to `on_chunk` as they arrive
+    // Only one read buffer is held in memory regardless of output size
+    // Returns false if the command could not be run or exited with an error
+    bool shell_command_chunks(const std::string& serial, const std::string& command,
+                              const ChunkCallback& on_chunk) const;
+
+    // shell_command / _chunks / _lines run a command through the device's
+    // gzip once its command class has produced at least `bytes` of output
+    // (shell v2 devices; 0 = never). Output is inflated as it arrives.
+    void set_shell_compression_threshold(size_t bytes) { shell_compression.set_threshold(bytes); }
+
+    // Latency per path (plain, gzip, abb_exec), bytes saved and time per MB,
+    // for each command class seen
+    std::map<std::string, adb::ShellClassStats> shell_compression_stats() const { return shell_compression.stats(); }
+
+    // Execute shell command and push each output line (without '\n') to `on_line`
+    // Parsing runs while the transfer is still in progress
+    bool shell_command_lines(const std::string& serial, const std::string& command,
+                             const LineCallback& on_line) const;
+
+    // Execute shell command with separate stdout/stderr and its exit status
+    // (native shell protocol v2; the adb binary is used if the server cannot be reached)
+    // Returns nullopt if the device could not be reached at all
+    std::optional<adb::ShellResult> shell(const std::string& serial, const std::string& command,
+                                          int timeout_ms = 10000) const;
+
+    // Whether `path` exists / is a directory (following symlinks, like
+    // `test -e` / `test -d`): a sync stat, or the shell test without sync
+    bool path_exists(const std::string& serial, const std::string& path) const;
+    bool is_directory(const std::string& serial, const std::string& path) const;
+
+    // `value` single-quoted for the device shell ('\'' for each quote)
+    static std::string shell_quote(const std::string& value);
+
+    // Metadata for many paths, pipelined over one sync session
+    // (lstat unless `follow_links`); nullopt if the sync service could not be reached
+    std::optional<std::vector<adb::FileStat>> stat_paths(const std::string& serial,
+                                                         const std::vector<std::string>& paths,
+                                                         bool follow_links = false) const;
+
+    // Contents of several directories over one sync session
+    std::optional<std::vector<std::vector<adb::DirEntry>>> list_directories(
+        const std::string& serial, const std::vector<std::string>& dirs) const;
+
+    // Features, SDK level and toybox applets of the device, probed once per
+    // connection (nullptr if unreachable). Dropped when list_devices() sees
+    // the device gone or on a new transport, and on reboot().
+    std::shared_ptr<const adb::DeviceCapabilities> capabilities(const std::string& serial) const
+    {
+        return capability_cache.get(serial);
+    }
+    void invalidate_capabilities(const std::string& serial) const { capability_cache.invalidate(serial); }
+
     // Get device property
     std::optional<std::string> get_property(const std::string& serial, const std::string& property) const;
 
-    // Push file to device (for future use)
-    bool push_file(const std::string& serial, const std::string& local_path, const std::string& remote_path) const;
+    // Push file to device (native sync SEND/SND2; the adb binary if the server is unreachable)
+    // `mode` sets the device copy's permission bits (the adb binary keeps the local ones)
+    bool push_file(const std::string& serial, const std::string& local_path, const std::string& remote_path,
+                   adb::TransferStats* stats = nullptr, uint32_t mode = 0644) const;
+
+    // Pull file from device (native sync RECV/RCV2; the adb binary if the server is unreachable)
+    // `stats` receives size, compression ratio, throughput and time to first byte
+    bool pull_file(const std::string& serial, const std::string& remote_path, const std::string& local_path,
+                   adb::TransferStats* stats = nullptr) const;
+
+    // Compress pull_file/push_file/pull_stream payload when the device offers
+    // a sync v2 codec this build has (on by default)
+    void set_transfer_compression(bool enabled) { compress_transfers = enabled; }
+
+    // Stream a device file into `on_chunk` as it arrives (native sync only)
+    std::optional<adb::TransferStats> pull_stream(const std::string& serial, const std::string& remote_path,
+                                                  const ChunkCallback& on_chunk) const;
 
-    // Pull file from device
-    bool pull_file(const std::string& serial, const std::string& remote_path, const std::string& local_path) const;
+    // Pull several files with their requests pipelined on one sync session;
+    // each file is streamed to on_data(index, chunk) as it lands and the
+    // manifest lists per-file sizes and timings (nullopt: no sync session)
+    std::optional<adb::BundleManifest> pull_bundle(const std::string& serial,
+                                                   const std::vector<std::string>& remote_paths,
+                                                   const adb::SyncClient::BundleCallback& on_data) const;
 
     // Reboot device (normal/bootloader/recovery)
     bool reboot(const std::string& serial, const std::string& mode = "device") const;
@@ -56,16 +151,47 @@ public:
     // Check if device is in fastboot mode
     bool is_fastboot_available() const;
 
-    // Execute fastboot command
-    std::string fastboot_command(const std::string& command) const;
+    // Execute fastboot command (empty serial = only device)
+    // fastboot reports on stderr, so both streams are captured
+    std::string fastboot_command(const std::string& command, const std::string& serial = "") const;
 
 private:
     std::string adb_path;
+
+    // What each connected device supports; picks the mechanism for every
+    // operation (shell v2, stat/ls v2, sync codec, gzip'd shell output)
+    mutable adb::CapabilityCache capability_cache;
+    bool compress_transfers = true;
+    // Which shell commands go through gzip
+    mutable adb::ShellCompressionPolicy shell_compression;
     
     // Execute command and return output
     std::optional<std::string> execute_command(const std::string& command) const;
 
-    // Parse "adb devices" output
+    // Execute command, streaming stdout in chunks; false on failure
+    bool execute_command_stream(const std::string& command, const ChunkCallback& on_chunk) const;
+
+    // Give a transfer client the device's negotiated codec, and remember the
+    // codec as unusable if the client had to drop it
+    void apply_transfer_codec(const std::string& serial, adb::SyncClient& client) const;
+    void note_transfer_codec(const std::string& serial, const adb::SyncClient& client) const;
+
+    // Run `command` through the device's gzip, inflating into `on_chunk`;
+    // nullopt if the device cannot (the caller runs it plain), else whether
+    // it succeeded as shell_command_chunks() reports it
+    std::optional<bool> shell_command_gzip(const std::string& serial, const std::string& command,
+                                           const std::string& command_class, const ChunkCallback& on_chunk) const;
+
+    // Run `command` through abb_exec if it translates to a binder service
+    // call; nullopt if it does not or the device cannot (the caller uses
+    // the shell), else whether the output arrived completely
+    std::optional<bool> shell_command_abb(const std::string& serial, const std::string& command,
+                                          const std::string& command_class, const ChunkCallback& on_chunk) const;
+
+    // Build the "adb -s <serial> shell ..." command line
+    std::string build_shell_command(const std::string& serial, const std::string& command) const;
+
+    // Parse "adb devices [-l]" output
     std::vector<AdbDevice> parse_devices_output(const std::string& output) const;
 
     // Try to find adb in common locations
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <utility>
+#include <cstdint>
+#include "agent/protocol.hpp"
+
+class AdbAbstraction;
+
+namespace agent {
+
+/**
+ * One batch of agent requests; each call returns the index of its reply
+ */
+class AgentQuery {
+public:
+    size_t property(std::string_view name);
+    size_t all_properties();
+    size_t stat(std::string_view path, bool follow_links = false);
+    size_t read_file(std::string_view path, uint64_t max_bytes = 1024 * 1024);
+    size_t processes();
+    size_t system_info();
+    size_t which(std::string_view program);
+    size_t mounts();
+    size_t list(std::string_view path);
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    // Request frames followed by END
+    std::string encoded() const;
+
+private:
+    std::string frames_;
+    size_t count_ = 0;
+
+    // Append one request frame; `arguments` writes what follows the op
+    template <class Arguments>
+    size_t add(Op op, Arguments&& arguments);
+};
+
+/**
+ * Replies to one AgentQuery, in request order
+ * Typed accessors return nullopt for a failed request (see error()) or a
+ * reply of the wrong shape.
+ */
+class AgentResults {
+public:
+    struct Reply {
+        Status status = Status::ERROR;
+        int error = 0;          // errno on the device for Status::ERROR
+        std::string payload;    // result bytes after the status
+    };
+
+    explicit AgentResults(std::vector<Reply> replies) : replies_(std::move(replies)) {}
+
+    size_t size() const { return replies_.size(); }
+    Status status(size_t index) const { return replies_[index].status; }
+    bool ok(size_t index) const { return replies_[index].status == Status::OK; }
+    int error(size_t index) const { return replies_[index].error; }
+
+    std::optional<std::string> text(size_t index) const;      // property, read_file, which
+    std::optional<std::vector<std::pair<std::string, std::string>>> properties(size_t index) const;
+    std::optional<FileInfo> stat(size_t index) const;
+    std::optional<std::vector<ProcessEntry>> processes(size_t index) const;
+    std::optional<SystemInfo> system_info(size_t index) const;
+    std::optional<std::vector<MountEntry>> mounts(size_t index) const;
+    std::optional<std::vector<std::string>> names(size_t index) const;     // list
+
+private:
+    std::vector<Reply> replies_;
+};
+
+/**
+ * Runs the query agent on a device
+ * deploy() pushes the static helper built for the device's ABI to
+ * /data/local/tmp; run() starts it over "exec:" (raw stdin/stdout, no
+ * PTY) and answers a whole batch in one round trip, with the parsing of
+ * /proc and properties done on the device.
+ */
+class AgentClient {
+public:
+    static constexpr const char* REMOTE_PATH = "/data/local/tmp/lincheckroot-agent";
+    static constexpr const char* BINARY_NAME = "lincheckroot-agent";
+
+    AgentClient(const AdbAbstraction& adb, const std::string& serial);
+
+    // "<dir>/lincheckroot-agent-<abi>" (abi as in ro.product.cpu.abi)
+    static std::string binary_for_abi(const std::string& dir, const std::string& abi);
+
+    // Push `local_binary` unless the device copy already matches its size
+    // and mtime; false if the push failed
+    bool deploy(const std::string& local_binary);
+
+    // Run one batch; nullopt if the agent could not be started (not
+    // deployed, wrong ABI, noexec /data), the session broke, or a reply
+    // carried a status this client does not know
+    std::optional<AgentResults> run(const AgentQuery& query, int timeout_ms = 10000);
+
+    const std::string& last_error() const { return last_error_; }
+
+private:
+    const AdbAbstraction& adb_;
+    std::string serial_;
+    std::string last_error_;
+};
+
+} // namespace agent
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include "report/binary_codec.hpp"
+
+namespace agent {
+
+/**
+ * Wire protocol of the on-device query agent
+ * Both directions are a stream of frames: <4 byte little-endian length>
+ * <payload>, payloads encoded with report::BinaryWriter. The agent opens
+ * with a hello frame (magic, version), then answers each request frame
+ * with exactly one reply frame, in order, until an END request or EOF.
+ * Requests are <u8 op><arguments>; replies are <u8 status><result>.
+ * Everything the agent does is read-only.
+ */
+constexpr std::string_view MAGIC = "LCRA";
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t MAX_FRAME = 64 * 1024 * 1024;
+
+enum class Op : uint8_t {
+    END = 0,            // no reply; the agent exits
+    PROPERTY = 1,       // str name -> str value ("" if unset)
+    PROPERTIES = 2,     // -> varint count, (str name, str value)*
+    STAT = 3,           // str path, bool follow_links -> FileInfo
+    READ = 4,           // str path, varint max_bytes -> str contents
+    PROCESSES = 5,      // -> varint count, ProcessEntry*
+    SYSTEM = 6,         // -> SystemInfo
+    WHICH = 7,          // str program -> str path of the first executable match on PATH
+    MOUNTS = 8,         // -> varint count, MountEntry*
+    LIST = 9,           // str path -> varint count, str name* ("." and ".." omitted)
+};
+
+enum class Status : uint8_t {
+    OK = 0,
+    ERROR = 1,          // svarint errno follows
+    UNKNOWN_OP = 2,     // agent older than the client
+};
+
+struct FileInfo {
+    uint32_t mode = 0;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint32_t uid = 0;
+    uint32_t gid = 0;
+};
+
+struct ProcessEntry {
+    int pid = 0;
+    uint32_t uid = 0;
+    std::string name;       // argv[0], or comm for kernel threads
+};
+
+struct SystemInfo {
+    int cpu_cores = 0;
+    uint64_t mem_total_kb = 0;
+    uint64_t mem_available_kb = 0;
+    uint64_t data_total_bytes = 0;      // statvfs("/data")
+    uint64_t data_free_bytes = 0;
+};
+
+struct MountEntry {
+    std::string source;
+    std::string target;
+    std::string type;
+    std::string options;
+};
+
+// Frames are written with BinaryWriter::begin_length()/end_length()
+// Payload length of the frame at the front of `data`, nullopt until all of it is there
+std::optional<size_t> frame_length(std::string_view data);
+
+void encode_hello(report::BinaryWriter& writer);
+bool decode_hello(report::BinaryReader& reader);
+
+void encode(report::BinaryWriter& writer, const FileInfo& info);
+void encode(report::BinaryWriter& writer, const ProcessEntry& entry);
+void encode(report::BinaryWriter& writer, const SystemInfo& info);
+void encode(report::BinaryWriter& writer, const MountEntry& entry);
+
+// Each leaves reader.ok() false on malformed input
+FileInfo decode_file_info(report::BinaryReader& reader);
+ProcessEntry decode_process(report::BinaryReader& reader);
+SystemInfo decode_system_info(report::BinaryReader& reader);
+MountEntry decode_mount(report::BinaryReader& reader);
+
+} // namespace agent
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include "adb/shell_session.hpp"
+
+namespace analyzer {
+
+/**
+ * One process in the hotspot list
+ */
+struct ProcessHotspot {
+    int pid = 0;
+    int ppid = 0;
+    char state = '?';
+    std::string name;
+    double cpu_percent = 0;     // 100 = one full core, like top
+    uint64_t rss_kb = 0;
+    int64_t rss_delta_kb = 0;   // change since the previous tick
+    uint64_t threads = 0;
+};
+
+/**
+ * Per-process hotspot sampler (read-only)
+ * Each refresh() reads every /proc/<pid>/stat in one bulk round trip over
+ * a persistent shell and updates a per-PID table in place; CPU% and RSS
+ * deltas come from the previous tick and the top N by CPU are kept with
+ * a bounded heap. Used to spot runaway system services.
+ */
+class ProcessHotspotAnalyzer {
+public:
+    ProcessHotspotAnalyzer(const std::string& adb_path, const std::string& serial, size_t top_n = 15);
+
+    // Take one sample; false if the device did not answer
+    bool refresh();
+
+    // Top N by CPU% from the last refresh (empty after the first one: no deltas yet)
+    const std::vector<ProcessHotspot>& get_hotspots() const { return hotspots_; }
+
+    size_t process_count() const { return table_.size(); }
+    std::chrono::milliseconds last_sample_time() const { return last_sample_time_; }
+
+    // Parse one line of the bulk capture ("cpu ..." from /proc/stat or a /proc/<pid>/stat line)
+    void parse_line(std::string_view line);
+
+    // Finish a tick: drop vanished PIDs, compute deltas and rebuild the top N;
+    // later parse_line() calls start the next tick
+    void finish_tick();
+
+    static std::string format_hotspots(const std::vector<ProcessHotspot>& hotspots);
+
+private:
+    struct Entry {
+        uint64_t start_time = 0;    // tells a reused PID from the old process
+        uint64_t cpu_ticks = 0;     // utime + stime
+        uint64_t prev_cpu_ticks = 0;
+        uint64_t rss_pages = 0;
+        uint64_t prev_rss_pages = 0;
+        uint64_t threads = 0;
+        uint32_t seen_tick = 0;
+        uint32_t first_tick = 0;
+        int ppid = 0;
+        char state = '?';
+        uint8_t name_length = 0;
+        char name[16] = {};         // TASK_COMM_LEN, so no allocation per process
+    };
+
+    adb::ShellSession session_;
+    size_t top_n_;
+    uint32_t tick_ = 1;
+    uint64_t page_kb_ = 4;
+
+    std::unordered_map<int, Entry> table_;
+    uint64_t total_ticks_ = 0;
+    uint64_t prev_total_ticks_ = 0;
+    unsigned cpu_count_ = 0;
+    unsigned cpu_lines_ = 0;
+
+    std::vector<std::pair<double, int>> heap_;  // (cpu%, pid), min-heap of size top_n
+    std::vector<ProcessHotspot> hotspots_;
+    std::chrono::milliseconds last_sample_time_{0};
+};
+
+} // namespace analyzer
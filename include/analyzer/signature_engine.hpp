@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include "adb_abstraction.h"
+#include "agent/agent_client.hpp"
+#include "parse/aho_corasick.hpp"
+
+namespace analyzer {
+
+/**
+ * One root/hooking framework and the strings that give it away
+ */
+struct Signature {
+    std::string id;             // "kernelsu"
+    std::string name;           // "KernelSU"
+    std::string category;       // "root", "hooking", "hiding"
+    std::vector<std::string> patterns;
+};
+
+/**
+ * A signature seen on the device, with the patterns that matched
+ */
+struct SignatureMatch {
+    std::string id;
+    std::string name;
+    std::string category;
+    std::vector<std::string> evidence;
+};
+
+/**
+ * Root/hooking signature engine (read-only)
+ * Signatures come from a JSON data file and are compiled into one
+ * Aho-Corasick automaton. A single shell round trip captures the listed
+ * paths and directories, /proc/mounts and "ps -A"; the capture is then
+ * matched in one linear pass, however many signatures the file holds.
+ */
+class SignatureEngine {
+public:
+    SignatureEngine();
+
+    // Data file format:
+    // {
+    //   "probe_paths": ["/data/adb/ksu", ...],      // reported if they exist (ls -d)
+    //   "list_dirs":   ["/data/adb/modules", ...],  // contents listed (ls -a)
+    //   "signatures": [
+    //     { "id": "kernelsu", "name": "KernelSU", "category": "root",
+    //       "patterns": ["/data/adb/ksu", "me.weishu.kernelsu"] },
+    //     ...
+    //   ]
+    // }
+    // Patterns are matched anywhere in the capture, so they should be paths,
+    // package names or other strings that cannot occur by accident; a bare
+    // short word like "ksud" would also match unrelated process names.
+    bool load_file(const std::string& path);
+    bool load_json(const std::string& json_content);
+
+    bool is_loaded() const { return !signatures_.empty(); }
+    size_t signature_count() const { return signatures_.size(); }
+    const std::vector<Signature>& signatures() const { return signatures_; }
+
+    // The one shell command whose output is matched
+    std::string capture_command() const;
+
+    // Match an already captured text
+    std::vector<SignatureMatch> match(std::string_view capture) const;
+
+    // Capture on the device and match
+    std::vector<SignatureMatch> scan(const AdbAbstraction& adb, const std::string& serial) const;
+
+    // The same capture read by the on-device agent, as part of a larger
+    // query: add_capture() appends its requests, capture_from() turns the
+    // replies into text shaped like capture_command()'s output (nullopt if
+    // the agent predates one of the requests)
+    struct AgentCapture {
+        size_t first = 0;       // index of the first request added
+    };
+    AgentCapture add_capture(agent::AgentQuery& query) const;
+    std::optional<std::string> capture_from(const agent::AgentResults& results,
+                                            const AgentCapture& capture) const;
+
+private:
+    std::vector<Signature> signatures_;
+    std::vector<std::string> probe_paths_;
+    std::vector<std::string> list_dirs_;
+
+    parse::AhoCorasick automaton_;
+    std::vector<std::pair<uint32_t, uint32_t>> pattern_owner_;  // pattern id -> (signature, pattern index)
+};
+
+} // namespace analyzer
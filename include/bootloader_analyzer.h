@@ -2,8 +2,13 @@
 #define BOOTLOADER_ANALYZER_H
 
 #include "adb_abstraction.h"
+#include "fastboot/fastboot_client.hpp"
+#include "device/property_snapshot.hpp"
 #include <string>
 #include <optional>
+#include <vector>
+#include <map>
+#include <cstdint>
 
 enum class BootloaderStatus {
     LOCKED,
@@ -12,29 +17,69 @@ enum class BootloaderStatus {
     UNKNOWN
 };
 
+// How much the reported status can be trusted
+enum class LockConfidence {
+    HIGH,           // fastboot, or several boot properties agree
+    MEDIUM,         // one authoritative boot property
+    LOW,            // only indirect hints (warranty bit, vendor props)
+    NONE            // no evidence / evidence contradicts itself
+};
+
 // Bootloader information
 struct BootloaderInfo {
     BootloaderStatus status;
     std::string status_string;
     bool fastboot_available;
     std::string fastboot_path;
+
+    // Filled from a single fastboot "getvar all" when the device is in bootloader mode
+    bool from_fastboot = false;
+    bool secure = false;
+    bool is_userspace = false;          // fastbootd rather than the bootloader
+    int slot_count = 0;
+    std::string current_slot;
+    std::string product;
+    std::string serialno;
+    std::string bootloader_version;
+    std::string baseband_version;
+    std::map<std::string, std::string> variables;  // every reported variable
+
+    // Inference from the running system's boot properties
+    bool from_properties = false;
+    LockConfidence confidence = LockConfidence::NONE;
+    std::vector<std::string> evidence;  // "ro.boot.flash.locked=1 (locked)", ...
+    bool needs_fastboot_check = false;  // ambiguous; only fastboot can settle it
 };
 
 // Bootloader Analyzer
 // Detects bootloader lock status with clear warnings
 class BootloaderAnalyzer {
 public:
-    explicit BootloaderAnalyzer(const AdbAbstraction& adb);
+    // `properties` is the shared snapshot cache; without one a private getprop is used
+    explicit BootloaderAnalyzer(const AdbAbstraction& adb, device::PropertyCache* properties = nullptr);
 
     // Analyze bootloader status
-    // Note: May require device reboot to bootloader mode
+    // Infers the lock state from boot properties first (milliseconds, no reboot);
+    // fastboot is consulted only if that is ambiguous and the device is already there
     std::optional<BootloaderInfo> analyze(const std::string& serial) const;
 
-    // Get bootloader status from fastboot
-    BootloaderStatus get_status_via_fastboot() const;
+    // Lock state from boot properties alone
+    BootloaderInfo infer_from_properties(const device::PropertySnapshot& props) const;
+
+    // Get bootloader status from fastboot (empty serial = only device)
+    BootloaderStatus get_status_via_fastboot(const std::string& serial = "") const;
+
+    // Query every variable with one "fastboot getvar all" run
+    // Returns nullopt if the device did not answer
+    std::optional<BootloaderInfo> analyze_via_fastboot(const std::string& serial = "") const;
+
+    // Same query over the native fastboot TCP protocol (network fastboot)
+    std::optional<BootloaderInfo> analyze_via_fastboot_tcp(const std::string& host,
+                                                           uint16_t port = 5554) const;
 
     // Get friendly status string
     std::string status_to_string(BootloaderStatus status) const;
+    std::string confidence_to_string(LockConfidence confidence) const;
 
     // Get warning about data loss
     std::string get_data_loss_warning() const;
@@ -44,9 +89,17 @@ public:
 
 private:
     const AdbAbstraction& adb;
+    device::PropertyCache* properties;
 
     // Check common fastboot locations
     std::string locate_fastboot() const;
+
+    // Fill structured fields from getvar results in one pass
+    void apply_fastboot_variables(BootloaderInfo& info,
+                                  const std::vector<fastboot::Variable>& vars) const;
+
+    // True if serial is listed by "fastboot devices"
+    bool is_in_fastboot(const std::string& serial) const;
 };
 
 #endif // BOOTLOADER_ANALYZER_H
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include "adb_abstraction.h"
+
+namespace device {
+
+/**
+ * Mode a device is currently in, across adb and fastboot transports
+ */
+enum class DeviceMode {
+    SYSTEM,         // adb "device"
+    RECOVERY,       // adb "recovery"
+    SIDELOAD,       // adb "sideload"
+    RESCUE,         // adb "rescue"
+    BOOTLOADER,     // fastboot (bootloader)
+    FASTBOOTD,      // fastboot (userspace fastbootd)
+    UNAUTHORIZED,   // adb "unauthorized" / "authorizing"
+    OFFLINE,        // adb "offline"
+    NO_PERMISSIONS, // adb "no permissions" (udev rules)
+    DISCONNECTED,   // not visible on any transport
+    UNKNOWN
+};
+
+/**
+ * One row of the unified device table
+ */
+struct DiscoveredDevice {
+    std::string serial;
+    DeviceMode mode = DeviceMode::UNKNOWN;
+    std::string transport;      // "adb" or "fastboot"
+    std::string state_string;   // raw state reported by the tool
+    std::string usb;
+    std::string product;
+    std::string model;
+    std::string device;
+    int transport_id = -1;
+
+    // True if adb shell commands can run against it right now
+    bool is_adb_ready() const { return mode == DeviceMode::SYSTEM || mode == DeviceMode::RECOVERY; }
+};
+
+using DeviceTable = std::map<std::string, DiscoveredDevice>;
+
+/**
+ * Unified device discovery
+ * Queries "adb devices -l" and "fastboot devices -l" in parallel, merges
+ * them into one table keyed by serial and caches the result so the GUI
+ * and headless mode read the same snapshot without re-running the tools.
+ */
+class DeviceDiscovery {
+public:
+    explicit DeviceDiscovery(const AdbAbstraction& adb);
+
+    // One parallel round over all transports; replaces the cached table
+    DeviceTable scan();
+
+    // Cached table if younger than max_age, otherwise a fresh scan
+    DeviceTable get(std::chrono::milliseconds max_age);
+
+    // Cached table only (never runs the tools)
+    DeviceTable devices() const;
+    std::optional<DiscoveredDevice> find(const std::string& serial) const;
+
+    // Drop the cached table (e.g. after a reboot was issued)
+    void invalidate();
+
+    bool has_scanned() const;
+
+    static std::string mode_to_string(DeviceMode mode);
+
+    // Parsers, exposed for reuse
+    static DeviceMode mode_from_adb_state(const std::string& state);
+    static std::vector<DiscoveredDevice> parse_fastboot_devices(std::string_view output);
+
+private:
+    const AdbAbstraction& adb_;
+
+    mutable std::mutex mutex_;
+    DeviceTable cache_;
+    std::chrono::steady_clock::time_point last_scan_;
+    bool scanned_ = false;
+};
+
+} // namespace device
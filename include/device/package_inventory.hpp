@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <optional>
+#include <chrono>
+#include <cstdint>
+#include "adb_abstraction.h"
+
+namespace device {
+
+/**
+ * One installed package (views into the inventory's storage)
+ */
+struct PackageRecord {
+    std::string_view name;
+    std::string_view path;      // base APK, empty if pm did not report it
+    int uid = -1;
+    long long version_code = -1;
+};
+
+/**
+ * Installed package inventory
+ * Built from a single "pm list packages -f -U --show-versioncode" and
+ * queried in O(1) afterwards. Strings live in one arena and the index
+ * maps name views to compact records, so thousands of packages cost a
+ * couple of allocations. Not copyable: records point into the arena.
+ */
+class PackageInventory {
+public:
+    PackageInventory() = default;
+    PackageInventory(const PackageInventory&) = delete;
+    PackageInventory& operator=(const PackageInventory&) = delete;
+
+    // One pm round trip; flags follow the device's SDK level, and a pm that
+    // rejects --show-versioncode / -U anyway is retried with fewer
+    bool load(const AdbAbstraction& adb, const std::string& serial);
+
+    // Build from captured pm output (one "package:..." line per package)
+    void parse(std::string_view output);
+
+    bool contains(std::string_view name) const { return index_.count(name) != 0; }
+    std::optional<PackageRecord> find(std::string_view name) const;
+
+    // First of `names` that is installed
+    std::optional<PackageRecord> find_any(std::initializer_list<std::string_view> names) const;
+
+    // Case-insensitive substring search over names (linear; for "grep -i" style checks)
+    std::vector<PackageRecord> search(std::string_view needle) const;
+
+    size_t size() const { return records_.size(); }
+    bool empty() const { return records_.empty(); }
+    std::chrono::steady_clock::time_point loaded_at() const { return loaded_at_; }
+
+    // Parse one "package:<path>=<name> versionCode:<n> uid:<n>" line
+    static bool parse_line(std::string_view line, PackageRecord& record);
+
+private:
+    struct Record {
+        uint32_t name_offset;
+        uint32_t path_offset;
+        uint16_t name_length;
+        uint16_t path_length;
+        int32_t uid;
+        long long version_code;
+    };
+
+    std::string arena_;
+    std::vector<Record> records_;
+    std::unordered_map<std::string_view, uint32_t> index_;
+    std::chrono::steady_clock::time_point loaded_at_{};
+
+    PackageRecord view(const Record& record) const;
+    void build_index();
+};
+
+} // namespace device
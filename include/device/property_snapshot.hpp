@@ -0,0 +1,157 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <optional>
+#include "adb_abstraction.h"
+#include "device/string_pool.hpp"
+
+namespace device {
+
+/**
+ * Every system property of one device, read with a single "getprop"
+ * Stored as a flat array of (key id, value id) pairs sorted by key id,
+ * with the strings themselves in a StringPool that snapshots of a fleet
+ * share (a snapshot built without one gets a private pool). A snapshot
+ * costs 8 bytes per property; two snapshots from the same pool compare by
+ * id without touching any string.
+ */
+class PropertySnapshot {
+public:
+    struct Entry {
+        uint32_t key;
+        uint32_t value;
+    };
+
+    explicit PropertySnapshot(std::shared_ptr<StringPool> pool = std::make_shared<StringPool>())
+        : pool_(std::move(pool)) {}
+
+    // Copy of `other` with its strings interned into `pool`
+    PropertySnapshot(const PropertySnapshot& other, std::shared_ptr<StringPool> pool);
+
+    enum class LoadResult {
+        LOADED,
+        UNCHANGED,      // the device's dump still hashes to `known_hash`; nothing was read
+        FAILED          // the device returned nothing
+    };
+
+    // One round trip; false if the device returned nothing
+    bool load(const AdbAbstraction& adb, const std::string& serial);
+
+    // One round trip that first hashes the dump on the device (md5sum) and
+    // only transfers and parses it if the hash differs from `known_hash`.
+    // On UNCHANGED this snapshot is left as it was.
+    LoadResult load_if_changed(const AdbAbstraction& adb, const std::string& serial,
+                               const std::string& known_hash);
+
+    // Build from captured "getprop" output ("[key]: [value]" per line)
+    void parse(std::string_view output);
+
+    // Same contract as AdbAbstraction::get_property: nullopt if unset or empty
+    std::optional<std::string> get(const std::string& key) const;
+    std::string get_or(const std::string& key, const std::string& fallback) const;
+    bool has(const std::string& key) const;
+
+    // Raw value view (valid as long as the pool), empty if unset
+    std::string_view view(std::string_view key) const;
+
+    const std::vector<Entry>& entries() const { return entries_; }
+    const StringPool& pool() const { return *pool_; }
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    std::chrono::steady_clock::time_point loaded_at() const { return loaded_at_; }
+
+    // md5 of the getprop output this snapshot was parsed from, as the
+    // device reported it; empty if unknown (no md5sum, or built by parse())
+    const std::string& content_hash() const { return content_hash_; }
+
+    // Bytes owned by this snapshot (the pool is not counted)
+    size_t memory_bytes() const { return sizeof(*this) + entries_.capacity() * sizeof(Entry); }
+
+private:
+    std::shared_ptr<StringPool> pool_;
+    std::vector<Entry> entries_;
+    std::chrono::steady_clock::time_point loaded_at_{};
+    std::string content_hash_;
+
+    void add_line(std::string_view line);
+
+    // Sort by key id; for duplicate keys the last line wins, like getprop
+    void finish();
+    void sort_entries();
+
+    const Entry* find(std::string_view key) const;
+};
+
+/**
+ * Per-device property snapshots shared by the inspector and analyzers,
+ * so one refresh costs one getprop per device instead of one per property.
+ * A refresh sends the cached snapshot's hash along; while the device's
+ * dump still matches it, the device answers with the hash alone and the
+ * same snapshot is kept.
+ * All snapshots of one cache share a pool. Values that change on every
+ * refresh (uptimes, counters) would grow it forever, so once it has
+ * doubled since the last rebuild the cached snapshots are re-interned into
+ * a new pool; the old one is freed with the last snapshot still using it.
+ */
+class PropertyCache {
+public:
+    struct Stats {
+        uint64_t loads = 0;         // dumps transferred and parsed
+        uint64_t unchanged = 0;     // refreshes answered by the hash alone
+        uint64_t compactions = 0;   // pool rebuilds
+        size_t pool_strings = 0;    // strings in the current pool
+    };
+
+    explicit PropertyCache(const AdbAbstraction& adb);
+
+    // Cached snapshot if checked within max_age, otherwise a fresh (or
+    // re-confirmed) one
+    std::shared_ptr<const PropertySnapshot> get(const std::string& serial,
+                                                std::chrono::milliseconds max_age = std::chrono::seconds(5));
+
+    // Cache a snapshot parsed from getprop output captured elsewhere
+    // (a bundle pull, a recorded session)
+    std::shared_ptr<const PropertySnapshot> put(const std::string& serial, std::string_view getprop_output);
+
+    // Force the next get() to check the device (keeps the snapshot and its
+    // hash, so an unchanged device still answers with the hash alone)
+    void invalidate(const std::string& serial);
+    void clear();
+
+    // Move every cached snapshot to a new pool holding only their strings
+    void compact();
+
+    Stats stats() const;
+
+    // Current pool plus the cached snapshots, in bytes
+    size_t memory_bytes() const;
+
+private:
+    // Rebuilds start once the pool holds this many strings
+    static constexpr size_t COMPACT_MIN_STRINGS = 16 * 1024;
+
+    struct Cached {
+        std::shared_ptr<const PropertySnapshot> snapshot;
+        std::chrono::steady_clock::time_point checked_at;
+    };
+
+    const AdbAbstraction& adb_;
+    mutable std::mutex mutex_;
+    std::map<std::string, Cached> snapshots_;
+    std::shared_ptr<StringPool> pool_;
+    size_t compacted_size_ = 0;     // pool size right after the last rebuild
+    Stats stats_;
+
+    // Store `snapshot` and rebuild the pool if it has doubled (caller holds mutex_)
+    void store_locked(const std::string& serial, std::shared_ptr<const PropertySnapshot> snapshot);
+    void compact_locked();
+};
+
+} // namespace device
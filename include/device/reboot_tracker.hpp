@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "device/discovery.hpp"
+
+namespace device {
+
+/**
+ * Time spent in one mode while a reboot was tracked
+ */
+struct RebootPhase {
+    DeviceMode mode;
+    std::chrono::milliseconds duration;
+};
+
+/**
+ * Outcome of a tracked reboot
+ */
+struct RebootResult {
+    bool reached = false;                       // target mode observed in time
+    // The target is invisible to adb and fastboot (Samsung Download Mode):
+    // the device left adb, which a reboot to any mode also does
+    bool unconfirmed = false;
+    bool timed_out = false;
+    DeviceMode target = DeviceMode::UNKNOWN;
+    DeviceMode final_mode = DeviceMode::UNKNOWN;
+    std::vector<RebootPhase> phases;            // in the order observed
+    std::chrono::milliseconds total{0};
+    std::string error;                          // empty unless tracking failed
+};
+
+/**
+ * Event-driven reboot tracking
+ * Follows a device through its transitions (device -> offline -> gone ->
+ * bootloader/recovery/device) using the adb server's track-devices stream.
+ * Fastboot has no equivalent stream, so it is polled only while the
+ * device is absent from adb. Without an adb server connection the tracker
+ * falls back to polling both tools.
+ */
+class RebootTracker {
+public:
+    explicit RebootTracker(const std::string& adb_path = "");
+
+    /**
+     * Start watching `serial`. Call this BEFORE issuing the reboot: the
+     * subscription and the starting mode are captured before returning.
+     * The future resolves once `target` is reached (after the device has
+     * left its starting mode), when `timeout` expires or on cancel(). A
+     * DISCONNECTED target is never reached: the future resolves as
+     * unconfirmed once the device has gone.
+     * Dropping the future does not block.
+     */
+    std::future<RebootResult> track(const std::string& serial, DeviceMode target,
+                                    std::chrono::milliseconds timeout);
+
+    // Stop every watch started by this tracker (e.g. the reboot was rejected)
+    void cancel();
+
+    // Mode a reboot type ("system", "bootloader", "recovery", "download", "sideload") ends in
+    static DeviceMode target_for_reboot_type(const std::string& type);
+
+    // Mode of `serial` in one track-devices message (DISCONNECTED if absent)
+    static DeviceMode mode_in_device_list(const std::string& list, const std::string& serial);
+
+private:
+    std::string adb_path_;
+
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<std::atomic<bool>>> cancel_flags_;
+};
+
+} // namespace device
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <cstdint>
+
+namespace device {
+
+/**
+ * Append-only string intern pool
+ * Each distinct string is stored once in large arena blocks and named by a
+ * dense 32-bit id. Views returned by view() stay valid for the pool's
+ * lifetime, so callers can hold them without copying. Property keys and
+ * most values (vendor names, build hosts, locale props) repeat on every
+ * device, so a fleet of snapshots shares one copy of each.
+ * Nothing is ever removed: snapshots own their pool through a shared_ptr,
+ * and PropertyCache moves its snapshots to a fresh pool once churn has
+ * grown the old one (see PropertyCache::compact()).
+ * Thread-safe: lookups take a shared lock, inserts an exclusive one.
+ */
+class StringPool {
+public:
+    StringPool();
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    // Id of `value`, adding it if new; id 0 is always the empty string
+    uint32_t intern(std::string_view value);
+
+    // Id of `value` if it was interned before (never adds)
+    std::optional<uint32_t> find(std::string_view value) const;
+
+    // Contents of an id from this pool
+    std::string_view view(uint32_t id) const;
+
+    size_t size() const;
+
+    // Arena, index and id table, in bytes
+    size_t memory_bytes() const;
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* current_block_ = nullptr;     // shared block being filled
+    size_t block_used_ = BLOCK_SIZE;
+    size_t arena_bytes_ = 0;
+
+    std::vector<std::string_view> strings_;
+    std::unordered_map<std::string_view, uint32_t> index_;
+
+    mutable std::shared_mutex mutex_;
+
+    // Copy into the arena (caller holds the exclusive lock)
+    std::string_view store(std::string_view value);
+};
+
+} // namespace device
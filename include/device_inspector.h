@@ -2,7 +2,9 @@
 #define DEVICE_INSPECTOR_H
 
 #include "adb_abstraction.h"
+#include "device/property_snapshot.hpp"
 #include <string>
+#include <string_view>
 #include <map>
 #include <optional>
 
@@ -44,7 +46,13 @@ struct DeviceInfo {
 // Extracts comprehensive hardware and software information
 class DeviceInspector {
 public:
-    explicit DeviceInspector(const AdbAbstraction& adb);
+    // `properties` is the shared snapshot cache; without one a private getprop is used
+    explicit DeviceInspector(const AdbAbstraction& adb, device::PropertyCache* properties = nullptr);
+
+    // Directory with lincheckroot-agent-<abi> builds; when set, inspect()
+    // reads CPU, RAM and storage figures through the on-device agent in one
+    // round trip (falling back to /proc pulls and df if it cannot run)
+    void set_agent_dir(const std::string& dir) { agent_dir = dir; }
 
     // Inspect device and return full info
     // Returns nullopt if device is not accessible
@@ -67,9 +75,14 @@ public:
 
 private:
     const AdbAbstraction& adb;
+    device::PropertyCache* properties;
+    std::string agent_dir;
+
+    // Fill cores, RAM and storage from the agent; false if it could not run
+    bool inspect_with_agent(const std::string& serial, DeviceInfo& info) const;
 
-    // Helper: parse /proc/cpuinfo for core count
-    int parse_cpu_cores(const std::string& cpuinfo) const;
+    // Fill cores, RAM and storage from /proc and df
+    void inspect_hardware(const std::string& serial, DeviceInfo& info) const;
 
     // Helper: parse /proc/meminfo for RAM
     long long parse_ram_mb(const std::string& meminfo) const;
@@ -79,6 +92,9 @@ private:
 
     // Helper: get storage info from df
     void parse_storage_info(const std::string& df_output, long long& total_mb, long long& free_mb) const;
+
+    // Helper: parse a decimal field, 0 if malformed
+    long long parse_number(std::string_view text) const;
 };
 
 #endif // DEVICE_INSPECTOR_H
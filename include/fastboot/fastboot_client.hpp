@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <utility>
+#include <cstdint>
+
+namespace fastboot {
+
+/**
+ * One variable reported by "getvar:all"
+ * Partition-scoped variables keep their argument in the name
+ * (e.g. "partition-size:boot_a").
+ */
+struct Variable {
+    std::string name;
+    std::string value;
+};
+
+/**
+ * Native fastboot protocol client (read-only queries)
+ * TCP transport: "FB01" handshake followed by length-prefixed packets.
+ * Never sends flash/erase/oem commands.
+ */
+class FastbootClient {
+public:
+    static constexpr uint16_t DEFAULT_TCP_PORT = 5554;
+
+    FastbootClient() = default;
+    ~FastbootClient();
+
+    FastbootClient(const FastbootClient&) = delete;
+    FastbootClient& operator=(const FastbootClient&) = delete;
+
+    // Connect to a device in network fastboot (or a local fake server)
+    bool connect_tcp(const std::string& host, uint16_t port = DEFAULT_TCP_PORT,
+                     int timeout_ms = 3000);
+    void disconnect();
+    bool is_connected() const { return fd_ >= 0; }
+
+    // Single variable query ("getvar:<name>")
+    std::optional<std::string> getvar(const std::string& name);
+
+    // One "getvar:all" exchange; variables in the order the device sent them
+    std::optional<std::vector<Variable>> getvar_all();
+
+    // Last protocol or transport error
+    std::string last_error() const { return last_error_; }
+
+private:
+    int fd_ = -1;
+    int timeout_ms_ = 3000;
+    std::string last_error_;
+
+    // Run a command; INFO payloads go to on_info, OKAY payload is returned
+    std::optional<std::string> run_command(const std::string& command,
+                                           const std::function<void(std::string_view)>& on_info);
+
+    bool send_packet(std::string_view payload);
+    std::optional<std::string> read_packet();
+    bool write_all(const void* data, size_t size);
+    bool read_exact(void* data, size_t size);
+};
+
+/**
+ * Parse one getvar line into name/value
+ * Accepts the device form ("unlocked:yes", "partition-size:boot_a: 0x4000000")
+ * and the fastboot tool form ("(bootloader) unlocked: yes").
+ */
+std::optional<Variable> parse_variable_line(std::string_view line);
+
+// Parse the full text output of "fastboot getvar all" in one pass
+std::vector<Variable> parse_getvar_all_output(std::string_view output);
+
+} // namespace fastboot
@@ -8,6 +8,14 @@
 #include "bootloader_analyzer.h"
 #include "rom_compatibility.h"
 #include "config_manager.h"
+#include "device/discovery.hpp"
+#include "device/property_snapshot.hpp"
+#include "monitor/telemetry.hpp"
+#include "report/device_report.hpp"
+#include "report/history_store.hpp"
+#include "report/snapshot_diff.hpp"
+#include <map>
+#include <memory>
 
 // Application state
 struct AppState {
@@ -17,6 +25,10 @@ struct AppState {
     BootloaderAnalyzer* bootloader_analyzer;
     RomCompatibility* rom_compat;
     ConfigManager* config;
+    device::DeviceDiscovery* discovery;
+    device::PropertyCache* properties;
+    report::HistoryStore* history;
+    monitor::TelemetryMonitor* telemetry;
     
     GtkWidget* main_window;
     GtkWidget* device_list_combo;
@@ -26,8 +38,17 @@ struct AppState {
     GtkWidget* rom_compat_text;
     GtkWidget* adb_path_entry;
     GtkWidget* status_bar;
+    GtkWidget* telemetry_area;
+    GtkWidget* telemetry_button;
+    GtkWidget* telemetry_rate;
+    guint telemetry_timer;
+    GtkWidget* hotspot_text;
+    GtkWidget* hotspot_button;
+    guint hotspot_timer;
     
     std::string selected_device;
+    std::map<std::string, report::DeviceReport> reports;    // last refresh per device
+    std::map<std::string, std::shared_ptr<const device::PropertySnapshot>> last_properties;
 };
 
 // GUI initialization and callbacks
@@ -42,6 +63,9 @@ namespace GUI {
         void on_adb_path_changed(GtkEntry* entry, gpointer user_data);
         void on_refresh_info(GtkButton* button, gpointer user_data);
         void on_quit(GtkButton* button, gpointer user_data);
+        void on_toggle_telemetry(GtkButton* button, gpointer user_data);
+        void on_telemetry_rate_changed(GtkSpinButton* spin, gpointer user_data);
+        void on_toggle_hotspots(GtkButton* button, gpointer user_data);
     }
 }
 
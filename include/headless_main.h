@@ -0,0 +1,14 @@
+#ifndef HEADLESS_MAIN_H
+#define HEADLESS_MAIN_H
+
+// Command-line mode (no GTK window)
+// Used for bench automation and scripted fleet checks
+namespace Headless {
+    // True if the command line asks for a headless run
+    bool requested(int argc, char* argv[]);
+
+    // Run headless mode; returns the process exit code
+    int run(int argc, char* argv[]);
+}
+
+#endif // HEADLESS_MAIN_H
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace monitor {
+
+/**
+ * Fixed-capacity ring buffer
+ * Storage is allocated once in the constructor; push() overwrites the
+ * oldest element when full, so steady-state sampling never allocates.
+ * Index 0 is the oldest element, size() - 1 the newest.
+ */
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity = 0) : data_(capacity) {}
+
+    void push(const T& value) {
+        if (data_.empty()) return;
+        data_[head_] = value;
+        head_ = (head_ + 1) % data_.size();
+        if (size_ < data_.size()) ++size_;
+    }
+
+    const T& operator[](size_t index) const {
+        return data_[(head_ + data_.size() - size_ + index) % data_.size()];
+    }
+
+    const T& latest() const { return (*this)[size_ - 1]; }
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return data_.size(); }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == data_.size(); }
+
+    void clear() {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    // Copy oldest-to-newest into `out` (reuses its storage once it has grown to capacity)
+    void copy_to(std::vector<T>& out) const {
+        out.resize(size_);
+        for (size_t i = 0; i < size_; ++i) {
+            out[i] = (*this)[i];
+        }
+    }
+
+private:
+    std::vector<T> data_;
+    size_t head_ = 0;   // next write position
+    size_t size_ = 0;
+};
+
+} // namespace monitor
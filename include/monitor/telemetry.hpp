@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "adb/shell_session.hpp"
+#include "monitor/ring_buffer.hpp"
+
+namespace monitor {
+
+/**
+ * One telemetry sample (plain values only, so ring buffers of samples
+ * can be copied without touching the heap). Negative means "not available".
+ */
+struct TelemetrySample {
+    double time_s = 0;              // host time since monitoring started
+    float cpu_percent = -1;         // all cores, from /proc/stat deltas
+    float mem_used_percent = -1;    // (MemTotal - MemAvailable) / MemTotal
+    uint64_t mem_available_kb = 0;
+    float psi_cpu = -1;             // /proc/pressure/* "some avg10"
+    float psi_memory = -1;
+    float psi_io = -1;
+    float max_temp_c = -1;          // hottest plausible thermal zone
+    float avg_freq_mhz = -1;        // mean scaling_cur_freq over online cores
+    float max_freq_mhz = -1;
+};
+
+/**
+ * Samples one device over a persistent adb shell
+ * Every tick is a single round trip (one grep over all sources with file
+ * name tags) parsed in place from the line callback. Counter state for
+ * the CPU delta is kept between ticks.
+ */
+class TelemetrySampler {
+public:
+    TelemetrySampler(const std::string& adb_path, const std::string& serial);
+
+    // Take one sample; false if the device did not answer
+    bool sample(TelemetrySample& out);
+
+    // Parse one tagged line ("/proc/stat:cpu  12 0 ..."), accumulating into `out`
+    void parse_line(std::string_view line, TelemetrySample& out);
+
+    // Finish a tick: derive percentages and averages, update delta state
+    void finish_sample(TelemetrySample& out);
+
+    const std::string& serial() const { return session_.serial(); }
+
+private:
+    adb::ShellSession session_;
+    std::chrono::steady_clock::time_point started_;
+
+    // /proc/stat "cpu" totals from the previous tick
+    uint64_t prev_total_ = 0;
+    uint64_t prev_idle_ = 0;
+    uint64_t cur_total_ = 0;
+    uint64_t cur_idle_ = 0;
+
+    uint64_t mem_total_kb_ = 0;
+    double freq_sum_khz_ = 0;
+    unsigned freq_count_ = 0;
+};
+
+/**
+ * Live telemetry for any number of devices
+ * One sampling thread per device writes into a preallocated ring buffer;
+ * readers copy the series out under a short lock. Workers are detached and
+ * share their channel, so stop() only signals and returns at once instead
+ * of waiting out a sample in flight (up to its 5 s timeout) on the caller's
+ * thread, which is usually the UI.
+ */
+class TelemetryMonitor {
+public:
+    explicit TelemetryMonitor(const std::string& adb_path, size_t history = 600);
+    ~TelemetryMonitor();
+
+    TelemetryMonitor(const TelemetryMonitor&) = delete;
+    TelemetryMonitor& operator=(const TelemetryMonitor&) = delete;
+
+    // Start (or retune) sampling of `serial` at `rate_hz` samples per second
+    void start(const std::string& serial, double rate_hz);
+    void stop(const std::string& serial);
+    void stop_all();
+
+    bool is_running(const std::string& serial) const;
+    std::vector<std::string> devices() const;
+
+    // Copy the series for `serial` oldest-to-newest; false if not monitored
+    bool copy_series(const std::string& serial, std::vector<TelemetrySample>& out) const;
+
+    // Samples that could not be taken in time (device busy or gone)
+    uint64_t missed_samples(const std::string& serial) const;
+
+private:
+    struct Channel {
+        explicit Channel(size_t history) : series(history) {}
+
+        RingBuffer<TelemetrySample> series;
+        mutable std::mutex mutex;
+        // Flag of the current worker (guarded by the monitor's mutex); each
+        // start() makes a new one, so a stopped worker still finishing its
+        // last sample never sees its flag raised again by a restart
+        std::shared_ptr<std::atomic<bool>> running;
+        std::atomic<int64_t> interval_us{100000};
+        std::atomic<uint64_t> missed{0};
+    };
+
+    std::string adb_path_;
+    size_t history_;
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<Channel>> channels_;
+
+    static void run(std::shared_ptr<Channel> channel, std::shared_ptr<std::atomic<bool>> running,
+                    std::string adb_path, std::string serial);
+};
+
+} // namespace monitor
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace net {
+
+/**
+ * Small blocking TCP helpers shared by the native protocol clients
+ * (adb server, fastboot TCP). All reads honour a poll() timeout.
+ */
+
+// Connect with a timeout; returns the socket fd or -1 (error filled in)
+int connect_tcp(const std::string& host, uint16_t port, int timeout_ms, std::string& error);
+
+// Write the whole buffer (no SIGPIPE); false on error
+bool write_all(int fd, const void* data, size_t size);
+
+// Read exactly `size` bytes; false on timeout, EOF or error
+bool read_exact(int fd, void* data, size_t size, int timeout_ms);
+
+// Read up to `size` bytes as they arrive; returns bytes read, 0 on EOF, -1 on error/timeout
+long read_some(int fd, void* data, size_t size, int timeout_ms);
+
+// Wait until fd is readable; false on timeout
+bool wait_readable(int fd, int timeout_ms);
+
+} // namespace net
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+namespace parse {
+
+/**
+ * Aho-Corasick multi-pattern matcher
+ * add() every pattern, compile() once, then scan any amount of text in a
+ * single linear pass regardless of the pattern count. Transitions are a
+ * dense table over the byte classes that actually occur in the patterns,
+ * so the automaton stays small. Matching is ASCII case-insensitive when
+ * constructed with ignore_case.
+ */
+class AhoCorasick {
+public:
+    explicit AhoCorasick(bool ignore_case = false);
+
+    // Returns the pattern id (0, 1, 2, ... in insertion order)
+    uint32_t add(std::string_view pattern);
+    void compile();
+
+    bool compiled() const { return compiled_; }
+    size_t pattern_count() const { return pattern_lengths_.size(); }
+    size_t state_count() const { return fail_.size(); }
+
+    // Calls on_match(pattern_id, end_offset) for every occurrence; return false to stop
+    template <typename Fn>
+    void scan(std::string_view text, Fn&& on_match) const {
+        if (!compiled_) return;
+        uint32_t state = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            state = next_[state * class_count_ + byte_class_[static_cast<unsigned char>(text[i])]];
+            for (int32_t out = first_output_[state]; out >= 0; out = output_next_[out]) {
+                if (!on_match(output_pattern_[out], i + 1)) return;
+            }
+        }
+    }
+
+    // Which patterns occur at least once (indexed by pattern id)
+    std::vector<bool> find_all(std::string_view text) const;
+
+private:
+    bool ignore_case_;
+    bool compiled_ = false;
+
+    std::array<uint8_t, 256> byte_class_{};     // 0 = byte absent from every pattern
+    uint32_t class_count_ = 1;
+
+    // Trie during add(), goto/fail automaton after compile()
+    std::vector<std::vector<std::pair<uint8_t, uint32_t>>> trie_;
+    std::vector<uint32_t> next_;                // state * class_count_ + class -> state
+    std::vector<uint32_t> fail_;
+    std::vector<int32_t> first_output_;         // head of the output chain per state
+    std::vector<int32_t> output_next_;
+    std::vector<uint32_t> output_pattern_;
+    std::vector<uint32_t> pattern_lengths_;
+    std::vector<std::vector<uint32_t>> terminal_;   // patterns ending at each trie node
+
+    unsigned char fold(unsigned char c) const;
+};
+
+} // namespace parse
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace parse {
+
+/**
+ * Vectorized byte scanning for large command outputs
+ * (dumpsys, pm, logcat, /proc files)
+ *
+ * The implementation is picked once at runtime from the host CPU:
+ * AVX2, then SSE2, then a portable scalar fallback.
+ */
+
+// Returns a pointer to the first `c` in [begin, end), or `end`
+const char* find_byte(const char* begin, const char* end, char c);
+
+// Counts occurrences of `c` in [begin, end)
+std::size_t count_byte(const char* begin, const char* end, char c);
+
+// Name of the selected implementation ("avx2", "sse2" or "scalar")
+const char* scanner_isa();
+
+/**
+ * Zero-copy line iterator over a text buffer
+ * Lines are returned without the trailing '\n' (and '\r' for CRLF output).
+ * The returned views point into the scanned buffer.
+ */
+class LineScanner {
+public:
+    explicit LineScanner(std::string_view text);
+
+    // Advance to the next line; returns false once the buffer is exhausted
+    bool next(std::string_view& line);
+
+    // Unconsumed part of the buffer
+    std::string_view remaining() const { return {pos_, static_cast<std::size_t>(end_ - pos_)}; }
+
+private:
+    using FindFn = const char* (*)(const char*, const char*, char);
+
+    const char* pos_;
+    const char* end_;
+    FindFn find_;
+};
+
+// Invoke fn(std::string_view) for every line in `text`
+template <typename Fn>
+void for_each_line(std::string_view text, Fn&& fn) {
+    LineScanner scanner(text);
+    std::string_view line;
+    while (scanner.next(line)) {
+        fn(line);
+    }
+}
+
+/**
+ * Incremental line splitter for streamed output
+ * Feed arbitrary chunks; complete lines are handed to the callback as soon
+ * as their newline arrives. Only the trailing partial line is buffered, so
+ * memory stays bounded by the longest line rather than the whole output.
+ */
+class LineSplitter {
+public:
+    // Feed a chunk; calls bool fn(line) per complete line.
+    // Returns false as soon as fn does (the rest of the chunk is dropped).
+    template <typename Fn>
+    bool feed(std::string_view chunk, Fn&& fn) {
+        if (!partial_.empty()) {
+            const char* nl = find_byte(chunk.data(), chunk.data() + chunk.size(), '\n');
+            if (nl == chunk.data() + chunk.size()) {
+                partial_.append(chunk.data(), chunk.size());
+                return true;
+            }
+            std::size_t head = static_cast<std::size_t>(nl - chunk.data());
+            partial_.append(chunk.data(), head);
+            std::string_view line(partial_);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            bool keep_going = fn(line);
+            partial_.clear();
+            if (!keep_going) return false;
+            chunk.remove_prefix(head + 1);
+        }
+
+        LineScanner scanner(chunk);
+        std::string_view line;
+        while (scanner.next(line)) {
+            // A last line without '\n' is incomplete; keep it for the next chunk
+            if (scanner.remaining().empty() && chunk.back() != '\n') {
+                partial_.assign(line.data(), chunk.data() + chunk.size() - line.data());
+                break;
+            }
+            if (!fn(line)) return false;
+        }
+        return true;
+    }
+
+    // Flush a final unterminated line, if any
+    template <typename Fn>
+    bool finish(Fn&& fn) {
+        if (partial_.empty()) return true;
+        std::string_view line(partial_);
+        if (line.back() == '\r') line.remove_suffix(1);
+        bool keep_going = fn(line);
+        partial_.clear();
+        return keep_going;
+    }
+
+    // Drop a buffered partial line, keeping its storage for the next stream
+    void reset() { partial_.clear(); }
+
+private:
+    std::string partial_;
+};
+
+/**
+ * Split `line` on `delim` into at most `max_fields` views.
+ * The last field receives the rest of the line when there are more.
+ * Returns the number of fields written.
+ */
+std::size_t split_fields(std::string_view line, char delim,
+                         std::string_view* out, std::size_t max_fields);
+
+/**
+ * Split `line` on runs of spaces/tabs (like `>>` on an istream).
+ * Leading and trailing whitespace is ignored; the last field receives
+ * the rest of the line when there are more than `max_fields`.
+ */
+std::size_t split_whitespace(std::string_view line,
+                             std::string_view* out, std::size_t max_fields);
+
+// Strip leading/trailing whitespace (space, tab, CR, LF)
+std::string_view trim(std::string_view text);
+
+// True if `text` begins with `prefix`
+inline bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+} // namespace parse
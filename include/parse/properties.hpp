@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string_view>
+
+namespace parse {
+
+/**
+ * Parse one line of "getprop" output: "[key]: [value]"
+ * Returns false for anything else (continuation lines of multi-line
+ * values, blank lines, error text).
+ */
+inline bool parse_property_line(std::string_view line, std::string_view& key, std::string_view& value) {
+    if (line.size() < 6 || line.front() != '[') return false;
+
+    size_t key_end = line.find("]: [", 1);
+    if (key_end == std::string_view::npos || line.back() != ']') return false;
+
+    key = line.substr(1, key_end - 1);
+    size_t value_start = key_end + 4;
+    value = line.substr(value_start, line.size() - 1 - value_start);
+    return true;
+}
+
+} // namespace parse
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace report {
+
+/**
+ * Append-only little-endian writer: LEB128 varints, zigzag for signed values,
+ * length-prefixed strings. Output is a plain std::string so it can be written
+ * or mmapped as-is.
+ */
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string& out) : out_(out) {}
+
+    void u8(uint8_t value) { out_.push_back(static_cast<char>(value)); }
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            out_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<char>(value));
+    }
+
+    void svarint(int64_t value) {
+        varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void boolean(bool value) { u8(value ? 1 : 0); }
+
+    void str(std::string_view value) {
+        varint(value.size());
+        out_.append(value.data(), value.size());
+    }
+
+    void raw(const void* data, size_t size) {
+        out_.append(static_cast<const char*>(data), size);
+    }
+
+    size_t size() const { return out_.size(); }
+
+    // Reserve a 4-byte length slot; end_length() fills it once the payload is written
+    size_t begin_length() {
+        size_t at = out_.size();
+        out_.append(4, '\0');
+        return at;
+    }
+
+    void end_length(size_t at) {
+        uint32_t length = static_cast<uint32_t>(out_.size() - at - 4);
+        for (int i = 0; i < 4; ++i) {
+            out_[at + i] = static_cast<char>((length >> (8 * i)) & 0xff);
+        }
+    }
+
+private:
+    std::string& out_;
+};
+
+/**
+ * Bounds-checked reader for BinaryWriter output. Reads past the end or
+ * malformed varints set ok() to false and return zero values, so a decoder
+ * can read a whole record and check once at the end.
+ */
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data) : data_(data) {}
+
+    uint8_t u8() {
+        if (pos_ >= data_.size()) return fail();
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos_ >= data_.size()) return fail();
+            uint8_t byte = static_cast<uint8_t>(data_[pos_++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        return fail();
+    }
+
+    int64_t svarint() {
+        uint64_t value = varint();
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    bool boolean() { return u8() != 0; }
+
+    std::string_view str() {
+        uint64_t length = varint();
+        if (!ok_ || length > data_.size() - pos_) {
+            fail();
+            return {};
+        }
+        std::string_view value = data_.substr(pos_, length);
+        pos_ += length;
+        return value;
+    }
+
+    uint32_t u32() {
+        if (data_.size() - pos_ < 4) return fail();
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(data_[pos_ + i])) << (8 * i);
+        }
+        pos_ += 4;
+        return value;
+    }
+
+    // Sub-reader over the next `length` bytes; this reader skips past them
+    BinaryReader sub(size_t length) {
+        if (length > data_.size() - pos_) {
+            fail();
+            return BinaryReader(std::string_view());
+        }
+        BinaryReader reader(data_.substr(pos_, length));
+        pos_ += length;
+        return reader;
+    }
+
+    bool ok() const { return ok_; }
+    bool at_end() const { return pos_ >= data_.size(); }
+    size_t position() const { return pos_; }
+
+private:
+    std::string_view data_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+
+    uint8_t fail() {
+        ok_ = false;
+        pos_ = data_.size();
+        return 0;
+    }
+};
+
+} // namespace report
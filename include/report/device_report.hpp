@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "device_inspector.h"
+#include "root_analyzer.h"
+#include "bootloader_analyzer.h"
+#include "rom_compatibility.h"
+#include "device/property_snapshot.hpp"
+
+namespace report {
+
+/**
+ * Results of the analyzer::* checks (SELinux, verified boot, OEM unlock, slots)
+ */
+struct AnalyzerResults {
+    std::string selinux_status = "Unknown";
+    std::string verified_boot_state = "Unknown";
+    std::string device_state = "Unknown";
+    std::string vbmeta_state = "Unknown";
+    std::string oem_unlock_support = "Unknown";
+    std::string oem_unlock_allowed = "Unknown";
+    std::string current_slot = "Unknown";
+    bool has_ab = false;
+};
+
+/**
+ * One complete scan of one device
+ * Every section is optional because each analyzer can fail on its own.
+ */
+struct DeviceReport {
+    std::string serial;
+    int64_t captured_at_ms = 0;         // Unix time in milliseconds
+
+    std::optional<DeviceInfo> device;
+    std::optional<RootInfo> root;
+    std::optional<BootloaderInfo> bootloader;
+    std::optional<RomInfo> rom;
+    std::optional<AnalyzerResults> analyzers;
+};
+
+// Binary format version written by encode(); decode() accepts this and older
+constexpr uint16_t REPORT_FORMAT_VERSION = 1;
+
+/**
+ * Compact binary form: "LCRR" magic, format version, then tagged
+ * length-prefixed sections. Unknown sections are skipped, so older readers
+ * can load newer files.
+ */
+std::string encode(const DeviceReport& report);
+void encode_to(const DeviceReport& report, std::string& out);   // appends
+std::optional<DeviceReport> decode(std::string_view data);
+
+// Every field as a ("section.field", value) pair sorted by key, for diffing
+// (lists are joined, maps and signature matches get one pair per entry)
+std::vector<std::pair<std::string, std::string>> flatten(const DeviceReport& report);
+
+// JSON for humans and scripts (indent < 0 = single line)
+std::string to_json(const DeviceReport& report, int indent = 2);
+std::optional<DeviceReport> from_json(const std::string& json_content);
+
+// Results of the analyzer::* checks from a property snapshot plus "getenforce" output
+AnalyzerResults analyzers_from_properties(const device::PropertySnapshot& props,
+                                          const std::string& getenforce);
+
+/**
+ * Runs every analyzer against one device and fills a DeviceReport
+ */
+class ReportCollector {
+public:
+    ReportCollector(const AdbAbstraction& adb,
+                    const DeviceInspector& inspector,
+                    const RootAnalyzer& root_analyzer,
+                    const BootloaderAnalyzer& bootloader_analyzer,
+                    const RomCompatibility& rom_compat,
+                    device::PropertyCache& properties);
+
+    DeviceReport collect(const std::string& serial) const;
+
+private:
+    const AdbAbstraction& adb_;
+    const DeviceInspector& inspector_;
+    const RootAnalyzer& root_analyzer_;
+    const BootloaderAnalyzer& bootloader_analyzer_;
+    const RomCompatibility& rom_compat_;
+    device::PropertyCache& properties_;
+};
+
+} // namespace report
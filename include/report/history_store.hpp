@@ -0,0 +1,150 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <optional>
+#include <mutex>
+#include <cstdint>
+#include "report/device_report.hpp"
+
+namespace report {
+
+/**
+ * Append-only columnar history of device reports
+ *
+ * Layout under the store directory (default <config dir>/history):
+ *   <column>.col   one fixed-width little-endian value per scan
+ *   strings.dat    append-only dictionary (serials, fingerprints)
+ *   reports.dat    every full report in binary form, addressed by the
+ *                  report_offset/report_size columns
+ *
+ * Queries mmap only the columns they touch, so a storage trend reads the
+ * time and storage columns and nothing else. The serial index (rows per
+ * serial) is rebuilt from the 4-byte serial column when the store is
+ * opened; the time index is the time column itself, binary searched while
+ * scans arrive in order. A crash mid-append leaves at most one ragged row,
+ * which is trimmed on the next open.
+ *
+ * The GUI and a headless --report append to the same directory, so every
+ * append holds an flock() on append.lock and first reads the strings and
+ * rows other writers added since, taking ids and offsets from the files
+ * rather than from what this instance saw at open(). Queries see other
+ * writers' scans after the next append or open().
+ */
+class HistoryStore {
+public:
+    struct StoragePoint {
+        int64_t time_ms;
+        long long free_mb;
+        long long total_mb;
+    };
+
+    struct FingerprintChange {
+        std::string serial;
+        int64_t time_ms;            // first scan that saw the new build
+        std::string before;
+        std::string after;
+    };
+
+    explicit HistoryStore(const std::string& directory = default_directory());
+    ~HistoryStore();
+
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    // <config dir>/history
+    static std::string default_directory();
+
+    // Create or reopen the store; false if the directory is not writable
+    bool open();
+    bool is_open() const { return open_; }
+
+    // Append one scan (reports without device info are skipped)
+    bool append(const DeviceReport& report);
+
+    size_t size() const;
+    std::vector<std::string> serials() const;
+
+    // Storage free/total for one serial within [from_ms, to_ms]
+    std::vector<StoragePoint> storage_trend(const std::string& serial,
+                                            int64_t from_ms, int64_t to_ms) const;
+
+    // Devices whose build fingerprint changed within [from_ms, to_ms]
+    std::vector<FingerprintChange> fingerprint_changes(int64_t from_ms, int64_t to_ms) const;
+
+    // Full report of the newest scan of `serial`
+    std::optional<DeviceReport> latest(const std::string& serial) const;
+
+    // Full report of one row
+    std::optional<DeviceReport> load(size_t row) const;
+
+private:
+    // One memory-mapped, append-only column file
+    struct ColumnFile {
+        std::string name;
+        size_t width = 0;
+        int fd = -1;
+        const uint8_t* map = nullptr;
+        size_t mapped = 0;
+    };
+
+    enum Column {
+        COL_TIME,               // int64   captured_at_ms
+        COL_SERIAL,             // uint32  string id
+        COL_FINGERPRINT,        // uint32  string id
+        COL_STORAGE_FREE,       // int64   MB
+        COL_STORAGE_TOTAL,      // int64   MB
+        COL_RAM,                // int64   MB
+        COL_API_LEVEL,          // int32
+        COL_ROOT_STATUS,        // uint8   RootStatus (+1, 0 = not scanned)
+        COL_BOOTLOADER_STATUS,  // uint8   BootloaderStatus (+1, 0 = not scanned)
+        COL_REPORT_OFFSET,      // uint64  offset in reports.dat
+        COL_REPORT_SIZE,        // uint32
+        COLUMN_COUNT
+    };
+
+    std::string directory_;
+    bool open_ = false;
+    size_t rows_ = 0;
+    bool time_ordered_ = true;
+    int64_t last_time_ = 0;
+
+    mutable ColumnFile columns_[COLUMN_COUNT];
+    int strings_fd_ = -1;
+    uint64_t strings_size_ = 0;     // end of the last complete entry
+    int reports_fd_ = -1;
+    uint64_t reports_size_ = 0;
+    int lock_fd_ = -1;
+
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> string_ids_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> rows_by_serial_;
+
+    mutable std::mutex mutex_;
+
+    void close_all();
+    // Id of `value` in strings.dat (0 for ""); nullopt if it could not be written
+    std::optional<uint32_t> intern(const std::string& value);
+
+    // Read what other writers appended since the last sync and trim a torn
+    // append (caller holds mutex_ and the append lock)
+    bool sync_locked();
+    bool load_new_strings();
+    template <class T>
+    std::optional<T> read_value(Column column, size_t row) const;
+
+    // Map `column` far enough to read every committed row (caller holds mutex_)
+    const uint8_t* column_data(Column column) const;
+
+    template <class T>
+    T value_at(Column column, size_t row) const;
+
+    // Rows of one serial with time in [from_ms, to_ms], in scan order
+    std::vector<uint32_t> rows_in_range(uint32_t serial_id, int64_t from_ms, int64_t to_ms) const;
+
+    std::optional<DeviceReport> load_locked(size_t row) const;
+};
+
+} // namespace report
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include "device/property_snapshot.hpp"
+#include "report/device_report.hpp"
+
+namespace report {
+
+/**
+ * One difference between two snapshots or reports
+ */
+struct Change {
+    enum class Kind {
+        ADDED,
+        REMOVED,
+        CHANGED
+    };
+
+    Kind kind;
+    std::string key;        // property name or "section.field"
+    std::string before;     // empty for ADDED
+    std::string after;      // empty for REMOVED
+};
+
+// Keys to compare; return false to ignore a key
+using KeyFilter = std::function<bool(std::string_view key)>;
+
+/**
+ * Single sorted merge over two key-ordered ranges of (key, value) pairs.
+ * Linear in the combined size; no lookups or temporary maps.
+ */
+template <class ItA, class ItB, class Emit>
+void merge_diff(ItA a, ItA a_end, ItB b, ItB b_end, Emit&& emit) {
+    while (a != a_end || b != b_end) {
+        if (b == b_end || (a != a_end && std::string_view(a->first) < std::string_view(b->first))) {
+            emit(Change::Kind::REMOVED, a->first, a->second, std::string_view());
+            ++a;
+        } else if (a == a_end || std::string_view(b->first) < std::string_view(a->first)) {
+            emit(Change::Kind::ADDED, b->first, std::string_view(), b->second);
+            ++b;
+        } else {
+            if (std::string_view(a->second) != std::string_view(b->second)) {
+                emit(Change::Kind::CHANGED, a->first, a->second, b->second);
+            }
+            ++a;
+            ++b;
+        }
+    }
+}
+
+// Property differences, in key order; snapshots sharing a StringPool are
+// merged on key ids and compared by value id
+std::vector<Change> diff_properties(const device::PropertySnapshot& before,
+                                    const device::PropertySnapshot& after,
+                                    const KeyFilter& filter = nullptr);
+
+// Analyzer field differences ("device.storage_free_mb", "root.status", ...)
+std::vector<Change> diff_reports(const DeviceReport& before, const DeviceReport& after,
+                                 const KeyFilter& filter = nullptr);
+
+// Keys that describe the build and should match across identical devices
+// (ro.build.*, ro.vendor.build.*, ro.*.build.fingerprint, security patch, ...)
+bool is_build_key(std::string_view key);
+
+// "+ key = value" / "- key" / "~ key: before -> after", at most `limit` lines
+std::string format_changes(const std::vector<Change>& changes, size_t limit = 50);
+
+} // namespace report
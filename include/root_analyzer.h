@@ -2,8 +2,14 @@
 #define ROOT_ANALYZER_H
 
 #include "adb_abstraction.h"
+#include "device/package_inventory.hpp"
+#include "analyzer/signature_engine.hpp"
 #include <string>
 #include <optional>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <chrono>
 
 enum class RootStatus {
     ROOTED,
@@ -14,6 +20,8 @@ enum class RootStatus {
 enum class RootMethod {
     MAGISK,
     SUPERSU,
+    KERNELSU,
+    APATCH,
     UNKNOWN_METHOD,
     NO_ROOT
 };
@@ -25,6 +33,8 @@ struct RootInfo {
     std::string magisk_version;  // empty if not Magisk
     bool has_su = false;
     bool has_magisk_binary = false;
+    std::vector<std::string> manager_apps;  // installed root manager packages (informational)
+    std::vector<analyzer::SignatureMatch> signatures;  // root/hooking/hiding frameworks seen
 };
 
 // Root Analyzer
@@ -33,6 +43,17 @@ class RootAnalyzer {
 public:
     explicit RootAnalyzer(const AdbAbstraction& adb);
 
+    // Signature database (data/root_signatures.json); when loaded, analyze()
+    // adds one signature scan to the su/Magisk/SuperSU checks, and a named
+    // framework takes precedence over the method those checks infer
+    bool load_signatures(const std::string& path);
+    bool has_signatures() const { return signature_engine.is_loaded(); }
+
+    // Directory with lincheckroot-agent-<abi> builds; when set, analyze()
+    // reads the su/Magisk/SuperSU paths, the PATH lookups and the signature
+    // capture in one agent query, and uses sync/shell only if it cannot run
+    void set_agent_dir(const std::string& dir) { agent_dir = dir; }
+
     // Analyze root status
     std::optional<RootInfo> analyze(const std::string& serial) const;
 
@@ -42,21 +63,62 @@ public:
     std::string get_magisk_version(const std::string& serial) const;
     bool has_supersu(const std::string& serial) const;
     
+    // Installed packages, loaded with one pm call and shared by all package checks
+    // (reused for `max_age`, then reloaded)
+    std::shared_ptr<const device::PackageInventory> get_packages(
+        const std::string& serial,
+        std::chrono::milliseconds max_age = std::chrono::seconds(60)) const;
+    void invalidate_packages(const std::string& serial) const;
+
     // Get friendly status string
     std::string status_to_string(RootStatus status) const;
     std::string method_to_string(RootMethod method) const;
 
 private:
     const AdbAbstraction& adb;
+    analyzer::SignatureEngine signature_engine;
+    std::string agent_dir;
+
+    // Derive status/method from signature matches
+    void apply_signatures(RootInfo& info) const;
+
+    // Root-related paths found on the device
+    struct FilesystemEvidence {
+        bool su = false;
+        bool magisk = false;
+        bool supersu = false;
+    };
+
+    // Stat every su/Magisk/SuperSU path in one pipelined sync exchange, plus
+    // one "command -v" for su/magisk elsewhere on PATH; nullopt if the sync
+    // service is unavailable (the shell checks are used then)
+    std::optional<FilesystemEvidence> probe_filesystem(const std::string& serial) const;
+
+    // Evidence from the st_mode of each probed path (0 = missing)
+    static FilesystemEvidence evidence_from_modes(const std::vector<uint32_t>& modes);
+
+    // Path probes, PATH lookups and (with signatures loaded) the signature
+    // capture from the agent; nullopt if no agent is configured or it failed
+    struct AgentEvidence {
+        FilesystemEvidence fs;
+        std::optional<std::string> capture;     // nullopt: use the shell capture
+    };
+    std::optional<AgentEvidence> query_agent(const std::string& serial) const;
 
     // Check standard su locations
-    bool check_su_locations(const std::string& serial) const;
+    bool check_su_locations(const std::string& serial, const FilesystemEvidence* fs = nullptr) const;
 
     // Check Magisk-specific markers
-    bool check_magisk(const std::string& serial) const;
+    bool check_magisk(const std::string& serial, const FilesystemEvidence* fs = nullptr) const;
 
     // Check SuperSU markers
-    bool check_supersu(const std::string& serial) const;
+    bool check_supersu(const std::string& serial, const FilesystemEvidence* fs = nullptr) const;
+
+    // Root manager apps (Magisk, KernelSU, APatch, SuperSU) present in the inventory
+    std::vector<std::string> find_manager_apps(const std::string& serial) const;
+
+    mutable std::mutex packages_mutex;
+    mutable std::map<std::string, std::shared_ptr<const device::PackageInventory>> packages;
 };
 
 #endif // ROOT_ANALYZER_H
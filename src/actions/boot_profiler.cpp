@@ -0,0 +1,193 @@
+#include "actions/boot_profiler.hpp"
+#include "adb/shell_session.hpp"
+#include "parse/line_scanner.hpp"
+#include "parse/properties.hpp"
+
+#include <charconv>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+
+namespace actions {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+constexpr milliseconds POLL_INTERVAL{200};
+constexpr const char* EVENTS_SEPARATOR = "__LCR_BOOT_EVENTS__";
+
+long long to_number(std::string_view text) {
+    long long value = 0;
+    text = parse::trim(text);
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+// Value of the first present key, or -1
+double first_ms(const std::map<std::string, long long>& values, std::initializer_list<const char*> keys,
+                double scale) {
+    for (const char* key : keys) {
+        auto it = values.find(key);
+        if (it != values.end() && it->second > 0) return it->second / scale;
+    }
+    return -1;
+}
+
+} // namespace
+
+BootProfiler::BootProfiler(const std::string& adb_path, const std::string& serial)
+    : adb_path_(adb_path), serial_(serial) {}
+
+BootProfile BootProfiler::profile_current_boot(Clock::time_point reboot_sent, milliseconds timeout) const {
+    BootProfile profile;
+    adb::ShellSession session(adb_path_, serial_);
+    Clock::time_point deadline = Clock::now() + timeout;
+
+    // One round trip per poll: the flag plus the device clock at that moment
+    while (Clock::now() < deadline) {
+        auto result = session.run("getprop sys.boot_completed; cat /proc/uptime", 5000);
+        if (result) {
+            std::string_view lines[2];
+            size_t count = 0;
+            parse::for_each_line(result->output, [&](std::string_view line) {
+                if (count < 2) lines[count++] = parse::trim(line);
+            });
+
+            if (count == 2 && lines[0] == "1") {
+                profile.completed = true;
+                profile.to_boot_completed = std::chrono::duration_cast<milliseconds>(Clock::now() - reboot_sent);
+                profile.completed_uptime_ms = std::strtod(std::string(lines[1]).c_str(), nullptr) * 1000.0;
+                break;
+            }
+        }
+        // A dead session (device still coming up) is simply reopened next time
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+
+    if (!profile.completed) {
+        profile.error = "Timed out waiting for sys.boot_completed";
+        return profile;
+    }
+
+    // Everything else in a single batch
+    std::string batch =
+        "getprop | grep -e '^\\[ro\\.boottime\\.' -e '^\\[ro\\.boot\\.boottime\\]'; "
+        "echo " + std::string(EVENTS_SEPARATOR) + "; "
+        "logcat -b events -d 2>/dev/null | grep boot_progress_";
+    auto result = session.run(batch, 15000);
+    if (!result) {
+        profile.error = "Failed to collect boot timing properties";
+        return profile;
+    }
+
+    std::string_view output = result->output;
+    std::string_view props = output;
+    std::string_view events;
+    size_t split = output.find(EVENTS_SEPARATOR);
+    if (split != std::string_view::npos) {
+        props = output.substr(0, split);
+        events = output.substr(split + std::char_traits<char>::length(EVENTS_SEPARATOR));
+    }
+
+    parse_timeline(props, events, profile);
+    return profile;
+}
+
+void BootProfiler::parse_timeline(std::string_view props, std::string_view events, BootProfile& profile) {
+    double bootloader_ms = 0;
+
+    parse::for_each_line(props, [&](std::string_view line) {
+        std::string_view key, value;
+        if (!parse::parse_property_line(line, key, value)) return;
+
+        if (key == "ro.boot.boottime") {
+            // Pixel-style "1BLL:62,1BLE:611,KL:0,KD:0,SW:10225,ODT:0,AVB:159"; SW is time
+            // spent waiting for the user, not boot work
+            std::string_view fields[32];
+            size_t count = parse::split_fields(value, ',', fields, 32);
+            for (size_t i = 0; i < count; ++i) {
+                std::string_view kv[2];
+                if (parse::split_fields(fields[i], ':', kv, 2) == 2 && parse::trim(kv[0]) != "SW") {
+                    bootloader_ms += to_number(kv[1]);
+                }
+            }
+        } else {
+            profile.boottime_props[std::string(key)] = to_number(value);
+        }
+    });
+
+    // "... I boot_progress_system_run: 7012" (value is uptime in ms)
+    parse::for_each_line(events, [&](std::string_view line) {
+        size_t pos = line.find("boot_progress_");
+        if (pos == std::string_view::npos) return;
+        std::string_view rest = line.substr(pos);
+        size_t colon = rest.find(':');
+        if (colon == std::string_view::npos) return;
+        // Keep the latest boot's value if the buffer spans several boots
+        profile.boot_progress[std::string(rest.substr(0, colon))] = to_number(rest.substr(colon + 1));
+    });
+
+    // ro.boottime.<service> are nanosecond timestamps since kernel start
+    double init_ms = first_ms(profile.boottime_props, {"ro.boottime.init"}, 1e6);
+    double zygote_ms = first_ms(profile.boottime_props, {"ro.boottime.zygote", "ro.boottime.zygote64"}, 1e6);
+    if (zygote_ms < 0) zygote_ms = first_ms(profile.boot_progress, {"boot_progress_start"}, 1);
+    double system_run_ms = first_ms(profile.boot_progress, {"boot_progress_system_run"}, 1);
+    double enable_screen_ms = first_ms(profile.boot_progress,
+                                       {"boot_progress_enable_screen", "boot_progress_ams_ready"}, 1);
+    double complete_ms = profile.completed ? profile.completed_uptime_ms : -1;
+
+    profile.phases.clear();
+    if (bootloader_ms > 0) {
+        profile.phases.push_back({"bootloader", -bootloader_ms, bootloader_ms});
+    }
+
+    // Each phase runs from its start mark to the next mark that is known
+    struct Mark { const char* name; double at; };
+    const Mark marks[] = {
+        {"kernel", 0},
+        {"init", init_ms},
+        {"zygote", zygote_ms},
+        {"system_server", system_run_ms},
+        {"boot complete", enable_screen_ms},
+        {nullptr, complete_ms},
+    };
+    constexpr size_t mark_count = sizeof(marks) / sizeof(marks[0]);
+
+    for (size_t i = 0; i + 1 < mark_count; ++i) {
+        if (marks[i].at < 0) continue;
+        for (size_t j = i + 1; j < mark_count; ++j) {
+            if (marks[j].at >= marks[i].at) {
+                profile.phases.push_back({marks[i].name, marks[i].at, marks[j].at - marks[i].at});
+                break;
+            }
+        }
+    }
+}
+
+std::string BootProfiler::format_profile(const BootProfile& profile) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(0);
+
+    for (const auto& phase : profile.phases) {
+        out << std::left << std::setw(16) << phase.name
+            << std::right << std::setw(8) << phase.duration_ms << " ms"
+            << "   (at " << phase.start_ms << " ms)\n";
+    }
+
+    if (profile.to_adb_online.count() > 0) {
+        out << "adb online after " << profile.to_adb_online.count() << " ms\n";
+    }
+    if (profile.completed) {
+        out << "Boot completed after " << profile.to_boot_completed.count() << " ms"
+            << " (device uptime " << profile.completed_uptime_ms << " ms)\n";
+    }
+    if (!profile.error.empty()) {
+        out << "Error: " << profile.error << "\n";
+    }
+
+    return out.str();
+}
+
+} // namespace actions
@@ -1,5 +1,7 @@
 #include "actions/reboot.hpp"
 
+#include <algorithm>
+
 namespace actions {
 
 RebootAction::RebootAction(const adb::AdbClient& adb, const device::DeviceInfo& device)
@@ -77,4 +79,61 @@ bool RebootAction::execute_reboot_download() {
     return adb_.reboot_download_mode();
 }
 
+std::future<device::RebootResult> RebootAction::execute_reboot_tracked(const std::string& type,
+                                                                       std::chrono::milliseconds timeout) {
+    device::DeviceMode target = device::RebootTracker::target_for_reboot_type(type);
+
+    auto failed = [target](const std::string& error) {
+        std::promise<device::RebootResult> promise;
+        device::RebootResult result;
+        result.target = target;
+        result.error = error;
+        promise.set_value(result);
+        return promise.get_future();
+    };
+
+    if (!can_reboot()) {
+        return failed("Device not connected");
+    }
+
+    device::RebootTracker tracker(adb_.get_adb_path());
+    auto future = tracker.track(device_.serial(), target, timeout);
+
+    bool sent = false;
+    if (type == "bootloader") {
+        sent = adb_.reboot_bootloader();
+    } else if (type == "recovery") {
+        sent = adb_.reboot_recovery();
+    } else if (type == "download") {
+        sent = adb_.reboot_download_mode();
+    } else {
+        sent = adb_.reboot_system();
+    }
+
+    if (!sent) {
+        tracker.cancel();
+        return failed("adb rejected the reboot command");
+    }
+
+    return future;
+}
+
+BootProfile RebootAction::execute_reboot_and_profile(std::chrono::milliseconds timeout) {
+    auto sent = std::chrono::steady_clock::now();
+    device::RebootResult reboot = execute_reboot_tracked("system", timeout).get();
+
+    BootProfile profile;
+    if (!reboot.reached) {
+        profile.error = reboot.error.empty() ? "Device did not come back to Android" : reboot.error;
+        return profile;
+    }
+
+    auto remaining = timeout - std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - sent);
+    BootProfiler profiler(adb_.get_adb_path(), device_.serial());
+    profile = profiler.profile_current_boot(sent, std::max(remaining, std::chrono::milliseconds(0)));
+    profile.to_adb_online = reboot.total;
+    return profile;
+}
+
 } // namespace actions
@@ -0,0 +1,170 @@
+#include "adb/abb_exec.hpp"
+#include "adb/adb_connection.hpp"
+#include "parse/line_scanner.hpp"
+
+namespace adb {
+
+namespace {
+
+// Programs that are `cmd <service>` wrappers on devices with abb
+// (am instrument still starts app_process, so `am` is limited to the rest)
+struct ServiceAlias {
+    std::string_view program;
+    std::string_view service;
+};
+constexpr ServiceAlias SERVICE_ALIASES[] = {
+    {"pm", "package"},
+    {"am", "activity"},
+    {"wm", "window"},
+    {"settings", "settings"},
+};
+
+// What abb answers instead of output when the binder service is missing or broken
+constexpr std::string_view SERVICE_ERRORS[] = {
+    "cmd: Can't find service",
+    "cmd: Failure calling service",
+};
+
+// What a service prints in place of output when the command itself fails
+// (pm/am/cmd error paths, ShellCommand's exception handler). Through the
+// shell this went to stderr with a non-zero exit status; abb has neither.
+constexpr std::string_view COMMAND_ERRORS[] = {
+    "Error:",
+    "Unknown option",
+    "Unknown command",
+    "Exception occurred while executing",
+    "Security exception",
+    "Failure [",
+    "java.lang.",
+};
+
+// Output held back until the first line is known not to be one of the above
+constexpr size_t HEAD_SIZE = 128;
+
+bool needs_shell(char c) {
+    static constexpr std::string_view special = ";|&<>()$`'\"\\*?~{}[]#\n";
+    return special.find(c) != std::string_view::npos;
+}
+
+template <size_t N>
+bool starts_with_any(std::string_view head, const std::string_view (&prefixes)[N]) {
+    for (std::string_view prefix : prefixes) {
+        if (parse::starts_with(head, prefix)) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+AbbExecClient::AbbExecClient(const std::string& serial) : serial_(serial) {}
+
+std::optional<std::vector<std::string>> AbbExecClient::translate(std::string_view command) {
+    command = parse::trim(command);
+    // Only as a word of its own: "x2>/dev/null" redirects stdout of "x2"
+    constexpr std::string_view discard_stderr = " 2>/dev/null";
+    if (command.size() > discard_stderr.size() &&
+        command.substr(command.size() - discard_stderr.size()) == discard_stderr) {
+        command = parse::trim(command.substr(0, command.size() - discard_stderr.size()));
+    }
+
+    std::vector<std::string> words;
+    size_t i = 0;
+    while (i < command.size()) {
+        while (i < command.size() && (command[i] == ' ' || command[i] == '\t')) ++i;
+        if (i >= command.size()) break;
+        size_t start = i;
+        while (i < command.size() && command[i] != ' ' && command[i] != '\t') {
+            if (needs_shell(command[i])) return std::nullopt;
+            ++i;
+        }
+        words.emplace_back(command.substr(start, i - start));
+    }
+    if (words.size() < 2) return std::nullopt;
+
+    if (words[0] == "cmd") {
+        // "cmd -l" and friends are options of the cmd binary itself
+        if (words[1].front() == '-') return std::nullopt;
+        words.erase(words.begin());
+        return words;
+    }
+    if (words[0] == "am" && words[1] == "instrument") return std::nullopt;
+    for (const auto& alias : SERVICE_ALIASES) {
+        if (words[0] == alias.program) {
+            words[0] = std::string(alias.service);
+            return words;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<bool> AbbExecClient::run(const std::vector<std::string>& args, const DataCallback& on_data,
+                                       int timeout_ms) {
+    // Arguments are NUL-separated, so they need no quoting
+    std::string service = "abb_exec:";
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i > 0) service += '\0';
+        service += args[i];
+    }
+
+    rejected_ = false;
+    AdbConnection connection;
+    connection.set_timeout(timeout_ms);
+    if (!connection.connect() || !connection.switch_transport(serial_)) {
+        last_error_ = connection.last_error();
+        return std::nullopt;
+    }
+    // adbd without abb_exec refuses the service
+    if (!connection.request(service)) {
+        last_error_ = connection.last_error();
+        rejected_ = true;
+        return std::nullopt;
+    }
+
+    // Nothing is delivered until the first line is known to be output:
+    // nullopt for a missing service, false for a failed command
+    std::string head;
+    bool head_checked = false;
+    auto check_head = [&]() -> std::optional<bool> {
+        head_checked = true;
+        std::string_view first = parse::trim(std::string_view(head).substr(0, head.find('\n')));
+        if (starts_with_any(first, SERVICE_ERRORS)) {
+            last_error_ = std::string(first);
+            return std::nullopt;
+        }
+        if (starts_with_any(first, COMMAND_ERRORS)) {
+            last_error_ = std::string(first);
+            return false;
+        }
+        return true;
+    };
+
+    char buffer[64 * 1024];
+    while (true) {
+        long n = connection.read_some(buffer, sizeof(buffer));
+        if (n == 0) break;
+        if (n < 0) {
+            last_error_ = "abb_exec read failed or timed out";
+            if (!head_checked) return std::nullopt;
+            return false;
+        }
+
+        std::string_view data(buffer, static_cast<size_t>(n));
+        if (!head_checked) {
+            head.append(data.data(), data.size());
+            if (head.size() < HEAD_SIZE && head.find('\n') == std::string::npos) continue;
+            auto output = check_head();
+            if (!output.value_or(false)) return output;
+            data = head;
+        }
+        if (!data.empty() && !on_data(data)) return true;
+    }
+
+    if (!head_checked) {
+        auto output = check_head();
+        if (!output.value_or(false)) return output;
+        if (!head.empty()) on_data(head);
+    }
+    return true;
+}
+
+} // namespace adb
@@ -131,8 +131,6 @@ bool AdbClient::reboot_system() const {
         return false;
     }
     
-    // Command executed, wait for device to disconnect
-    usleep(500000);  // 500ms delay
     return true;
 }
 
@@ -150,7 +148,6 @@ bool AdbClient::reboot_bootloader() const {
         return false;
     }
     
-    usleep(500000);  // 500ms delay
     return true;
 }
 
@@ -168,7 +165,6 @@ bool AdbClient::reboot_recovery() const {
         return false;
     }
     
-    usleep(500000);  // 500ms delay
     return true;
 }
 
@@ -186,7 +182,6 @@ bool AdbClient::reboot_download_mode() const {
         return false;
     }
     
-    usleep(500000);  // 500ms delay
     return true;
 }
 
@@ -216,7 +211,6 @@ AdbClient::CommandResult AdbClient::reboot_system_detailed() const {
         }
     }
     
-    usleep(500000);
     return result;
 }
 
@@ -245,7 +239,6 @@ AdbClient::CommandResult AdbClient::reboot_bootloader_detailed() const {
         }
     }
     
-    usleep(500000);
     return result;
 }
 
@@ -274,7 +267,6 @@ AdbClient::CommandResult AdbClient::reboot_recovery_detailed() const {
         }
     }
     
-    usleep(500000);
     return result;
 }
 
@@ -303,7 +295,6 @@ AdbClient::CommandResult AdbClient::reboot_download_mode_detailed() const {
         }
     }
     
-    usleep(500000);
     return result;
 }
 
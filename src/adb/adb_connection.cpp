@@ -0,0 +1,171 @@
+#include "adb/adb_connection.hpp"
+#include "net/tcp_socket.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace adb {
+
+namespace {
+
+bool parse_hex4(const char* digits, size_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = digits[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= static_cast<size_t>(c - '0');
+        else if (c >= 'a' && c <= 'f') value |= static_cast<size_t>(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') value |= static_cast<size_t>(c - 'A' + 10);
+        else return false;
+    }
+    return true;
+}
+
+} // namespace
+
+AdbConnection::~AdbConnection() {
+    close();
+}
+
+AdbConnection::AdbConnection(AdbConnection&& other) noexcept
+    : fd_(other.fd_), timeout_ms_(other.timeout_ms_), last_error_(std::move(other.last_error_)) {
+    other.fd_ = -1;
+}
+
+AdbConnection& AdbConnection::operator=(AdbConnection&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd_ = other.fd_;
+        timeout_ms_ = other.timeout_ms_;
+        last_error_ = std::move(other.last_error_);
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+uint16_t AdbConnection::server_port() {
+    const char* env = std::getenv("ANDROID_ADB_SERVER_PORT");
+    if (env) {
+        int port = std::atoi(env);
+        if (port > 0 && port < 65536) {
+            return static_cast<uint16_t>(port);
+        }
+    }
+    return DEFAULT_SERVER_PORT;
+}
+
+bool AdbConnection::connect(int timeout_ms) {
+    close();
+    fd_ = net::connect_tcp("127.0.0.1", server_port(), timeout_ms, last_error_);
+    if (fd_ < 0) {
+        last_error_ = "adb server not reachable: " + last_error_;
+        return false;
+    }
+    return true;
+}
+
+void AdbConnection::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool AdbConnection::write_all(const void* data, size_t size) {
+    if (!net::write_all(fd_, data, size)) {
+        last_error_ = "Write to adb server failed";
+        return false;
+    }
+    return true;
+}
+
+bool AdbConnection::read_exact(void* data, size_t size) {
+    if (!net::read_exact(fd_, data, size, timeout_ms_)) {
+        last_error_ = "Read from adb server failed or timed out";
+        return false;
+    }
+    return true;
+}
+
+long AdbConnection::read_some(void* data, size_t size) {
+    return net::read_some(fd_, data, size, timeout_ms_);
+}
+
+bool AdbConnection::wait_readable(int timeout_ms) const {
+    return net::wait_readable(fd_, timeout_ms);
+}
+
+bool AdbConnection::request(std::string_view service) {
+    if (!is_open()) {
+        last_error_ = "Not connected to adb server";
+        return false;
+    }
+
+    // Header and service in one write: split, Nagle holds the service back
+    // until the header is acknowledged (a delayed-ACK stall per request)
+    char header[5];
+    std::snprintf(header, sizeof(header), "%04zx", service.size());
+    std::string message(header, 4);
+    message.append(service.data(), service.size());
+    if (!write_all(message.data(), message.size())) {
+        return false;
+    }
+
+    return read_status();
+}
+
+bool AdbConnection::read_status() {
+    char status[4];
+    if (!read_exact(status, sizeof(status))) return false;
+
+    if (std::string_view(status, 4) == "OKAY") {
+        return true;
+    }
+
+    if (std::string_view(status, 4) == "FAIL") {
+        auto message = read_length_prefixed();
+        last_error_ = message ? *message : "adb server replied FAIL";
+    } else {
+        last_error_ = "Unexpected adb server status";
+    }
+    return false;
+}
+
+bool AdbConnection::switch_transport(const std::string& serial) {
+    return request("host:transport:" + serial);
+}
+
+std::optional<std::string> AdbConnection::read_length_prefixed() {
+    char digits[4];
+    if (!read_exact(digits, sizeof(digits))) return std::nullopt;
+
+    size_t length = 0;
+    if (!parse_hex4(digits, length)) {
+        last_error_ = "Malformed length prefix from adb server";
+        return std::nullopt;
+    }
+
+    std::string payload(length, '\0');
+    if (length > 0 && !read_exact(payload.data(), length)) return std::nullopt;
+    return payload;
+}
+
+std::optional<std::string> AdbConnection::read_to_end() {
+    std::string result;
+    char buffer[64 * 1024];
+
+    while (true) {
+        long n = read_some(buffer, sizeof(buffer));
+        if (n == 0) break;
+        if (n < 0) {
+            last_error_ = "Read from adb server failed or timed out";
+            return std::nullopt;
+        }
+        result.append(buffer, static_cast<size_t>(n));
+    }
+
+    return result;
+}
+
+} // namespace adb
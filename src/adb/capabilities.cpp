@@ -0,0 +1,194 @@
+#include "adb/capabilities.hpp"
+#include "adb/adb_connection.hpp"
+#include "adb/shell_v2.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <sstream>
+
+namespace adb {
+
+namespace {
+
+constexpr Feature ALL_FEATURES[] = {
+    Feature::SHELL_V2, Feature::CMD, Feature::STAT_V2, Feature::LS_V2,
+    Feature::ABB, Feature::ABB_EXEC, Feature::SENDRECV_V2,
+};
+
+constexpr int PROBE_TIMEOUT_MS = 5000;
+
+// One host service request with a length-prefixed reply
+std::optional<std::string> host_query(const std::string& service) {
+    AdbConnection connection;
+    connection.set_timeout(PROBE_TIMEOUT_MS);
+    if (!connection.connect() || !connection.request(service)) {
+        return std::nullopt;
+    }
+    return connection.read_length_prefixed();
+}
+
+std::vector<std::string> split_features(const std::string& list) {
+    std::vector<std::string> features;
+    std::stringstream stream(list);
+    std::string feature;
+    while (std::getline(stream, feature, ',')) {
+        if (!feature.empty()) features.push_back(feature);
+    }
+    return features;
+}
+
+// transport_id of `serial` in "host:devices-l" output
+int find_transport_id(std::string_view devices, const std::string& serial) {
+    int transport_id = -1;
+    parse::for_each_line(devices, [&](std::string_view line) {
+        if (line.substr(0, line.find_first_of(" \t")) != serial) return;
+        size_t at = line.find("transport_id:");
+        if (at != std::string_view::npos) {
+            transport_id = std::atoi(std::string(line.substr(at + 13)).c_str());
+        }
+    });
+    return transport_id;
+}
+
+} // namespace
+
+const char* feature_name(Feature feature) {
+    switch (feature) {
+        case Feature::SHELL_V2: return "shell_v2";
+        case Feature::CMD: return "cmd";
+        case Feature::STAT_V2: return "stat_v2";
+        case Feature::LS_V2: return "ls_v2";
+        case Feature::ABB: return "abb";
+        case Feature::ABB_EXEC: return "abb_exec";
+        case Feature::SENDRECV_V2: return "sendrecv_v2";
+    }
+    return "";
+}
+
+CapabilityCache::Entry CapabilityCache::probe(const std::string& serial) {
+    auto device_reply = host_query("host-serial:" + serial + ":features");
+    if (!device_reply) return nullptr;
+
+    auto caps = std::make_shared<DeviceCapabilities>();
+    caps->serial = serial;
+    caps->device_features = split_features(device_reply.value());
+    // A server too old for host:features supports none of the newer services
+    caps->host_features = split_features(host_query("host:features").value_or(""));
+
+    std::vector<std::string> common;
+    for (const auto& feature : caps->device_features) {
+        if (std::find(caps->host_features.begin(), caps->host_features.end(), feature) != caps->host_features.end()) {
+            common.push_back(feature);
+        }
+    }
+    for (Feature feature : ALL_FEATURES) {
+        if (std::find(common.begin(), common.end(), feature_name(feature)) != common.end()) {
+            caps->features |= static_cast<uint32_t>(feature);
+        }
+    }
+    caps->sync_compression = negotiate_compression(common);
+
+    if (auto devices = host_query("host:devices-l")) {
+        caps->transport_id = find_transport_id(devices.value(), serial);
+    }
+
+    // SDK level and toybox applets in one round trip; "toybox" alone lists
+    // its applets. The separator line keeps an empty getprop from turning
+    // the first applet name into the SDK level.
+    ShellV2Client shell(serial, caps->has(Feature::SHELL_V2));
+    auto result = shell.run("getprop ro.build.version.sdk; echo --; toybox 2>/dev/null", PROBE_TIMEOUT_MS);
+    if (result) {
+        parse_probe_output(result->out, *caps);
+    }
+    return caps;
+}
+
+void CapabilityCache::parse_probe_output(std::string_view output, DeviceCapabilities& caps) {
+    parse::LineScanner scanner(output);
+    std::string_view line;
+    std::string_view sdk;
+    bool separated = false;
+    while (scanner.next(line)) {
+        line = parse::trim(line);
+        if (line == "--") {
+            separated = true;
+            break;
+        }
+        if (sdk.empty()) sdk = line;
+    }
+    if (!separated) return;     // not the probe's output; leave both unknown
+
+    caps.sdk = std::atoi(std::string(sdk).c_str());
+    std::stringstream words{std::string(scanner.remaining())};
+    std::string word;
+    while (words >> word) caps.applets.insert(word);
+    caps.applets_probed = true;
+}
+
+CapabilityCache::Entry CapabilityCache::get(const std::string& serial) {
+    if (auto cached = peek(serial)) return cached;
+
+    // Probed outside the lock; a concurrent probe of the same device just
+    // yields an equivalent entry
+    Entry probed = probe(serial);
+    if (!probed) return nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = entries_.emplace(serial, probed);
+    return it->second;
+}
+
+CapabilityCache::Entry CapabilityCache::peek(const std::string& serial) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(serial);
+    return it != entries_.end() ? it->second : nullptr;
+}
+
+void CapabilityCache::retain(const std::map<std::string, int>& online) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        auto device = online.find(it->first);
+        bool reconnected = device != online.end() && device->second >= 0 && it->second->transport_id >= 0 &&
+                           device->second != it->second->transport_id;
+        if (device == online.end() || reconnected) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CapabilityCache::invalidate(const std::string& serial) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(serial);
+}
+
+void CapabilityCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+template <class Change>
+void CapabilityCache::update(const std::string& serial, Change&& change) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(serial);
+    if (it == entries_.end()) return;
+    auto copy = std::make_shared<DeviceCapabilities>(*it->second);
+    change(*copy);
+    it->second = std::move(copy);
+}
+
+void CapabilityCache::revoke(const std::string& serial, Feature feature) {
+    update(serial, [feature](DeviceCapabilities& caps) {
+        caps.features &= ~static_cast<uint32_t>(feature);
+        if (feature == Feature::SENDRECV_V2) caps.sync_compression = Compression::NONE;
+    });
+}
+
+void CapabilityCache::revoke_applet(const std::string& serial, const std::string& applet) {
+    update(serial, [&applet](DeviceCapabilities& caps) { caps.applets.erase(applet); });
+}
+
+} // namespace adb
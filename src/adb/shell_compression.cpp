@@ -0,0 +1,173 @@
+#include "adb/shell_compression.hpp"
+
+#include <vector>
+
+#ifdef LINECHECK_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace adb {
+
+namespace {
+
+#ifdef LINECHECK_HAVE_ZLIB
+// Output is handed to the sink in blocks of this size
+constexpr size_t OUTPUT_BLOCK = 128 * 1024;
+
+class GzipDecoder : public StreamDecoder {
+public:
+    GzipDecoder() : out_(OUTPUT_BLOCK) {
+        // 16 + MAX_WBITS: gzip header and trailer, not a raw zlib stream
+        ok_ = inflateInit2(&stream_, 16 + MAX_WBITS) == Z_OK;
+    }
+    ~GzipDecoder() override {
+        if (ok_) inflateEnd(&stream_);
+    }
+
+    bool feed(std::string_view input, const CodecSink& output) override {
+        if (!ok_) return false;
+        stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream_.avail_in = static_cast<uInt>(input.size());
+
+        // A full output buffer means the inflater may hold more
+        bool full = true;
+        while (stream_.avail_in > 0 || full) {
+            stream_.next_out = out_.data();
+            stream_.avail_out = static_cast<uInt>(out_.size());
+            int rc = inflate(&stream_, Z_NO_FLUSH);
+            if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) return false;
+
+            size_t produced = out_.size() - stream_.avail_out;
+            if (produced > 0 &&
+                !output(std::string_view(reinterpret_cast<const char*>(out_.data()), produced))) {
+                return false;
+            }
+            full = stream_.avail_out == 0;
+
+            if (rc == Z_STREAM_END) {
+                // gzip output may hold several members back to back
+                member_done_ = true;
+                if (stream_.avail_in > 0 && inflateReset(&stream_) != Z_OK) return false;
+            } else if (rc == Z_OK) {
+                member_done_ = false;
+            } else if (!full) {
+                break;      // Z_BUF_ERROR: needs more input
+            }
+        }
+        return true;
+    }
+
+    bool finished() const override { return ok_ && member_done_; }
+
+private:
+    z_stream stream_{};
+    std::vector<Bytef> out_;
+    bool ok_ = false;
+    bool member_done_ = false;
+};
+#endif
+
+bool is_shell_operator(char c) {
+    return c == ';' || c == '|' || c == '&' || c == '>' || c == '<' || c == '(' || c == ')';
+}
+
+} // namespace
+
+std::unique_ptr<StreamDecoder> create_gzip_decoder() {
+#ifdef LINECHECK_HAVE_ZLIB
+    return std::make_unique<GzipDecoder>();
+#else
+    return nullptr;
+#endif
+}
+
+std::string gzip_command(const std::string& command) {
+    // mksh and toybox sh know pipefail; a shell that does not would exit on
+    // the bare `set`, hence the probe in a subshell. Without it the status is gzip's.
+    return "(set -o pipefail) 2>/dev/null && set -o pipefail; (" + command + ") | gzip -1";
+}
+
+double ShellClassStats::net_ms_per_mb() const {
+    if (plain_bytes == 0 || gzip_bytes == 0) return 0;
+    constexpr double MB = 1024.0 * 1024.0;
+    return plain_ms / (static_cast<double>(plain_bytes) / MB) - gzip_ms / (static_cast<double>(gzip_bytes) / MB);
+}
+
+void ShellCompressionPolicy::set_threshold(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threshold_ = bytes;
+}
+
+size_t ShellCompressionPolicy::threshold() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threshold_;
+}
+
+std::string ShellCompressionPolicy::command_class(std::string_view command) {
+    std::string result;
+    size_t words = 0;
+    // A leading subshell counts as the command inside it
+    size_t i = command.find_first_not_of(" \t(");
+    if (i == std::string_view::npos) return result;
+    while (i < command.size() && words < 2) {
+        while (i < command.size() && (command[i] == ' ' || command[i] == '\t')) ++i;
+        if (i >= command.size() || is_shell_operator(command[i])) break;
+
+        size_t start = i;
+        while (i < command.size() && command[i] != ' ' && command[i] != '\t' && !is_shell_operator(command[i])) ++i;
+        std::string_view word = command.substr(start, i - start);
+        if (words > 0 && word.front() == '-') continue;
+
+        if (words > 0) result += ' ';
+        result.append(word.data(), word.size());
+        ++words;
+    }
+    return result;
+}
+
+bool ShellCompressionPolicy::should_compress(const std::string& command_class) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (threshold_ == 0) return false;
+    auto it = classes_.find(command_class);
+    return it != classes_.end() && it->second.last_output >= threshold_;
+}
+
+void ShellCompressionPolicy::record_plain(const std::string& command_class, uint64_t bytes, double ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClassState& state = classes_[command_class];
+    state.last_output = bytes;
+    state.stats.plain_runs++;
+    state.stats.plain_bytes += bytes;
+    state.stats.plain_ms += ms;
+}
+
+void ShellCompressionPolicy::record_gzip(const std::string& command_class, uint64_t bytes, uint64_t wire_bytes,
+                                         double ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClassState& state = classes_[command_class];
+    state.last_output = bytes;
+    state.stats.gzip_runs++;
+    state.stats.gzip_bytes += bytes;
+    state.stats.gzip_wire_bytes += wire_bytes;
+    state.stats.gzip_ms += ms;
+}
+
+void ShellCompressionPolicy::record_abb(const std::string& command_class, uint64_t bytes, double ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ClassState& state = classes_[command_class];
+    state.last_output = bytes;
+    state.stats.abb_runs++;
+    state.stats.abb_bytes += bytes;
+    state.stats.abb_ms += ms;
+}
+
+std::map<std::string, ShellClassStats> ShellCompressionPolicy::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, ShellClassStats> result;
+    for (const auto& [name, state] : classes_) {
+        result.emplace(name, state.stats);
+    }
+    return result;
+}
+
+} // namespace adb
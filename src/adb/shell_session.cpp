@@ -0,0 +1,207 @@
+#include "adb/shell_session.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace adb {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Write to a pipe without risking SIGPIPE for the whole process:
+// block it for this thread and swallow it if the write raised it.
+bool write_pipe(int fd, const char* data, size_t size) {
+    sigset_t pipe_set, old_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+    bool ok = true;
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+
+    if (!ok && errno == EPIPE) {
+        timespec zero{0, 0};
+        while (sigtimedwait(&pipe_set, nullptr, &zero) > 0) {}
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+    return ok;
+}
+
+} // namespace
+
+ShellSession::ShellSession(const std::string& adb_path, const std::string& serial)
+    : adb_path_(adb_path.empty() ? "adb" : adb_path), serial_(serial) {}
+
+ShellSession::~ShellSession() {
+    close();
+}
+
+bool ShellSession::open() {
+    if (is_open()) return true;
+
+    int in_pipe[2];
+    int out_pipe[2];
+    if (pipe2(in_pipe, O_CLOEXEC) != 0) return false;
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+        ::close(in_pipe[0]);
+        ::close(in_pipe[1]);
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        ::close(in_pipe[0]);
+        ::close(in_pipe[1]);
+        ::close(out_pipe[0]);
+        ::close(out_pipe[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        // Child: stdin/stdout are the pipes, stderr is discarded
+        dup2(in_pipe[0], STDIN_FILENO);
+        dup2(out_pipe[1], STDOUT_FILENO);
+        int devnull = ::open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+
+        execlp(adb_path_.c_str(), adb_path_.c_str(), "-s", serial_.c_str(), "shell", nullptr);
+        _exit(127);
+    }
+
+    ::close(in_pipe[0]);
+    ::close(out_pipe[1]);
+    pid_ = pid;
+    stdin_fd_ = in_pipe[1];
+    stdout_fd_ = out_pipe[0];
+    sequence_ = 0;
+    // A command cut off by a timeout may have left half a line behind
+    splitter_.reset();
+    return true;
+}
+
+void ShellSession::close() {
+    if (!is_open()) return;
+
+    // EOF on stdin ends the remote shell; give it a moment before killing adb
+    ::close(stdin_fd_);
+    ::close(stdout_fd_);
+    stdin_fd_ = -1;
+    stdout_fd_ = -1;
+
+    for (int i = 0; i < 50; ++i) {
+        if (waitpid(pid_, nullptr, WNOHANG) == pid_) {
+            pid_ = -1;
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    kill(pid_, SIGTERM);
+    waitpid(pid_, nullptr, 0);
+    pid_ = -1;
+}
+
+bool ShellSession::send(const std::string& data) {
+    return write_pipe(stdin_fd_, data.data(), data.size());
+}
+
+std::optional<int> ShellSession::run_lines(const std::string& command, const LineCallback& on_line,
+                                           int timeout_ms) {
+    if (!is_open() && !open()) return std::nullopt;
+
+    // The marker starts on its own line even if the output lacks a final '\n'.
+    // The buffers and the splitter are members so that high-rate pollers
+    // do not reallocate per call.
+    marker_.assign("__LCR_END_");
+    marker_ += std::to_string(++sequence_);
+    marker_ += "__";
+    frame_.assign(command);
+    frame_ += "\nprintf '\\n%s %d\\n' ";
+    frame_ += marker_;
+    frame_ += " $?\n";
+    if (!send(frame_)) {
+        close();
+        return std::nullopt;
+    }
+
+    std::optional<int> exit_code;
+    bool deliver = true;
+    bool held_empty = false;    // the '\n' we added may produce one spurious empty line
+
+    auto handle_line = [&](std::string_view line) {
+        if (parse::starts_with(line, marker_)) {
+            std::string_view status = parse::trim(line.substr(marker_.size()));
+            int code = -1;
+            std::from_chars(status.data(), status.data() + status.size(), code);
+            exit_code = code;
+            return false;
+        }
+        if (held_empty && deliver) {
+            deliver = on_line(std::string_view());
+        }
+        held_empty = line.empty();
+        if (!held_empty && deliver) {
+            deliver = on_line(line);
+        }
+        return true;
+    };
+
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+    char buffer[64 * 1024];
+
+    while (!exit_code) {
+        int remaining = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+        pollfd pfd{stdout_fd_, POLLIN, 0};
+        if (remaining <= 0 || poll(&pfd, 1, remaining) <= 0) {
+            // Unknown position in the stream; the session cannot be reused
+            close();
+            return std::nullopt;
+        }
+
+        ssize_t n = read(stdout_fd_, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            close();
+            return std::nullopt;
+        }
+
+        splitter_.feed(std::string_view(buffer, static_cast<size_t>(n)), handle_line);
+    }
+
+    return exit_code;
+}
+
+std::optional<ShellSession::Result> ShellSession::run(const std::string& command, int timeout_ms) {
+    Result result;
+    auto exit_code = run_lines(command, [&result](std::string_view line) {
+        result.output.append(line.data(), line.size());
+        result.output.push_back('\n');
+        return true;
+    }, timeout_ms);
+
+    if (!exit_code) return std::nullopt;
+    result.exit_code = exit_code.value();
+    return result;
+}
+
+} // namespace adb
@@ -0,0 +1,192 @@
+#include "adb/shell_v2.hpp"
+#include "adb/adb_connection.hpp"
+
+#include <charconv>
+
+namespace adb {
+
+namespace {
+
+constexpr size_t HEADER_SIZE = 5;
+constexpr const char* LEGACY_MARKER = "\x1f__lcr_exit:";
+
+uint32_t read_le32(const char* p) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(p[0])) |
+           static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 8 |
+           static_cast<uint32_t>(static_cast<uint8_t>(p[2])) << 16 |
+           static_cast<uint32_t>(static_cast<uint8_t>(p[3])) << 24;
+}
+
+} // namespace
+
+// ============ ShellPacketParser ============
+
+bool ShellPacketParser::feed(std::string_view data, const PacketCallback& on_packet) {
+    // Packets normally come straight from the read buffer; only a packet
+    // split across reads is carried over in pending_
+    std::string_view input = data;
+    if (!pending_.empty()) {
+        pending_.append(data.data(), data.size());
+        input = pending_;
+    }
+
+    size_t consumed = 0;
+    while (input.size() - consumed >= HEADER_SIZE) {
+        uint32_t length = read_le32(input.data() + consumed + 1);
+        if (input.size() - consumed - HEADER_SIZE < length) break;
+        if (!on_packet(static_cast<uint8_t>(input[consumed]), input.substr(consumed + HEADER_SIZE, length))) {
+            pending_.clear();
+            return false;
+        }
+        consumed += HEADER_SIZE + length;
+    }
+
+    std::string rest(input.substr(consumed));
+    pending_ = std::move(rest);
+    return true;
+}
+
+std::string ShellPacketParser::encode(uint8_t id, std::string_view payload) {
+    std::string packet(HEADER_SIZE, '\0');
+    packet[0] = static_cast<char>(id);
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    for (int i = 0; i < 4; ++i) {
+        packet[1 + i] = static_cast<char>((length >> (8 * i)) & 0xff);
+    }
+    packet.append(payload.data(), payload.size());
+    return packet;
+}
+
+// ============ ShellV2Client ============
+
+ShellV2Client::ShellV2Client(const std::string& serial, bool try_v2)
+    : serial_(serial), v2_supported_(try_v2) {}
+
+std::optional<ShellResult> ShellV2Client::run(const std::string& command, int timeout_ms) {
+    ShellResult result;
+    auto exit_code = run_streaming(command, [&result](Stream stream, std::string_view data) {
+        (stream == Stream::OUT ? result.out : result.err).append(data.data(), data.size());
+        return true;
+    }, timeout_ms);
+
+    if (!exit_code) return std::nullopt;
+    result.exit_code = exit_code.value();
+    result.protocol_v2 = v2_supported_;
+    return result;
+}
+
+std::optional<int> ShellV2Client::run_streaming(const std::string& command, const StreamCallback& on_data,
+                                                int timeout_ms) {
+    if (v2_supported_) {
+        bool unsupported = false;
+        auto exit_code = run_v2(command, on_data, timeout_ms, unsupported);
+        if (!unsupported) return exit_code;
+    }
+
+    auto exit_code = run_legacy(command, on_data, timeout_ms);
+    if (exit_code) v2_supported_ = false;      // only once the old protocol is known to work
+    return exit_code;
+}
+
+std::optional<int> ShellV2Client::run_v2(const std::string& command, const StreamCallback& on_data,
+                                         int timeout_ms, bool& unsupported) {
+    AdbConnection connection;
+    connection.set_timeout(timeout_ms);
+    if (!connection.connect() || !connection.switch_transport(serial_)) {
+        last_error_ = connection.last_error();
+        return std::nullopt;
+    }
+
+    // adbd without shell_v2 does not know the service and closes the stream
+    if (!connection.request("shell,v2,raw:" + command)) {
+        last_error_ = connection.last_error();
+        unsupported = true;
+        return std::nullopt;
+    }
+
+    // Nothing to send: close stdin so commands that read it see EOF
+    std::string close_stdin = ShellPacketParser::encode(ShellPacketParser::ID_CLOSE_STDIN, {});
+    connection.write_all(close_stdin.data(), close_stdin.size());
+
+    ShellPacketParser parser;
+    int exit_code = -1;
+    bool stopped = false;
+    char buffer[64 * 1024];
+
+    while (true) {
+        long n = connection.read_some(buffer, sizeof(buffer));
+        if (n == 0) break;
+        if (n < 0) {
+            if (exit_code >= 0) break;      // reset after the exit packet: nothing was lost
+            last_error_ = "Shell read failed or timed out";
+            return std::nullopt;
+        }
+
+        bool ok = parser.feed(std::string_view(buffer, static_cast<size_t>(n)),
+                              [&](uint8_t id, std::string_view payload) {
+            switch (id) {
+                case ShellPacketParser::ID_STDOUT:
+                    return on_data(Stream::OUT, payload);
+                case ShellPacketParser::ID_STDERR:
+                    return on_data(Stream::ERR, payload);
+                case ShellPacketParser::ID_EXIT:
+                    if (!payload.empty()) exit_code = static_cast<uint8_t>(payload[0]);
+                    return true;
+                default:
+                    return true;
+            }
+        });
+        if (!ok) {
+            stopped = true;
+            break;
+        }
+    }
+
+    return stopped ? -1 : exit_code;
+}
+
+std::optional<int> ShellV2Client::run_legacy(const std::string& command, const StreamCallback& on_data,
+                                             int timeout_ms) {
+    AdbConnection connection;
+    connection.set_timeout(timeout_ms);
+    if (!connection.connect() || !connection.switch_transport(serial_)) {
+        last_error_ = connection.last_error();
+        return std::nullopt;
+    }
+
+    // No exit packet: append the status behind a marker line (subshell, so
+    // an "exit" in the command cannot skip it)
+    std::string framed = "(" + command + "); printf '\\n%s%d\\n' '" + LEGACY_MARKER + "' $?";
+    if (!connection.request("shell:" + framed)) {
+        last_error_ = connection.last_error();
+        return std::nullopt;
+    }
+
+    auto output = connection.read_to_end();
+    if (!output) {
+        last_error_ = connection.last_error();
+        return std::nullopt;
+    }
+
+    // Old adbd runs commands on a PTY: undo its CRLF translation
+    std::string text;
+    text.reserve(output->size());
+    for (size_t i = 0; i < output->size(); ++i) {
+        if ((*output)[i] == '\r' && i + 1 < output->size() && (*output)[i + 1] == '\n') continue;
+        text.push_back((*output)[i]);
+    }
+
+    int exit_code = -1;
+    size_t marker = text.rfind(LEGACY_MARKER);
+    if (marker != std::string::npos) {
+        const char* digits = text.data() + marker + std::char_traits<char>::length(LEGACY_MARKER);
+        std::from_chars(digits, text.data() + text.size(), exit_code);
+        // Drop the marker line and the newline printed in front of it
+        text.resize(marker > 0 ? marker - 1 : 0);
+    }
+
+    if (!text.empty()) on_data(Stream::OUT, text);
+    return exit_code;
+}
+
+} // namespace adb
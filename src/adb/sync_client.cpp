@@ -0,0 +1,751 @@
+#include "adb/sync_client.hpp"
+#include "net/tcp_socket.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace adb {
+
+namespace {
+
+// Requests written before their replies are read; keeps both directions
+// well below the socket buffers so neither side can block the other
+constexpr size_t MAX_BATCH_BYTES = 16 * 1024;
+
+// Receive buffer for replies and buffered file payload
+constexpr size_t READ_BUFFER_SIZE = 256 * 1024;
+
+// Largest DATA payload adbd accepts (SYNC_DATA_MAX)
+constexpr size_t SYNC_DATA_MAX = 64 * 1024;
+
+// struct sync_stat_v2 after the 4-byte id; sync_dent_v2 adds a name length
+constexpr size_t STAT_V2_SIZE = 68;
+constexpr size_t DENT_V2_SIZE = STAT_V2_SIZE + 4;
+// struct sync_stat / sync_dent (v1) after the id
+constexpr size_t STAT_V1_SIZE = 12;
+constexpr size_t DENT_V1_SIZE = 16;
+
+uint32_t le32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+uint64_t le64(const unsigned char* p) {
+    return static_cast<uint64_t>(le32(p)) | static_cast<uint64_t>(le32(p + 4)) << 32;
+}
+
+void append_le32(std::string& batch, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        batch.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+void append_request(std::string& batch, const char* id, std::string_view path) {
+    batch.append(id, 4);
+    append_le32(batch, static_cast<uint32_t>(path.size()));
+    batch.append(path.data(), path.size());
+}
+
+// Fixed-size message: id + one u32 (RCV2 flags, DONE mtime)
+void append_word(std::string& batch, const char* id, uint32_t value) {
+    batch.append(id, 4);
+    append_le32(batch, value);
+}
+
+FileStat parse_stat_v2(const unsigned char* p) {
+    FileStat stat;
+    stat.error = le32(p);
+    stat.ino = le64(p + 12);
+    stat.mode = le32(p + 20);
+    stat.nlink = le32(p + 24);
+    stat.uid = le32(p + 28);
+    stat.gid = le32(p + 32);
+    stat.size = le64(p + 36);
+    stat.mtime = static_cast<int64_t>(le64(p + 52));
+    return stat;
+}
+
+FileStat parse_stat_v1(const unsigned char* p) {
+    FileStat stat;
+    stat.mode = le32(p);
+    stat.size = le32(p + 4);
+    stat.mtime = le32(p + 8);
+    return stat;
+}
+
+bool is_id(const char* id, const char* expected) {
+    return std::memcmp(id, expected, 4) == 0;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+bool write_fully(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+#ifdef __linux__
+// Move `length` bytes socket -> pipe -> file without copying through user space
+bool splice_exact(int socket_fd, const int pipe_fds[2], int file_fd, size_t length, int timeout_ms) {
+    while (length > 0) {
+        if (!net::wait_readable(socket_fd, timeout_ms)) return false;
+        ssize_t in = splice(socket_fd, nullptr, pipe_fds[1], nullptr, length, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (in < 0 && errno == EINTR) continue;
+        if (in <= 0) return false;
+        length -= static_cast<size_t>(in);
+
+        while (in > 0) {
+            ssize_t out = splice(pipe_fds[0], nullptr, file_fd, nullptr, static_cast<size_t>(in),
+                                 SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (out < 0 && errno == EINTR) continue;
+            if (out <= 0) return false;
+            in -= out;
+        }
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+SyncClient::SyncClient(const std::string& serial, bool use_v2)
+    : serial_(serial), v2_(use_v2) {}
+
+SyncClient::~SyncClient() {
+    close();
+}
+
+bool SyncClient::open(int timeout_ms) {
+    close();
+    timeout_ms_ = timeout_ms;
+    connection_.set_timeout(timeout_ms);
+    if (!connection_.connect() || !connection_.switch_transport(serial_) || !connection_.request("sync:")) {
+        last_error_ = connection_.last_error();
+        connection_.close();
+        return false;
+    }
+    return true;
+}
+
+void SyncClient::close() {
+    if (connection_.is_open()) {
+        std::string quit;
+        append_request(quit, "QUIT", {});
+        connection_.write_all(quit.data(), quit.size());
+        connection_.close();
+    }
+    rpos_ = 0;
+    rend_ = 0;
+}
+
+// ============ Buffered reads ============
+
+bool SyncClient::fill(size_t n) {
+    if (buffered() >= n) return true;
+
+    if (rpos_ > 0) {
+        std::memmove(rbuf_.data(), rbuf_.data() + rpos_, buffered());
+        rend_ -= rpos_;
+        rpos_ = 0;
+    }
+    size_t limit = read_ahead_ ? std::max(n, READ_BUFFER_SIZE) : n;
+    if (rbuf_.size() < limit) rbuf_.resize(limit);
+
+    while (rend_ < n) {
+        long got = connection_.read_some(rbuf_.data() + rend_, limit - rend_);
+        if (got <= 0) {
+            last_error_ = got == 0 ? "Sync session closed by device" : "Sync read failed or timed out";
+            return false;
+        }
+        rend_ += static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool SyncClient::take(void* out, size_t n) {
+    if (!fill(n)) return false;
+    std::memcpy(out, rbuf_.data() + rpos_, n);
+    rpos_ += n;
+    return true;
+}
+
+bool SyncClient::take_string(std::string& out, size_t n) {
+    if (!fill(n)) return false;
+    out.assign(rbuf_.data() + rpos_, n);
+    rpos_ += n;
+    return true;
+}
+
+bool SyncClient::read_fail_message() {
+    unsigned char length[4];
+    std::string message;
+    if (take(length, 4) && take_string(message, le32(length))) {
+        last_error_ = "Sync request failed: " + message;
+    }
+    rejected_ = true;
+    return false;
+}
+
+// ============ Requests ============
+
+bool SyncClient::send_batch(const std::string& batch) {
+    if (!connection_.write_all(batch.data(), batch.size())) {
+        last_error_ = connection_.last_error();
+        return false;
+    }
+    return true;
+}
+
+bool SyncClient::read_stat(FileStat& out) {
+    char id[4];
+    if (!take(id, 4)) return false;
+    if (is_id(id, "FAIL")) return read_fail_message();
+
+    if (v2_) {
+        unsigned char body[STAT_V2_SIZE];
+        if (!take(body, sizeof(body))) return false;
+        out = parse_stat_v2(body);
+    } else {
+        unsigned char body[STAT_V1_SIZE];
+        if (!take(body, sizeof(body))) return false;
+        out = parse_stat_v1(body);
+    }
+    return true;
+}
+
+bool SyncClient::read_listing(std::vector<DirEntry>& out) {
+    const size_t entry_size = v2_ ? DENT_V2_SIZE : DENT_V1_SIZE;
+    const char* entry_id = v2_ ? "DNT2" : "DENT";
+    unsigned char body[DENT_V2_SIZE];
+
+    while (true) {
+        char id[4];
+        if (!take(id, 4)) return false;
+        if (is_id(id, "FAIL")) return read_fail_message();
+        if (!take(body, entry_size)) return false;
+        if (is_id(id, "DONE")) return true;
+        if (!is_id(id, entry_id)) {
+            last_error_ = "Unexpected sync reply";
+            return false;
+        }
+
+        DirEntry entry;
+        uint32_t name_length = le32(body + entry_size - 4);
+        if (!take_string(entry.name, name_length)) return false;
+        if (entry.name == "." || entry.name == "..") continue;
+        entry.stat = v2_ ? parse_stat_v2(body) : parse_stat_v1(body);
+        out.push_back(std::move(entry));
+    }
+}
+
+template <class Result, class Request, class Read>
+std::optional<std::vector<Result>> SyncClient::pipeline(const std::vector<std::string>& paths,
+                                                        Request&& request, Read&& read) {
+    read_ahead_ = true;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!is_open() && !open()) return std::nullopt;
+
+        std::vector<Result> results;
+        results.reserve(paths.size());
+        rejected_ = false;
+        bool failed = false;
+
+        size_t next = 0;
+        while (next < paths.size() && !failed) {
+            std::string batch;
+            size_t first = next;
+            while (next < paths.size() && batch.size() < MAX_BATCH_BYTES) {
+                request(batch, paths[next++]);
+            }
+            if (!send_batch(batch)) {
+                failed = true;
+                break;
+            }
+            for (size_t i = first; i < next; ++i) {
+                Result result;
+                if (!read(result)) {
+                    failed = true;
+                    break;
+                }
+                results.push_back(std::move(result));
+            }
+        }
+
+        if (!failed) {
+            v2_confirmed_ = v2_confirmed_ || v2_;
+            return results;
+        }
+
+        // adbd without stat_v2/ls_v2 fails the first v2 request and drops
+        // the session; anything else is a lost connection
+        close();
+        if (!(v2_ && !v2_confirmed_ && rejected_ && results.empty())) break;
+        v2_ = false;
+    }
+    return std::nullopt;
+}
+
+std::optional<std::vector<FileStat>> SyncClient::stat(const std::vector<std::string>& paths,
+                                                      bool follow_links) {
+    return pipeline<FileStat>(paths,
+        [&](std::string& batch, const std::string& path) {
+            append_request(batch, !v2_ ? "STAT" : (follow_links ? "STA2" : "LST2"), path);
+        },
+        [&](FileStat& out) { return read_stat(out); });
+}
+
+std::optional<std::vector<std::vector<DirEntry>>> SyncClient::list(const std::vector<std::string>& dirs) {
+    return pipeline<std::vector<DirEntry>>(dirs,
+        [&](std::string& batch, const std::string& dir) {
+            append_request(batch, v2_ ? "LIS2" : "LIST", dir);
+        },
+        [&](std::vector<DirEntry>& out) { return read_listing(out); });
+}
+
+// ============ File transfer ============
+
+SyncClient::FileReply SyncClient::read_file(const std::function<bool(size_t)>& payload, TransferStats& stats,
+                                            std::chrono::steady_clock::time_point start) {
+    while (true) {
+        char id[4];
+        unsigned char length[4];
+        if (!take(id, 4)) return FileReply::BROKEN;
+        if (is_id(id, "FAIL")) {
+            read_fail_message();
+            return FileReply::FAILED;
+        }
+        if (!take(length, 4)) return FileReply::BROKEN;
+
+        if (is_id(id, "DONE")) {
+            stats.total_ms = elapsed_ms(start);
+            return FileReply::DONE;
+        }
+        if (!is_id(id, "DATA")) {
+            last_error_ = "Unexpected sync reply";
+            return FileReply::BROKEN;
+        }
+
+        size_t size = le32(length);
+        if (stats.wire_bytes == 0) stats.first_byte_ms = elapsed_ms(start);
+        if (!payload(size)) return FileReply::BROKEN;
+        stats.bytes += size;
+        stats.wire_bytes += size;
+    }
+}
+
+bool SyncClient::deliver(size_t size, const DataCallback& on_data) {
+    bool stopped = false;
+    auto forward = [&](std::string_view chunk) {
+        decoded_bytes_ += chunk.size();
+        stopped = on_data && !on_data(chunk);
+        return !stopped;
+    };
+
+    while (size > 0) {
+        if (!fill(1)) return false;
+        size_t chunk = std::min(size, buffered());
+        std::string_view data(rbuf_.data() + rpos_, chunk);
+        if (!(decoder_ ? decoder_->feed(data, forward) : forward(data))) {
+            last_error_ = stopped ? "Transfer stopped by consumer"
+                                  : std::string("Corrupt ") + compression_name(compression_) + " stream";
+            return false;
+        }
+        rpos_ += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+std::optional<TransferStats> SyncClient::receive(const std::string& remote, const std::string& prefix,
+                                                 const std::function<bool()>& read_prefix,
+                                                 const std::function<bool(size_t)>& payload) {
+    if (!is_open() && !open()) return std::nullopt;
+
+    const Compression method = compression_;
+    std::string batch = prefix;
+    if (method == Compression::NONE) {
+        append_request(batch, "RECV", remote);
+    } else {
+        decoder_ = StreamDecoder::create(method);
+        if (!decoder_) {
+            last_error_ = std::string(compression_name(method)) + " support not compiled in";
+            return std::nullopt;
+        }
+        decoded_bytes_ = 0;
+        append_request(batch, "RCV2", remote);
+        append_word(batch, "RCV2", static_cast<uint32_t>(method));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!send_batch(batch) || (read_prefix && !read_prefix())) {
+        decoder_.reset();
+        close();
+        return std::nullopt;
+    }
+
+    TransferStats stats;
+    stats.compression = method;
+    FileReply reply = read_file(payload, stats, start);
+    std::unique_ptr<StreamDecoder> decoder = std::move(decoder_);
+    if (reply == FileReply::DONE) {
+        if (!decoder) return stats;
+        if (decoder->finished()) {
+            stats.bytes = decoded_bytes_;
+            return stats;
+        }
+        last_error_ = std::string("Truncated ") + compression_name(method) + " stream";
+    }
+
+    // A failed RECV ends the session on the device, and mid-transfer
+    // the stream cannot be resynchronised
+    close();
+
+    // adbd that advertises a codec but cannot serve it fails the RCV2
+    // before any data; plain RECV tells that apart from an unreadable file
+    if (reply == FileReply::FAILED && method != Compression::NONE && stats.wire_bytes == 0) {
+        compression_ = Compression::NONE;
+        auto retry = receive(remote, prefix, read_prefix, payload);
+        if (!retry) compression_ = method;
+        return retry;
+    }
+    return std::nullopt;
+}
+
+std::optional<TransferStats> SyncClient::pull(const std::string& remote, const DataCallback& on_data) {
+    read_ahead_ = true;
+    return receive(remote, {}, nullptr, [&](size_t size) { return deliver(size, on_data); });
+}
+
+std::optional<BundleManifest> SyncClient::pull_bundle(const std::vector<std::string>& remotes,
+                                                      const BundleCallback& on_data) {
+    read_ahead_ = true;
+    BundleManifest manifest;
+    manifest.entries.resize(remotes.size());
+    for (size_t i = 0; i < remotes.size(); ++i) {
+        manifest.entries[i].remote = remotes[i];
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t next = 0;                // first file whose reply has not been read
+    std::string broken;             // set once the connection itself is gone
+
+    while (next < remotes.size() && broken.empty()) {
+        if (!is_open() && !open()) {
+            if (manifest.sessions == 0) return std::nullopt;
+            broken = last_error_;
+            break;
+        }
+        ++manifest.sessions;
+
+        bool session_open = true;
+        while (next < remotes.size() && session_open) {
+            // RECVs go out a window at a time; adbd answers them in order
+            std::string batch;
+            size_t end = next;
+            while (end < remotes.size() && batch.size() < MAX_BATCH_BYTES) {
+                append_request(batch, "RECV", remotes[end++]);
+            }
+            if (!send_batch(batch)) {
+                broken = last_error_;
+                break;
+            }
+
+            for (; next < end; ++next) {
+                BundleEntry& entry = manifest.entries[next];
+                bool wanted = true;
+                size_t index = next;
+                auto payload = [&](size_t size) {
+                    return deliver(size, [&](std::string_view chunk) {
+                        if (wanted && on_data) wanted = on_data(index, chunk);
+                        return true;
+                    });
+                };
+
+                FileReply reply = read_file(payload, entry.stats, start);
+                if (reply == FileReply::DONE) {
+                    entry.ok = true;
+                    manifest.total_bytes += entry.stats.bytes;
+                    continue;
+                }
+
+                entry.error = last_error_;
+                close();
+                if (reply == FileReply::BROKEN) {
+                    broken = last_error_;
+                } else {
+                    ++next;     // resend the rest on a new session
+                }
+                session_open = false;
+                break;
+            }
+        }
+    }
+
+    // Files never answered because the connection was lost
+    for (; next < remotes.size(); ++next) {
+        if (manifest.entries[next].error.empty()) manifest.entries[next].error = broken;
+    }
+
+    manifest.total_ms = elapsed_ms(start);
+    return manifest;
+}
+
+std::optional<TransferStats> SyncClient::pull_to_file(const std::string& remote, const std::string& local,
+                                                      PullMode mode) {
+#ifndef __linux__
+    if (mode == PullMode::SPLICE) mode = PullMode::BUFFERED;
+#endif
+    // Compressed payload has to pass through the decoder
+    if (compression_ != Compression::NONE) mode = PullMode::BUFFERED;
+
+    // Payload goes to a new file next to `local` that replaces it only once
+    // the pull is complete, so a failed pull leaves an existing file intact
+    static std::atomic<unsigned> partial_count{0};
+    std::string partial = local + ".partial-" + std::to_string(getpid()) + "-" + std::to_string(partial_count++);
+    int flags = (mode == PullMode::MMAP ? O_RDWR : O_WRONLY) | O_CREAT | O_EXCL | O_CLOEXEC;
+    int fd = ::open(partial.c_str(), flags, 0644);
+    if (fd < 0) {
+        last_error_ = "Cannot create " + partial + ": " + std::strerror(errno);
+        return std::nullopt;
+    }
+
+    // Bytes of the current DATA payload still in the receive buffer go
+    // out first; the rest can bypass the buffer
+    auto drain_buffered = [&](size_t& size, auto&& sink) {
+        size_t chunk = std::min(size, buffered());
+        if (chunk > 0) {
+            if (!sink(rbuf_.data() + rpos_, chunk)) return false;
+            rpos_ += chunk;
+            size -= chunk;
+        }
+        return true;
+    };
+
+    std::optional<TransferStats> stats;
+    if (mode == PullMode::BUFFERED) {
+        read_ahead_ = true;
+        bool write_failed = false;
+        stats = receive(remote, {}, nullptr, [&](size_t size) {
+            return deliver(size, [&](std::string_view chunk) {
+                write_failed = !write_fully(fd, chunk.data(), chunk.size());
+                return !write_failed;
+            });
+        });
+        if (write_failed) last_error_ = "Write to " + local + " failed";
+    }
+#ifdef __linux__
+    else if (mode == PullMode::SPLICE) {
+        int pipe_fds[2];
+        if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+            ::close(fd);
+            ::unlink(partial.c_str());
+            last_error_ = "Cannot create pipe";
+            return std::nullopt;
+        }
+        read_ahead_ = false;
+        stats = receive(remote, {}, nullptr, [&](size_t size) {
+            if (!drain_buffered(size, [&](const char* data, size_t n) { return write_fully(fd, data, n); }) ||
+                !splice_exact(connection_.fd(), pipe_fds, fd, size, timeout_ms_)) {
+                last_error_ = "Sync payload to " + local + " failed (connection lost or write error)";
+                return false;
+            }
+            return true;
+        });
+        ::close(pipe_fds[0]);
+        ::close(pipe_fds[1]);
+    }
+#endif
+    else {
+        // STAT rides in the same write as RECV; its size presizes the mapping,
+        // which grows if the file changed in between
+        char* map = nullptr;
+        size_t mapped = 0;
+        size_t offset = 0;
+
+        auto remap = [&](size_t size) {
+            if (map) munmap(map, mapped);
+            map = nullptr;
+            mapped = 0;
+            if (size == 0) return true;
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0) return false;
+            void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (region == MAP_FAILED) return false;
+            map = static_cast<char*>(region);
+            mapped = size;
+            return true;
+        };
+
+        std::string prefix;
+        append_request(prefix, "STAT", remote);
+        read_ahead_ = false;
+        stats = receive(remote, prefix,
+            [&]() {
+                char id[4];
+                unsigned char body[STAT_V1_SIZE];
+                if (!take(id, 4) || !take(body, sizeof(body))) return false;
+                return remap(parse_stat_v1(body).size);
+            },
+            [&](size_t size) {
+                if (offset + size > mapped && !remap(std::max(offset + size, mapped * 2))) {
+                    last_error_ = "Cannot map " + local;
+                    return false;
+                }
+                bool ok = drain_buffered(size, [&](const char* data, size_t n) {
+                    std::memcpy(map + offset, data, n);
+                    offset += n;
+                    return true;
+                });
+                if (ok && size > 0) {
+                    ok = connection_.read_exact(map + offset, size);
+                    if (!ok) last_error_ = connection_.last_error();
+                    offset += size;
+                }
+                return ok;
+            });
+
+        if (map) munmap(map, mapped);
+        if (stats && ftruncate(fd, static_cast<off_t>(offset)) != 0) stats.reset();
+    }
+
+    read_ahead_ = true;
+    ::close(fd);
+    if (stats && ::rename(partial.c_str(), local.c_str()) != 0) {
+        last_error_ = "Cannot replace " + local + ": " + std::strerror(errno);
+        stats.reset();
+    }
+    if (!stats) {
+        ::unlink(partial.c_str());
+    }
+    return stats;
+}
+
+std::optional<TransferStats> SyncClient::push(const std::string& local, const std::string& remote,
+                                              uint32_t mode) {
+    int fd = ::open(local.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        last_error_ = "Cannot open " + local + ": " + std::strerror(errno);
+        return std::nullopt;
+    }
+    struct stat info;
+    uint32_t mtime = fstat(fd, &info) == 0 ? static_cast<uint32_t>(info.st_mtime) : 0;
+
+    auto stats = send_file(fd, remote, mode, mtime);
+    ::close(fd);
+    return stats;
+}
+
+std::optional<TransferStats> SyncClient::send_file(int fd, const std::string& remote, uint32_t mode,
+                                                   uint32_t mtime) {
+    read_ahead_ = true;
+    if (!is_open() && !open()) return std::nullopt;
+
+    const Compression method = compression_;
+    const uint32_t file_mode = 0100000 | (mode & 07777);
+    std::unique_ptr<StreamEncoder> encoder;
+    std::string out;
+    if (method == Compression::NONE) {
+        append_request(out, "SEND", remote + "," + std::to_string(file_mode));
+    } else {
+        encoder = StreamEncoder::create(method);
+        if (!encoder) {
+            last_error_ = std::string(compression_name(method)) + " support not compiled in";
+            return std::nullopt;
+        }
+        append_request(out, "SND2", remote);
+        append_word(out, "SND2", file_mode);
+        append_le32(out, static_cast<uint32_t>(method));
+    }
+
+    TransferStats stats;
+    stats.compression = method;
+    auto start = std::chrono::steady_clock::now();
+
+    auto flush = [&]() {
+        if (!send_batch(out)) return false;
+        if (stats.first_byte_ms == 0 && stats.wire_bytes > 0) stats.first_byte_ms = elapsed_ms(start);
+        out.clear();
+        return true;
+    };
+    // DATA packets are queued and written a receive buffer's worth at a time
+    auto emit = [&](std::string_view data) {
+        while (!data.empty()) {
+            size_t n = std::min(data.size(), SYNC_DATA_MAX);
+            append_request(out, "DATA", data.substr(0, n));
+            stats.wire_bytes += n;
+            data.remove_prefix(n);
+            if (out.size() >= READ_BUFFER_SIZE && !flush()) return false;
+        }
+        return true;
+    };
+
+    std::vector<char> block(READ_BUFFER_SIZE);
+    bool sent = true;
+    bool local_error = false;
+    while (sent) {
+        ssize_t n = ::read(fd, block.data(), block.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            last_error_ = std::string("Local read failed: ") + std::strerror(errno);
+            local_error = true;
+            break;
+        }
+        if (n == 0) break;
+        stats.bytes += static_cast<uint64_t>(n);
+        std::string_view data(block.data(), static_cast<size_t>(n));
+        sent = encoder ? encoder->feed(data, emit) : emit(data);
+    }
+    if (sent && !local_error && encoder) sent = encoder->finish(emit);
+    if (sent && !local_error) {
+        append_word(out, "DONE", mtime);
+        sent = flush();
+    }
+
+    // OKAY once the file is written, FAIL at the first error; adbd may stop
+    // reading after a FAIL, so its reason is still read after a failed write
+    FileReply reply = FileReply::BROKEN;
+    char id[4];
+    unsigned char word[4];
+    if (!local_error && take(id, 4)) {
+        if (is_id(id, "FAIL")) {
+            read_fail_message();
+            reply = FileReply::FAILED;
+        } else if (sent && is_id(id, "OKAY") && take(word, 4)) {
+            reply = FileReply::DONE;
+        } else if (sent) {
+            last_error_ = "Unexpected sync reply";
+        }
+    }
+    if (reply == FileReply::DONE) {
+        stats.total_ms = elapsed_ms(start);
+        return stats;
+    }
+    close();
+
+    // As for RCV2: an advertised but unusable codec is retried once as SEND
+    if (reply == FileReply::FAILED && method != Compression::NONE) {
+        compression_ = Compression::NONE;
+        if (::lseek(fd, 0, SEEK_SET) == 0) {
+            auto retry = send_file(fd, remote, mode, mtime);
+            if (retry) return retry;
+        }
+        compression_ = method;
+    }
+    return std::nullopt;
+}
+
+} // namespace adb
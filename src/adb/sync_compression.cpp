@@ -0,0 +1,321 @@
+#include "adb/sync_compression.hpp"
+
+#include <algorithm>
+
+#ifdef LINECHECK_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef LINECHECK_HAVE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef LINECHECK_HAVE_BROTLI
+#include <brotli/decode.h>
+#include <brotli/encode.h>
+#endif
+
+namespace adb {
+
+namespace {
+
+// Output is handed to the sink in blocks of this size
+constexpr size_t OUTPUT_BLOCK = 128 * 1024;
+
+// Speed over ratio: the host must keep up with USB 3 while encoding,
+// and adbd decodes pushes on the phone
+#ifdef LINECHECK_HAVE_ZSTD
+constexpr int ZSTD_LEVEL = 1;
+#endif
+#ifdef LINECHECK_HAVE_BROTLI
+constexpr int BROTLI_QUALITY = 1;
+#endif
+
+#ifdef LINECHECK_HAVE_ZSTD
+class ZstdDecoder : public StreamDecoder {
+public:
+    ZstdDecoder() : ctx_(ZSTD_createDStream()), out_(OUTPUT_BLOCK) {}
+    ~ZstdDecoder() override { ZSTD_freeDStream(ctx_); }
+
+    bool feed(std::string_view input, const CodecSink& output) override {
+        ZSTD_inBuffer in{input.data(), input.size(), 0};
+        // A full output buffer means the decoder may hold more
+        bool full = true;
+        while (in.pos < in.size || full) {
+            ZSTD_outBuffer out{out_.data(), out_.size(), 0};
+            size_t rc = ZSTD_decompressStream(ctx_, &out, &in);
+            if (ZSTD_isError(rc)) return false;
+            frame_done_ = rc == 0;
+            if (out.pos > 0 && !output(std::string_view(out_.data(), out.pos))) return false;
+            full = out.pos == out.size;
+        }
+        return true;
+    }
+
+    bool finished() const override { return frame_done_; }
+
+private:
+    ZSTD_DStream* ctx_;
+    std::vector<char> out_;
+    bool frame_done_ = true;
+};
+
+class ZstdEncoder : public StreamEncoder {
+public:
+    ZstdEncoder() : ctx_(ZSTD_createCCtx()), out_(ZSTD_CStreamOutSize()) {
+        ZSTD_CCtx_setParameter(ctx_, ZSTD_c_compressionLevel, ZSTD_LEVEL);
+    }
+    ~ZstdEncoder() override { ZSTD_freeCCtx(ctx_); }
+
+    bool feed(std::string_view input, const CodecSink& output) override {
+        return run(input, ZSTD_e_continue, output);
+    }
+
+    bool finish(const CodecSink& output) override {
+        return run({}, ZSTD_e_end, output);
+    }
+
+private:
+    ZSTD_CCtx* ctx_;
+    std::vector<char> out_;
+
+    bool run(std::string_view input, ZSTD_EndDirective mode, const CodecSink& output) {
+        ZSTD_inBuffer in{input.data(), input.size(), 0};
+        while (true) {
+            ZSTD_outBuffer out{out_.data(), out_.size(), 0};
+            size_t remaining = ZSTD_compressStream2(ctx_, &out, &in, mode);
+            if (ZSTD_isError(remaining)) return false;
+            if (out.pos > 0 && !output(std::string_view(out_.data(), out.pos))) return false;
+            bool done = mode == ZSTD_e_end ? remaining == 0 : in.pos == in.size;
+            if (done) return true;
+        }
+    }
+};
+#endif
+
+#ifdef LINECHECK_HAVE_LZ4
+class Lz4Decoder : public StreamDecoder {
+public:
+    Lz4Decoder() : out_(OUTPUT_BLOCK) {
+        LZ4F_createDecompressionContext(&ctx_, LZ4F_VERSION);
+    }
+    ~Lz4Decoder() override { LZ4F_freeDecompressionContext(ctx_); }
+
+    bool feed(std::string_view input, const CodecSink& output) override {
+        const char* src = input.data();
+        size_t left = input.size();
+        // Loop until the input is used up and the decoder has nothing left to flush
+        while (true) {
+            size_t src_size = left;
+            size_t dst_size = out_.size();
+            size_t hint = LZ4F_decompress(ctx_, out_.data(), &dst_size, src, &src_size, nullptr);
+            if (LZ4F_isError(hint)) return false;
+            frame_done_ = hint == 0;
+            src += src_size;
+            left -= src_size;
+            if (dst_size > 0 && !output(std::string_view(out_.data(), dst_size))) return false;
+            if (left == 0 && dst_size < out_.size()) return true;
+        }
+    }
+
+    bool finished() const override { return frame_done_; }
+
+private:
+    LZ4F_dctx* ctx_ = nullptr;
+    std::vector<char> out_;
+    bool frame_done_ = true;
+};
+
+class Lz4Encoder : public StreamEncoder {
+public:
+    Lz4Encoder() {
+        LZ4F_createCompressionContext(&ctx_, LZ4F_VERSION);
+    }
+    ~Lz4Encoder() override { LZ4F_freeCompressionContext(ctx_); }
+
+    bool feed(std::string_view input, const CodecSink& output) override {
+        if (!started_ && !begin(output)) return false;
+        while (!input.empty()) {
+            size_t take = std::min(input.size(), OUTPUT_BLOCK);
+            out_.resize(LZ4F_compressBound(take, nullptr));
+            size_t n = LZ4F_compressUpdate(ctx_, out_.data(), out_.size(), input.data(), take, nullptr);
+            if (LZ4F_isError(n)) return false;
+            if (n > 0 && !output(std::string_view(out_.data(), n))) return false;
+            input.remove_prefix(take);
+        }
+        return true;
+    }
+
+    bool finish(const CodecSink& output) override {
+        if (!started_ && !begin(output)) return false;
+        out_.resize(LZ4F_compressBound(0, nullptr));
+        size_t n = LZ4F_compressEnd(ctx_, out_.data(), out_.size(), nullptr);
+        if (LZ4F_isError(n)) return false;
+        return n == 0 || output(std::string_view(out_.data(), n));
+    }
+
+private:
+    LZ4F_cctx* ctx_ = nullptr;
+    std::vector<char> out_;
+    bool started_ = false;
+
+    bool begin(const CodecSink& output) {
+        started_ = true;
+        out_.resize(LZ4F_HEADER_SIZE_MAX);
+        size_t n = LZ4F_compressBegin(ctx_, out_.data(), out_.size(), nullptr);
+        if (LZ4F_isError(n)) return false;
+        return output(std::string_view(out_.data(), n));
+    }
+};
+#endif
+
+#ifdef LINECHECK_HAVE_BROTLI
+class BrotliDecoder : public StreamDecoder {
+public:
+    BrotliDecoder() : ctx_(BrotliDecoderCreateInstance(nullptr, nullptr, nullptr)), out_(OUTPUT_BLOCK) {}
+    ~BrotliDecoder() override { BrotliDecoderDestroyInstance(ctx_); }
+
+    bool feed(std::string_view input, const CodecSink& output) override {
+        size_t available_in = input.size();
+        const uint8_t* next_in = reinterpret_cast<const uint8_t*>(input.data());
+        while (true) {
+            size_t available_out = out_.size();
+            uint8_t* next_out = out_.data();
+            BrotliDecoderResult rc = BrotliDecoderDecompressStream(ctx_, &available_in, &next_in,
+                                                                   &available_out, &next_out, nullptr);
+            if (rc == BROTLI_DECODER_RESULT_ERROR) return false;
+            size_t produced = out_.size() - available_out;
+            if (produced > 0 &&
+                !output(std::string_view(reinterpret_cast<const char*>(out_.data()), produced))) {
+                return false;
+            }
+            if (rc != BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) return true;
+        }
+    }
+
+    bool finished() const override { return BrotliDecoderIsFinished(ctx_); }
+
+private:
+    BrotliDecoderState* ctx_;
+    std::vector<uint8_t> out_;
+};
+
+class BrotliEncoder : public StreamEncoder {
+public:
+    BrotliEncoder() : ctx_(BrotliEncoderCreateInstance(nullptr, nullptr, nullptr)), out_(OUTPUT_BLOCK) {
+        BrotliEncoderSetParameter(ctx_, BROTLI_PARAM_QUALITY, BROTLI_QUALITY);
+    }
+    ~BrotliEncoder() override { BrotliEncoderDestroyInstance(ctx_); }
+
+    bool feed(std::string_view input, const CodecSink& output) override {
+        return run(input, BROTLI_OPERATION_PROCESS, output);
+    }
+
+    bool finish(const CodecSink& output) override {
+        return run({}, BROTLI_OPERATION_FINISH, output);
+    }
+
+private:
+    BrotliEncoderState* ctx_;
+    std::vector<uint8_t> out_;
+
+    bool run(std::string_view input, BrotliEncoderOperation op, const CodecSink& output) {
+        size_t available_in = input.size();
+        const uint8_t* next_in = reinterpret_cast<const uint8_t*>(input.data());
+        while (true) {
+            size_t available_out = out_.size();
+            uint8_t* next_out = out_.data();
+            if (!BrotliEncoderCompressStream(ctx_, op, &available_in, &next_in, &available_out, &next_out, nullptr)) {
+                return false;
+            }
+            size_t produced = out_.size() - available_out;
+            if (produced > 0 &&
+                !output(std::string_view(reinterpret_cast<const char*>(out_.data()), produced))) {
+                return false;
+            }
+            bool done = op == BROTLI_OPERATION_FINISH
+                            ? BrotliEncoderIsFinished(ctx_)
+                            : available_in == 0 && !BrotliEncoderHasMoreOutput(ctx_);
+            if (done) return true;
+        }
+    }
+};
+#endif
+
+} // namespace
+
+const char* compression_name(Compression method) {
+    switch (method) {
+        case Compression::BROTLI: return "brotli";
+        case Compression::LZ4: return "lz4";
+        case Compression::ZSTD: return "zstd";
+        default: return "none";
+    }
+}
+
+bool compression_available(Compression method) {
+    switch (method) {
+        case Compression::NONE: return true;
+#ifdef LINECHECK_HAVE_BROTLI
+        case Compression::BROTLI: return true;
+#endif
+#ifdef LINECHECK_HAVE_LZ4
+        case Compression::LZ4: return true;
+#endif
+#ifdef LINECHECK_HAVE_ZSTD
+        case Compression::ZSTD: return true;
+#endif
+        default: return false;
+    }
+}
+
+const char* compression_feature(Compression method) {
+    switch (method) {
+        case Compression::BROTLI: return "sendrecv_v2_brotli";
+        case Compression::LZ4: return "sendrecv_v2_lz4";
+        case Compression::ZSTD: return "sendrecv_v2_zstd";
+        default: return "sendrecv_v2";
+    }
+}
+
+Compression negotiate_compression(const std::vector<std::string>& device_features) {
+    auto has = [&](const char* feature) {
+        return std::find(device_features.begin(), device_features.end(), feature) != device_features.end();
+    };
+    if (!has("sendrecv_v2")) return Compression::NONE;
+
+    for (Compression method : {Compression::ZSTD, Compression::LZ4, Compression::BROTLI}) {
+        if (compression_available(method) && has(compression_feature(method))) return method;
+    }
+    return Compression::NONE;
+}
+
+std::unique_ptr<StreamDecoder> StreamDecoder::create(Compression method) {
+    switch (method) {
+#ifdef LINECHECK_HAVE_ZSTD
+        case Compression::ZSTD: return std::make_unique<ZstdDecoder>();
+#endif
+#ifdef LINECHECK_HAVE_LZ4
+        case Compression::LZ4: return std::make_unique<Lz4Decoder>();
+#endif
+#ifdef LINECHECK_HAVE_BROTLI
+        case Compression::BROTLI: return std::make_unique<BrotliDecoder>();
+#endif
+        default: return nullptr;
+    }
+}
+
+std::unique_ptr<StreamEncoder> StreamEncoder::create(Compression method) {
+    switch (method) {
+#ifdef LINECHECK_HAVE_ZSTD
+        case Compression::ZSTD: return std::make_unique<ZstdEncoder>();
+#endif
+#ifdef LINECHECK_HAVE_LZ4
+        case Compression::LZ4: return std::make_unique<Lz4Encoder>();
+#endif
+#ifdef LINECHECK_HAVE_BROTLI
+        case Compression::BROTLI: return std::make_unique<BrotliEncoder>();
+#endif
+        default: return nullptr;
+    }
+}
+
+} // namespace adb
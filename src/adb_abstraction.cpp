@@ -1,4 +1,5 @@
 #include "adb_abstraction.h"
+#include "parse/line_scanner.hpp"
 #include <iostream>
 #include <cstdlib>
 #include <sstream>
@@ -6,9 +7,51 @@
 #include <unistd.h>
 #include <filesystem>
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// Read timeout for gzip'd shell output: gzip holds output back until a
+// block fills, so slow producers go quiet for longer than usual
+constexpr int GZIP_SHELL_TIMEOUT_MS = 60000;
+
+// Read timeout for abb_exec: the service answers only once the whole call
+// (e.g. a full package list) has been built
+constexpr int ABB_TIMEOUT_MS = 30000;
+
+double ms_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Run one sync request with v2 if the device has `feature`, revoking it
+// if adbd turns out to only speak STAT/LIST
+template <class Call>
+auto with_sync_client(const std::string& serial, adb::CapabilityCache& cache, adb::Feature feature, Call&& call)
+    -> decltype(call(std::declval<adb::SyncClient&>()))
+{
+    auto caps = cache.get(serial);
+    bool use_v2 = !caps || caps->has(feature);
+
+    adb::SyncClient client(serial, use_v2);
+    auto result = call(client);
+    if (result && use_v2 && !client.uses_v2()) {
+        cache.revoke(serial, feature);
+    }
+    return result;
+}
+
+// Devices whose adbd is up; their capabilities stay valid while the transport id holds
+bool is_online_state(const std::string& state)
+{
+    return state == "device" || state == "recovery" || state == "rescue" || state == "sideload";
+}
+
+} // namespace
+
 AdbAbstraction::AdbAbstraction(const std::string& custom_adb_path)
 {
     if (!custom_adb_path.empty()) {
@@ -68,91 +111,378 @@ std::string AdbAbstraction::get_adb_path() const
 
 std::optional<std::string> AdbAbstraction::execute_command(const std::string& command) const
 {
-    FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) return std::nullopt;
-
     std::string result;
-    char buffer[128];
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
-    }
+    bool ok = execute_command_stream(command, [&result](std::string_view chunk) {
+        result.append(chunk.data(), chunk.size());
+        return true;
+    });
 
-    int status = pclose(pipe);
-    if (status != 0) {
+    if (!ok) {
         return std::nullopt;
     }
 
     return result;
 }
 
+bool AdbAbstraction::execute_command_stream(const std::string& command, const ChunkCallback& on_chunk) const
+{
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) return false;
+
+    // One fixed buffer; chunks are handed off as soon as the pipe delivers them
+    char buffer[64 * 1024];
+    bool stopped = false;
+    int fd = fileno(pipe);
+
+    while (true) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        if (!on_chunk(std::string_view(buffer, static_cast<size_t>(n)))) {
+            stopped = true;
+            break;
+        }
+    }
+
+    // Closing the read end early makes the child exit on its next write
+    int status = pclose(pipe);
+    return stopped || status == 0;
+}
+
 std::vector<AdbDevice> AdbAbstraction::list_devices() const
 {
-    std::string cmd = adb_path + " devices";
+    std::string cmd = adb_path + " devices -l";
     auto output = execute_command(cmd);
     
     if (!output) {
         return {};
     }
 
-    return parse_devices_output(output.value());
+    auto devices = parse_devices_output(output.value());
+
+    // A device that went away or came back on a new transport is probed afresh
+    std::map<std::string, int> online;
+    for (const auto& device : devices) {
+        if (is_online_state(device.state_string)) online[device.serial] = device.transport_id;
+    }
+    capability_cache.retain(online);
+    return devices;
 }
 
 std::vector<AdbDevice> AdbAbstraction::parse_devices_output(const std::string& output) const
 {
     std::vector<AdbDevice> devices;
-    std::istringstream stream(output);
-    std::string line;
 
-    // Skip first line "List of attached devices"
-    if (std::getline(stream, line) && line.find("attached devices") == std::string::npos) {
-        // Put back first line if it's not the header
-        std::istringstream temp_stream(output);
-        std::string first_line;
-        std::getline(temp_stream, first_line);
-    }
-
-    while (std::getline(stream, line)) {
-        if (line.empty() || line.find("attached devices") != std::string::npos) {
-            continue;
+    parse::for_each_line(output, [&devices](std::string_view line) {
+        // Skip header "List of devices attached", daemon notices and blank lines
+        if (line.empty() || line.front() == '*' ||
+            line.find("devices attached") != std::string_view::npos ||
+            line.find("attached devices") != std::string_view::npos) {
+            return;
         }
 
-        // Parse: "serial\tstate"
-        size_t tab_pos = line.find('\t');
-        if (tab_pos == std::string::npos) {
-            continue;
+        // Parse: "serial\tstate" or, with -l, "serial   state usb:1-1 product:x model:y ..."
+        std::string_view fields[8];
+        size_t count = parse::split_whitespace(line, fields, 8);
+        if (count < 2) {
+            return;
         }
 
-        std::string serial = line.substr(0, tab_pos);
-        std::string state_str = line.substr(tab_pos + 1);
+        AdbDevice device;
+        device.serial = std::string(fields[0]);
+        device.state_string = std::string(fields[1]);
 
-        // Remove trailing whitespace
-        state_str.erase(state_str.find_last_not_of(" \t\n\r") + 1);
+        if (device.state_string == "no") {
+            // "no permissions (missing udev rules? ...)" - descriptors are unreliable
+            device.state_string = "no permissions";
+            count = 2;
+        }
 
-        AdbDevice device;
-        device.serial = serial;
-        device.state_string = state_str;
+        for (size_t i = 2; i < count; ++i) {
+            std::string_view kv[2];
+            if (parse::split_fields(fields[i], ':', kv, 2) < 2) {
+                continue;
+            }
+            if (kv[0] == "usb") {
+                device.usb = std::string(kv[1]);
+            } else if (kv[0] == "product") {
+                device.product = std::string(kv[1]);
+            } else if (kv[0] == "model") {
+                device.model = std::string(kv[1]);
+            } else if (kv[0] == "device") {
+                device.device = std::string(kv[1]);
+            } else if (kv[0] == "transport_id") {
+                try {
+                    device.transport_id = std::stoi(std::string(kv[1]));
+                } catch (...) {}
+            }
+        }
 
-        if (state_str == "device") {
+        if (device.state_string == "device") {
             device.state = DeviceState::DEVICE;
-        } else if (state_str == "unauthorized") {
+        } else if (device.state_string == "unauthorized") {
             device.state = DeviceState::UNAUTHORIZED;
-        } else if (state_str == "offline") {
+        } else if (device.state_string == "offline") {
             device.state = DeviceState::OFFLINE;
         } else {
             device.state = DeviceState::UNKNOWN;
         }
 
         devices.push_back(device);
-    }
+    });
 
     return devices;
 }
 
+std::string AdbAbstraction::build_shell_command(const std::string& serial, const std::string& command) const
+{
+    return adb_path + " -s " + serial + " shell \"" + command + "\" 2>/dev/null";
+}
+
 std::string AdbAbstraction::shell_command(const std::string& serial, const std::string& command) const
 {
-    std::string cmd = adb_path + " -s " + serial + " shell \"" + command + "\" 2>/dev/null";
-    auto output = execute_command(cmd);
-    return output ? output.value() : "";
+    std::string command_class = adb::ShellCompressionPolicy::command_class(command);
+    std::string output;
+    auto collect = [&output](std::string_view chunk) {
+        output.append(chunk.data(), chunk.size());
+        return true;
+    };
+    if (auto ok = shell_command_abb(serial, command, command_class, collect)) {
+        return ok.value() ? output : "";
+    }
+    if (shell_compression.should_compress(command_class)) {
+        auto ok = shell_command_gzip(serial, command, command_class, collect);
+        if (ok) return ok.value() ? output : "";
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto plain = execute_command(build_shell_command(serial, command));
+    if (!plain) {
+        return "";
+    }
+    shell_compression.record_plain(command_class, plain->size(), ms_since(start));
+    return plain.value();
+}
+
+std::optional<bool> AdbAbstraction::shell_command_abb(const std::string& serial, const std::string& command,
+                                                      const std::string& command_class,
+                                                      const ChunkCallback& on_chunk) const
+{
+    auto args = adb::AbbExecClient::translate(command);
+    if (!args) {
+        return std::nullopt;
+    }
+    auto caps = capability_cache.get(serial);
+    if (!caps || !caps->has(adb::Feature::ABB_EXEC)) {
+        return std::nullopt;
+    }
+
+    uint64_t bytes = 0;
+    bool stopped = false;
+    auto start = std::chrono::steady_clock::now();
+
+    adb::AbbExecClient client(serial);
+    auto ok = client.run(args.value(), [&](std::string_view chunk) {
+        bytes += chunk.size();
+        stopped = !on_chunk(chunk);
+        return !stopped;
+    }, ABB_TIMEOUT_MS);
+    if (!ok) {
+        // adbd advertises abb_exec but refused it; a missing binder
+        // service only rules out this one command
+        if (client.rejected()) {
+            capability_cache.revoke(serial, adb::Feature::ABB_EXEC);
+        }
+        return std::nullopt;
+    }
+    if (ok.value() && !stopped) {
+        shell_compression.record_abb(command_class, bytes, ms_since(start));
+    }
+    return ok;
+}
+
+std::optional<bool> AdbAbstraction::shell_command_gzip(const std::string& serial, const std::string& command,
+                                                       const std::string& command_class,
+                                                       const ChunkCallback& on_chunk) const
+{
+    // Compressed output is binary, so only the raw shell v2 service will do
+    auto caps = capability_cache.get(serial);
+    if (!caps || !caps->has(adb::Feature::SHELL_V2) || !caps->has_applet("gzip")) {
+        return std::nullopt;
+    }
+
+    auto decoder = adb::create_gzip_decoder();
+    if (!decoder) return std::nullopt;
+
+    uint64_t wire_bytes = 0;
+    uint64_t bytes = 0;
+    bool stopped = false;
+    bool corrupt = false;
+    auto start = std::chrono::steady_clock::now();
+
+    adb::ShellV2Client client(serial);
+    auto exit_code = client.run_streaming(adb::gzip_command(command),
+        [&](adb::ShellV2Client::Stream stream, std::string_view data) {
+            if (stream != adb::ShellV2Client::Stream::OUT) return true;
+            wire_bytes += data.size();
+            bool ok = decoder->feed(data, [&](std::string_view chunk) {
+                bytes += chunk.size();
+                stopped = !on_chunk(chunk);
+                return !stopped;
+            });
+            corrupt = !ok && !stopped;
+            return ok;
+        }, GZIP_SHELL_TIMEOUT_MS);
+    if (!exit_code) {
+        return std::nullopt;
+    }
+
+    // No gzip on the device: the shell reports 127 and stdout stays empty
+    // (an empty gzip stream still has a header)
+    if (wire_bytes == 0 && exit_code.value() == 127) {
+        capability_cache.revoke_applet(serial, "gzip");
+        return std::nullopt;
+    }
+    if (stopped) {
+        return true;
+    }
+    if (corrupt || !decoder->finished()) {
+        // Nothing delivered yet, so the plain command can still take over
+        if (bytes == 0) return std::nullopt;
+        return false;
+    }
+
+    shell_compression.record_gzip(command_class, bytes, wire_bytes, ms_since(start));
+    return exit_code.value() == 0;
+}
+
+std::optional<adb::ShellResult> AdbAbstraction::shell(const std::string& serial, const std::string& command,
+                                                      int timeout_ms) const
+{
+    auto caps = capability_cache.get(serial);
+    bool try_v2 = !caps || caps->has(adb::Feature::SHELL_V2);
+
+    adb::ShellV2Client client(serial, try_v2);
+    auto result = client.run(command, timeout_ms);
+    if (result) {
+        if (try_v2 && !client.uses_v2()) {
+            capability_cache.revoke(serial, adb::Feature::SHELL_V2);
+        }
+        return result;
+    }
+
+    // No native connection: the adb binary starts the server if needed.
+    // The status follows a marker line; stderr is not available this way.
+    static const std::string marker = "__lcr_exit:";
+    auto output = execute_command(build_shell_command(serial, "(" + command + "); printf '\\n" + marker + "%d\\n' \\$?"));
+    if (!output) {
+        return std::nullopt;
+    }
+
+    size_t at = output->rfind(marker);
+    if (at == std::string::npos) {
+        return std::nullopt;
+    }
+
+    adb::ShellResult fallback;
+    fallback.exit_code = std::atoi(output->c_str() + at + marker.size());
+    // Drop the marker line and the newline printed in front of it
+    output->resize(at >= 1 ? at - 1 : 0);
+    fallback.out = std::move(output.value());
+    return fallback;
+}
+
+std::string AdbAbstraction::shell_quote(const std::string& value)
+{
+    std::string quoted = "'";
+    for (char c : value) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    quoted += "'";
+    return quoted;
+}
+
+bool AdbAbstraction::path_exists(const std::string& serial, const std::string& path) const
+{
+    // A sync stat takes the path as data, no shell involved
+    if (auto stats = stat_paths(serial, {path}, true)) {
+        return stats->front().exists();
+    }
+    auto result = shell(serial, "test -e " + shell_quote(path));
+    return result && result->succeeded();
+}
+
+bool AdbAbstraction::is_directory(const std::string& serial, const std::string& path) const
+{
+    if (auto stats = stat_paths(serial, {path}, true)) {
+        return stats->front().exists() && stats->front().is_directory();
+    }
+    auto result = shell(serial, "test -d " + shell_quote(path));
+    return result && result->succeeded();
+}
+
+std::optional<std::vector<adb::FileStat>> AdbAbstraction::stat_paths(const std::string& serial,
+                                                                     const std::vector<std::string>& paths,
+                                                                     bool follow_links) const
+{
+    return with_sync_client(serial, capability_cache, adb::Feature::STAT_V2,
+                            [&](adb::SyncClient& client) { return client.stat(paths, follow_links); });
+}
+
+std::optional<std::vector<std::vector<adb::DirEntry>>> AdbAbstraction::list_directories(
+    const std::string& serial, const std::vector<std::string>& dirs) const
+{
+    return with_sync_client(serial, capability_cache, adb::Feature::LS_V2,
+                            [&](adb::SyncClient& client) { return client.list(dirs); });
+}
+
+bool AdbAbstraction::shell_command_chunks(const std::string& serial, const std::string& command,
+                                          const ChunkCallback& on_chunk) const
+{
+    std::string command_class = adb::ShellCompressionPolicy::command_class(command);
+    if (auto ok = shell_command_abb(serial, command, command_class, on_chunk)) {
+        return ok.value();
+    }
+    if (shell_compression.should_compress(command_class)) {
+        auto ok = shell_command_gzip(serial, command, command_class, on_chunk);
+        if (ok) return ok.value();
+    }
+
+    uint64_t bytes = 0;
+    bool stopped = false;
+    auto start = std::chrono::steady_clock::now();
+    bool ok = execute_command_stream(build_shell_command(serial, command), [&](std::string_view chunk) {
+        bytes += chunk.size();
+        stopped = !on_chunk(chunk);
+        return !stopped;
+    });
+    // A consumer that stops early says nothing about the full output size
+    if (ok && !stopped) {
+        shell_compression.record_plain(command_class, bytes, ms_since(start));
+    }
+    return ok;
+}
+
+bool AdbAbstraction::shell_command_lines(const std::string& serial, const std::string& command,
+                                         const LineCallback& on_line) const
+{
+    parse::LineSplitter splitter;
+    bool keep_going = true;
+
+    bool ok = shell_command_chunks(serial, command, [&](std::string_view chunk) {
+        keep_going = splitter.feed(chunk, on_line);
+        return keep_going;
+    });
+
+    if (keep_going) {
+        splitter.finish(on_line);
+    }
+    return ok;
 }
 
 std::optional<std::string> AdbAbstraction::get_property(const std::string& serial, const std::string& property) const
@@ -169,20 +499,104 @@ std::optional<std::string> AdbAbstraction::get_property(const std::string& seria
     return result;
 }
 
-bool AdbAbstraction::push_file(const std::string& serial, const std::string& local_path, const std::string& remote_path) const
+void AdbAbstraction::apply_transfer_codec(const std::string& serial, adb::SyncClient& client) const
 {
+    if (!compress_transfers) return;
+    if (auto caps = capability_cache.get(serial)) {
+        client.set_compression(caps->sync_compression);
+    }
+}
+
+void AdbAbstraction::note_transfer_codec(const std::string& serial, const adb::SyncClient& client) const
+{
+    auto caps = capability_cache.peek(serial);
+    if (caps && caps->sync_compression != adb::Compression::NONE && client.compression() == adb::Compression::NONE) {
+        capability_cache.revoke(serial, adb::Feature::SENDRECV_V2);
+    }
+}
+
+bool AdbAbstraction::push_file(const std::string& serial, const std::string& local_path, const std::string& remote_path,
+                               adb::TransferStats* stats, uint32_t mode) const
+{
+    adb::SyncClient client(serial);
+    apply_transfer_codec(serial, client);
+    if (client.open()) {
+        auto result = client.push(local_path, remote_path, mode);
+        note_transfer_codec(serial, client);
+        if (result && stats) *stats = result.value();
+        return result.has_value();
+    }
+
+    // No adb server connection: let the binary start one
+    auto start = std::chrono::steady_clock::now();
     std::string cmd = adb_path + " -s " + serial + " push \"" + local_path + "\" \"" + remote_path + "\" >/dev/null 2>&1";
-    return system(cmd.c_str()) == 0;
+    if (system(cmd.c_str()) != 0) {
+        return false;
+    }
+
+    if (stats) {
+        std::error_code ec;
+        auto size = fs::file_size(local_path, ec);
+        *stats = adb::TransferStats{};
+        stats->bytes = ec ? 0 : size;
+        stats->wire_bytes = stats->bytes;
+        stats->total_ms = ms_since(start);
+    }
+    return true;
 }
 
-bool AdbAbstraction::pull_file(const std::string& serial, const std::string& remote_path, const std::string& local_path) const
+bool AdbAbstraction::pull_file(const std::string& serial, const std::string& remote_path, const std::string& local_path,
+                               adb::TransferStats* stats) const
 {
+    adb::SyncClient client(serial);
+    apply_transfer_codec(serial, client);
+    if (client.open()) {
+        auto result = client.pull_to_file(remote_path, local_path);
+        note_transfer_codec(serial, client);
+        if (result && stats) *stats = result.value();
+        return result.has_value();
+    }
+
+    // No adb server connection: let the binary start one
+    auto start = std::chrono::steady_clock::now();
     std::string cmd = adb_path + " -s " + serial + " pull \"" + remote_path + "\" \"" + local_path + "\" >/dev/null 2>&1";
-    return system(cmd.c_str()) == 0;
+    if (system(cmd.c_str()) != 0) {
+        return false;
+    }
+
+    if (stats) {
+        std::error_code ec;
+        auto size = fs::file_size(local_path, ec);
+        *stats = adb::TransferStats{};
+        stats->bytes = ec ? 0 : size;
+        stats->wire_bytes = stats->bytes;
+        stats->total_ms = ms_since(start);
+    }
+    return true;
+}
+
+std::optional<adb::TransferStats> AdbAbstraction::pull_stream(const std::string& serial, const std::string& remote_path,
+                                                              const ChunkCallback& on_chunk) const
+{
+    adb::SyncClient client(serial);
+    apply_transfer_codec(serial, client);
+    auto result = client.pull(remote_path, on_chunk);
+    note_transfer_codec(serial, client);
+    return result;
+}
+
+std::optional<adb::BundleManifest> AdbAbstraction::pull_bundle(const std::string& serial,
+                                                               const std::vector<std::string>& remote_paths,
+                                                               const adb::SyncClient::BundleCallback& on_data) const
+{
+    adb::SyncClient client(serial);
+    return client.pull_bundle(remote_paths, on_data);
 }
 
 bool AdbAbstraction::reboot(const std::string& serial, const std::string& mode) const
 {
+    // adbd comes back on a new transport, possibly as recovery or fastbootd
+    capability_cache.invalidate(serial);
     std::string cmd = adb_path + " -s " + serial + " reboot " + mode + " >/dev/null 2>&1";
     return system(cmd.c_str()) == 0;
 }
@@ -192,9 +606,13 @@ bool AdbAbstraction::is_fastboot_available() const
     return system("which fastboot >/dev/null 2>&1") == 0;
 }
 
-std::string AdbAbstraction::fastboot_command(const std::string& command) const
+std::string AdbAbstraction::fastboot_command(const std::string& command, const std::string& serial) const
 {
-    std::string cmd = "fastboot " + command + " 2>/dev/null";
+    std::string cmd = "fastboot ";
+    if (!serial.empty()) {
+        cmd += "-s " + serial + " ";
+    }
+    cmd += command + " 2>&1";
     auto output = execute_command(cmd);
     return output ? output.value() : "";
 }
@@ -0,0 +1,247 @@
+#include "agent/agent_client.hpp"
+#include "adb_abstraction.h"
+#include "adb/adb_connection.hpp"
+
+#include <sys/stat.h>
+
+namespace agent {
+
+namespace {
+
+// Read one frame; nullopt on a lost connection or a length no agent sends
+// (e.g. "sh: ...: not found" read as a header)
+std::optional<std::string> read_frame(adb::AdbConnection& connection) {
+    char header[4];
+    if (!connection.read_exact(header, sizeof(header))) return std::nullopt;
+    uint32_t length = report::BinaryReader(std::string_view(header, sizeof(header))).u32();
+    if (length == 0 || length > MAX_FRAME) return std::nullopt;
+
+    std::string frame(length, '\0');
+    if (!connection.read_exact(frame.data(), length)) return std::nullopt;
+    return frame;
+}
+
+template <class Decode>
+auto decode_list(std::string_view payload, Decode&& decode)
+    -> std::optional<std::vector<decltype(decode(std::declval<report::BinaryReader&>()))>>
+{
+    report::BinaryReader reader(payload);
+    uint64_t count = reader.varint();
+    std::vector<decltype(decode(reader))> items;
+    // Every entry takes at least one byte; a larger count is corrupt
+    if (!reader.ok() || count > payload.size()) return std::nullopt;
+    items.reserve(count);
+    for (uint64_t i = 0; i < count && reader.ok(); ++i) {
+        items.push_back(decode(reader));
+    }
+    if (!reader.ok()) return std::nullopt;
+    return items;
+}
+
+} // namespace
+
+// ============ AgentQuery ============
+
+template <class Arguments>
+size_t AgentQuery::add(Op op, Arguments&& arguments) {
+    report::BinaryWriter out(frames_);
+    size_t frame = out.begin_length();
+    out.u8(static_cast<uint8_t>(op));
+    arguments(out);
+    out.end_length(frame);
+    return count_++;
+}
+
+size_t AgentQuery::property(std::string_view name) {
+    return add(Op::PROPERTY, [name](report::BinaryWriter& out) { out.str(name); });
+}
+
+size_t AgentQuery::all_properties() {
+    return add(Op::PROPERTIES, [](report::BinaryWriter&) {});
+}
+
+size_t AgentQuery::stat(std::string_view path, bool follow_links) {
+    return add(Op::STAT, [&](report::BinaryWriter& out) {
+        out.str(path);
+        out.boolean(follow_links);
+    });
+}
+
+size_t AgentQuery::read_file(std::string_view path, uint64_t max_bytes) {
+    return add(Op::READ, [&](report::BinaryWriter& out) {
+        out.str(path);
+        out.varint(max_bytes);
+    });
+}
+
+size_t AgentQuery::processes() {
+    return add(Op::PROCESSES, [](report::BinaryWriter&) {});
+}
+
+size_t AgentQuery::system_info() {
+    return add(Op::SYSTEM, [](report::BinaryWriter&) {});
+}
+
+size_t AgentQuery::which(std::string_view program) {
+    return add(Op::WHICH, [program](report::BinaryWriter& out) { out.str(program); });
+}
+
+size_t AgentQuery::mounts() {
+    return add(Op::MOUNTS, [](report::BinaryWriter&) {});
+}
+
+size_t AgentQuery::list(std::string_view path) {
+    return add(Op::LIST, [path](report::BinaryWriter& out) { out.str(path); });
+}
+
+std::string AgentQuery::encoded() const {
+    std::string out = frames_;
+    report::BinaryWriter writer(out);
+    size_t frame = writer.begin_length();
+    writer.u8(static_cast<uint8_t>(Op::END));
+    writer.end_length(frame);
+    return out;
+}
+
+// ============ AgentResults ============
+
+std::optional<std::string> AgentResults::text(size_t index) const {
+    if (!ok(index)) return std::nullopt;
+    report::BinaryReader reader(replies_[index].payload);
+    std::string_view value = reader.str();
+    if (!reader.ok()) return std::nullopt;
+    return std::string(value);
+}
+
+std::optional<std::vector<std::pair<std::string, std::string>>> AgentResults::properties(size_t index) const {
+    if (!ok(index)) return std::nullopt;
+    return decode_list(replies_[index].payload, [](report::BinaryReader& reader) {
+        std::string name(reader.str());
+        return std::make_pair(std::move(name), std::string(reader.str()));
+    });
+}
+
+std::optional<FileInfo> AgentResults::stat(size_t index) const {
+    if (!ok(index)) return std::nullopt;
+    report::BinaryReader reader(replies_[index].payload);
+    FileInfo info = decode_file_info(reader);
+    if (!reader.ok()) return std::nullopt;
+    return info;
+}
+
+std::optional<std::vector<ProcessEntry>> AgentResults::processes(size_t index) const {
+    if (!ok(index)) return std::nullopt;
+    return decode_list(replies_[index].payload, decode_process);
+}
+
+std::optional<SystemInfo> AgentResults::system_info(size_t index) const {
+    if (!ok(index)) return std::nullopt;
+    report::BinaryReader reader(replies_[index].payload);
+    SystemInfo info = decode_system_info(reader);
+    if (!reader.ok()) return std::nullopt;
+    return info;
+}
+
+std::optional<std::vector<MountEntry>> AgentResults::mounts(size_t index) const {
+    if (!ok(index)) return std::nullopt;
+    return decode_list(replies_[index].payload, decode_mount);
+}
+
+std::optional<std::vector<std::string>> AgentResults::names(size_t index) const {
+    if (!ok(index)) return std::nullopt;
+    return decode_list(replies_[index].payload, [](report::BinaryReader& reader) {
+        return std::string(reader.str());
+    });
+}
+
+// ============ AgentClient ============
+
+AgentClient::AgentClient(const AdbAbstraction& adb, const std::string& serial)
+    : adb_(adb), serial_(serial) {}
+
+std::string AgentClient::binary_for_abi(const std::string& dir, const std::string& abi) {
+    return dir + "/" + BINARY_NAME + "-" + abi;
+}
+
+bool AgentClient::deploy(const std::string& local_binary) {
+    struct stat local {};
+    if (::stat(local_binary.c_str(), &local) != 0) {
+        last_error_ = "No agent binary at " + local_binary;
+        return false;
+    }
+
+    // The sync push keeps the local mtime, so size + mtime identify the build
+    auto remote = adb_.stat_paths(serial_, {REMOTE_PATH});
+    if (remote && remote->front().is_regular() && (remote->front().mode & 0100) &&
+        remote->front().size == static_cast<uint64_t>(local.st_size) &&
+        remote->front().mtime == static_cast<int64_t>(local.st_mtime)) {
+        return true;
+    }
+
+    if (!adb_.push_file(serial_, local_binary, REMOTE_PATH, nullptr, 0755)) {
+        last_error_ = "Could not push the agent to " + std::string(REMOTE_PATH);
+        return false;
+    }
+    return true;
+}
+
+std::optional<AgentResults> AgentClient::run(const AgentQuery& query, int timeout_ms) {
+    adb::AdbConnection connection;
+    connection.set_timeout(timeout_ms);
+    if (!connection.connect() || !connection.switch_transport(serial_) ||
+        !connection.request(std::string("exec:") + REMOTE_PATH)) {
+        last_error_ = connection.last_error();
+        return std::nullopt;
+    }
+
+    // The whole batch goes out before the first reply is read
+    std::string requests = query.encoded();
+    if (!connection.write_all(requests.data(), requests.size())) {
+        last_error_ = connection.last_error();
+        return std::nullopt;
+    }
+
+    auto hello = read_frame(connection);
+    report::BinaryReader hello_reader(hello.value_or(""));
+    if (!hello || !decode_hello(hello_reader)) {
+        last_error_ = "Agent did not start (not deployed, or built for another ABI or version)";
+        return std::nullopt;
+    }
+
+    std::vector<AgentResults::Reply> replies;
+    replies.reserve(query.size());
+    for (size_t i = 0; i < query.size(); ++i) {
+        auto frame = read_frame(connection);
+        if (!frame) {
+            last_error_ = "Agent session ended after " + std::to_string(i) + " of " +
+                          std::to_string(query.size()) + " replies";
+            return std::nullopt;
+        }
+
+        AgentResults::Reply reply;
+        report::BinaryReader reader(frame.value());
+        uint8_t status = reader.u8();
+        bool known = true;
+        if (status == static_cast<uint8_t>(Status::OK)) {
+            reply.status = Status::OK;
+            reply.payload = frame->substr(1);
+        } else if (status == static_cast<uint8_t>(Status::ERROR)) {
+            reply.status = Status::ERROR;
+            reply.error = static_cast<int>(reader.svarint());
+        } else if (status == static_cast<uint8_t>(Status::UNKNOWN_OP)) {
+            reply.status = Status::UNKNOWN_OP;
+        } else {
+            known = false;
+        }
+        // Replies are matched to requests by position, so one that cannot be
+        // read leaves the rest of the session unusable
+        if (!known || !reader.ok()) {
+            last_error_ = "Malformed agent reply " + std::to_string(i) + " of " + std::to_string(query.size());
+            return std::nullopt;
+        }
+        replies.push_back(std::move(reply));
+    }
+    return AgentResults(std::move(replies));
+}
+
+} // namespace agent
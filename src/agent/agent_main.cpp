@@ -0,0 +1,401 @@
+// lincheckroot-agent: read-only query helper run from /data/local/tmp
+// Answers agent/protocol.hpp requests on stdin/stdout; see agent::AgentClient.
+// Built static and without the GUI so the same source serves arm64 devices
+// (NDK toolchain) and an x86_64 host build for local testing.
+
+#include "agent/protocol.hpp"
+#include "parse/line_scanner.hpp"
+#include "parse/properties.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <utility>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#ifdef __ANDROID__
+#include <sys/system_properties.h>
+#endif
+
+namespace {
+
+using report::BinaryReader;
+using report::BinaryWriter;
+
+// Replies are flushed once this much is pending, or when no request is waiting
+constexpr size_t FLUSH_SIZE = 64 * 1024;
+
+constexpr const char* DEFAULT_PATH =
+    "/product/bin:/apex/com.android.runtime/bin:/apex/com.android.art/bin:/system_ext/bin:"
+    "/system/bin:/system/xbin:/odm/bin:/vendor/bin:/vendor/xbin";
+
+bool read_full(int fd, void* data, size_t size) {
+    char* out = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = read(fd, out, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        out += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool write_full(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool input_pending() {
+    pollfd fd{STDIN_FILENO, POLLIN, 0};
+    return poll(&fd, 1, 0) > 0;
+}
+
+// Up to `max_bytes` of a file; errno on failure
+std::pair<std::string, int> read_file(const std::string& path, uint64_t max_bytes) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return {std::string(), errno};
+
+    std::string contents;
+    char buffer[64 * 1024];
+    while (contents.size() < max_bytes) {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(sizeof(buffer), max_bytes - contents.size()));
+        ssize_t n = read(fd, buffer, want);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            int error = errno;
+            close(fd);
+            return {std::string(), error};
+        }
+        if (n == 0) break;
+        contents.append(buffer, static_cast<size_t>(n));
+    }
+    close(fd);
+    return {contents, 0};
+}
+
+// ============ Properties ============
+
+#ifdef __ANDROID__
+std::string read_property(const prop_info* info) {
+    std::string value;
+#if __ANDROID_API__ >= 26
+    // Values of ro.* properties may exceed PROP_VALUE_MAX
+    __system_property_read_callback(info, [](void* cookie, const char*, const char* text, uint32_t) {
+        *static_cast<std::string*>(cookie) = text;
+    }, &value);
+#else
+    char text[PROP_VALUE_MAX] = {};
+    __system_property_read(info, nullptr, text);
+    value = text;
+#endif
+    return value;
+}
+
+std::vector<std::pair<std::string, std::string>> all_properties() {
+    std::vector<std::pair<std::string, std::string>> properties;
+    __system_property_foreach([](const prop_info* info, void* cookie) {
+        auto* out = static_cast<std::vector<std::pair<std::string, std::string>>*>(cookie);
+        std::string name;
+#if __ANDROID_API__ >= 26
+        __system_property_read_callback(info, [](void* target, const char* key, const char*, uint32_t) {
+            *static_cast<std::string*>(target) = key;
+        }, &name);
+#else
+        char key[PROP_NAME_MAX] = {};
+        char text[PROP_VALUE_MAX] = {};
+        __system_property_read(info, key, text);
+        name = key;
+#endif
+        out->emplace_back(std::move(name), read_property(info));
+    }, &properties);
+    return properties;
+}
+
+std::string property(const std::string& name) {
+    const prop_info* info = __system_property_find(name.c_str());
+    return info ? read_property(info) : std::string();
+}
+#else
+// Host build: whatever getprop is on PATH (none on a plain Linux host)
+std::vector<std::pair<std::string, std::string>> all_properties() {
+    std::vector<std::pair<std::string, std::string>> properties;
+    FILE* pipe = popen("getprop 2>/dev/null", "r");
+    if (!pipe) return properties;
+
+    std::string output;
+    char buffer[16 * 1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, n);
+    }
+    pclose(pipe);
+
+    parse::for_each_line(output, [&properties](std::string_view line) {
+        std::string_view key, value;
+        if (parse::parse_property_line(line, key, value)) {
+            properties.emplace_back(std::string(key), std::string(value));
+        }
+    });
+    return properties;
+}
+
+std::string property(const std::string& name) {
+    static const auto properties = all_properties();
+    for (const auto& [key, value] : properties) {
+        if (key == name) return value;
+    }
+    return std::string();
+}
+#endif
+
+// ============ Queries ============
+
+void reply_error(BinaryWriter& out, int error) {
+    out.u8(static_cast<uint8_t>(agent::Status::ERROR));
+    out.svarint(error);
+}
+
+void answer_stat(BinaryReader& request, BinaryWriter& out) {
+    std::string path(request.str());
+    bool follow_links = request.boolean();
+
+    struct stat st {};
+    int rc = follow_links ? stat(path.c_str(), &st) : lstat(path.c_str(), &st);
+    if (rc != 0) {
+        reply_error(out, errno);
+        return;
+    }
+
+    agent::FileInfo info;
+    info.mode = st.st_mode;
+    info.size = static_cast<uint64_t>(st.st_size);
+    info.mtime = static_cast<int64_t>(st.st_mtime);
+    info.uid = st.st_uid;
+    info.gid = st.st_gid;
+    out.u8(static_cast<uint8_t>(agent::Status::OK));
+    agent::encode(out, info);
+}
+
+void answer_read(BinaryReader& request, BinaryWriter& out) {
+    std::string path(request.str());
+    uint64_t max_bytes = request.varint();
+
+    auto [contents, error] = read_file(path, std::min<uint64_t>(max_bytes, agent::MAX_FRAME / 2));
+    if (error != 0) {
+        reply_error(out, error);
+        return;
+    }
+    out.u8(static_cast<uint8_t>(agent::Status::OK));
+    out.str(contents);
+}
+
+void answer_processes(BinaryWriter& out) {
+    DIR* proc = opendir("/proc");
+    if (!proc) {
+        reply_error(out, errno);
+        return;
+    }
+
+    std::vector<agent::ProcessEntry> entries;
+    while (dirent* entry = readdir(proc)) {
+        int pid = std::atoi(entry->d_name);
+        if (pid <= 0) continue;
+
+        std::string base = std::string("/proc/") + entry->d_name;
+        struct stat st {};
+        if (stat(base.c_str(), &st) != 0) continue;     // exited meanwhile
+
+        agent::ProcessEntry process;
+        process.pid = pid;
+        process.uid = st.st_uid;
+        // argv[0] as ps -A shows it; kernel threads have no cmdline
+        process.name = read_file(base + "/cmdline", 4096).first;
+        size_t nul = process.name.find('\0');
+        if (nul != std::string::npos) process.name.resize(nul);
+        if (process.name.empty()) {
+            process.name = std::string(parse::trim(read_file(base + "/comm", 256).first));
+        }
+        entries.push_back(std::move(process));
+    }
+    closedir(proc);
+
+    out.u8(static_cast<uint8_t>(agent::Status::OK));
+    out.varint(entries.size());
+    for (const auto& process : entries) {
+        agent::encode(out, process);
+    }
+}
+
+void answer_system(BinaryWriter& out) {
+    agent::SystemInfo info;
+    long cores = sysconf(_SC_NPROCESSORS_CONF);
+    info.cpu_cores = cores > 0 ? static_cast<int>(cores) : 1;
+
+    auto meminfo = read_file("/proc/meminfo", 64 * 1024).first;
+    parse::for_each_line(meminfo, [&info](std::string_view line) {
+        std::string_view fields[3];
+        if (parse::split_whitespace(line, fields, 3) < 2) return;
+        uint64_t kb = std::strtoull(std::string(fields[1]).c_str(), nullptr, 10);
+        if (fields[0] == "MemTotal:") info.mem_total_kb = kb;
+        if (fields[0] == "MemAvailable:") info.mem_available_kb = kb;
+    });
+
+    struct statvfs vfs {};
+    if (statvfs("/data", &vfs) == 0) {
+        info.data_total_bytes = static_cast<uint64_t>(vfs.f_blocks) * vfs.f_frsize;
+        info.data_free_bytes = static_cast<uint64_t>(vfs.f_bavail) * vfs.f_frsize;
+    }
+
+    out.u8(static_cast<uint8_t>(agent::Status::OK));
+    agent::encode(out, info);
+}
+
+void answer_which(BinaryReader& request, BinaryWriter& out) {
+    std::string program(request.str());
+    const char* env = std::getenv("PATH");
+    std::string_view path = env && *env ? env : DEFAULT_PATH;
+
+    std::string found;
+    while (found.empty() && !path.empty()) {
+        size_t colon = path.find(':');
+        std::string_view dir = path.substr(0, colon);
+        path = colon == std::string_view::npos ? std::string_view() : path.substr(colon + 1);
+        if (dir.empty() || program.empty() || program.find('/') != std::string::npos) continue;
+
+        std::string candidate = std::string(dir) + "/" + program;
+        struct stat st {};
+        if (stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(candidate.c_str(), X_OK) == 0) {
+            found = candidate;
+        }
+    }
+    out.u8(static_cast<uint8_t>(agent::Status::OK));
+    out.str(found);
+}
+
+void answer_mounts(BinaryWriter& out) {
+    auto [mounts, error] = read_file("/proc/mounts", 4 * 1024 * 1024);
+    if (error != 0) {
+        reply_error(out, error);
+        return;
+    }
+
+    std::vector<agent::MountEntry> entries;
+    parse::for_each_line(mounts, [&entries](std::string_view line) {
+        // The last field takes the rest of the line, so dump/pass get their own
+        std::string_view fields[5];
+        if (parse::split_whitespace(line, fields, 5) < 4) return;
+        entries.push_back({std::string(fields[0]), std::string(fields[1]), std::string(fields[2]),
+                           std::string(fields[3])});
+    });
+
+    out.u8(static_cast<uint8_t>(agent::Status::OK));
+    out.varint(entries.size());
+    for (const auto& entry : entries) {
+        agent::encode(out, entry);
+    }
+}
+
+void answer_list(BinaryReader& request, BinaryWriter& out) {
+    std::string path(request.str());
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        reply_error(out, errno);
+        return;
+    }
+
+    std::vector<std::string> names;
+    while (dirent* entry = readdir(dir)) {
+        std::string_view name = entry->d_name;
+        if (name != "." && name != "..") names.emplace_back(name);
+    }
+    closedir(dir);
+
+    out.u8(static_cast<uint8_t>(agent::Status::OK));
+    out.varint(names.size());
+    for (const auto& name : names) {
+        out.str(name);
+    }
+}
+
+void answer(agent::Op op, BinaryReader& request, BinaryWriter& out) {
+    switch (op) {
+        case agent::Op::PROPERTY:
+            out.u8(static_cast<uint8_t>(agent::Status::OK));
+            out.str(property(std::string(request.str())));
+            return;
+        case agent::Op::PROPERTIES: {
+            auto properties = all_properties();
+            out.u8(static_cast<uint8_t>(agent::Status::OK));
+            out.varint(properties.size());
+            for (const auto& [name, value] : properties) {
+                out.str(name);
+                out.str(value);
+            }
+            return;
+        }
+        case agent::Op::STAT: answer_stat(request, out); return;
+        case agent::Op::READ: answer_read(request, out); return;
+        case agent::Op::PROCESSES: answer_processes(out); return;
+        case agent::Op::SYSTEM: answer_system(out); return;
+        case agent::Op::WHICH: answer_which(request, out); return;
+        case agent::Op::MOUNTS: answer_mounts(out); return;
+        case agent::Op::LIST: answer_list(request, out); return;
+        case agent::Op::END: break;
+    }
+    out.u8(static_cast<uint8_t>(agent::Status::UNKNOWN_OP));
+}
+
+} // namespace
+
+int main() {
+    // A client that disconnects early just ends the session
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::string pending;
+    BinaryWriter out(pending);
+    size_t hello = out.begin_length();
+    agent::encode_hello(out);
+    out.end_length(hello);
+
+    std::string request;
+    while (true) {
+        if (!pending.empty() && (pending.size() >= FLUSH_SIZE || !input_pending())) {
+            if (!write_full(STDOUT_FILENO, pending.data(), pending.size())) return 1;
+            pending.clear();
+        }
+
+        char header[4];
+        if (!read_full(STDIN_FILENO, header, sizeof(header))) break;
+        uint32_t length = BinaryReader(std::string_view(header, sizeof(header))).u32();
+        if (length == 0 || length > agent::MAX_FRAME) return 1;
+
+        request.resize(length);
+        if (!read_full(STDIN_FILENO, request.data(), length)) return 1;
+
+        BinaryReader reader(request);
+        auto op = static_cast<agent::Op>(reader.u8());
+        if (op == agent::Op::END) break;
+
+        size_t frame = out.begin_length();
+        answer(op, reader, out);
+        out.end_length(frame);
+    }
+
+    return write_full(STDOUT_FILENO, pending.data(), pending.size()) ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include "agent/protocol.hpp"
+
+namespace agent {
+
+std::optional<size_t> frame_length(std::string_view data) {
+    if (data.size() < 4) return std::nullopt;
+    report::BinaryReader reader(data);
+    uint32_t length = reader.u32();
+    if (data.size() - 4 < length) return std::nullopt;
+    return length;
+}
+
+void encode_hello(report::BinaryWriter& writer) {
+    writer.raw(MAGIC.data(), MAGIC.size());
+    writer.varint(VERSION);
+}
+
+bool decode_hello(report::BinaryReader& reader) {
+    for (char c : MAGIC) {
+        if (reader.u8() != static_cast<uint8_t>(c)) return false;
+    }
+    return reader.varint() == VERSION && reader.ok();
+}
+
+void encode(report::BinaryWriter& writer, const FileInfo& info) {
+    writer.varint(info.mode);
+    writer.varint(info.size);
+    writer.svarint(info.mtime);
+    writer.varint(info.uid);
+    writer.varint(info.gid);
+}
+
+void encode(report::BinaryWriter& writer, const ProcessEntry& entry) {
+    writer.varint(static_cast<uint64_t>(entry.pid));
+    writer.varint(entry.uid);
+    writer.str(entry.name);
+}
+
+void encode(report::BinaryWriter& writer, const SystemInfo& info) {
+    writer.varint(static_cast<uint64_t>(info.cpu_cores));
+    writer.varint(info.mem_total_kb);
+    writer.varint(info.mem_available_kb);
+    writer.varint(info.data_total_bytes);
+    writer.varint(info.data_free_bytes);
+}
+
+void encode(report::BinaryWriter& writer, const MountEntry& entry) {
+    writer.str(entry.source);
+    writer.str(entry.target);
+    writer.str(entry.type);
+    writer.str(entry.options);
+}
+
+FileInfo decode_file_info(report::BinaryReader& reader) {
+    FileInfo info;
+    info.mode = static_cast<uint32_t>(reader.varint());
+    info.size = reader.varint();
+    info.mtime = reader.svarint();
+    info.uid = static_cast<uint32_t>(reader.varint());
+    info.gid = static_cast<uint32_t>(reader.varint());
+    return info;
+}
+
+ProcessEntry decode_process(report::BinaryReader& reader) {
+    ProcessEntry entry;
+    entry.pid = static_cast<int>(reader.varint());
+    entry.uid = static_cast<uint32_t>(reader.varint());
+    entry.name = std::string(reader.str());
+    return entry;
+}
+
+SystemInfo decode_system_info(report::BinaryReader& reader) {
+    SystemInfo info;
+    info.cpu_cores = static_cast<int>(reader.varint());
+    info.mem_total_kb = reader.varint();
+    info.mem_available_kb = reader.varint();
+    info.data_total_bytes = reader.varint();
+    info.data_free_bytes = reader.varint();
+    return info;
+}
+
+MountEntry decode_mount(report::BinaryReader& reader) {
+    MountEntry entry;
+    entry.source = std::string(reader.str());
+    entry.target = std::string(reader.str());
+    entry.type = std::string(reader.str());
+    entry.options = std::string(reader.str());
+    return entry;
+}
+
+} // namespace agent
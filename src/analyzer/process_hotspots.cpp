@@ -0,0 +1,200 @@
+#include "analyzer/process_hotspots.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <sstream>
+#include <iomanip>
+
+namespace analyzer {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// CPU totals first, then one line per process
+constexpr const char* SAMPLE_COMMAND = "grep '^cpu' /proc/stat; cat /proc/[0-9]*/stat 2>/dev/null";
+
+uint64_t to_u64(std::string_view text) {
+    uint64_t value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+bool all_digits(std::string_view text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+} // namespace
+
+ProcessHotspotAnalyzer::ProcessHotspotAnalyzer(const std::string& adb_path, const std::string& serial,
+                                               size_t top_n)
+    : session_(adb_path, serial), top_n_(top_n) {
+    // Typical devices run a few hundred to a thousand processes
+    table_.reserve(1024);
+    heap_.reserve(top_n_ + 1);
+    hotspots_.reserve(top_n_);
+}
+
+bool ProcessHotspotAnalyzer::refresh() {
+    Clock::time_point start = Clock::now();
+
+    // Page size only once (16 KiB pages exist on newer arm64 devices)
+    std::string command = tick_ == 1 ? std::string("getconf PAGESIZE 2>/dev/null; ") + SAMPLE_COMMAND
+                                     : std::string(SAMPLE_COMMAND);
+
+    auto status = session_.run_lines(command, [this](std::string_view line) {
+        parse_line(line);
+        return true;
+    }, 10000);
+
+    if (!status) {
+        // Whatever arrived is a torn tick; the next one starts afresh
+        ++tick_;
+        cpu_lines_ = 0;
+        return false;
+    }
+
+    finish_tick();
+    last_sample_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+    return true;
+}
+
+void ProcessHotspotAnalyzer::parse_line(std::string_view line) {
+    if (parse::starts_with(line, "cpu")) {
+        std::string_view fields[10];
+        size_t count = parse::split_whitespace(line, fields, 10);
+        if (fields[0] == "cpu") {
+            uint64_t total = 0;
+            for (size_t i = 1; i < count && i <= 8; ++i) {
+                total += to_u64(fields[i]);
+            }
+            prev_total_ticks_ = total_ticks_;
+            total_ticks_ = total;
+        } else {
+            ++cpu_lines_;
+        }
+        return;
+    }
+
+    if (all_digits(line)) {
+        uint64_t page_size = to_u64(line);
+        if (page_size >= 1024) page_kb_ = page_size / 1024;
+        return;
+    }
+
+    // "1234 (name with) spaces) S 1 ..." - the name ends at the last ')'
+    size_t open = line.find(" (");
+    size_t close = line.rfind(')');
+    if (open == std::string_view::npos || close == std::string_view::npos || close < open) return;
+
+    int pid = 0;
+    std::from_chars(line.data(), line.data() + open, pid);
+    if (pid <= 0) return;
+
+    // After ')': state ppid pgrp session tty tpgid flags minflt cminflt majflt cmajflt
+    //            utime stime cutime cstime priority nice num_threads itrealvalue starttime vsize rss
+    std::string_view fields[23];
+    size_t count = parse::split_whitespace(line.substr(close + 1), fields, 23);
+    if (count < 22) return;
+
+    uint64_t start_time = to_u64(fields[19]);
+    auto [it, inserted] = table_.try_emplace(pid);
+    Entry& entry = it->second;
+
+    if (inserted || entry.start_time != start_time) {
+        entry = Entry();
+        entry.start_time = start_time;
+        entry.first_tick = tick_;
+        std::string_view name = line.substr(open + 2, close - open - 2);
+        entry.name_length = static_cast<uint8_t>(std::min(name.size(), sizeof(entry.name)));
+        std::copy_n(name.data(), entry.name_length, entry.name);
+    }
+
+    entry.prev_cpu_ticks = entry.cpu_ticks;
+    entry.prev_rss_pages = entry.rss_pages;
+    entry.cpu_ticks = to_u64(fields[11]) + to_u64(fields[12]);
+    entry.rss_pages = to_u64(fields[21]);
+    entry.threads = to_u64(fields[17]);
+    entry.state = fields[0].empty() ? '?' : fields[0][0];
+    int ppid = 0;
+    std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), ppid);
+    entry.ppid = ppid;
+    entry.seen_tick = tick_;
+}
+
+void ProcessHotspotAnalyzer::finish_tick() {
+    if (cpu_lines_ > 0) cpu_count_ = cpu_lines_;
+
+    uint64_t total_delta = total_ticks_ > prev_total_ticks_ ? total_ticks_ - prev_total_ticks_ : 0;
+    // Jiffies of one core over the interval
+    double core_ticks = (prev_total_ticks_ > 0 && total_delta > 0)
+        ? static_cast<double>(total_delta) / std::max(1u, cpu_count_) : 0;
+
+    heap_.clear();
+    auto heap_order = std::greater<std::pair<double, int>>();   // smallest on top
+
+    for (auto it = table_.begin(); it != table_.end();) {
+        const Entry& entry = it->second;
+        if (entry.seen_tick != tick_) {
+            it = table_.erase(it);
+            continue;
+        }
+
+        if (core_ticks > 0 && entry.first_tick != tick_) {
+            double cpu = 100.0 * static_cast<double>(entry.cpu_ticks - std::min(entry.prev_cpu_ticks, entry.cpu_ticks))
+                       / core_ticks;
+            if (heap_.size() < top_n_) {
+                heap_.emplace_back(cpu, it->first);
+                std::push_heap(heap_.begin(), heap_.end(), heap_order);
+            } else if (top_n_ > 0 && cpu > heap_.front().first) {
+                std::pop_heap(heap_.begin(), heap_.end(), heap_order);
+                heap_.back() = {cpu, it->first};
+                std::push_heap(heap_.begin(), heap_.end(), heap_order);
+            }
+        }
+        ++it;
+    }
+
+    // Highest first
+    std::sort_heap(heap_.begin(), heap_.end(), heap_order);
+
+    hotspots_.clear();
+    for (const auto& [cpu, pid] : heap_) {
+        const Entry& entry = table_.at(pid);
+        ProcessHotspot hotspot;
+        hotspot.pid = pid;
+        hotspot.ppid = entry.ppid;
+        hotspot.state = entry.state;
+        hotspot.name.assign(entry.name, entry.name_length);
+        hotspot.cpu_percent = cpu;
+        hotspot.rss_kb = entry.rss_pages * page_kb_;
+        hotspot.rss_delta_kb = (static_cast<int64_t>(entry.rss_pages) - static_cast<int64_t>(entry.prev_rss_pages))
+                             * static_cast<int64_t>(page_kb_);
+        hotspot.threads = entry.threads;
+        hotspots_.push_back(std::move(hotspot));
+    }
+
+    // Lines fed from here on belong to the next tick
+    ++tick_;
+    cpu_lines_ = 0;
+}
+
+std::string ProcessHotspotAnalyzer::format_hotspots(const std::vector<ProcessHotspot>& hotspots) {
+    std::ostringstream out;
+    out << std::left << std::setw(8) << "PID" << std::setw(18) << "NAME" << std::setw(3) << "S"
+        << std::right << std::setw(8) << "CPU%" << std::setw(12) << "RSS KB" << std::setw(11) << "RSS DELTA"
+        << std::setw(6) << "THR" << "\n";
+
+    out << std::fixed << std::setprecision(1);
+    for (const auto& p : hotspots) {
+        out << std::left << std::setw(8) << p.pid << std::setw(18) << p.name << std::setw(3) << p.state
+            << std::right << std::setw(8) << p.cpu_percent << std::setw(12) << p.rss_kb
+            << std::setw(11) << std::showpos << p.rss_delta_kb << std::noshowpos
+            << std::setw(6) << p.threads << "\n";
+    }
+    return out.str();
+}
+
+} // namespace analyzer
@@ -0,0 +1,179 @@
+#include "analyzer/signature_engine.hpp"
+#include <nlohmann/json.hpp>
+#include <fstream>
+
+using json = nlohmann::json;
+
+namespace analyzer {
+
+SignatureEngine::SignatureEngine() : automaton_(true) {}
+
+bool SignatureEngine::load_file(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    try {
+        std::string content((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+        return load_json(content);
+    } catch (...) {
+        return false;
+    }
+}
+
+bool SignatureEngine::load_json(const std::string& json_content) {
+    try {
+        auto db = json::parse(json_content);
+        if (!db.contains("signatures")) {
+            return false;
+        }
+
+        std::vector<Signature> signatures;
+        for (const auto& entry : db["signatures"]) {
+            Signature sig;
+            sig.id = entry.value("id", "");
+            sig.name = entry.value("name", sig.id);
+            sig.category = entry.value("category", "root");
+            if (entry.contains("patterns")) {
+                for (const auto& pattern : entry["patterns"]) {
+                    sig.patterns.push_back(pattern.get<std::string>());
+                }
+            }
+            if (!sig.id.empty() && !sig.patterns.empty()) {
+                signatures.push_back(std::move(sig));
+            }
+        }
+
+        std::vector<std::string> probe_paths;
+        std::vector<std::string> list_dirs;
+        if (db.contains("probe_paths")) {
+            probe_paths = db["probe_paths"].get<std::vector<std::string>>();
+        }
+        if (db.contains("list_dirs")) {
+            list_dirs = db["list_dirs"].get<std::vector<std::string>>();
+        }
+
+        // Build the automaton before replacing anything, so a bad file changes nothing
+        parse::AhoCorasick automaton(true);
+        std::vector<std::pair<uint32_t, uint32_t>> owners;
+        for (uint32_t s = 0; s < signatures.size(); ++s) {
+            for (uint32_t p = 0; p < signatures[s].patterns.size(); ++p) {
+                automaton.add(signatures[s].patterns[p]);
+                owners.emplace_back(s, p);
+            }
+        }
+        automaton.compile();
+
+        signatures_ = std::move(signatures);
+        probe_paths_ = std::move(probe_paths);
+        list_dirs_ = std::move(list_dirs);
+        automaton_ = std::move(automaton);
+        pattern_owner_ = std::move(owners);
+        return !signatures_.empty();
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string SignatureEngine::capture_command() const {
+    std::string command;
+
+    // Paths that exist are echoed back by ls -d; missing or unreadable ones print nothing
+    if (!probe_paths_.empty()) {
+        command += "ls -d";
+        for (const auto& path : probe_paths_) {
+            command += " " + AdbAbstraction::shell_quote(path);
+        }
+        command += " 2>/dev/null; ";
+    }
+    if (!list_dirs_.empty()) {
+        command += "ls -a";
+        for (const auto& dir : list_dirs_) {
+            command += " " + AdbAbstraction::shell_quote(dir);
+        }
+        command += " 2>/dev/null; ";
+    }
+
+    command += "cat /proc/mounts 2>/dev/null; ps -A 2>/dev/null || ps";
+    return command;
+}
+
+SignatureEngine::AgentCapture SignatureEngine::add_capture(agent::AgentQuery& query) const {
+    // Request order: probe paths, listed directories, mounts, processes
+    AgentCapture capture;
+    capture.first = query.size();
+    for (const auto& path : probe_paths_) {
+        query.stat(path);
+    }
+    for (const auto& dir : list_dirs_) {
+        query.list(dir);
+    }
+    query.mounts();
+    query.processes();
+    return capture;
+}
+
+std::optional<std::string> SignatureEngine::capture_from(const agent::AgentResults& results,
+                                                         const AgentCapture& capture) const {
+    size_t index = capture.first;
+    if (results.size() < index + probe_paths_.size() + list_dirs_.size() + 2) return std::nullopt;
+
+    // Failed requests print nothing, like the shell's 2>/dev/null; only an
+    // agent that does not know a request sends the caller back to the shell
+    std::string text;
+    for (const auto& path : probe_paths_) {
+        if (results.ok(index++)) text += path + "\n";
+    }
+    for (const auto& dir : list_dirs_) {
+        if (results.status(index) == agent::Status::UNKNOWN_OP) return std::nullopt;
+        if (auto names = results.names(index)) {
+            text += dir + ":\n";
+            for (const auto& name : *names) {
+                text += name + "\n";
+            }
+        }
+        ++index;
+    }
+    if (auto mounts = results.mounts(index++)) {
+        for (const auto& mount : *mounts) {
+            text += mount.source + " " + mount.target + " " + mount.type + " " + mount.options + " 0 0\n";
+        }
+    }
+    if (auto processes = results.processes(index++)) {
+        for (const auto& process : *processes) {
+            text += std::to_string(process.uid) + " " + std::to_string(process.pid) + " " + process.name + "\n";
+        }
+    }
+    return text;
+}
+
+std::vector<SignatureMatch> SignatureEngine::match(std::string_view capture) const {
+    std::vector<SignatureMatch> matches;
+    if (!automaton_.compiled()) return matches;
+
+    // Per pattern "seen" flags; signatures are assembled afterwards in file order
+    std::vector<bool> seen = automaton_.find_all(capture);
+
+    // Pattern ids were assigned signature by signature, so owners are contiguous
+    for (uint32_t id = 0; id < pattern_owner_.size(); ++id) {
+        if (!seen[id]) continue;
+        const auto& [sig_index, pattern_index] = pattern_owner_[id];
+        const Signature& sig = signatures_[sig_index];
+
+        if (matches.empty() || matches.back().id != sig.id) {
+            matches.push_back({sig.id, sig.name, sig.category, {}});
+        }
+        matches.back().evidence.push_back(sig.patterns[pattern_index]);
+    }
+
+    return matches;
+}
+
+std::vector<SignatureMatch> SignatureEngine::scan(const AdbAbstraction& adb, const std::string& serial) const {
+    if (!is_loaded()) return {};
+    return match(adb.shell_command(serial, capture_command()));
+}
+
+} // namespace analyzer
@@ -1,43 +1,282 @@
 #include "bootloader_analyzer.h"
+#include "parse/line_scanner.hpp"
 #include <iostream>
 #include <unistd.h>
 
-BootloaderAnalyzer::BootloaderAnalyzer(const AdbAbstraction& adb) : adb(adb) {}
+BootloaderAnalyzer::BootloaderAnalyzer(const AdbAbstraction& adb, device::PropertyCache* properties)
+    : adb(adb), properties(properties) {}
 
 std::optional<BootloaderInfo> BootloaderAnalyzer::analyze(const std::string& serial) const
 {
     BootloaderInfo info;
     info.fastboot_path = locate_fastboot();
     info.fastboot_available = !info.fastboot_path.empty();
+    info.status = BootloaderStatus::UNKNOWN;
 
-    // Note: To get actual bootloader status, device needs to be in fastboot mode
-    // This requires user to reboot device manually or via ADB
-    // For now, we indicate it requires fastboot check
+    // Network fastboot serials look like "tcp:<host>[:<port>]"
+    if (serial.rfind("tcp:", 0) == 0) {
+        std::string target = serial.substr(4);
+        uint16_t port = fastboot::FastbootClient::DEFAULT_TCP_PORT;
+        size_t colon = target.rfind(':');
+        if (colon != std::string::npos) {
+            try {
+                port = static_cast<uint16_t>(std::stoi(target.substr(colon + 1)));
+            } catch (...) {}
+            target = target.substr(0, colon);
+        }
+
+        auto tcp_info = analyze_via_fastboot_tcp(target, port);
+        if (tcp_info) {
+            tcp_info->fastboot_path = info.fastboot_path;
+            tcp_info->fastboot_available = info.fastboot_available;
+            return tcp_info;
+        }
+    }
 
-    if (info.fastboot_available) {
-        // Could attempt to get status if device is already in fastboot
-        // For safety, we'll require user interaction
-        info.status = BootloaderStatus::UNKNOWN;
+    // A running system exposes the lock state through its boot properties
+    std::shared_ptr<const device::PropertySnapshot> props;
+    if (properties) {
+        props = properties->get(serial);
     } else {
-        info.status = BootloaderStatus::UNKNOWN;
+        auto own = std::make_shared<device::PropertySnapshot>();
+        own->load(adb, serial);
+        props = own;
+    }
+
+    if (!props->empty()) {
+        BootloaderInfo inferred = infer_from_properties(*props);
+        inferred.fastboot_path = info.fastboot_path;
+        inferred.fastboot_available = info.fastboot_available;
+        if (!inferred.needs_fastboot_check) {
+            return inferred;
+        }
+        info = inferred;
+    }
+
+    // Ambiguous or no adb: fastboot is authoritative, but only if the device is
+    // already there. We never reboot it ourselves; one getvar all suffices.
+    if (info.fastboot_available && is_in_fastboot(serial)) {
+        auto fastboot_info = analyze_via_fastboot(serial);
+        if (fastboot_info) {
+            fastboot_info->confidence = LockConfidence::HIGH;
+            return fastboot_info;
+        }
+    }
+
+    info.needs_fastboot_check = info.needs_fastboot_check || info.status == BootloaderStatus::UNKNOWN;
+    info.status_string = status_to_string(info.status);
+    return info;
+}
+
+BootloaderInfo BootloaderAnalyzer::infer_from_properties(const device::PropertySnapshot& props) const
+{
+    BootloaderInfo info;
+    info.status = BootloaderStatus::UNKNOWN;
+    info.fastboot_available = false;
+    info.from_properties = true;
+
+    int strong_locked = 0, strong_unlocked = 0;
+    int weak_locked = 0, weak_unlocked = 0;
+
+    auto note = [&info](const std::string& key, const std::string& value, const char* meaning) {
+        info.evidence.push_back(key + "=" + value + " (" + meaning + ")");
+    };
+
+    // Set by the bootloader itself on most devices (Pixel, OnePlus, Motorola, ...)
+    if (auto value = props.get("ro.boot.flash.locked")) {
+        if (*value == "1") {
+            ++strong_locked;
+            note("ro.boot.flash.locked", *value, "locked");
+        } else if (*value == "0") {
+            ++strong_unlocked;
+            note("ro.boot.flash.locked", *value, "unlocked");
+        }
+    }
+
+    // AVB device state passed on the kernel command line
+    if (auto value = props.get("ro.boot.vbmeta.device_state")) {
+        if (*value == "locked") {
+            ++strong_locked;
+            note("ro.boot.vbmeta.device_state", *value, "locked");
+        } else if (*value == "unlocked") {
+            ++strong_unlocked;
+            note("ro.boot.vbmeta.device_state", *value, "unlocked");
+        }
+    }
+
+    // green/yellow only boot on a locked bootloader; orange means unlocked
+    if (auto value = props.get("ro.boot.verifiedbootstate")) {
+        if (*value == "green" || *value == "yellow") {
+            ++strong_locked;
+            note("ro.boot.verifiedbootstate", *value, "locked");
+        } else if (*value == "orange") {
+            ++strong_unlocked;
+            note("ro.boot.verifiedbootstate", *value, "unlocked");
+        }
+    }
+
+    // Vendor-specific lock state properties
+    static const char* vendor_lockstate[] = {
+        "ro.secureboot.lockstate",      // Huawei, Xiaomi, Motorola
+        "ro.boot.bl_state",             // some MediaTek devices
+    };
+    for (const char* key : vendor_lockstate) {
+        if (auto value = props.get(key)) {
+            if (*value == "locked" || *value == "1") {
+                ++weak_locked;
+                note(key, *value, "locked");
+            } else if (*value == "unlocked" || *value == "0" || *value == "2") {
+                ++weak_unlocked;
+                note(key, *value, "unlocked");
+            }
+        }
+    }
+
+    // Samsung Knox warranty bit: set once the device has ever run unofficial
+    // software. It says "was unlocked", not "is unlocked".
+    for (const char* key : {"ro.boot.warranty_bit", "ro.warranty_bit"}) {
+        if (auto value = props.get(key)) {
+            if (*value == "1") {
+                ++weak_unlocked;
+                note(key, *value, "Knox tripped");
+            }
+            break;
+        }
+    }
+
+    bool locked_side = strong_locked + weak_locked > 0;
+    bool unlocked_side = strong_unlocked + weak_unlocked > 0;
+
+    if (strong_locked > 0 && strong_unlocked > 0) {
+        // Authoritative sources disagree
+        info.confidence = LockConfidence::NONE;
+    } else if (strong_locked > 0 || strong_unlocked > 0) {
+        bool locked = strong_locked > 0;
+        info.status = locked ? BootloaderStatus::LOCKED : BootloaderStatus::UNLOCKED;
+        int agreeing = locked ? strong_locked : strong_unlocked;
+        int weak_against = locked ? weak_unlocked : weak_locked;
+        if (weak_against > 0) {
+            info.confidence = LockConfidence::MEDIUM;
+        } else {
+            info.confidence = agreeing >= 2 ? LockConfidence::HIGH : LockConfidence::MEDIUM;
+        }
+    } else if (locked_side != unlocked_side) {
+        info.status = locked_side ? BootloaderStatus::LOCKED : BootloaderStatus::UNLOCKED;
+        info.confidence = LockConfidence::LOW;
+    }
+
+    // Locked, but the user already allowed OEM unlocking in developer options
+    if (info.status == BootloaderStatus::LOCKED &&
+        props.get_or("ro.oem_unlock_supported", "") == "1" &&
+        props.get_or("sys.oem_unlock_allowed", "") == "1") {
+        info.status = BootloaderStatus::UNLOCKABLE;
+        note("sys.oem_unlock_allowed", "1", "OEM unlocking allowed");
     }
 
+    info.needs_fastboot_check = info.confidence == LockConfidence::NONE ||
+                                info.confidence == LockConfidence::LOW;
     info.status_string = status_to_string(info.status);
     return info;
 }
 
-BootloaderStatus BootloaderAnalyzer::get_status_via_fastboot() const
+BootloaderStatus BootloaderAnalyzer::get_status_via_fastboot(const std::string& serial) const
 {
     // This requires device to be in bootloader/fastboot mode
-    std::string output = adb.fastboot_command("getvar unlocked");
+    auto info = analyze_via_fastboot(serial);
+    return info ? info->status : BootloaderStatus::UNKNOWN;
+}
 
-    if (output.find("unlocked: yes") != std::string::npos) {
-        return BootloaderStatus::UNLOCKED;
-    } else if (output.find("unlocked: no") != std::string::npos) {
-        return BootloaderStatus::LOCKED;
+std::optional<BootloaderInfo> BootloaderAnalyzer::analyze_via_fastboot(const std::string& serial) const
+{
+    std::string output = adb.fastboot_command("getvar all", serial);
+    auto variables = fastboot::parse_getvar_all_output(output);
+    if (variables.empty()) {
+        return std::nullopt;
     }
 
-    return BootloaderStatus::UNKNOWN;
+    BootloaderInfo info;
+    info.fastboot_path = locate_fastboot();
+    info.fastboot_available = !info.fastboot_path.empty();
+    apply_fastboot_variables(info, variables);
+    return info;
+}
+
+std::optional<BootloaderInfo> BootloaderAnalyzer::analyze_via_fastboot_tcp(const std::string& host,
+                                                                           uint16_t port) const
+{
+    fastboot::FastbootClient client;
+    if (!client.connect_tcp(host, port)) {
+        return std::nullopt;
+    }
+
+    auto variables = client.getvar_all();
+    if (!variables || variables->empty()) {
+        return std::nullopt;
+    }
+
+    BootloaderInfo info;
+    info.fastboot_available = true;
+    apply_fastboot_variables(info, variables.value());
+    return info;
+}
+
+void BootloaderAnalyzer::apply_fastboot_variables(BootloaderInfo& info,
+                                                  const std::vector<fastboot::Variable>& vars) const
+{
+    info.from_fastboot = true;
+    info.status = BootloaderStatus::UNKNOWN;
+
+    for (const auto& var : vars) {
+        const std::string& name = var.name;
+        const std::string& value = var.value;
+
+        if (name == "unlocked") {
+            if (value == "yes") {
+                info.status = BootloaderStatus::UNLOCKED;
+            } else if (value == "no") {
+                info.status = BootloaderStatus::LOCKED;
+            }
+        } else if (name == "secure") {
+            info.secure = (value == "yes");
+        } else if (name == "is-userspace") {
+            info.is_userspace = (value == "yes");
+        } else if (name == "slot-count") {
+            try {
+                info.slot_count = std::stoi(value);
+            } catch (...) {}
+        } else if (name == "current-slot") {
+            info.current_slot = value;
+        } else if (name == "product") {
+            info.product = value;
+        } else if (name == "serialno") {
+            info.serialno = value;
+        } else if (name == "version-bootloader") {
+            info.bootloader_version = value;
+        } else if (name == "version-baseband") {
+            info.baseband_version = value;
+        }
+
+        info.variables[name] = value;
+    }
+
+    info.status_string = status_to_string(info.status);
+}
+
+bool BootloaderAnalyzer::is_in_fastboot(const std::string& serial) const
+{
+    // "fastboot devices" prints "<serial>\tfastboot"
+    std::string output = adb.fastboot_command("devices");
+    bool found = false;
+
+    parse::for_each_line(output, [&](std::string_view line) {
+        std::string_view fields[2];
+        if (parse::split_whitespace(line, fields, 2) >= 1 &&
+            (serial.empty() || fields[0] == serial)) {
+            found = true;
+        }
+    });
+
+    return found;
 }
 
 std::string BootloaderAnalyzer::status_to_string(BootloaderStatus status) const
@@ -56,6 +295,22 @@ std::string BootloaderAnalyzer::status_to_string(BootloaderStatus status) const
     }
 }
 
+std::string BootloaderAnalyzer::confidence_to_string(LockConfidence confidence) const
+{
+    switch (confidence) {
+        case LockConfidence::HIGH:
+            return "High";
+        case LockConfidence::MEDIUM:
+            return "Medium";
+        case LockConfidence::LOW:
+            return "Low";
+        case LockConfidence::NONE:
+            return "None";
+        default:
+            return "Unknown";
+    }
+}
+
 std::string BootloaderAnalyzer::get_data_loss_warning() const
 {
     return "⚠️  WARNING: Unlocking bootloader will ERASE all device data!\n"
@@ -0,0 +1,150 @@
+#include "device/discovery.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <future>
+
+namespace device {
+
+DeviceDiscovery::DeviceDiscovery(const AdbAbstraction& adb) : adb_(adb) {}
+
+DeviceTable DeviceDiscovery::scan() {
+    // Both tools block on USB enumeration; run them side by side
+    auto adb_future = std::async(std::launch::async, [this]() {
+        return adb_.list_devices();
+    });
+    auto fastboot_future = std::async(std::launch::async, [this]() -> std::string {
+        if (!adb_.is_fastboot_available()) return "";
+        return adb_.fastboot_command("devices -l");
+    });
+
+    DeviceTable table;
+
+    for (const auto& dev : adb_future.get()) {
+        DiscoveredDevice entry;
+        entry.serial = dev.serial;
+        entry.mode = mode_from_adb_state(dev.state_string);
+        entry.transport = "adb";
+        entry.state_string = dev.state_string;
+        entry.usb = dev.usb;
+        entry.product = dev.product;
+        entry.model = dev.model;
+        entry.device = dev.device;
+        entry.transport_id = dev.transport_id;
+        table[entry.serial] = entry;
+    }
+
+    // A serial seen by fastboot is in the bootloader, whatever adb still thinks
+    for (auto& entry : parse_fastboot_devices(fastboot_future.get())) {
+        auto it = table.find(entry.serial);
+        if (it != table.end()) {
+            entry.product = it->second.product;
+            entry.model = it->second.model;
+            entry.device = it->second.device;
+        }
+        table[entry.serial] = entry;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_ = table;
+    last_scan_ = std::chrono::steady_clock::now();
+    scanned_ = true;
+    return table;
+}
+
+DeviceTable DeviceDiscovery::get(std::chrono::milliseconds max_age) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (scanned_ && std::chrono::steady_clock::now() - last_scan_ < max_age) {
+            return cache_;
+        }
+    }
+    return scan();
+}
+
+DeviceTable DeviceDiscovery::devices() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_;
+}
+
+std::optional<DiscoveredDevice> DeviceDiscovery::find(const std::string& serial) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(serial);
+    if (it == cache_.end()) return std::nullopt;
+    return it->second;
+}
+
+void DeviceDiscovery::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    scanned_ = false;
+}
+
+bool DeviceDiscovery::has_scanned() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return scanned_;
+}
+
+DeviceMode DeviceDiscovery::mode_from_adb_state(const std::string& state) {
+    if (state == "device") return DeviceMode::SYSTEM;
+    if (state == "recovery") return DeviceMode::RECOVERY;
+    if (state == "sideload") return DeviceMode::SIDELOAD;
+    if (state == "rescue") return DeviceMode::RESCUE;
+    if (state == "bootloader") return DeviceMode::BOOTLOADER;
+    if (state == "unauthorized" || state == "authorizing") return DeviceMode::UNAUTHORIZED;
+    if (state == "offline" || state == "connecting") return DeviceMode::OFFLINE;
+    if (state == "no permissions") return DeviceMode::NO_PERMISSIONS;
+    return DeviceMode::UNKNOWN;
+}
+
+std::vector<DiscoveredDevice> DeviceDiscovery::parse_fastboot_devices(std::string_view output) {
+    std::vector<DiscoveredDevice> devices;
+
+    // "SERIAL\tfastboot" or, with -l, "SERIAL   fastboot usb:1-1"
+    parse::for_each_line(output, [&devices](std::string_view line) {
+        std::string_view fields[3];
+        size_t count = parse::split_whitespace(line, fields, 3);
+        if (count < 2 || (fields[1] != "fastboot" && fields[1] != "fastbootd")) {
+            return;
+        }
+
+        DiscoveredDevice entry;
+        entry.serial = std::string(fields[0]);
+        entry.mode = (fields[1] == "fastbootd") ? DeviceMode::FASTBOOTD : DeviceMode::BOOTLOADER;
+        entry.transport = "fastboot";
+        entry.state_string = std::string(fields[1]);
+        if (count == 3 && parse::starts_with(fields[2], "usb:")) {
+            entry.usb = std::string(fields[2].substr(4));
+        }
+        devices.push_back(entry);
+    });
+
+    return devices;
+}
+
+std::string DeviceDiscovery::mode_to_string(DeviceMode mode) {
+    switch (mode) {
+        case DeviceMode::SYSTEM:
+            return "Android";
+        case DeviceMode::RECOVERY:
+            return "Recovery";
+        case DeviceMode::SIDELOAD:
+            return "Sideload";
+        case DeviceMode::RESCUE:
+            return "Rescue";
+        case DeviceMode::BOOTLOADER:
+            return "Bootloader";
+        case DeviceMode::FASTBOOTD:
+            return "fastbootd";
+        case DeviceMode::UNAUTHORIZED:
+            return "Unauthorized";
+        case DeviceMode::OFFLINE:
+            return "Offline";
+        case DeviceMode::NO_PERMISSIONS:
+            return "No Permissions";
+        case DeviceMode::DISCONNECTED:
+            return "Disconnected";
+        default:
+            return "Unknown";
+    }
+}
+
+} // namespace device
@@ -0,0 +1,159 @@
+#include "device/package_inventory.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <iterator>
+
+namespace device {
+
+namespace {
+
+template <typename T>
+T to_number(std::string_view text, T fallback) {
+    T value = fallback;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+} // namespace
+
+bool PackageInventory::load(const AdbAbstraction& adb, const std::string& serial) {
+    // Newest flags first; pm rejects unknown options with an error and no packages
+    static const char* commands[] = {
+        "pm list packages -f -U --show-versioncode 2>/dev/null",
+        "pm list packages -f -U 2>/dev/null",
+        "pm list packages -f 2>/dev/null",
+    };
+
+    // The SDK level says which flags pm knows (-U: 26, --show-versioncode: 28),
+    // sparing old devices the rejected attempts
+    size_t first = 0;
+    if (auto caps = adb.capabilities(serial); caps && caps->sdk > 0) {
+        first = caps->sdk >= 28 ? 0 : caps->sdk >= 26 ? 1 : 2;
+    }
+
+    for (size_t i = first; i < std::size(commands); ++i) {
+        std::string output = adb.shell_command(serial, commands[i]);
+        if (output.find("package:") != std::string::npos) {
+            parse(output);
+            return true;
+        }
+    }
+
+    parse("");
+    return false;
+}
+
+void PackageInventory::parse(std::string_view output) {
+    arena_.clear();
+    records_.clear();
+    index_.clear();
+
+    // The arena never needs more than the raw output
+    arena_.reserve(output.size());
+    records_.reserve(parse::count_byte(output.data(), output.data() + output.size(), '\n') + 1);
+
+    parse::for_each_line(output, [this](std::string_view line) {
+        PackageRecord parsed;
+        if (!parse_line(line, parsed)) return;
+
+        Record record;
+        record.name_offset = static_cast<uint32_t>(arena_.size());
+        record.name_length = static_cast<uint16_t>(parsed.name.size());
+        arena_.append(parsed.name);
+        record.path_offset = static_cast<uint32_t>(arena_.size());
+        record.path_length = static_cast<uint16_t>(parsed.path.size());
+        arena_.append(parsed.path);
+        record.uid = parsed.uid;
+        record.version_code = parsed.version_code;
+        records_.push_back(record);
+    });
+
+    build_index();
+    loaded_at_ = std::chrono::steady_clock::now();
+}
+
+void PackageInventory::build_index() {
+    // Views are taken only once the arena has stopped growing
+    index_.reserve(records_.size());
+    for (uint32_t i = 0; i < records_.size(); ++i) {
+        index_.emplace(view(records_[i]).name, i);
+    }
+}
+
+PackageRecord PackageInventory::view(const Record& record) const {
+    PackageRecord result;
+    result.name = std::string_view(arena_).substr(record.name_offset, record.name_length);
+    result.path = std::string_view(arena_).substr(record.path_offset, record.path_length);
+    result.uid = record.uid;
+    result.version_code = record.version_code;
+    return result;
+}
+
+std::optional<PackageRecord> PackageInventory::find(std::string_view name) const {
+    auto it = index_.find(name);
+    if (it == index_.end()) return std::nullopt;
+    return view(records_[it->second]);
+}
+
+std::optional<PackageRecord> PackageInventory::find_any(std::initializer_list<std::string_view> names) const {
+    for (std::string_view name : names) {
+        auto record = find(name);
+        if (record) return record;
+    }
+    return std::nullopt;
+}
+
+std::vector<PackageRecord> PackageInventory::search(std::string_view needle) const {
+    std::vector<PackageRecord> matches;
+    auto equal_ci = [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    };
+
+    for (const auto& record : records_) {
+        PackageRecord package = view(record);
+        if (std::search(package.name.begin(), package.name.end(),
+                        needle.begin(), needle.end(), equal_ci) != package.name.end()) {
+            matches.push_back(package);
+        }
+    }
+    return matches;
+}
+
+bool PackageInventory::parse_line(std::string_view line, PackageRecord& record) {
+    line = parse::trim(line);
+    if (!parse::starts_with(line, "package:")) return false;
+    line.remove_prefix(8);
+
+    // "<path>=<name>" comes first; the path itself may contain '=' (e.g. "~~AbC==")
+    size_t space = line.find(' ');
+    std::string_view head = line.substr(0, space);
+    std::string_view tail = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+
+    size_t equals = head.rfind('=');
+    if (equals != std::string_view::npos) {
+        record.path = head.substr(0, equals);
+        record.name = head.substr(equals + 1);
+    } else {
+        record.path = std::string_view();
+        record.name = head;
+    }
+    if (record.name.empty()) return false;
+
+    // Remaining "key:value" fields in any order ("installer:" may also appear)
+    std::string_view fields[6];
+    size_t count = parse::split_whitespace(tail, fields, 6);
+    for (size_t i = 0; i < count; ++i) {
+        std::string_view field = fields[i];
+        if (parse::starts_with(field, "versionCode:")) {
+            record.version_code = to_number<long long>(field.substr(12), -1);
+        } else if (parse::starts_with(field, "uid:")) {
+            record.uid = to_number<int>(field.substr(4), -1);
+        }
+    }
+    return true;
+}
+
+} // namespace device
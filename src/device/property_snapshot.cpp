@@ -0,0 +1,251 @@
+#include "device/property_snapshot.hpp"
+#include "parse/line_scanner.hpp"
+#include "parse/properties.hpp"
+#include <algorithm>
+
+namespace device {
+
+namespace {
+
+// 32 lowercase hex digits, as md5sum prints them (also keeps anything
+// else out of the shell command)
+bool is_md5(std::string_view text) {
+    return text.size() == 32 &&
+           std::all_of(text.begin(), text.end(), [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'); });
+}
+
+} // namespace
+
+void PropertySnapshot::add_line(std::string_view line) {
+    std::string_view key, value;
+    if (parse::parse_property_line(line, key, value)) {
+        entries_.push_back({pool_->intern(key), pool_->intern(value)});
+    }
+}
+
+PropertySnapshot::PropertySnapshot(const PropertySnapshot& other, std::shared_ptr<StringPool> pool)
+    : pool_(std::move(pool)), loaded_at_(other.loaded_at_), content_hash_(other.content_hash_) {
+    entries_.reserve(other.entries_.size());
+    for (const Entry& entry : other.entries_) {
+        entries_.push_back({pool_->intern(other.pool_->view(entry.key)),
+                            pool_->intern(other.pool_->view(entry.value))});
+    }
+    // Keys are unique already; only the id order changed
+    sort_entries();
+}
+
+void PropertySnapshot::sort_entries() {
+    std::stable_sort(entries_.begin(), entries_.end(),
+                     [](const Entry& a, const Entry& b) { return a.key < b.key; });
+}
+
+void PropertySnapshot::finish() {
+    sort_entries();
+
+    // Keep the last of each run of equal keys
+    auto out = entries_.begin();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        auto next = it + 1;
+        if (next != entries_.end() && next->key == it->key) continue;
+        *out++ = *it;
+    }
+    entries_.erase(out, entries_.end());
+    entries_.shrink_to_fit();
+    loaded_at_ = std::chrono::steady_clock::now();
+}
+
+bool PropertySnapshot::load(const AdbAbstraction& adb, const std::string& serial) {
+    return load_if_changed(adb, serial, "") == LoadResult::LOADED;
+}
+
+PropertySnapshot::LoadResult PropertySnapshot::load_if_changed(const AdbAbstraction& adb, const std::string& serial,
+                                                               const std::string& known_hash) {
+    // The hash line ("<md5>  -", or the known hash alone) comes first and
+    // the dump only if the hash differs. The dump is a second getprop; a
+    // change in between just makes the next refresh reload. Without md5sum
+    // there is no hash line and the dump always follows. No $ or double
+    // quotes: the adb binary fallback passes the command in double quotes.
+    std::string command = "getprop | md5sum 2>/dev/null; getprop";
+    if (is_md5(known_hash)) {
+        command = "getprop | md5sum 2>/dev/null | grep -q '^" + known_hash + " ' && echo " + known_hash +
+                  " || { " + command + "; }";
+    }
+
+    std::vector<Entry> previous;
+    previous.swap(entries_);
+    bool first = true;
+    bool unchanged = false;
+    std::string hash;
+    adb.shell_command_lines(serial, command, [&](std::string_view line) {
+        if (first) {
+            first = false;
+            std::string_view reported = parse::trim(line).substr(0, 32);
+            if (is_md5(reported)) {
+                hash = std::string(reported);
+                unchanged = hash == known_hash;
+                return !unchanged;
+            }
+        }
+        add_line(line);
+        return true;
+    });
+
+    if (unchanged) {
+        entries_.swap(previous);
+        return LoadResult::UNCHANGED;
+    }
+    content_hash_ = entries_.empty() ? std::string() : hash;
+    finish();
+    return entries_.empty() ? LoadResult::FAILED : LoadResult::LOADED;
+}
+
+void PropertySnapshot::parse(std::string_view output) {
+    entries_.clear();
+    content_hash_.clear();
+    parse::for_each_line(output, [this](std::string_view line) {
+        add_line(line);
+    });
+    finish();
+}
+
+const PropertySnapshot::Entry* PropertySnapshot::find(std::string_view key) const {
+    // A key the pool has never seen cannot be in any snapshot
+    auto id = pool_->find(key);
+    if (!id) return nullptr;
+
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), id.value(),
+                               [](const Entry& entry, uint32_t k) { return entry.key < k; });
+    if (it == entries_.end() || it->key != id.value()) return nullptr;
+    return &*it;
+}
+
+std::string_view PropertySnapshot::view(std::string_view key) const {
+    const Entry* entry = find(key);
+    return entry ? pool_->view(entry->value) : std::string_view();
+}
+
+std::optional<std::string> PropertySnapshot::get(const std::string& key) const {
+    std::string_view value = view(key);
+    if (value.empty()) {
+        return std::nullopt;
+    }
+    return std::string(value);
+}
+
+std::string PropertySnapshot::get_or(const std::string& key, const std::string& fallback) const {
+    std::string_view value = view(key);
+    return value.empty() ? fallback : std::string(value);
+}
+
+bool PropertySnapshot::has(const std::string& key) const {
+    return find(key) != nullptr;
+}
+
+PropertyCache::PropertyCache(const AdbAbstraction& adb)
+    : adb_(adb), pool_(std::make_shared<StringPool>()) {}
+
+std::shared_ptr<const PropertySnapshot> PropertyCache::get(const std::string& serial,
+                                                           std::chrono::milliseconds max_age) {
+    std::shared_ptr<const PropertySnapshot> cached;
+    std::shared_ptr<StringPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = snapshots_.find(serial);
+        if (it != snapshots_.end()) {
+            if (std::chrono::steady_clock::now() - it->second.checked_at < max_age) {
+                return it->second.snapshot;
+            }
+            cached = it->second.snapshot;
+        }
+        pool = pool_;
+    }
+
+    auto snapshot = std::make_shared<PropertySnapshot>(pool);
+    auto result = snapshot->load_if_changed(adb_, serial, cached ? cached->content_hash() : "");
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (result == PropertySnapshot::LoadResult::UNCHANGED) {
+        stats_.unchanged++;
+        snapshots_[serial] = {cached, std::chrono::steady_clock::now()};
+        return cached;
+    }
+    if (result == PropertySnapshot::LoadResult::LOADED) stats_.loads++;
+    store_locked(serial, snapshot);
+    return snapshot;
+}
+
+std::shared_ptr<const PropertySnapshot> PropertyCache::put(const std::string& serial,
+                                                           std::string_view getprop_output) {
+    std::shared_ptr<StringPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pool = pool_;
+    }
+
+    auto snapshot = std::make_shared<PropertySnapshot>(pool);
+    snapshot->parse(getprop_output);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.loads++;
+    store_locked(serial, snapshot);
+    return snapshot;
+}
+
+void PropertyCache::store_locked(const std::string& serial, std::shared_ptr<const PropertySnapshot> snapshot) {
+    snapshots_[serial] = {std::move(snapshot), std::chrono::steady_clock::now()};
+
+    size_t strings = pool_->size();
+    if (strings >= COMPACT_MIN_STRINGS && strings >= 2 * compacted_size_) {
+        compact_locked();
+    }
+}
+
+void PropertyCache::compact_locked() {
+    auto pool = std::make_shared<StringPool>();
+    for (auto& [serial, cached] : snapshots_) {
+        cached.snapshot = std::make_shared<const PropertySnapshot>(*cached.snapshot, pool);
+    }
+    pool_ = std::move(pool);
+    compacted_size_ = pool_->size();
+    stats_.compactions++;
+}
+
+void PropertyCache::compact() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    compact_locked();
+}
+
+void PropertyCache::invalidate(const std::string& serial) {
+    // Only mark it stale: the next get() still sends its hash, and gets the
+    // same snapshot back if nothing changed
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = snapshots_.find(serial);
+    if (it != snapshots_.end()) {
+        it->second.checked_at = std::chrono::steady_clock::time_point{};
+    }
+}
+
+void PropertyCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshots_.clear();
+    pool_ = std::make_shared<StringPool>();
+    compacted_size_ = 0;
+}
+
+PropertyCache::Stats PropertyCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.pool_strings = pool_->size();
+    return stats;
+}
+
+size_t PropertyCache::memory_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t bytes = pool_->memory_bytes();
+    for (const auto& [serial, cached] : snapshots_) {
+        bytes += cached.snapshot->memory_bytes();
+    }
+    return bytes;
+}
+
+} // namespace device
@@ -0,0 +1,237 @@
+#include "device/reboot_tracker.hpp"
+#include "adb/adb_connection.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace device {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+// Fastboot (and the no-server fallback) can only be polled
+constexpr milliseconds POLL_INTERVAL{250};
+
+bool is_fastboot_mode(DeviceMode mode) {
+    return mode == DeviceMode::BOOTLOADER || mode == DeviceMode::FASTBOOTD;
+}
+
+// fastboot does not reliably tell the bootloader from fastbootd
+bool mode_matches(DeviceMode current, DeviceMode target) {
+    if (is_fastboot_mode(target)) return is_fastboot_mode(current);
+    return current == target;
+}
+
+class Watcher {
+public:
+    Watcher(const std::string& adb_path, const std::string& serial, DeviceMode target,
+            std::shared_ptr<std::atomic<bool>> cancelled)
+        : adb_(adb_path), serial_(serial), target_(target), cancelled_(std::move(cancelled)) {}
+
+    // Synchronous part: subscribe and capture the starting mode
+    void subscribe() {
+        streaming_ = connection_.connect() && connection_.request("host:track-devices");
+        if (streaming_) {
+            // The server sends the current list immediately
+            auto list = connection_.read_length_prefixed();
+            if (list) {
+                start_mode_ = RebootTracker::mode_in_device_list(*list, serial_);
+            } else {
+                streaming_ = false;
+            }
+        }
+
+        if (!streaming_) {
+            start_mode_ = poll_mode();
+        }
+
+        current_ = start_mode_;
+        start_ = Clock::now();
+        entered_ = start_;
+    }
+
+    RebootResult run(milliseconds timeout) {
+        RebootResult result;
+        result.target = target_;
+
+        Clock::time_point deadline = start_ + timeout;
+        Clock::time_point next_poll = start_;
+
+        while (!reached()) {
+            if (gone_unobservable()) {
+                result.unconfirmed = true;
+                break;
+            }
+            if (cancelled_->load()) {
+                result.error = "Tracking cancelled";
+                break;
+            }
+
+            Clock::time_point now = Clock::now();
+            if (now >= deadline) {
+                result.timed_out = true;
+                break;
+            }
+
+            int wait_ms = static_cast<int>(std::min<long long>(
+                std::chrono::duration_cast<milliseconds>(deadline - now).count(),
+                POLL_INTERVAL.count()));
+
+            if (streaming_) {
+                if (connection_.wait_readable(wait_ms)) {
+                    auto list = connection_.read_length_prefixed();
+                    if (list) {
+                        DeviceMode mode = RebootTracker::mode_in_device_list(*list, serial_);
+                        // Gone from adb may just mean "now in fastboot"; let the poll decide
+                        if (mode != DeviceMode::DISCONNECTED || !is_fastboot_mode(current_)) {
+                            transition(mode);
+                        }
+                    } else {
+                        // Server went away (e.g. restarted); keep going by polling
+                        streaming_ = false;
+                        connection_.close();
+                    }
+                }
+            } else {
+                std::this_thread::sleep_for(milliseconds(wait_ms));
+            }
+
+            // Fastboot has no event stream: poll only while adb cannot see the device
+            now = Clock::now();
+            bool absent = current_ == DeviceMode::DISCONNECTED || is_fastboot_mode(current_);
+            if (now >= next_poll && (!streaming_ || absent)) {
+                DeviceMode mode = streaming_ ? poll_fastboot() : poll_mode();
+                if (mode != DeviceMode::DISCONNECTED || !streaming_) {
+                    transition(mode);
+                } else if (is_fastboot_mode(current_)) {
+                    transition(DeviceMode::DISCONNECTED);
+                }
+                next_poll = Clock::now() + POLL_INTERVAL;
+            }
+        }
+
+        Clock::time_point end = Clock::now();
+        result.phases = phases_;
+        result.phases.push_back({current_, std::chrono::duration_cast<milliseconds>(end - entered_)});
+        result.reached = reached();
+        result.final_mode = current_;
+        result.total = std::chrono::duration_cast<milliseconds>(end - start_);
+        return result;
+    }
+
+private:
+    AdbAbstraction adb_;
+    adb::AdbConnection connection_;
+    std::string serial_;
+    DeviceMode target_;
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+    bool streaming_ = false;
+
+    DeviceMode start_mode_ = DeviceMode::UNKNOWN;
+    DeviceMode current_ = DeviceMode::UNKNOWN;
+    bool left_start_ = false;
+    Clock::time_point start_;
+    Clock::time_point entered_;
+    std::vector<RebootPhase> phases_;
+
+    bool reached() const {
+        // Nothing tells Download Mode from any other reboot that drops adb
+        if (target_ == DeviceMode::DISCONNECTED) return false;
+        if (!mode_matches(current_, target_)) return false;
+        // Rebooting into the mode we started in only counts after leaving it
+        return left_start_ || !mode_matches(start_mode_, target_);
+    }
+
+    bool gone_unobservable() const {
+        return target_ == DeviceMode::DISCONNECTED && current_ == DeviceMode::DISCONNECTED && left_start_;
+    }
+
+    void transition(DeviceMode mode) {
+        if (mode == current_) return;
+
+        Clock::time_point now = Clock::now();
+        phases_.push_back({current_, std::chrono::duration_cast<milliseconds>(now - entered_)});
+        current_ = mode;
+        entered_ = now;
+        if (mode != start_mode_) {
+            left_start_ = true;
+        }
+    }
+
+    DeviceMode poll_fastboot() {
+        if (!adb_.is_fastboot_available()) return DeviceMode::DISCONNECTED;
+        for (const auto& dev : DeviceDiscovery::parse_fastboot_devices(adb_.fastboot_command("devices"))) {
+            if (dev.serial == serial_) return dev.mode;
+        }
+        return DeviceMode::DISCONNECTED;
+    }
+
+    DeviceMode poll_mode() {
+        for (const auto& dev : adb_.list_devices()) {
+            if (dev.serial == serial_) return DeviceDiscovery::mode_from_adb_state(dev.state_string);
+        }
+        return poll_fastboot();
+    }
+};
+
+} // namespace
+
+RebootTracker::RebootTracker(const std::string& adb_path) : adb_path_(adb_path) {}
+
+std::future<RebootResult> RebootTracker::track(const std::string& serial, DeviceMode target,
+                                               std::chrono::milliseconds timeout) {
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancel_flags_.push_back(cancelled);
+    }
+
+    auto watcher = std::make_shared<Watcher>(adb_path_, serial, target, cancelled);
+    watcher->subscribe();
+
+    // Detached so that an abandoned future never blocks its owner
+    auto promise = std::make_shared<std::promise<RebootResult>>();
+    std::future<RebootResult> future = promise->get_future();
+    std::thread([watcher, promise, timeout]() {
+        promise->set_value(watcher->run(timeout));
+    }).detach();
+
+    return future;
+}
+
+void RebootTracker::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& flag : cancel_flags_) {
+        flag->store(true);
+    }
+    cancel_flags_.clear();
+}
+
+DeviceMode RebootTracker::target_for_reboot_type(const std::string& type) {
+    if (type == "bootloader") return DeviceMode::BOOTLOADER;
+    if (type == "fastboot") return DeviceMode::FASTBOOTD;
+    if (type == "recovery") return DeviceMode::RECOVERY;
+    if (type == "sideload" || type == "sideload-auto-reboot") return DeviceMode::SIDELOAD;
+    // Samsung Download Mode is invisible to adb and fastboot
+    if (type == "download") return DeviceMode::DISCONNECTED;
+    return DeviceMode::SYSTEM;
+}
+
+DeviceMode RebootTracker::mode_in_device_list(const std::string& list, const std::string& serial) {
+    DeviceMode mode = DeviceMode::DISCONNECTED;
+
+    // Same "serial\tstate" lines as "adb devices"
+    parse::for_each_line(list, [&](std::string_view line) {
+        std::string_view fields[2];
+        if (parse::split_fields(line, '\t', fields, 2) == 2 && fields[0] == serial) {
+            mode = DeviceDiscovery::mode_from_adb_state(std::string(parse::trim(fields[1])));
+        }
+    });
+
+    return mode;
+}
+
+} // namespace device
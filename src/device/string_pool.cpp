@@ -0,0 +1,78 @@
+#include "device/string_pool.hpp"
+#include <cstring>
+#include <mutex>
+
+namespace device {
+
+StringPool::StringPool() {
+    strings_.emplace_back();
+    index_.emplace(std::string_view(), 0);
+}
+
+std::string_view StringPool::store(std::string_view value) {
+    if (value.size() > BLOCK_SIZE / 4) {
+        // Large values get a block of their own so they do not waste a shared one
+        blocks_.emplace_back(new char[value.size()]);
+        std::memcpy(blocks_.back().get(), value.data(), value.size());
+        arena_bytes_ += value.size();
+        return std::string_view(blocks_.back().get(), value.size());
+    }
+
+    if (BLOCK_SIZE - block_used_ < value.size()) {
+        blocks_.emplace_back(new char[BLOCK_SIZE]);
+        block_used_ = 0;
+        arena_bytes_ += BLOCK_SIZE;
+        current_block_ = blocks_.back().get();
+    }
+
+    char* at = current_block_ + block_used_;
+    std::memcpy(at, value.data(), value.size());
+    block_used_ += value.size();
+    return std::string_view(at, value.size());
+}
+
+uint32_t StringPool::intern(std::string_view value) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = index_.find(value);
+        if (it != index_.end()) return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(value);
+    if (it != index_.end()) return it->second;
+
+    std::string_view stored = store(value);
+    uint32_t id = static_cast<uint32_t>(strings_.size());
+    strings_.push_back(stored);
+    index_.emplace(stored, id);
+    return id;
+}
+
+std::optional<uint32_t> StringPool::find(std::string_view value) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = index_.find(value);
+    if (it == index_.end()) return std::nullopt;
+    return it->second;
+}
+
+std::string_view StringPool::view(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return id < strings_.size() ? strings_[id] : std::string_view();
+}
+
+size_t StringPool::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return strings_.size();
+}
+
+size_t StringPool::memory_bytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    // Hash nodes hold a view, an id and a next pointer; buckets are one pointer each
+    size_t node = sizeof(void*) + sizeof(std::string_view) + sizeof(uint32_t) + sizeof(size_t);
+    return arena_bytes_ +
+           strings_.capacity() * sizeof(std::string_view) +
+           index_.size() * node + index_.bucket_count() * sizeof(void*);
+}
+
+} // namespace device
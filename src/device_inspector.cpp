@@ -1,18 +1,31 @@
 #include "device_inspector.h"
-#include <sstream>
+#include "parse/line_scanner.hpp"
+#include "agent/agent_client.hpp"
+#include <charconv>
 #include <cctype>
 #include <algorithm>
 
-DeviceInspector::DeviceInspector(const AdbAbstraction& adb) : adb(adb) {}
+DeviceInspector::DeviceInspector(const AdbAbstraction& adb, device::PropertyCache* properties)
+    : adb(adb), properties(properties) {}
 
 std::optional<DeviceInfo> DeviceInspector::inspect(const std::string& serial) const
 {
     DeviceInfo info;
 
+    // All properties below come from one getprop
+    std::shared_ptr<const device::PropertySnapshot> props;
+    if (properties) {
+        props = properties->get(serial);
+    } else {
+        auto own = std::make_shared<device::PropertySnapshot>();
+        own->load(adb, serial);
+        props = own;
+    }
+
     // Manufacturer and model
-    auto mfg = adb.get_property(serial, "ro.product.manufacturer");
-    auto model = adb.get_property(serial, "ro.product.model");
-    auto codename = adb.get_property(serial, "ro.product.device");
+    auto mfg = props->get("ro.product.manufacturer");
+    auto model = props->get("ro.product.model");
+    auto codename = props->get("ro.product.device");
 
     if (!mfg || !model) {
         return std::nullopt;  // Device not accessible
@@ -23,8 +36,8 @@ std::optional<DeviceInfo> DeviceInspector::inspect(const std::string& serial) co
     info.codename = codename ? codename.value() : "unknown";
 
     // Android version
-    auto android_ver = adb.get_property(serial, "ro.build.version.release");
-    auto api_level = adb.get_property(serial, "ro.build.version.sdk");
+    auto android_ver = props->get("ro.build.version.release");
+    auto api_level = props->get("ro.build.version.sdk");
 
     if (android_ver) {
         info.android_version = android_ver.value();
@@ -36,14 +49,14 @@ std::optional<DeviceInfo> DeviceInspector::inspect(const std::string& serial) co
     }
 
     // Build fingerprint
-    auto fingerprint = adb.get_property(serial, "ro.build.fingerprint");
+    auto fingerprint = props->get("ro.build.fingerprint");
     if (fingerprint) {
         info.build_fingerprint = fingerprint.value();
     }
 
     // CPU ABI
-    auto cpu_abi = adb.get_property(serial, "ro.product.cpu.abi");
-    auto cpu_abi2 = adb.get_property(serial, "ro.product.cpu.abi2");
+    auto cpu_abi = props->get("ro.product.cpu.abi");
+    auto cpu_abi2 = props->get("ro.product.cpu.abi2");
 
     if (cpu_abi) {
         info.cpu_abi = cpu_abi.value();
@@ -53,31 +66,25 @@ std::optional<DeviceInfo> DeviceInspector::inspect(const std::string& serial) co
         info.cpu_abi2 = cpu_abi2.value();
     }
 
-    // CPU cores
-    std::string cpuinfo = adb.shell_command(serial, "cat /proc/cpuinfo");
-    info.cpu_cores = parse_cpu_cores(cpuinfo);
-
-    // RAM
-    std::string meminfo = adb.shell_command(serial, "cat /proc/meminfo");
-    info.ram_mb = parse_ram_mb(meminfo);
-
-    // Storage
-    std::string df_output = adb.shell_command(serial, "df /data");
-    parse_storage_info(df_output, info.storage_total_mb, info.storage_free_mb);
+    // CPU cores, RAM and storage: one agent request when an agent build is
+    // available, else a pipelined /proc pull and df
+    if (!inspect_with_agent(serial, info)) {
+        inspect_hardware(serial, info);
+    }
 
     // Kernel
-    auto kernel_release = adb.get_property(serial, "ro.build.version.release");
-    auto kernel_version = adb.get_property(serial, "ro.kernel.version");
+    auto kernel_release = props->get("ro.build.version.release");
+    auto kernel_version = props->get("ro.kernel.version");
 
     if (kernel_version) {
         info.kernel_version = kernel_version.value();
     }
 
     // Build info
-    auto build_type = adb.get_property(serial, "ro.build.type");
-    auto build_date = adb.get_property(serial, "ro.build.date.utc");
-    auto build_id = adb.get_property(serial, "ro.build.id");
-    auto build_host = adb.get_property(serial, "ro.build.host");
+    auto build_type = props->get("ro.build.type");
+    auto build_date = props->get("ro.build.date.utc");
+    auto build_id = props->get("ro.build.id");
+    auto build_host = props->get("ro.build.host");
 
     if (build_type) info.build_type = build_type.value();
     if (build_date) info.build_date = build_date.value();
@@ -87,6 +94,69 @@ std::optional<DeviceInfo> DeviceInspector::inspect(const std::string& serial) co
     return info;
 }
 
+void DeviceInspector::inspect_hardware(const std::string& serial, DeviceInfo& info) const
+{
+    // CPU cores and RAM: both /proc files in one pipelined pull, each
+    // parsed line by line as it arrives
+    int cores = 0;
+    long long ram_mb = 0;
+    parse::LineSplitter cpuinfo_lines;
+    parse::LineSplitter meminfo_lines;
+    auto count_core = [&cores](std::string_view line) {
+        if (parse::starts_with(line, "processor")) cores++;
+        return true;
+    };
+    auto find_mem_total = [&](std::string_view line) {
+        if (!parse::starts_with(line, "MemTotal")) return true;
+        ram_mb = parse_ram_mb(std::string(line));
+        return false;
+    };
+
+    auto manifest = adb.pull_bundle(serial, {"/proc/cpuinfo", "/proc/meminfo"},
+                                    [&](size_t index, std::string_view chunk) {
+        return index == 0 ? cpuinfo_lines.feed(chunk, count_core) : meminfo_lines.feed(chunk, find_mem_total);
+    });
+    if (manifest && manifest->entries[0].ok && manifest->entries[1].ok) {
+        cpuinfo_lines.finish(count_core);
+        meminfo_lines.finish(find_mem_total);
+        info.cpu_cores = cores > 0 ? cores : 1;
+        info.ram_mb = ram_mb;
+    } else {
+        info.cpu_cores = get_cpu_cores(serial);
+        info.ram_mb = get_ram_mb(serial);
+    }
+
+    // Storage
+    std::string df_output = adb.shell_command(serial, "df /data");
+    parse_storage_info(df_output, info.storage_total_mb, info.storage_free_mb);
+}
+
+bool DeviceInspector::inspect_with_agent(const std::string& serial, DeviceInfo& info) const
+{
+    if (agent_dir.empty() || info.cpu_abi.empty()) {
+        return false;
+    }
+
+    agent::AgentClient client(adb, serial);
+    if (!client.deploy(agent::AgentClient::binary_for_abi(agent_dir, info.cpu_abi))) {
+        return false;
+    }
+
+    agent::AgentQuery query;
+    size_t system = query.system_info();
+    auto results = client.run(query);
+    auto system_info = results ? results->system_info(system) : std::nullopt;
+    if (!system_info || system_info->mem_total_kb == 0) {
+        return false;
+    }
+
+    info.cpu_cores = system_info->cpu_cores;
+    info.ram_mb = static_cast<long long>(system_info->mem_total_kb / 1024);
+    info.storage_total_mb = static_cast<long long>(system_info->data_total_bytes / (1024 * 1024));
+    info.storage_free_mb = static_cast<long long>(system_info->data_free_bytes / (1024 * 1024));
+    return true;
+}
+
 std::string DeviceInspector::get_manufacturer(const std::string& serial) const
 {
     auto val = adb.get_property(serial, "ro.product.manufacturer");
@@ -136,14 +206,28 @@ std::string DeviceInspector::get_cpu_abi(const std::string& serial) const
 
 int DeviceInspector::get_cpu_cores(const std::string& serial) const
 {
-    std::string cpuinfo = adb.shell_command(serial, "cat /proc/cpuinfo");
-    return parse_cpu_cores(cpuinfo);
+    int cores = 0;
+    adb.shell_command_lines(serial, "cat /proc/cpuinfo", [&cores](std::string_view line) {
+        if (parse::starts_with(line, "processor")) {
+            cores++;
+        }
+        return true;
+    });
+    return cores > 0 ? cores : 1;
 }
 
 long long DeviceInspector::get_ram_mb(const std::string& serial) const
 {
-    std::string meminfo = adb.shell_command(serial, "cat /proc/meminfo");
-    return parse_ram_mb(meminfo);
+    // MemTotal is the first line; stop reading as soon as it arrives
+    long long ram_mb = 0;
+    adb.shell_command_lines(serial, "cat /proc/meminfo", [&](std::string_view line) {
+        if (!parse::starts_with(line, "MemTotal")) {
+            return true;
+        }
+        ram_mb = parse_ram_mb(std::string(line));
+        return false;
+    });
+    return ram_mb;
 }
 
 long long DeviceInspector::get_storage_total_mb(const std::string& serial) const
@@ -174,33 +258,19 @@ std::string DeviceInspector::get_arch(const std::string& serial) const
     return infer_arch(abi);
 }
 
-int DeviceInspector::parse_cpu_cores(const std::string& cpuinfo) const
-{
-    int cores = 0;
-    std::istringstream stream(cpuinfo);
-    std::string line;
-
-    while (std::getline(stream, line)) {
-        if (line.find("processor") == 0) {
-            cores++;
-        }
-    }
-
-    return cores > 0 ? cores : 1;
-}
-
 long long DeviceInspector::parse_ram_mb(const std::string& meminfo) const
 {
-    std::istringstream stream(meminfo);
-    std::string line;
-
-    while (std::getline(stream, line)) {
-        if (line.find("MemTotal") == 0) {
-            std::istringstream value_stream(line);
-            std::string key;
-            long long kb;
-            value_stream >> key >> kb;
-            return kb / 1024;
+    parse::LineScanner scanner(meminfo);
+    std::string_view line;
+
+    while (scanner.next(line)) {
+        if (parse::starts_with(line, "MemTotal")) {
+            // "MemTotal:  3822316 kB"
+            std::string_view fields[3];
+            if (parse::split_whitespace(line, fields, 3) < 2) {
+                return 0;
+            }
+            return parse_number(fields[1]) / 1024;
         }
     }
 
@@ -223,21 +293,28 @@ std::string DeviceInspector::infer_arch(const std::string& cpu_abi) const
 
 void DeviceInspector::parse_storage_info(const std::string& df_output, long long& total_mb, long long& free_mb) const
 {
-    std::istringstream stream(df_output);
-    std::string line;
+    parse::LineScanner scanner(df_output);
+    std::string_view line;
 
     // Skip header
-    std::getline(stream, line);
+    scanner.next(line);
 
-    if (std::getline(stream, line)) {
-        std::istringstream line_stream(line);
-        std::string filesystem;
-        long long blocks, used, available;
-
-        line_stream >> filesystem >> blocks >> used >> available;
+    if (scanner.next(line)) {
+        // "Filesystem 1K-blocks Used Available Use% Mounted on"
+        std::string_view fields[5];
+        if (parse::split_whitespace(line, fields, 5) < 4) {
+            return;
+        }
 
         // Parse in blocks (usually 1KB blocks)
-        total_mb = blocks / 1024;
-        free_mb = available / 1024;
+        total_mb = parse_number(fields[1]) / 1024;
+        free_mb = parse_number(fields[3]) / 1024;
     }
 }
+
+long long DeviceInspector::parse_number(std::string_view text) const
+{
+    long long value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
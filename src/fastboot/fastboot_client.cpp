@@ -0,0 +1,192 @@
+#include "fastboot/fastboot_client.hpp"
+#include "net/tcp_socket.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace fastboot {
+
+namespace {
+
+// Responses larger than this are not fastboot status packets
+constexpr uint64_t MAX_PACKET_SIZE = 64 * 1024;
+
+} // namespace
+
+FastbootClient::~FastbootClient() {
+    disconnect();
+}
+
+bool FastbootClient::connect_tcp(const std::string& host, uint16_t port, int timeout_ms) {
+    disconnect();
+    timeout_ms_ = timeout_ms;
+
+    fd_ = net::connect_tcp(host, port, timeout_ms, last_error_);
+    if (fd_ < 0) return false;
+
+    // Handshake: both sides send "FB" + two-digit protocol version
+    if (!write_all("FB01", 4)) {
+        disconnect();
+        return false;
+    }
+
+    char reply[4];
+    if (!read_exact(reply, sizeof(reply)) || reply[0] != 'F' || reply[1] != 'B') {
+        last_error_ = "Invalid fastboot handshake";
+        disconnect();
+        return false;
+    }
+
+    return true;
+}
+
+void FastbootClient::disconnect() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool FastbootClient::write_all(const void* data, size_t size) {
+    if (!net::write_all(fd_, data, size)) {
+        last_error_ = std::string("Write failed: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool FastbootClient::read_exact(void* data, size_t size) {
+    if (!net::read_exact(fd_, data, size, timeout_ms_)) {
+        last_error_ = "No response from device (timeout or connection closed)";
+        return false;
+    }
+    return true;
+}
+
+bool FastbootClient::send_packet(std::string_view payload) {
+    unsigned char header[8];
+    uint64_t len = payload.size();
+    for (int i = 7; i >= 0; --i) {
+        header[i] = static_cast<unsigned char>(len & 0xff);
+        len >>= 8;
+    }
+    return write_all(header, sizeof(header)) && write_all(payload.data(), payload.size());
+}
+
+std::optional<std::string> FastbootClient::read_packet() {
+    unsigned char header[8];
+    if (!read_exact(header, sizeof(header))) return std::nullopt;
+
+    uint64_t len = 0;
+    for (unsigned char byte : header) {
+        len = (len << 8) | byte;
+    }
+    if (len > MAX_PACKET_SIZE) {
+        last_error_ = "Oversized fastboot packet";
+        return std::nullopt;
+    }
+
+    std::string payload(static_cast<size_t>(len), '\0');
+    if (len > 0 && !read_exact(payload.data(), payload.size())) return std::nullopt;
+    return payload;
+}
+
+std::optional<std::string> FastbootClient::run_command(
+    const std::string& command, const std::function<void(std::string_view)>& on_info) {
+    if (!is_connected()) {
+        last_error_ = "Not connected";
+        return std::nullopt;
+    }
+
+    if (!send_packet(command)) return std::nullopt;
+
+    while (true) {
+        auto packet = read_packet();
+        if (!packet) return std::nullopt;
+
+        std::string_view response(*packet);
+        if (response.size() < 4) {
+            last_error_ = "Malformed fastboot response";
+            return std::nullopt;
+        }
+
+        std::string_view status = response.substr(0, 4);
+        std::string_view body = response.substr(4);
+
+        if (status == "OKAY") {
+            return std::string(body);
+        } else if (status == "INFO" || status == "TEXT") {
+            if (on_info) on_info(body);
+        } else if (status == "FAIL") {
+            last_error_ = "Device replied FAIL: " + std::string(body);
+            return std::nullopt;
+        } else {
+            last_error_ = "Unexpected fastboot response: " + std::string(status);
+            return std::nullopt;
+        }
+    }
+}
+
+std::optional<std::string> FastbootClient::getvar(const std::string& name) {
+    return run_command("getvar:" + name, nullptr);
+}
+
+std::optional<std::vector<Variable>> FastbootClient::getvar_all() {
+    std::vector<Variable> variables;
+    auto result = run_command("getvar:all", [&variables](std::string_view info) {
+        if (auto var = parse_variable_line(info)) {
+            variables.push_back(std::move(*var));
+        }
+    });
+
+    if (!result) return std::nullopt;
+    return variables;
+}
+
+std::optional<Variable> parse_variable_line(std::string_view line) {
+    line = parse::trim(line);
+
+    // fastboot tool output prefixes device lines with "(bootloader) "
+    constexpr std::string_view tool_prefix = "(bootloader)";
+    if (parse::starts_with(line, tool_prefix)) {
+        line = parse::trim(line.substr(tool_prefix.size()));
+    }
+
+    // Bootloaders print "name: value"; fastbootd prints "name:value".
+    // Partition-scoped names carry extra ':' ("partition-type:system_a:ext4").
+    size_t sep = line.find(": ");
+    size_t value_start;
+    if (sep != std::string_view::npos) {
+        value_start = sep + 2;
+    } else {
+        sep = line.rfind(':');
+        if (sep == std::string_view::npos) return std::nullopt;
+        value_start = sep + 1;
+    }
+
+    Variable var;
+    var.name = std::string(parse::trim(line.substr(0, sep)));
+    var.value = std::string(parse::trim(line.substr(value_start)));
+    if (var.name.empty()) return std::nullopt;
+    return var;
+}
+
+std::vector<Variable> parse_getvar_all_output(std::string_view output) {
+    std::vector<Variable> variables;
+
+    parse::for_each_line(output, [&variables](std::string_view line) {
+        // Only device lines; skip "all:", "Finished. Total time: ..." and errors
+        if (!parse::starts_with(parse::trim(line), "(bootloader)")) {
+            return;
+        }
+        if (auto var = parse_variable_line(line)) {
+            variables.push_back(std::move(*var));
+        }
+    });
+
+    return variables;
+}
+
+} // namespace fastboot
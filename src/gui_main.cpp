@@ -2,12 +2,18 @@
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 // New modules
 #include "adb/adb_client.hpp"
 #include "device/device_info.hpp"
 #include "actions/reboot.hpp"
 #include "analyzer/analyzers.hpp"
+#include "analyzer/process_hotspots.hpp"
 #include "ui/dialogs.hpp"
 
 // Suppress deprecation warnings for GTK4 compatibility
@@ -17,6 +23,8 @@
 // Global state
 static std::unique_ptr<AppState> app_state = nullptr;
 
+static void update_telemetry_button();
+
 // Helper function to update status bar
 static void update_status(const std::string& message)
 {
@@ -26,6 +34,68 @@ static void update_status(const std::string& message)
     }
 }
 
+// Everything that holds the AdbAbstraction (by reference) or its path; an
+// ADB path change deletes and rebuilds all of it together
+static void create_adb_modules(const std::string& adb_path)
+{
+    app_state->adb = new AdbAbstraction(adb_path);
+
+    // One property snapshot per refresh, shared
+    app_state->properties = new device::PropertyCache(*app_state->adb);
+    app_state->inspector = new DeviceInspector(*app_state->adb, app_state->properties);
+    app_state->root_analyzer = new RootAnalyzer(*app_state->adb);
+    app_state->bootloader_analyzer = new BootloaderAnalyzer(*app_state->adb, app_state->properties);
+    app_state->discovery = new device::DeviceDiscovery(*app_state->adb);
+    app_state->telemetry = new monitor::TelemetryMonitor(adb_path);
+
+    // Root/hooking signature database (same search order as the ROM database)
+    const char* signature_locations[] = {
+        "/usr/share/lincheckroot/root_signatures.json",
+        "/usr/local/share/lincheckroot/root_signatures.json",
+        "./data/root_signatures.json",
+    };
+
+    for (const auto& loc : signature_locations) {
+        if (app_state->root_analyzer->load_signatures(loc)) {
+            break;
+        }
+    }
+
+    // Installed agent builds (LINECHECK_BUILD_AGENT / the NDK build); a
+    // device whose ABI has no build here is inspected without the agent
+    const char* agent_locations[] = {
+        "/usr/share/lincheckroot/agent",
+        "/usr/local/share/lincheckroot/agent",
+    };
+
+    for (const auto& loc : agent_locations) {
+        if (g_file_test(loc, G_FILE_TEST_IS_DIR)) {
+            app_state->inspector->set_agent_dir(loc);
+            app_state->root_analyzer->set_agent_dir(loc);
+            break;
+        }
+    }
+}
+
+// Users of the AdbAbstraction go first
+static void delete_adb_modules()
+{
+    delete app_state->telemetry;
+    delete app_state->discovery;
+    delete app_state->bootloader_analyzer;
+    delete app_state->root_analyzer;
+    delete app_state->inspector;
+    delete app_state->properties;
+    delete app_state->adb;
+    app_state->telemetry = nullptr;
+    app_state->discovery = nullptr;
+    app_state->bootloader_analyzer = nullptr;
+    app_state->root_analyzer = nullptr;
+    app_state->inspector = nullptr;
+    app_state->properties = nullptr;
+    app_state->adb = nullptr;
+}
+
 // Callback: Scan devices button
 extern "C" void on_scan_devices(GtkButton* button, gpointer user_data)
 {
@@ -39,8 +109,8 @@ extern "C" void on_scan_devices(GtkButton* button, gpointer user_data)
         return;
     }
 
-    // Get devices
-    auto devices = app_state->adb->list_devices();
+    // One parallel round over adb and fastboot; result is cached for other readers
+    auto devices = app_state->discovery->scan();
 
     // Clear combo box
     gtk_combo_box_text_remove_all(GTK_COMBO_BOX_TEXT(app_state->device_list_combo));
@@ -53,10 +123,13 @@ extern "C" void on_scan_devices(GtkButton* button, gpointer user_data)
     }
 
     // Add devices to combo box
-    for (size_t i = 0; i < devices.size(); ++i) {
-        std::string label = devices[i].serial + " (" + devices[i].state_string + ")";
+    for (const auto& [serial, dev] : devices) {
+        std::string label = serial + " (" + device::DeviceDiscovery::mode_to_string(dev.mode) + ")";
+        if (!dev.model.empty()) {
+            label += " - " + dev.model;
+        }
         gtk_combo_box_text_append(GTK_COMBO_BOX_TEXT(app_state->device_list_combo), 
-                                  devices[i].serial.c_str(), label.c_str());
+                                  serial.c_str(), label.c_str());
     }
 
     gtk_combo_box_set_active(GTK_COMBO_BOX(app_state->device_list_combo), 0);
@@ -81,6 +154,10 @@ extern "C" void on_device_selected(GtkComboBox* combo, gpointer user_data)
     gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(app_state->bootloader_status_text)), "", -1);
     gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(app_state->rom_compat_text)), "", -1);
 
+    // Graphs follow the selection; other devices keep sampling in the background
+    update_telemetry_button();
+    gtk_widget_queue_draw(app_state->telemetry_area);
+
     update_status("Device selected. Click 'Refresh' to get information.");
 }
 
@@ -94,10 +171,45 @@ extern "C" void on_refresh_info(GtkButton* button, gpointer user_data)
 
     update_status("Analyzing device...");
 
+    // One typed report per refresh; the inspector and analyzers share one getprop
+    report::ReportCollector collector(*app_state->adb, *app_state->inspector,
+                                      *app_state->root_analyzer, *app_state->bootloader_analyzer,
+                                      *app_state->rom_compat, *app_state->properties);
+    const std::string& serial = app_state->selected_device;
+    auto previous_report = app_state->reports.find(serial);
+    bool has_previous = previous_report != app_state->reports.end();
+    report::DeviceReport last_report = has_previous ? previous_report->second : report::DeviceReport();
+    auto last_properties = app_state->last_properties[serial];
+
+    report::DeviceReport& device_report = app_state->reports[serial];
+    device_report = collector.collect(serial);
+    auto properties = app_state->properties->get(serial);
+    app_state->last_properties[serial] = properties;
+    if (app_state->history->is_open()) {
+        app_state->history->append(device_report);
+    }
+
     std::stringstream ss_info, ss_root, ss_bootloader, ss_rom;
 
+    // Changes since the previous refresh of this device
+    if (has_previous && device_report.device) {
+        auto changes = report::diff_reports(last_report, device_report);
+        if (last_properties) {
+            auto property_changes = report::diff_properties(*last_properties, *properties);
+            changes.insert(changes.end(), property_changes.begin(), property_changes.end());
+        }
+
+        ss_info << "=== CHANGES SINCE LAST REFRESH ===\n\n";
+        if (changes.empty()) {
+            ss_info << "No changes\n";
+        } else {
+            ss_info << report::format_changes(changes, 40);
+        }
+        ss_info << "\n";
+    }
+
     // Device info
-    auto device_info = app_state->inspector->inspect(app_state->selected_device);
+    const auto& device_info = device_report.device;
     if (device_info) {
         ss_info << "=== DEVICE INFORMATION ===\n\n";
         ss_info << "Manufacturer: " << device_info->manufacturer << "\n";
@@ -119,7 +231,7 @@ extern "C" void on_refresh_info(GtkButton* button, gpointer user_data)
     }
 
     // Root status
-    auto root_info = app_state->root_analyzer->analyze(app_state->selected_device);
+    const auto& root_info = device_report.root;
     if (root_info) {
         ss_root << "=== ROOT STATUS ===\n\n";
         ss_root << "Status: " << app_state->root_analyzer->status_to_string(root_info->status) << "\n";
@@ -130,16 +242,55 @@ extern "C" void on_refresh_info(GtkButton* button, gpointer user_data)
                 ss_root << "Magisk Version: " << root_info->magisk_version << "\n";
             }
         }
+        for (const auto& app : root_info->manager_apps) {
+            ss_root << "Root Manager App: " << app << "\n";
+        }
+        if (!root_info->signatures.empty()) {
+            ss_root << "\n=== DETECTED FRAMEWORKS ===\n\n";
+            for (const auto& match : root_info->signatures) {
+                ss_root << match.name << " (" << match.category << ")";
+                for (size_t i = 0; i < match.evidence.size(); ++i) {
+                    ss_root << (i == 0 ? " - " : ", ") << match.evidence[i];
+                }
+                ss_root << "\n";
+            }
+        }
     } else {
         ss_root << "Error: Unable to analyze root status\n";
     }
 
     // Bootloader status
-    auto bootloader_info = app_state->bootloader_analyzer->analyze(app_state->selected_device);
+    const auto& bootloader_info = device_report.bootloader;
     if (bootloader_info) {
         ss_bootloader << "=== BOOTLOADER STATUS ===\n\n";
         ss_bootloader << "Status: " << bootloader_info->status_string << "\n";
-        ss_bootloader << "Fastboot Available: " << (bootloader_info->fastboot_available ? "Yes" : "No") << "\n\n";
+        ss_bootloader << "Fastboot Available: " << (bootloader_info->fastboot_available ? "Yes" : "No") << "\n";
+        if (bootloader_info->from_properties) {
+            ss_bootloader << "Confidence: "
+                          << app_state->bootloader_analyzer->confidence_to_string(bootloader_info->confidence)
+                          << " (from boot properties)\n";
+            for (const auto& item : bootloader_info->evidence) {
+                ss_bootloader << "  • " << item << "\n";
+            }
+            if (bootloader_info->needs_fastboot_check) {
+                ss_bootloader << "Evidence is inconclusive; reboot to bootloader for a definitive answer.\n";
+            }
+        }
+        if (bootloader_info->from_fastboot) {
+            ss_bootloader << "Product: " << bootloader_info->product << "\n";
+            ss_bootloader << "Secure Boot: " << (bootloader_info->secure ? "Yes" : "No") << "\n";
+            if (bootloader_info->slot_count > 0) {
+                ss_bootloader << "Slots: " << bootloader_info->slot_count
+                              << " (current: " << bootloader_info->current_slot << ")\n";
+            }
+            if (!bootloader_info->bootloader_version.empty()) {
+                ss_bootloader << "Bootloader Version: " << bootloader_info->bootloader_version << "\n";
+            }
+            if (bootloader_info->is_userspace) {
+                ss_bootloader << "Mode: fastbootd (userspace)\n";
+            }
+        }
+        ss_bootloader << "\n";
         ss_bootloader << app_state->bootloader_analyzer->get_data_loss_warning() << "\n";
     } else {
         ss_bootloader << "Error: Unable to analyze bootloader status\n";
@@ -147,7 +298,7 @@ extern "C" void on_refresh_info(GtkButton* button, gpointer user_data)
 
     // ROM compatibility
     if (device_info) {
-        auto rom_info = app_state->rom_compat->check_lineage_os(device_info->codename);
+        const auto& rom_info = device_report.rom;
         if (rom_info) {
             ss_rom << "=== ROM COMPATIBILITY (LineageOS) ===\n\n";
             ss_rom << app_state->rom_compat->format_rom_info(rom_info.value());
@@ -184,11 +335,10 @@ extern "C" void on_adb_path_changed(GtkEntry* entry, gpointer user_data)
     std::string path_str(path);
 
     if (ConfigManager::verify_adb_path(path_str)) {
-        // Reinitialize ADB with new path
-        if (app_state->adb) {
-            delete app_state->adb;
-        }
-        app_state->adb = new AdbAbstraction(path_str);
+        // Reinitialize ADB with new path, with every module that holds it
+        delete_adb_modules();
+        create_adb_modules(path_str);
+        update_telemetry_button();
 
         // Save to config
         app_state->config->set("adb_path", path_str);
@@ -206,6 +356,241 @@ extern "C" void on_quit(GtkButton* button, gpointer user_data)
     gtk_window_close(GTK_WINDOW(app_state->main_window));
 }
 
+// ============ LIVE TELEMETRY ============
+
+// Reused across redraws so the 10 Hz refresh does not allocate
+static std::vector<monitor::TelemetrySample> telemetry_series;
+
+using SampleField = float (*)(const monitor::TelemetrySample&);
+
+// One strip chart; values < 0 are gaps. max_value <= 0 means auto-scale.
+static void draw_series(cairo_t* cr, double x, double y, double width, double height,
+                        const char* title, SampleField field, double max_value,
+                        double red, double green, double blue)
+{
+    cairo_set_source_rgb(cr, 0.12, 0.12, 0.12);
+    cairo_rectangle(cr, x, y, width, height);
+    cairo_fill(cr);
+
+    double latest = -1;
+    if (max_value <= 0) {
+        for (const auto& sample : telemetry_series) {
+            max_value = std::max(max_value, static_cast<double>(field(sample)));
+        }
+        max_value = max_value > 0 ? max_value * 1.1 : 1;
+    }
+
+    size_t count = telemetry_series.size();
+    size_t capacity = std::max<size_t>(count, 2);
+    bool drawing = false;
+    cairo_set_source_rgb(cr, red, green, blue);
+    cairo_set_line_width(cr, 1.5);
+    for (size_t i = 0; i < count; ++i) {
+        double value = field(telemetry_series[i]);
+        if (value < 0) {
+            drawing = false;
+            continue;
+        }
+        latest = value;
+        double px = x + width * static_cast<double>(i + capacity - count) / (capacity - 1);
+        double py = y + height - height * std::min(value, max_value) / max_value;
+        if (drawing) {
+            cairo_line_to(cr, px, py);
+        } else {
+            cairo_move_to(cr, px, py);
+            drawing = true;
+        }
+    }
+    cairo_stroke(cr);
+
+    char label[96];
+    if (latest >= 0) {
+        snprintf(label, sizeof(label), "%s: %.1f", title, latest);
+    } else {
+        snprintf(label, sizeof(label), "%s: n/a", title);
+    }
+    cairo_set_source_rgb(cr, 0.85, 0.85, 0.85);
+    cairo_set_font_size(cr, 11);
+    cairo_move_to(cr, x + 6, y + 14);
+    cairo_show_text(cr, label);
+}
+
+static void draw_telemetry(GtkDrawingArea* area, cairo_t* cr, int width, int height, gpointer user_data)
+{
+    if (!app_state || !app_state->telemetry ||
+        !app_state->telemetry->copy_series(app_state->selected_device, telemetry_series)) {
+        telemetry_series.clear();
+    }
+
+    struct Chart {
+        const char* title;
+        SampleField field;
+        double max_value;
+        double red, green, blue;
+    };
+    static const Chart charts[] = {
+        {"CPU %", [](const monitor::TelemetrySample& s) { return s.cpu_percent; }, 100, 0.30, 0.67, 0.97},
+        {"Memory used %", [](const monitor::TelemetrySample& s) { return s.mem_used_percent; }, 100, 0.55, 0.85, 0.45},
+        {"CPU pressure (avg10)", [](const monitor::TelemetrySample& s) { return s.psi_cpu; }, 100, 0.95, 0.60, 0.25},
+        {"Memory pressure (avg10)", [](const monitor::TelemetrySample& s) { return s.psi_memory; }, 100, 0.90, 0.40, 0.60},
+        {"IO pressure (avg10)", [](const monitor::TelemetrySample& s) { return s.psi_io; }, 100, 0.70, 0.55, 0.95},
+        {"Max temperature °C", [](const monitor::TelemetrySample& s) { return s.max_temp_c; }, 0, 0.95, 0.35, 0.30},
+        {"Avg CPU frequency MHz", [](const monitor::TelemetrySample& s) { return s.avg_freq_mhz; }, 0, 0.95, 0.85, 0.30},
+    };
+    constexpr int chart_count = sizeof(charts) / sizeof(charts[0]);
+
+    const double gap = 6;
+    double chart_height = (height - gap * (chart_count + 1)) / chart_count;
+    for (int i = 0; i < chart_count; ++i) {
+        const Chart& chart = charts[i];
+        draw_series(cr, gap, gap + i * (chart_height + gap), width - 2 * gap, chart_height,
+                    chart.title, chart.field, chart.max_value, chart.red, chart.green, chart.blue);
+    }
+}
+
+static gboolean on_telemetry_tick(gpointer user_data)
+{
+    if (!app_state || !app_state->telemetry_area) return G_SOURCE_REMOVE;
+    gtk_widget_queue_draw(app_state->telemetry_area);
+    return G_SOURCE_CONTINUE;
+}
+
+static void update_telemetry_button()
+{
+    bool running = app_state->telemetry && app_state->telemetry->is_running(app_state->selected_device);
+    gtk_button_set_label(GTK_BUTTON(app_state->telemetry_button),
+                         running ? "⏹ Stop Monitoring" : "▶ Start Monitoring");
+}
+
+// Callback: Start/stop live telemetry for the selected device
+extern "C" void on_toggle_telemetry(GtkButton* button, gpointer user_data)
+{
+    if (!app_state || app_state->selected_device.empty()) {
+        update_status("No device selected");
+        return;
+    }
+
+    const std::string& serial = app_state->selected_device;
+    if (app_state->telemetry->is_running(serial)) {
+        app_state->telemetry->stop(serial);
+        update_status("Monitoring stopped for " + serial);
+    } else {
+        double rate = gtk_spin_button_get_value(GTK_SPIN_BUTTON(app_state->telemetry_rate));
+        app_state->telemetry->start(serial, rate);
+        update_status("Monitoring " + serial);
+    }
+
+    // One redraw timer while anything is being monitored
+    bool any_running = !app_state->telemetry->devices().empty();
+    if (any_running && app_state->telemetry_timer == 0) {
+        app_state->telemetry_timer = g_timeout_add(100, on_telemetry_tick, nullptr);
+    } else if (!any_running && app_state->telemetry_timer != 0) {
+        g_source_remove(app_state->telemetry_timer);
+        app_state->telemetry_timer = 0;
+    }
+
+    update_telemetry_button();
+}
+
+// Callback: Sampling rate changed (applies to the running monitor immediately)
+extern "C" void on_telemetry_rate_changed(GtkSpinButton* spin, gpointer user_data)
+{
+    if (!app_state || !app_state->telemetry) return;
+
+    const std::string& serial = app_state->selected_device;
+    if (app_state->telemetry->is_running(serial)) {
+        app_state->telemetry->start(serial, gtk_spin_button_get_value(spin));
+    }
+}
+
+// ============ PROCESS HOTSPOTS ============
+
+// Sampling runs off the UI thread; the UI only picks up the formatted table.
+// The worker is detached and shares this state, so stopping never waits on
+// the UI thread for a refresh in flight (up to its 10 s timeout).
+struct HotspotWorker {
+    std::atomic<bool> running{true};
+    std::mutex mutex;
+    std::string table;
+    std::string serial;
+};
+
+static std::shared_ptr<HotspotWorker> hotspot_worker;
+
+static void stop_hotspots()
+{
+    if (hotspot_worker) {
+        hotspot_worker->running = false;
+        hotspot_worker.reset();
+    }
+    if (app_state && app_state->hotspot_timer != 0) {
+        g_source_remove(app_state->hotspot_timer);
+        app_state->hotspot_timer = 0;
+    }
+}
+
+static gboolean on_hotspot_tick(gpointer user_data)
+{
+    if (!app_state || !app_state->hotspot_text || !hotspot_worker) return G_SOURCE_REMOVE;
+
+    std::string text;
+    {
+        std::lock_guard<std::mutex> lock(hotspot_worker->mutex);
+        text = hotspot_worker->table;
+    }
+    gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(app_state->hotspot_text)),
+                             text.c_str(), -1);
+    return G_SOURCE_CONTINUE;
+}
+
+// Callback: Start/stop the per-process sampler for the selected device
+extern "C" void on_toggle_hotspots(GtkButton* button, gpointer user_data)
+{
+    if (!app_state) return;
+
+    if (hotspot_worker) {
+        stop_hotspots();
+        gtk_button_set_label(GTK_BUTTON(app_state->hotspot_button), "▶ Start Sampling");
+        update_status("Process sampling stopped");
+        return;
+    }
+
+    if (app_state->selected_device.empty()) {
+        update_status("No device selected");
+        return;
+    }
+
+    auto worker = std::make_shared<HotspotWorker>();
+    worker->serial = app_state->selected_device;
+    worker->table = "Sampling " + worker->serial + "...\n";
+    hotspot_worker = worker;
+    std::thread([worker, adb_path = app_state->adb->get_adb_path()]() {
+        analyzer::ProcessHotspotAnalyzer sampler(adb_path, worker->serial, 20);
+        while (worker->running) {
+            std::string table;
+            if (sampler.refresh()) {
+                table = std::to_string(sampler.process_count()) + " processes, sampled in "
+                      + std::to_string(sampler.last_sample_time().count()) + " ms\n\n"
+                      + analyzer::ProcessHotspotAnalyzer::format_hotspots(sampler.get_hotspots());
+            } else {
+                table = "Device did not answer\n";
+            }
+            {
+                std::lock_guard<std::mutex> lock(worker->mutex);
+                worker->table = std::move(table);
+            }
+
+            for (int i = 0; i < 10 && worker->running; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+    }).detach();
+
+    app_state->hotspot_timer = g_timeout_add(500, on_hotspot_tick, nullptr);
+    gtk_button_set_label(GTK_BUTTON(app_state->hotspot_button), "⏹ Stop Sampling");
+    update_status("Sampling processes on " + worker->serial);
+}
+
 // ============ NEW CALLBACKS FOR DEVICE ACTIONS ============
 
 // Helper: Create reboot action handler
@@ -589,6 +974,55 @@ static GtkWidget* build_gui(GtkApplication* app)
     gtk_notebook_append_page(GTK_NOTEBOOK(notebook), rom_scroll, 
                             gtk_label_new("🐧 ROM Compatibility"));
 
+    // Live Telemetry Tab
+    GtkWidget* telemetry_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+    GtkWidget* telemetry_controls = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 10);
+    gtk_widget_set_margin_start(telemetry_controls, 10);
+    gtk_widget_set_margin_top(telemetry_controls, 8);
+
+    app_state->telemetry_button = gtk_button_new_with_label("▶ Start Monitoring");
+    g_signal_connect(app_state->telemetry_button, "clicked", G_CALLBACK(on_toggle_telemetry), nullptr);
+    gtk_box_append(GTK_BOX(telemetry_controls), app_state->telemetry_button);
+
+    gtk_box_append(GTK_BOX(telemetry_controls), gtk_label_new("Samples/s:"));
+    app_state->telemetry_rate = gtk_spin_button_new_with_range(0.5, 20, 0.5);
+    gtk_spin_button_set_value(GTK_SPIN_BUTTON(app_state->telemetry_rate), 10);
+    g_signal_connect(app_state->telemetry_rate, "value-changed",
+                     G_CALLBACK(on_telemetry_rate_changed), nullptr);
+    gtk_box_append(GTK_BOX(telemetry_controls), app_state->telemetry_rate);
+    gtk_box_append(GTK_BOX(telemetry_box), telemetry_controls);
+
+    app_state->telemetry_area = gtk_drawing_area_new();
+    gtk_drawing_area_set_draw_func(GTK_DRAWING_AREA(app_state->telemetry_area), draw_telemetry, nullptr, nullptr);
+    gtk_widget_set_hexpand(app_state->telemetry_area, TRUE);
+    gtk_widget_set_vexpand(app_state->telemetry_area, TRUE);
+    gtk_box_append(GTK_BOX(telemetry_box), app_state->telemetry_area);
+    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), telemetry_box,
+                            gtk_label_new("📈 Live Telemetry"));
+
+    // Process Hotspots Tab
+    GtkWidget* hotspot_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+    app_state->hotspot_button = gtk_button_new_with_label("▶ Start Sampling");
+    gtk_widget_set_margin_start(app_state->hotspot_button, 10);
+    gtk_widget_set_margin_top(app_state->hotspot_button, 8);
+    gtk_widget_set_size_request(app_state->hotspot_button, 160, -1);
+    gtk_widget_set_hexpand(app_state->hotspot_button, FALSE);
+    g_signal_connect(app_state->hotspot_button, "clicked", G_CALLBACK(on_toggle_hotspots), nullptr);
+    gtk_box_append(GTK_BOX(hotspot_box), app_state->hotspot_button);
+
+    app_state->hotspot_text = gtk_text_view_new();
+    gtk_text_view_set_editable(GTK_TEXT_VIEW(app_state->hotspot_text), FALSE);
+    gtk_text_view_set_monospace(GTK_TEXT_VIEW(app_state->hotspot_text), TRUE);
+    gtk_widget_add_css_class(app_state->hotspot_text, "textview");
+
+    GtkWidget* hotspot_scroll = gtk_scrolled_window_new();
+    gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(hotspot_scroll), app_state->hotspot_text);
+    gtk_scrolled_window_set_has_frame(GTK_SCROLLED_WINDOW(hotspot_scroll), TRUE);
+    gtk_widget_set_vexpand(hotspot_scroll, TRUE);
+    gtk_box_append(GTK_BOX(hotspot_box), hotspot_scroll);
+    gtk_notebook_append_page(GTK_NOTEBOOK(notebook), hotspot_box,
+                            gtk_label_new("🔥 Processes"));
+
     gtk_box_append(GTK_BOX(main_box), notebook);
     gtk_widget_set_hexpand(notebook, TRUE);
     gtk_widget_set_vexpand(notebook, TRUE);
@@ -628,17 +1062,15 @@ int GUI::init(int argc, char* argv[])
     // Get ADB path from config
     std::string adb_path = app_state->config->get("adb_path");
 
-    // Initialize ADB
-    app_state->adb = new AdbAbstraction(adb_path);
+    // Initialize ADB and the modules built on it
+    create_adb_modules(adb_path);
 
     if (!app_state->adb->verify_adb()) {
         std::cerr << "Warning: ADB not found. Please configure ADB path in GUI.\n";
     }
 
-    // Initialize other modules
-    app_state->inspector = new DeviceInspector(*app_state->adb);
-    app_state->root_analyzer = new RootAnalyzer(*app_state->adb);
-    app_state->bootloader_analyzer = new BootloaderAnalyzer(*app_state->adb);
+    app_state->history = new report::HistoryStore();
+    app_state->history->open();   // history is optional; scans still work without it
 
     // Initialize ROM compatibility database
     app_state->rom_compat = new RomCompatibility();
@@ -666,11 +1098,10 @@ int GUI::init(int argc, char* argv[])
 
     g_object_unref(app);
 
-    // Cleanup
-    delete app_state->adb;
-    delete app_state->inspector;
-    delete app_state->root_analyzer;
-    delete app_state->bootloader_analyzer;
+    // Cleanup (stop sampling threads first)
+    stop_hotspots();
+    delete_adb_modules();
+    delete app_state->history;
     delete app_state->rom_compat;
     delete app_state->config;
 
@@ -0,0 +1,468 @@
+#include "headless_main.h"
+#include "adb_abstraction.h"
+#include "config_manager.h"
+#include "device/discovery.hpp"
+#include "device/reboot_tracker.hpp"
+#include "actions/boot_profiler.hpp"
+#include "report/device_report.hpp"
+#include "report/history_store.hpp"
+#include "report/snapshot_diff.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <ctime>
+#include <cstdint>
+#include <iomanip>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <vector>
+
+static void print_usage(const char* argv0)
+{
+    std::cout << "Usage: " << argv0 << " [--list-devices] [--reboot MODE --serial SERIAL [--profile] [--timeout SEC]]\n"
+              << "       " << argv0 << " --report --serial SERIAL [--output FILE] [--agent DIR]\n"
+              << "       " << argv0 << " --history [--serial SERIAL] [--days N]\n"
+              << "       " << argv0 << " --drift\n"
+              << "       " << argv0 << " --bundle --serial SERIAL --output DIR\n"
+              << "\n"
+              << "  --list-devices   Scan adb and fastboot once and print the device table\n"
+              << "  --reboot MODE    Reboot (system|bootloader|recovery|download) and wait until\n"
+              << "                   the device reaches that mode, printing each phase (exit\n"
+              << "                   status 3 for download: the device left adb, unconfirmed)\n"
+              << "  --profile        With --reboot system: wait for boot completion and print\n"
+              << "                   the boot timeline (bootloader, kernel, init, zygote, ...)\n"
+              << "  --report         Run every analyzer once and print the report as JSON;\n"
+              << "                   with --output, write the compact binary form to FILE.\n"
+              << "                   Every report is also added to the scan history\n"
+              << "  --history        With --serial: storage trend of that device; without:\n"
+              << "                   devices whose build fingerprint changed\n"
+              << "  --drift          Compare the build properties of every connected device\n"
+              << "                   with the most common build of the same model\n"
+              << "  --bundle         Pull /proc and build.prop diagnostics into DIR in one\n"
+              << "                   sync exchange and print the manifest\n"
+              << "  --agent DIR      With --report: read hardware figures and the root checks'\n"
+              << "                   paths, PATH lookups and signature capture through the\n"
+              << "                   on-device agent, pushing DIR/lincheckroot-agent-<abi>\n"
+              << "                   when needed\n"
+              << "  --serial SERIAL  Device to act on\n"
+              << "  --timeout SEC    Give up waiting after SEC seconds (default 120)\n"
+              << "  --output FILE    Output file for --report, directory for --bundle\n"
+              << "  --days N         History window in days (default 7)\n"
+              << "  --help           Show this help\n"
+              << "\n"
+              << "Without options the graphical interface is started.\n";
+}
+
+// Positive integer option value; reports a malformed one
+static bool parse_positive(const std::string& option, const char* text, int& value)
+{
+    try {
+        size_t used = 0;
+        int parsed = std::stoi(text, &used);
+        if (used == std::strlen(text) && parsed > 0) {
+            value = parsed;
+            return true;
+        }
+    } catch (...) {}
+    std::cerr << "Error: " << option << " needs a positive number, got '" << text << "'\n";
+    return false;
+}
+
+static int list_devices(device::DeviceDiscovery& discovery)
+{
+    auto table = discovery.get(std::chrono::seconds(2));
+
+    if (table.empty()) {
+        std::cout << "No devices found\n";
+        return 1;
+    }
+
+    std::cout << std::left
+              << std::setw(24) << "SERIAL"
+              << std::setw(14) << "MODE"
+              << std::setw(10) << "TRANSPORT"
+              << "MODEL\n";
+
+    for (const auto& [serial, dev] : table) {
+        std::cout << std::setw(24) << serial
+                  << std::setw(14) << device::DeviceDiscovery::mode_to_string(dev.mode)
+                  << std::setw(10) << dev.transport
+                  << (dev.model.empty() ? "-" : dev.model) << "\n";
+    }
+
+    return 0;
+}
+
+static int reboot_and_track(const AdbAbstraction& adb, const std::string& serial,
+                            const std::string& type, bool profile, int timeout_sec)
+{
+    if (serial.empty()) {
+        std::cerr << "Error: --reboot needs --serial\n";
+        return 2;
+    }
+
+    device::DeviceMode target = device::RebootTracker::target_for_reboot_type(type);
+    if (profile && target != device::DeviceMode::SYSTEM) {
+        std::cerr << "Error: --profile only works with --reboot system\n";
+        return 2;
+    }
+
+    device::RebootTracker tracker(adb.get_adb_path());
+    auto sent = std::chrono::steady_clock::now();
+
+    // Subscribe first so the very first transition is observed
+    auto future = tracker.track(serial, target, std::chrono::seconds(timeout_sec));
+
+    if (!adb.reboot(serial, type == "system" ? "" : type)) {
+        tracker.cancel();
+        std::cerr << "Error: adb reboot " << type << " failed for " << serial << "\n";
+        return 1;
+    }
+
+    device::RebootResult result = future.get();
+
+    for (const auto& phase : result.phases) {
+        std::cout << std::left << std::setw(14) << device::DeviceDiscovery::mode_to_string(phase.mode)
+                  << phase.duration.count() << " ms\n";
+    }
+    std::cout << "Total: " << result.total.count() << " ms - ";
+    if (result.unconfirmed) {
+        std::cout << "left adb; " << type << " mode cannot be confirmed over adb or fastboot\n";
+        return 3;
+    }
+    std::cout << (result.reached ? "reached " : "did not reach ")
+              << device::DeviceDiscovery::mode_to_string(result.target) << "\n";
+
+    if (!result.reached || !profile) {
+        return result.reached ? 0 : 1;
+    }
+
+    auto remaining = std::chrono::seconds(timeout_sec) - (std::chrono::steady_clock::now() - sent);
+    actions::BootProfiler profiler(adb.get_adb_path(), serial);
+    actions::BootProfile boot = profiler.profile_current_boot(
+        sent, std::max(std::chrono::duration_cast<std::chrono::milliseconds>(remaining),
+                       std::chrono::milliseconds(0)));
+    boot.to_adb_online = result.total;
+
+    std::cout << "\nBoot timeline:\n" << actions::BootProfiler::format_profile(boot);
+    return boot.completed ? 0 : 1;
+}
+
+static int write_report(const AdbAbstraction& adb, const std::string& serial, const std::string& output,
+                        const std::string& agent_dir)
+{
+    if (serial.empty()) {
+        std::cerr << "Error: --report needs --serial\n";
+        return 2;
+    }
+
+    device::PropertyCache properties(adb);
+    DeviceInspector inspector(adb, &properties);
+    inspector.set_agent_dir(agent_dir);
+    RootAnalyzer root_analyzer(adb);
+    root_analyzer.set_agent_dir(agent_dir);
+    BootloaderAnalyzer bootloader_analyzer(adb, &properties);
+    RomCompatibility rom_compat;
+
+    // Same data file search order as the GUI
+    for (const char* dir : {"/usr/share/lincheckroot/", "/usr/local/share/lincheckroot/", "./data/"}) {
+        if (rom_compat.load_database(std::string(dir) + "lineage_devices.json")) break;
+    }
+    for (const char* dir : {"/usr/share/lincheckroot/", "/usr/local/share/lincheckroot/", "./data/"}) {
+        if (root_analyzer.load_signatures(std::string(dir) + "root_signatures.json")) break;
+    }
+
+    report::ReportCollector collector(adb, inspector, root_analyzer, bootloader_analyzer,
+                                      rom_compat, properties);
+    report::DeviceReport device_report = collector.collect(serial);
+    if (!device_report.device) {
+        std::cerr << "Error: " << serial << " is not accessible\n";
+        return 1;
+    }
+
+    report::HistoryStore history;
+    if (!history.open() || !history.append(device_report)) {
+        std::cerr << "Warning: could not add the report to " << report::HistoryStore::default_directory() << "\n";
+    }
+
+    if (output.empty()) {
+        std::cout << report::to_json(device_report) << "\n";
+        return 0;
+    }
+
+    std::ofstream file(output, std::ios::binary);
+    std::string encoded = report::encode(device_report);
+    file.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+    if (!file) {
+        std::cerr << "Error: cannot write " << output << "\n";
+        return 1;
+    }
+    std::cout << "Wrote " << encoded.size() << " bytes to " << output << "\n";
+    return 0;
+}
+
+static int pull_bundle(const AdbAbstraction& adb, const std::string& serial, const std::string& output)
+{
+    if (serial.empty() || output.empty()) {
+        std::cerr << "Error: --bundle needs --serial and --output DIR\n";
+        return 2;
+    }
+
+    // Diagnostics readable by the shell user on most builds
+    static const std::vector<std::string> files = {
+        "/proc/cpuinfo",
+        "/proc/meminfo",
+        "/proc/mounts",
+        "/proc/cmdline",
+        "/proc/version",
+        "/proc/filesystems",
+        "/system/build.prop",
+        "/vendor/build.prop",
+        "/product/etc/build.prop",
+        "/odm/etc/build.prop",
+    };
+
+    std::error_code ec;
+    std::filesystem::create_directories(output, ec);
+
+    // "/proc/cpuinfo" -> "proc_cpuinfo"; files are created when their data arrives
+    auto local_path = [&](const std::string& remote) {
+        std::string name = remote.substr(remote.find_first_not_of('/'));
+        std::replace(name.begin(), name.end(), '/', '_');
+        return (std::filesystem::path(output) / name).string();
+    };
+    std::vector<std::ofstream> streams(files.size());
+
+    auto manifest = adb.pull_bundle(serial, files, [&](size_t index, std::string_view chunk) {
+        if (!streams[index].is_open()) {
+            streams[index].open(local_path(files[index]), std::ios::binary);
+        }
+        streams[index].write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        return static_cast<bool>(streams[index]);
+    });
+    if (!manifest) {
+        std::cerr << "Error: no sync connection to " << serial << "\n";
+        return 1;
+    }
+
+    size_t pulled = 0;
+    for (size_t i = 0; i < manifest->entries.size(); ++i) {
+        const auto& entry = manifest->entries[i];
+        if (!entry.ok) {
+            std::cout << "  FAIL  " << std::left << std::setw(26) << "" << entry.remote
+                      << " (" << entry.error << ")\n";
+            continue;
+        }
+        if (!streams[i].is_open()) {
+            streams[i].open(local_path(entry.remote), std::ios::binary);     // empty file
+        }
+        ++pulled;
+        std::cout << "  OK    " << std::right << std::setw(9) << entry.stats.bytes << " B  "
+                  << std::fixed << std::setprecision(1) << std::setw(7) << entry.stats.total_ms << " ms   "
+                  << entry.remote << "\n";
+    }
+    std::cout << pulled << "/" << manifest->entries.size() << " files, " << manifest->total_bytes
+              << " bytes in " << std::fixed << std::setprecision(1) << manifest->total_ms << " ms ("
+              << manifest->sessions << " sync session" << (manifest->sessions == 1 ? "" : "s") << ") -> "
+              << output << "\n";
+    return pulled > 0 ? 0 : 1;
+}
+
+static int check_drift(const AdbAbstraction& adb, device::DeviceDiscovery& discovery)
+{
+    // One getprop per device, grouped by codename; one pool so the diffs
+    // compare ids
+    auto pool = std::make_shared<device::StringPool>();
+    std::map<std::string, std::vector<std::pair<std::string, device::PropertySnapshot>>> models;
+    for (const auto& [serial, dev] : discovery.get(std::chrono::seconds(2))) {
+        if (dev.mode != device::DeviceMode::SYSTEM) continue;
+        device::PropertySnapshot props(pool);
+        if (!props.load(adb, serial)) continue;
+        models[props.get_or("ro.product.device", "unknown")].emplace_back(serial, std::move(props));
+    }
+
+    if (models.empty()) {
+        std::cout << "No devices found\n";
+        return 1;
+    }
+
+    int drifted = 0;
+    for (const auto& [codename, devices] : models) {
+        // Baseline: the first device running the most common build
+        std::map<std::string, int> builds;
+        for (const auto& entry : devices) {
+            ++builds[entry.second.get_or("ro.build.fingerprint", "")];
+        }
+        auto common = std::max_element(builds.begin(), builds.end(),
+                                       [](const auto& a, const auto& b) { return a.second < b.second; });
+        auto baseline = std::find_if(devices.begin(), devices.end(), [&](const auto& entry) {
+            return entry.second.get_or("ro.build.fingerprint", "") == common->first;
+        });
+
+        std::cout << codename << ": " << devices.size() << " device(s), baseline " << baseline->first << "\n";
+        for (const auto& [serial, props] : devices) {
+            if (serial == baseline->first) continue;
+            auto changes = report::diff_properties(baseline->second, props, report::is_build_key);
+            if (changes.empty()) continue;
+            ++drifted;
+            std::cout << "  " << serial << " differs in " << changes.size() << " build properties:\n";
+            std::istringstream lines(report::format_changes(changes, 20));
+            for (std::string line; std::getline(lines, line);) {
+                std::cout << "    " << line << "\n";
+            }
+        }
+    }
+
+    std::cout << (drifted ? std::to_string(drifted) + " device(s) drifted\n" : "No build drift\n");
+    return drifted ? 1 : 0;
+}
+
+static std::string format_time(int64_t time_ms)
+{
+    std::time_t seconds = static_cast<std::time_t>(time_ms / 1000);
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    std::ostringstream out;
+    out << std::put_time(&local, "%Y-%m-%d %H:%M");
+    return out.str();
+}
+
+static int show_history(const std::string& serial, int days)
+{
+    report::HistoryStore history;
+    if (!history.open()) {
+        std::cerr << "Error: cannot open " << report::HistoryStore::default_directory() << "\n";
+        return 1;
+    }
+
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    int64_t from = now - static_cast<int64_t>(days) * 24 * 3600 * 1000;
+
+    if (!serial.empty()) {
+        auto trend = history.storage_trend(serial, from, INT64_MAX);
+        if (trend.empty()) {
+            std::cout << "No scans of " << serial << " in the last " << days << " days\n";
+            return 1;
+        }
+        std::cout << std::left << std::setw(20) << "SCANNED" << std::setw(12) << "FREE MB" << "TOTAL MB\n";
+        for (const auto& point : trend) {
+            std::cout << std::setw(20) << format_time(point.time_ms)
+                      << std::setw(12) << point.free_mb << point.total_mb << "\n";
+        }
+        return 0;
+    }
+
+    auto changes = history.fingerprint_changes(from, INT64_MAX);
+    if (changes.empty()) {
+        std::cout << "No build fingerprint changes in the last " << days << " days ("
+                  << history.serials().size() << " devices, " << history.size() << " scans)\n";
+        return 0;
+    }
+    for (const auto& change : changes) {
+        std::cout << format_time(change.time_ms) << "  " << change.serial << "\n"
+                  << "    " << change.before << "\n"
+                  << " -> " << change.after << "\n";
+    }
+    return 0;
+}
+
+bool Headless::requested(int argc, char* argv[])
+{
+    static const char* headless_options[] = {
+        "--list-devices",
+        "--reboot",
+        "--report",
+        "--history",
+        "--drift",
+        "--bundle",
+        "--help",
+        "-h",
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        for (const auto& option : headless_options) {
+            if (std::strcmp(argv[i], option) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int Headless::run(int argc, char* argv[])
+{
+    ConfigManager config;
+    config.load();
+
+    AdbAbstraction adb(config.get("adb_path"));
+    if (!adb.verify_adb()) {
+        std::cerr << "Warning: ADB not found. Set adb_path in " << ConfigManager::get_config_file() << "\n";
+    }
+
+    device::DeviceDiscovery discovery(adb);
+
+    std::string command;
+    std::string serial;
+    std::string reboot_type;
+    std::string output;
+    std::string agent_dir;
+    bool profile = false;
+    int timeout_sec = 120;
+    int days = 7;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--list-devices") {
+            command = arg;
+        } else if (arg == "--reboot" && has_value) {
+            command = arg;
+            reboot_type = argv[++i];
+        } else if (arg == "--report") {
+            command = arg;
+        } else if (arg == "--drift") {
+            command = arg;
+        } else if (arg == "--bundle") {
+            command = arg;
+        } else if (arg == "--history") {
+            command = arg;
+        } else if (arg == "--days" && has_value) {
+            if (!parse_positive(arg, argv[++i], days)) return 1;
+        } else if (arg == "--output" && has_value) {
+            output = argv[++i];
+        } else if (arg == "--agent" && has_value) {
+            agent_dir = argv[++i];
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--serial" && has_value) {
+            serial = argv[++i];
+        } else if (arg == "--timeout" && has_value) {
+            if (!parse_positive(arg, argv[++i], timeout_sec)) return 1;
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+
+    if (command == "--list-devices") {
+        return list_devices(discovery);
+    } else if (command == "--reboot") {
+        return reboot_and_track(adb, serial, reboot_type, profile, timeout_sec);
+    } else if (command == "--report") {
+        return write_report(adb, serial, output, agent_dir);
+    } else if (command == "--drift") {
+        return check_drift(adb, discovery);
+    } else if (command == "--bundle") {
+        return pull_bundle(adb, serial, output);
+    } else if (command == "--history") {
+        return show_history(serial, days);
+    }
+
+    print_usage(argv[0]);
+    return 2;
+}
@@ -1,4 +1,5 @@
 #include "gui_main.h"
+#include "headless_main.h"
 #include <iostream>
 #include <cstdlib>
 #include <glib.h>
@@ -7,6 +8,11 @@
 // Entry point for LinCheckROOT
 int main(int argc, char* argv[])
 {
+    // Command-line options select headless mode (no display needed)
+    if (Headless::requested(argc, argv)) {
+        return Headless::run(argc, argv);
+    }
+
     // Suppress non-critical GTK warnings (theme, modules, settings)
     // These are cosmetic warnings that don't affect functionality
     g_setenv("G_DEBUG", "", TRUE);
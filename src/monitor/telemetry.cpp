@@ -0,0 +1,258 @@
+#include "monitor/telemetry.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <thread>
+
+namespace monitor {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// One grep reads every source and tags each line with its file name
+constexpr const char* SAMPLE_COMMAND =
+    "grep -H -E '^(cpu |MemTotal|MemAvailable|some )|^-?[0-9]+$' "
+    "/proc/stat /proc/meminfo /proc/pressure/cpu /proc/pressure/memory /proc/pressure/io "
+    "/sys/class/thermal/thermal_zone*/temp "
+    "/sys/devices/system/cpu/cpu[0-9]*/cpufreq/scaling_cur_freq 2>/dev/null";
+
+uint64_t to_u64(std::string_view text) {
+    uint64_t value = 0;
+    text = parse::trim(text);
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+long long to_ll(std::string_view text) {
+    long long value = 0;
+    text = parse::trim(text);
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+// "some avg10=1.23 avg60=..." -> 1.23
+float avg10(std::string_view text) {
+    size_t pos = text.find("avg10=");
+    if (pos == std::string_view::npos) return -1;
+    text.remove_prefix(pos + 6);
+    size_t end = text.find(' ');
+    std::string_view number = text.substr(0, end);
+
+    // Fixed "X.YY" format; avoids locale-dependent strtod
+    float whole = 0, fraction = 0, scale = 1;
+    bool after_point = false;
+    for (char c : number) {
+        if (c == '.') {
+            after_point = true;
+        } else if (c >= '0' && c <= '9') {
+            if (after_point) {
+                scale /= 10;
+                fraction += (c - '0') * scale;
+            } else {
+                whole = whole * 10 + (c - '0');
+            }
+        }
+    }
+    return whole + fraction;
+}
+
+} // namespace
+
+TelemetrySampler::TelemetrySampler(const std::string& adb_path, const std::string& serial)
+    : session_(adb_path, serial), started_(Clock::now()) {}
+
+bool TelemetrySampler::sample(TelemetrySample& out) {
+    out = TelemetrySample();
+    freq_sum_khz_ = 0;
+    freq_count_ = 0;
+    out.time_s = std::chrono::duration<double>(Clock::now() - started_).count();
+
+    auto status = session_.run_lines(SAMPLE_COMMAND, [this, &out](std::string_view line) {
+        parse_line(line, out);
+        return true;
+    }, 5000);
+
+    if (!status) return false;
+    finish_sample(out);
+    return true;
+}
+
+void TelemetrySampler::parse_line(std::string_view line, TelemetrySample& out) {
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos) return;
+    std::string_view path = line.substr(0, colon);
+    std::string_view content = line.substr(colon + 1);
+
+    if (path == "/proc/stat") {
+        // cpu user nice system idle iowait irq softirq steal (guest time is part of user)
+        std::string_view fields[10];
+        size_t count = parse::split_whitespace(content, fields, 10);
+        if (count < 5 || fields[0] != "cpu") return;
+        uint64_t total = 0;
+        for (size_t i = 1; i < count && i <= 8; ++i) {
+            total += to_u64(fields[i]);
+        }
+        cur_total_ = total;
+        cur_idle_ = to_u64(fields[4]) + (count > 5 ? to_u64(fields[5]) : 0);
+    } else if (path == "/proc/meminfo") {
+        std::string_view fields[3];
+        if (parse::split_whitespace(content, fields, 3) < 2) return;
+        if (fields[0] == "MemTotal:") {
+            mem_total_kb_ = to_u64(fields[1]);
+        } else if (fields[0] == "MemAvailable:") {
+            out.mem_available_kb = to_u64(fields[1]);
+        }
+    } else if (parse::starts_with(path, "/proc/pressure/")) {
+        if (!parse::starts_with(content, "some ")) return;
+        std::string_view resource = path.substr(15);
+        float value = avg10(content);
+        if (resource == "cpu") out.psi_cpu = value;
+        else if (resource == "memory") out.psi_memory = value;
+        else if (resource == "io") out.psi_io = value;
+    } else if (parse::starts_with(path, "/sys/class/thermal/")) {
+        // Millidegrees on almost every kernel; a few report whole degrees
+        long long raw = to_ll(content);
+        float celsius = (raw > 1000 || raw < -1000) ? raw / 1000.0f : static_cast<float>(raw);
+        // Disabled or virtual zones report nonsense like -273 or 0
+        if (celsius > 0 && celsius < 150 && celsius > out.max_temp_c) {
+            out.max_temp_c = celsius;
+        }
+    } else if (parse::starts_with(path, "/sys/devices/system/cpu/")) {
+        uint64_t khz = to_u64(content);
+        if (khz == 0) return;
+        freq_sum_khz_ += static_cast<double>(khz);
+        ++freq_count_;
+        out.max_freq_mhz = std::max(out.max_freq_mhz, khz / 1000.0f);
+    }
+}
+
+void TelemetrySampler::finish_sample(TelemetrySample& out) {
+    // First tick only primes the counters
+    if (prev_total_ != 0 && cur_total_ > prev_total_) {
+        uint64_t total = cur_total_ - prev_total_;
+        uint64_t idle = cur_idle_ >= prev_idle_ ? cur_idle_ - prev_idle_ : 0;
+        out.cpu_percent = 100.0f * static_cast<float>(total - std::min(idle, total)) / static_cast<float>(total);
+    }
+    prev_total_ = cur_total_;
+    prev_idle_ = cur_idle_;
+
+    if (mem_total_kb_ > 0 && out.mem_available_kb > 0) {
+        out.mem_used_percent = 100.0f * static_cast<float>(mem_total_kb_ - std::min(out.mem_available_kb, mem_total_kb_))
+                             / static_cast<float>(mem_total_kb_);
+    }
+
+    if (freq_count_ > 0) {
+        out.avg_freq_mhz = static_cast<float>(freq_sum_khz_ / freq_count_ / 1000.0);
+    }
+    freq_sum_khz_ = 0;
+    freq_count_ = 0;
+}
+
+TelemetryMonitor::TelemetryMonitor(const std::string& adb_path, size_t history)
+    : adb_path_(adb_path), history_(history) {}
+
+TelemetryMonitor::~TelemetryMonitor() {
+    // Workers still finishing a sample keep their channel alive on their own
+    stop_all();
+}
+
+void TelemetryMonitor::start(const std::string& serial, double rate_hz) {
+    int64_t interval_us = static_cast<int64_t>(1e6 / std::clamp(rate_hz, 0.1, 50.0));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& channel = channels_[serial];
+    if (channel && channel->running && *channel->running) {
+        channel->interval_us = interval_us;
+        return;
+    }
+
+    if (!channel) channel = std::make_shared<Channel>(history_);
+    channel->interval_us = interval_us;
+    channel->running = std::make_shared<std::atomic<bool>>(true);
+    std::thread(run, channel, channel->running, adb_path_, serial).detach();
+}
+
+void TelemetryMonitor::stop(const std::string& serial) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(serial);
+    if (it != channels_.end() && it->second->running) {
+        it->second->running->store(false);
+    }
+}
+
+void TelemetryMonitor::stop_all() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [serial, channel] : channels_) {
+        if (channel->running) channel->running->store(false);
+    }
+}
+
+bool TelemetryMonitor::is_running(const std::string& serial) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(serial);
+    return it != channels_.end() && it->second->running && *it->second->running;
+}
+
+std::vector<std::string> TelemetryMonitor::devices() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> serials;
+    for (const auto& [serial, channel] : channels_) {
+        if (channel->running && *channel->running) serials.push_back(serial);
+    }
+    return serials;
+}
+
+bool TelemetryMonitor::copy_series(const std::string& serial, std::vector<TelemetrySample>& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(serial);
+    if (it == channels_.end()) return false;
+
+    std::lock_guard<std::mutex> series_lock(it->second->mutex);
+    it->second->series.copy_to(out);
+    return true;
+}
+
+uint64_t TelemetryMonitor::missed_samples(const std::string& serial) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(serial);
+    return it == channels_.end() ? 0 : it->second->missed.load();
+}
+
+void TelemetryMonitor::run(std::shared_ptr<Channel> channel, std::shared_ptr<std::atomic<bool>> running,
+                           std::string adb_path, std::string serial) {
+    TelemetrySampler sampler(adb_path, serial);
+    TelemetrySample sample;
+    Clock::time_point next = Clock::now();
+
+    while (*running) {
+        bool taken = sampler.sample(sample);
+        // Stopped during the round trip: a restarted worker may own the series now
+        if (!*running) break;
+        if (taken) {
+            std::lock_guard<std::mutex> lock(channel->mutex);
+            channel->series.push(sample);
+        } else {
+            ++channel->missed;
+        }
+
+        // Fixed schedule; ticks that cannot be kept are skipped, not queued
+        auto interval = std::chrono::microseconds(channel->interval_us.load());
+        next += interval;
+        Clock::time_point now = Clock::now();
+        if (next < now) {
+            auto behind = (now - next) / interval + 1;
+            channel->missed += static_cast<uint64_t>(behind);
+            next += interval * behind;
+        }
+
+        // Sleep in short slices so a stopped worker exits promptly
+        while (*running && Clock::now() < next) {
+            std::this_thread::sleep_for(std::min<Clock::duration>(next - Clock::now(),
+                                                                 std::chrono::milliseconds(50)));
+        }
+    }
+}
+
+} // namespace monitor
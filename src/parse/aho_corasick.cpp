@@ -0,0 +1,120 @@
+#include "parse/aho_corasick.hpp"
+
+#include <queue>
+
+namespace parse {
+
+AhoCorasick::AhoCorasick(bool ignore_case) : ignore_case_(ignore_case) {
+    trie_.emplace_back();
+    terminal_.emplace_back();
+}
+
+unsigned char AhoCorasick::fold(unsigned char c) const {
+    if (ignore_case_ && c >= 'A' && c <= 'Z') return static_cast<unsigned char>(c - 'A' + 'a');
+    return c;
+}
+
+uint32_t AhoCorasick::add(std::string_view pattern) {
+    compiled_ = false;
+    uint32_t id = static_cast<uint32_t>(pattern_lengths_.size());
+    pattern_lengths_.push_back(static_cast<uint32_t>(pattern.size()));
+    if (pattern.empty()) return id;     // never matches
+
+    uint32_t node = 0;
+    for (char ch : pattern) {
+        uint8_t c = fold(static_cast<unsigned char>(ch));
+        uint32_t child = 0;
+        for (const auto& [edge, target] : trie_[node]) {
+            if (edge == c) {
+                child = target;
+                break;
+            }
+        }
+        if (child == 0) {
+            child = static_cast<uint32_t>(trie_.size());
+            trie_[node].emplace_back(c, child);
+            trie_.emplace_back();
+            terminal_.emplace_back();
+        }
+        node = child;
+    }
+    terminal_[node].push_back(id);
+    return id;
+}
+
+void AhoCorasick::compile() {
+    // Byte classes: one per distinct (folded) byte used by any pattern
+    byte_class_.fill(0);
+    class_count_ = 1;
+    for (const auto& edges : trie_) {
+        for (const auto& edge : edges) {
+            if (byte_class_[edge.first] == 0) {
+                byte_class_[edge.first] = static_cast<uint8_t>(class_count_++);
+            }
+        }
+    }
+    if (ignore_case_) {
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            byte_class_[c] = byte_class_[c - 'A' + 'a'];
+        }
+    }
+
+    size_t states = trie_.size();
+    next_.assign(states * class_count_, 0);
+    fail_.assign(states, 0);
+    first_output_.assign(states, -1);
+    output_next_.clear();
+    output_pattern_.clear();
+
+    // Breadth-first, so a state's fail target is always complete before the state
+    std::queue<uint32_t> queue;
+    for (const auto& [c, child] : trie_[0]) {
+        next_[byte_class_[c]] = child;
+        queue.push(child);
+    }
+
+    auto link_outputs = [this](uint32_t state) {
+        int32_t inherited = first_output_[fail_[state]];
+        int32_t head = inherited;
+        // Own patterns in front, chained onto everything the fail state reports
+        for (auto it = terminal_[state].rbegin(); it != terminal_[state].rend(); ++it) {
+            output_pattern_.push_back(*it);
+            output_next_.push_back(head);
+            head = static_cast<int32_t>(output_pattern_.size() - 1);
+        }
+        first_output_[state] = head;
+    };
+    link_outputs(0);
+
+    while (!queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop();
+        link_outputs(state);
+
+        uint32_t* row = &next_[state * class_count_];
+        const uint32_t* fail_row = &next_[fail_[state] * class_count_];
+        for (uint32_t c = 0; c < class_count_; ++c) {
+            row[c] = fail_row[c];
+        }
+
+        for (const auto& [c, child] : trie_[state]) {
+            uint8_t cls = byte_class_[c];
+            fail_[child] = fail_row[cls];
+            row[cls] = child;
+            queue.push(child);
+        }
+    }
+
+    compiled_ = true;
+}
+
+std::vector<bool> AhoCorasick::find_all(std::string_view text) const {
+    std::vector<bool> found(pattern_lengths_.size(), false);
+    scan(text, [&found](uint32_t id, size_t) {
+        found[id] = true;
+        return true;
+    });
+    return found;
+}
+
+} // namespace parse
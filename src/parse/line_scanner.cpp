@@ -0,0 +1,236 @@
+#include "parse/line_scanner.hpp"
+
+#include <cstring>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LINECHECK_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace parse {
+
+namespace {
+
+using FindFn = const char* (*)(const char*, const char*, char);
+using CountFn = std::size_t (*)(const char*, const char*, char);
+
+// ============ Scalar fallback ============
+
+const char* find_byte_scalar(const char* begin, const char* end, char c) {
+    if (begin >= end) return end;
+    const void* hit = std::memchr(begin, c, static_cast<std::size_t>(end - begin));
+    return hit ? static_cast<const char*>(hit) : end;
+}
+
+std::size_t count_byte_scalar(const char* begin, const char* end, char c) {
+    std::size_t count = 0;
+    for (const char* p = begin; p < end; ++p) {
+        count += (*p == c);
+    }
+    return count;
+}
+
+#ifdef LINECHECK_SCANNER_X86
+
+// ============ SSE2 (baseline on x86_64) ============
+
+__attribute__((target("sse2")))
+const char* find_byte_sse2(const char* begin, const char* end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    const char* p = begin;
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask != 0) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        p += 16;
+    }
+
+    for (; p < end; ++p) {
+        if (*p == c) return p;
+    }
+    return end;
+}
+
+__attribute__((target("sse2")))
+std::size_t count_byte_sse2(const char* begin, const char* end, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    const char* p = begin;
+    std::size_t count = 0;
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+        count += static_cast<std::size_t>(__builtin_popcount(mask));
+        p += 16;
+    }
+
+    return count + count_byte_scalar(p, end, c);
+}
+
+// ============ AVX2 ============
+
+__attribute__((target("avx2")))
+const char* find_byte_avx2(const char* begin, const char* end, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    const char* p = begin;
+
+    // Two vectors per iteration keeps the load ports busy on long lines
+    while (end - p >= 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        unsigned mask_a = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, needle)));
+        unsigned mask_b = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, needle)));
+        if (mask_a != 0) return p + __builtin_ctz(mask_a);
+        if (mask_b != 0) return p + 32 + __builtin_ctz(mask_b);
+        p += 64;
+    }
+
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+
+    return find_byte_sse2(p, end, c);
+}
+
+__attribute__((target("avx2")))
+std::size_t count_byte_avx2(const char* begin, const char* end, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    const char* p = begin;
+    std::size_t count = 0;
+
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        count += static_cast<std::size_t>(__builtin_popcount(mask));
+        p += 32;
+    }
+
+    return count + count_byte_sse2(p, end, c);
+}
+
+#endif // LINECHECK_SCANNER_X86
+
+// ============ Runtime dispatch ============
+
+struct Dispatch {
+    FindFn find;
+    CountFn count;
+    const char* isa;
+};
+
+Dispatch select_dispatch() {
+#ifdef LINECHECK_SCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {find_byte_avx2, count_byte_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {find_byte_sse2, count_byte_sse2, "sse2"};
+    }
+#endif
+    return {find_byte_scalar, count_byte_scalar, "scalar"};
+}
+
+const Dispatch& dispatch() {
+    static const Dispatch selected = select_dispatch();
+    return selected;
+}
+
+bool is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+} // namespace
+
+const char* find_byte(const char* begin, const char* end, char c) {
+    return dispatch().find(begin, end, c);
+}
+
+std::size_t count_byte(const char* begin, const char* end, char c) {
+    return dispatch().count(begin, end, c);
+}
+
+const char* scanner_isa() {
+    return dispatch().isa;
+}
+
+// ============ LineScanner ============
+
+LineScanner::LineScanner(std::string_view text)
+    : pos_(text.data()), end_(text.data() + text.size()), find_(dispatch().find) {}
+
+bool LineScanner::next(std::string_view& line) {
+    if (pos_ >= end_) return false;
+
+    const char* nl = find_(pos_, end_, '\n');
+    const char* line_end = nl;
+    if (line_end > pos_ && *(line_end - 1) == '\r') {
+        --line_end;
+    }
+
+    line = std::string_view(pos_, static_cast<std::size_t>(line_end - pos_));
+    pos_ = (nl < end_) ? nl + 1 : end_;
+    return true;
+}
+
+// ============ Field splitting ============
+
+std::size_t split_fields(std::string_view line, char delim,
+                         std::string_view* out, std::size_t max_fields) {
+    if (max_fields == 0) return 0;
+
+    FindFn find = dispatch().find;
+    const char* p = line.data();
+    const char* end = p + line.size();
+    std::size_t n = 0;
+
+    while (n + 1 < max_fields) {
+        const char* hit = find(p, end, delim);
+        out[n++] = std::string_view(p, static_cast<std::size_t>(hit - p));
+        if (hit == end) return n;
+        p = hit + 1;
+    }
+
+    out[n++] = std::string_view(p, static_cast<std::size_t>(end - p));
+    return n;
+}
+
+std::size_t split_whitespace(std::string_view line,
+                             std::string_view* out, std::size_t max_fields) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    std::size_t n = 0;
+
+    while (n < max_fields) {
+        while (p < end && is_blank(*p)) ++p;
+        if (p == end) break;
+
+        if (n + 1 == max_fields) {
+            out[n++] = trim(std::string_view(p, static_cast<std::size_t>(end - p)));
+            break;
+        }
+
+        const char* start = p;
+        while (p < end && !is_blank(*p)) ++p;
+        out[n++] = std::string_view(start, static_cast<std::size_t>(p - start));
+    }
+
+    return n;
+}
+
+std::string_view trim(std::string_view text) {
+    const char* ws = " \t\r\n";
+    std::size_t first = text.find_first_not_of(ws);
+    if (first == std::string_view::npos) return {};
+    std::size_t last = text.find_last_not_of(ws);
+    return text.substr(first, last - first + 1);
+}
+
+} // namespace parse
@@ -0,0 +1,586 @@
+#include "report/device_report.hpp"
+#include "report/binary_codec.hpp"
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <algorithm>
+#include <type_traits>
+#include <cctype>
+
+using json = nlohmann::json;
+
+namespace report {
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'C', 'R', 'R'};
+
+enum SectionTag : uint8_t {
+    SECTION_END = 0,
+    SECTION_DEVICE = 1,
+    SECTION_ROOT = 2,
+    SECTION_BOOTLOADER = 3,
+    SECTION_ROM = 4,
+    SECTION_ANALYZERS = 5,
+};
+
+// ============ Field lists ============
+// One list per struct drives the binary writer/reader and the JSON
+// writer/reader, so the four can never disagree. Append new fields at the
+// end of a list; readers stop at the end of a section and keep defaults.
+
+template <class T, class V> void visit_fields(T& info, V& v, std::enable_if_t<std::is_same_v<std::remove_const_t<T>, DeviceInfo>>* = nullptr) {
+    v.field("manufacturer", info.manufacturer);
+    v.field("model", info.model);
+    v.field("codename", info.codename);
+    v.field("android_version", info.android_version);
+    v.field("api_level", info.api_level);
+    v.field("build_fingerprint", info.build_fingerprint);
+    v.field("cpu_abi", info.cpu_abi);
+    v.field("cpu_abi2", info.cpu_abi2);
+    v.field("cpu_cores", info.cpu_cores);
+    v.field("ram_mb", info.ram_mb);
+    v.field("storage_total_mb", info.storage_total_mb);
+    v.field("storage_free_mb", info.storage_free_mb);
+    v.field("kernel_version", info.kernel_version);
+    v.field("kernel_release", info.kernel_release);
+    v.field("arch", info.arch);
+    v.field("build_type", info.build_type);
+    v.field("build_date", info.build_date);
+    v.field("build_id", info.build_id);
+    v.field("build_host", info.build_host);
+}
+
+template <class T, class V> void visit_fields(T& match, V& v, std::enable_if_t<std::is_same_v<std::remove_const_t<T>, analyzer::SignatureMatch>>* = nullptr) {
+    v.field("id", match.id);
+    v.field("name", match.name);
+    v.field("category", match.category);
+    v.field("evidence", match.evidence);
+}
+
+template <class T, class V> void visit_fields(T& info, V& v, std::enable_if_t<std::is_same_v<std::remove_const_t<T>, RootInfo>>* = nullptr) {
+    v.field("status", info.status);
+    v.field("method", info.method);
+    v.field("magisk_version", info.magisk_version);
+    v.field("has_su", info.has_su);
+    v.field("has_magisk_binary", info.has_magisk_binary);
+    v.field("manager_apps", info.manager_apps);
+    v.field("signatures", info.signatures);
+}
+
+template <class T, class V> void visit_fields(T& info, V& v, std::enable_if_t<std::is_same_v<std::remove_const_t<T>, BootloaderInfo>>* = nullptr) {
+    v.field("status", info.status);
+    v.field("status_string", info.status_string);
+    v.field("fastboot_available", info.fastboot_available);
+    v.field("fastboot_path", info.fastboot_path);
+    v.field("from_fastboot", info.from_fastboot);
+    v.field("secure", info.secure);
+    v.field("is_userspace", info.is_userspace);
+    v.field("slot_count", info.slot_count);
+    v.field("current_slot", info.current_slot);
+    v.field("product", info.product);
+    v.field("serialno", info.serialno);
+    v.field("bootloader_version", info.bootloader_version);
+    v.field("baseband_version", info.baseband_version);
+    v.field("variables", info.variables);
+    v.field("from_properties", info.from_properties);
+    v.field("confidence", info.confidence);
+    v.field("evidence", info.evidence);
+    v.field("needs_fastboot_check", info.needs_fastboot_check);
+}
+
+template <class T, class V> void visit_fields(T& info, V& v, std::enable_if_t<std::is_same_v<std::remove_const_t<T>, RomInfo>>* = nullptr) {
+    v.field("codename", info.codename);
+    v.field("supported", info.supported);
+    v.field("latest_version", info.latest_version);
+    v.field("maintainer", info.maintainer);
+    v.field("url", info.url);
+    v.field("available_versions", info.available_versions);
+}
+
+template <class T, class V> void visit_fields(T& info, V& v, std::enable_if_t<std::is_same_v<std::remove_const_t<T>, AnalyzerResults>>* = nullptr) {
+    v.field("selinux_status", info.selinux_status);
+    v.field("verified_boot_state", info.verified_boot_state);
+    v.field("device_state", info.device_state);
+    v.field("vbmeta_state", info.vbmeta_state);
+    v.field("oem_unlock_support", info.oem_unlock_support);
+    v.field("oem_unlock_allowed", info.oem_unlock_allowed);
+    v.field("current_slot", info.current_slot);
+    v.field("has_ab", info.has_ab);
+}
+
+// ============ Enum names (JSON) ============
+
+const char* enum_name(RootStatus status) {
+    switch (status) {
+        case RootStatus::ROOTED: return "rooted";
+        case RootStatus::NOT_ROOTED: return "not_rooted";
+        default: return "unknown";
+    }
+}
+
+const char* enum_name(RootMethod method) {
+    switch (method) {
+        case RootMethod::MAGISK: return "magisk";
+        case RootMethod::SUPERSU: return "supersu";
+        case RootMethod::KERNELSU: return "kernelsu";
+        case RootMethod::APATCH: return "apatch";
+        case RootMethod::NO_ROOT: return "none";
+        default: return "unknown";
+    }
+}
+
+const char* enum_name(BootloaderStatus status) {
+    switch (status) {
+        case BootloaderStatus::LOCKED: return "locked";
+        case BootloaderStatus::UNLOCKED: return "unlocked";
+        case BootloaderStatus::UNLOCKABLE: return "unlockable";
+        default: return "unknown";
+    }
+}
+
+const char* enum_name(LockConfidence confidence) {
+    switch (confidence) {
+        case LockConfidence::HIGH: return "high";
+        case LockConfidence::MEDIUM: return "medium";
+        case LockConfidence::LOW: return "low";
+        default: return "none";
+    }
+}
+
+// Last enumerator of each enum, for range checks when decoding
+constexpr uint64_t enum_max(RootStatus) { return static_cast<uint64_t>(RootStatus::UNKNOWN); }
+constexpr uint64_t enum_max(RootMethod) { return static_cast<uint64_t>(RootMethod::NO_ROOT); }
+constexpr uint64_t enum_max(BootloaderStatus) { return static_cast<uint64_t>(BootloaderStatus::UNKNOWN); }
+constexpr uint64_t enum_max(LockConfidence) { return static_cast<uint64_t>(LockConfidence::NONE); }
+
+// What a value past enum_max() (written by a newer version) decodes to;
+// not always the last enumerator: NO_ROOT would claim there is no root
+constexpr RootStatus enum_unknown(RootStatus) { return RootStatus::UNKNOWN; }
+constexpr RootMethod enum_unknown(RootMethod) { return RootMethod::UNKNOWN_METHOD; }
+constexpr BootloaderStatus enum_unknown(BootloaderStatus) { return BootloaderStatus::UNKNOWN; }
+constexpr LockConfidence enum_unknown(LockConfidence) { return LockConfidence::NONE; }
+
+template <class E>
+bool enum_from_name(const std::string& name, E& value) {
+    for (uint64_t i = 0; i <= enum_max(E{}); ++i) {
+        if (name == enum_name(static_cast<E>(i))) {
+            value = static_cast<E>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============ Binary visitors ============
+
+struct BinaryEncoder {
+    BinaryWriter& out;
+
+    void field(const char*, const std::string& value) { out.str(value); }
+    void field(const char*, bool value) { out.boolean(value); }
+    void field(const char*, int value) { out.svarint(value); }
+    void field(const char*, long long value) { out.svarint(value); }
+
+    template <class E, std::enable_if_t<std::is_enum_v<E>, int> = 0>
+    void field(const char*, E value) { out.varint(static_cast<uint64_t>(value)); }
+
+    void field(const char*, const std::vector<std::string>& values) {
+        out.varint(values.size());
+        for (const auto& value : values) out.str(value);
+    }
+
+    void field(const char*, const std::map<std::string, std::string>& values) {
+        out.varint(values.size());
+        for (const auto& [key, value] : values) {
+            out.str(key);
+            out.str(value);
+        }
+    }
+
+    void field(const char*, const std::vector<analyzer::SignatureMatch>& matches) {
+        out.varint(matches.size());
+        for (const auto& match : matches) visit_fields(match, *this);
+    }
+};
+
+struct BinaryDecoder {
+    BinaryReader& in;
+
+    // A section written by an older version ends early: keep the defaults
+    bool more() const { return in.ok() && !in.at_end(); }
+
+    void field(const char*, std::string& value) { if (more()) value = in.str(); }
+    void field(const char*, bool& value) { if (more()) value = in.boolean(); }
+    void field(const char*, int& value) { if (more()) value = static_cast<int>(in.svarint()); }
+    void field(const char*, long long& value) { if (more()) value = in.svarint(); }
+
+    template <class E, std::enable_if_t<std::is_enum_v<E>, int> = 0>
+    void field(const char*, E& value) {
+        if (!more()) return;
+        uint64_t raw = in.varint();
+        value = raw <= enum_max(E{}) ? static_cast<E>(raw) : enum_unknown(E{});
+    }
+
+    void field(const char*, std::vector<std::string>& values) {
+        if (!more()) return;
+        uint64_t count = in.varint();
+        values.clear();
+        for (uint64_t i = 0; i < count && in.ok(); ++i) values.emplace_back(in.str());
+    }
+
+    void field(const char*, std::map<std::string, std::string>& values) {
+        if (!more()) return;
+        uint64_t count = in.varint();
+        values.clear();
+        for (uint64_t i = 0; i < count && in.ok(); ++i) {
+            std::string key(in.str());
+            values[std::move(key)] = std::string(in.str());
+        }
+    }
+
+    void field(const char*, std::vector<analyzer::SignatureMatch>& matches) {
+        if (!more()) return;
+        uint64_t count = in.varint();
+        matches.clear();
+        for (uint64_t i = 0; i < count && in.ok(); ++i) {
+            matches.emplace_back();
+            visit_fields(matches.back(), *this);
+        }
+    }
+};
+
+// ============ JSON visitors ============
+
+struct JsonEncoder {
+    json& out;
+
+    template <class T, std::enable_if_t<!std::is_enum_v<T>, int> = 0>
+    void field(const char* name, const T& value) { out[name] = value; }
+
+    template <class E, std::enable_if_t<std::is_enum_v<E>, int> = 0>
+    void field(const char* name, E value) { out[name] = enum_name(value); }
+
+    void field(const char* name, const std::vector<analyzer::SignatureMatch>& matches) {
+        json array = json::array();
+        for (const auto& match : matches) {
+            json entry = json::object();
+            JsonEncoder encoder{entry};
+            visit_fields(match, encoder);
+            array.push_back(std::move(entry));
+        }
+        out[name] = std::move(array);
+    }
+};
+
+struct JsonDecoder {
+    const json& in;
+
+    // Missing or mistyped fields keep their defaults
+    template <class T, std::enable_if_t<!std::is_enum_v<T>, int> = 0>
+    void field(const char* name, T& value) {
+        auto it = in.find(name);
+        if (it == in.end()) return;
+        try {
+            value = it->template get<T>();
+        } catch (...) {}
+    }
+
+    template <class E, std::enable_if_t<std::is_enum_v<E>, int> = 0>
+    void field(const char* name, E& value) {
+        auto it = in.find(name);
+        if (it != in.end() && it->is_string()) {
+            enum_from_name(it->template get<std::string>(), value);
+        }
+    }
+
+    void field(const char* name, std::vector<analyzer::SignatureMatch>& matches) {
+        auto it = in.find(name);
+        if (it == in.end() || !it->is_array()) return;
+        matches.clear();
+        for (const auto& entry : *it) {
+            if (!entry.is_object()) continue;
+            matches.emplace_back();
+            JsonDecoder decoder{entry};
+            visit_fields(matches.back(), decoder);
+        }
+    }
+};
+
+// ============ Flattening ============
+
+struct Flattener {
+    std::vector<std::pair<std::string, std::string>>& out;
+    std::string prefix;
+
+    void add(const char* name, std::string value) { out.emplace_back(prefix + name, std::move(value)); }
+
+    void field(const char* name, const std::string& value) { add(name, value); }
+    void field(const char* name, bool value) { add(name, value ? "true" : "false"); }
+    void field(const char* name, int value) { add(name, std::to_string(value)); }
+    void field(const char* name, long long value) { add(name, std::to_string(value)); }
+
+    template <class E, std::enable_if_t<std::is_enum_v<E>, int> = 0>
+    void field(const char* name, E value) { add(name, enum_name(value)); }
+
+    void field(const char* name, const std::vector<std::string>& values) {
+        std::string joined;
+        for (const auto& value : values) {
+            if (!joined.empty()) joined += ", ";
+            joined += value;
+        }
+        add(name, std::move(joined));
+    }
+
+    void field(const char* name, const std::map<std::string, std::string>& values) {
+        for (const auto& [key, value] : values) {
+            out.emplace_back(prefix + name + "." + key, value);
+        }
+    }
+
+    void field(const char* name, const std::vector<analyzer::SignatureMatch>& matches) {
+        for (const auto& match : matches) {
+            std::string evidence;
+            for (const auto& item : match.evidence) {
+                if (!evidence.empty()) evidence += ", ";
+                evidence += item;
+            }
+            out.emplace_back(prefix + name + "." + match.id, std::move(evidence));
+        }
+    }
+};
+
+template <class T>
+void flatten_section(std::vector<std::pair<std::string, std::string>>& out, const char* name,
+                     const std::optional<T>& section) {
+    if (!section) return;
+    Flattener flattener{out, std::string(name) + "."};
+    visit_fields(section.value(), flattener);
+}
+
+template <class T>
+void write_section(BinaryWriter& out, SectionTag tag, const std::optional<T>& section) {
+    if (!section) return;
+    out.u8(tag);
+    size_t length_at = out.begin_length();
+    BinaryEncoder encoder{out};
+    visit_fields(section.value(), encoder);
+    out.end_length(length_at);
+}
+
+template <class T>
+bool read_section(BinaryReader& section, std::optional<T>& target) {
+    T value{};
+    BinaryDecoder decoder{section};
+    visit_fields(value, decoder);
+    if (!section.ok()) return false;
+    target = std::move(value);
+    return true;
+}
+
+template <class T>
+void write_json_section(json& out, const char* name, const std::optional<T>& section) {
+    if (!section) return;
+    json object = json::object();
+    JsonEncoder encoder{object};
+    visit_fields(section.value(), encoder);
+    out[name] = std::move(object);
+}
+
+template <class T>
+void read_json_section(const json& in, const char* name, std::optional<T>& target) {
+    auto it = in.find(name);
+    if (it == in.end() || !it->is_object()) return;
+    T value{};
+    JsonDecoder decoder{*it};
+    visit_fields(value, decoder);
+    target = std::move(value);
+}
+
+} // namespace
+
+// ============ Binary ============
+
+void encode_to(const DeviceReport& report, std::string& out) {
+    BinaryWriter writer(out);
+    writer.raw(MAGIC, sizeof(MAGIC));
+    writer.varint(REPORT_FORMAT_VERSION);
+    writer.str(report.serial);
+    writer.svarint(report.captured_at_ms);
+
+    write_section(writer, SECTION_DEVICE, report.device);
+    write_section(writer, SECTION_ROOT, report.root);
+    write_section(writer, SECTION_BOOTLOADER, report.bootloader);
+    write_section(writer, SECTION_ROM, report.rom);
+    write_section(writer, SECTION_ANALYZERS, report.analyzers);
+    writer.u8(SECTION_END);
+}
+
+std::string encode(const DeviceReport& report) {
+    std::string out;
+    out.reserve(1024);
+    encode_to(report, out);
+    return out;
+}
+
+std::optional<DeviceReport> decode(std::string_view data) {
+    if (data.size() < sizeof(MAGIC) || data.compare(0, sizeof(MAGIC), std::string_view(MAGIC, sizeof(MAGIC))) != 0) {
+        return std::nullopt;
+    }
+
+    BinaryReader reader(data.substr(sizeof(MAGIC)));
+    uint64_t version = reader.varint();
+    if (!reader.ok() || version == 0 || version > REPORT_FORMAT_VERSION) {
+        return std::nullopt;
+    }
+
+    DeviceReport report;
+    report.serial = std::string(reader.str());
+    report.captured_at_ms = reader.svarint();
+
+    while (reader.ok()) {
+        uint8_t tag = reader.u8();
+        if (!reader.ok() || tag == SECTION_END) break;
+
+        BinaryReader section = reader.sub(reader.u32());
+        bool ok = true;
+        switch (tag) {
+            case SECTION_DEVICE: ok = read_section(section, report.device); break;
+            case SECTION_ROOT: ok = read_section(section, report.root); break;
+            case SECTION_BOOTLOADER: ok = read_section(section, report.bootloader); break;
+            case SECTION_ROM: ok = read_section(section, report.rom); break;
+            case SECTION_ANALYZERS: ok = read_section(section, report.analyzers); break;
+            default: break;  // newer section, already skipped by sub()
+        }
+        if (!ok) return std::nullopt;
+    }
+
+    if (!reader.ok()) return std::nullopt;
+    return report;
+}
+
+std::vector<std::pair<std::string, std::string>> flatten(const DeviceReport& report) {
+    std::vector<std::pair<std::string, std::string>> fields;
+    fields.reserve(96);
+    flatten_section(fields, "device", report.device);
+    flatten_section(fields, "root", report.root);
+    flatten_section(fields, "bootloader", report.bootloader);
+    flatten_section(fields, "rom", report.rom);
+    flatten_section(fields, "analyzers", report.analyzers);
+
+    std::sort(fields.begin(), fields.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    return fields;
+}
+
+// ============ JSON ============
+
+std::string to_json(const DeviceReport& report, int indent) {
+    json out = json::object();
+    out["format_version"] = REPORT_FORMAT_VERSION;
+    out["serial"] = report.serial;
+    out["captured_at_ms"] = report.captured_at_ms;
+
+    write_json_section(out, "device", report.device);
+    write_json_section(out, "root", report.root);
+    write_json_section(out, "bootloader", report.bootloader);
+    write_json_section(out, "rom", report.rom);
+    write_json_section(out, "analyzers", report.analyzers);
+
+    return out.dump(indent);
+}
+
+std::optional<DeviceReport> from_json(const std::string& json_content) {
+    try {
+        auto in = json::parse(json_content);
+        if (!in.is_object() || !in.contains("serial")) {
+            return std::nullopt;
+        }
+
+        DeviceReport report;
+        report.serial = in.value("serial", "");
+        report.captured_at_ms = in.value("captured_at_ms", static_cast<int64_t>(0));
+
+        read_json_section(in, "device", report.device);
+        read_json_section(in, "root", report.root);
+        read_json_section(in, "bootloader", report.bootloader);
+        read_json_section(in, "rom", report.rom);
+        read_json_section(in, "analyzers", report.analyzers);
+        return report;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+// ============ Analyzer results ============
+
+AnalyzerResults analyzers_from_properties(const device::PropertySnapshot& props,
+                                          const std::string& getenforce) {
+    // Same mappings as the analyzer::* refresh() methods
+    AnalyzerResults results;
+
+    std::string selinux = getenforce;
+    while (!selinux.empty() && std::isspace(static_cast<unsigned char>(selinux.back()))) {
+        selinux.pop_back();
+    }
+    if (!selinux.empty()) results.selinux_status = selinux;
+
+    results.verified_boot_state = props.get_or("ro.boot.verifiedbootstate", "Unknown");
+    results.device_state = props.get_or("ro.boot.vbmeta.device_state", "Unknown");
+    if (results.device_state == "locked") {
+        results.vbmeta_state = "Locked";
+    } else if (results.device_state == "unlocked") {
+        results.vbmeta_state = "Unlocked";
+    }
+
+    if (auto supported = props.get("ro.oem_unlock_supported")) {
+        results.oem_unlock_support = supported.value() == "1" ? "Supported" : "Not Supported";
+    }
+    if (auto allowed = props.get("sys.oem_unlock_allowed")) {
+        results.oem_unlock_allowed = allowed.value() == "1" ? "Allowed" : "Not Allowed";
+    }
+
+    if (auto suffix = props.get("ro.boot.slot_suffix")) {
+        results.current_slot = suffix.value();
+        results.has_ab = true;
+    }
+    if (props.get_or("ro.build.ab_update", "") == "true") {
+        results.has_ab = true;
+    }
+    return results;
+}
+
+// ============ ReportCollector ============
+
+ReportCollector::ReportCollector(const AdbAbstraction& adb,
+                                 const DeviceInspector& inspector,
+                                 const RootAnalyzer& root_analyzer,
+                                 const BootloaderAnalyzer& bootloader_analyzer,
+                                 const RomCompatibility& rom_compat,
+                                 device::PropertyCache& properties)
+    : adb_(adb), inspector_(inspector), root_analyzer_(root_analyzer),
+      bootloader_analyzer_(bootloader_analyzer), rom_compat_(rom_compat),
+      properties_(properties) {}
+
+DeviceReport ReportCollector::collect(const std::string& serial) const {
+    DeviceReport report;
+    report.serial = serial;
+    report.captured_at_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // One getprop for the whole scan
+    properties_.invalidate(serial);
+    auto props = properties_.get(serial);
+
+    report.device = inspector_.inspect(serial);
+    report.root = root_analyzer_.analyze(serial);
+    report.bootloader = bootloader_analyzer_.analyze(serial);
+    if (report.device) {
+        report.rom = rom_compat_.check_lineage_os(report.device->codename);
+    }
+    if (!props->empty()) {
+        report.analyzers = analyzers_from_properties(*props, adb_.shell_command(serial, "getenforce"));
+    }
+
+    return report;
+}
+
+} // namespace report
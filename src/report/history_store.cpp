@@ -0,0 +1,470 @@
+#include "report/history_store.hpp"
+#include "report/binary_codec.hpp"
+#include "config_manager.h"
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
+
+namespace report {
+
+namespace {
+
+bool write_all(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+uint64_t file_size(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+// Column values are stored little-endian; every supported host already is
+template <class T>
+bool append_value(int fd, T value) {
+    return write_all(fd, &value, sizeof(value));
+}
+
+// Exclusive flock() for one scope; serializes writers across processes
+class AppendLock {
+public:
+    explicit AppendLock(int fd) : fd_(fd) {
+        int rc;
+        while ((rc = flock(fd_, LOCK_EX)) != 0 && errno == EINTR) {}
+        held_ = rc == 0;
+    }
+    ~AppendLock() {
+        if (held_) flock(fd_, LOCK_UN);
+    }
+    AppendLock(const AppendLock&) = delete;
+    AppendLock& operator=(const AppendLock&) = delete;
+
+    bool held() const { return held_; }
+
+private:
+    int fd_;
+    bool held_ = false;
+};
+
+} // namespace
+
+HistoryStore::HistoryStore(const std::string& directory) : directory_(directory) {
+    static const std::pair<const char*, size_t> layout[COLUMN_COUNT] = {
+        {"time", 8}, {"serial", 4}, {"fingerprint", 4},
+        {"storage_free", 8}, {"storage_total", 8}, {"ram", 8},
+        {"api_level", 4}, {"root_status", 1}, {"bootloader_status", 1},
+        {"report_offset", 8}, {"report_size", 4},
+    };
+    for (int i = 0; i < COLUMN_COUNT; ++i) {
+        columns_[i].name = layout[i].first;
+        columns_[i].width = layout[i].second;
+    }
+}
+
+HistoryStore::~HistoryStore() {
+    close_all();
+}
+
+std::string HistoryStore::default_directory() {
+    return ConfigManager::get_config_dir() + "/history";
+}
+
+void HistoryStore::close_all() {
+    for (auto& column : columns_) {
+        if (column.map) munmap(const_cast<uint8_t*>(column.map), column.mapped);
+        if (column.fd >= 0) ::close(column.fd);
+        column.map = nullptr;
+        column.mapped = 0;
+        column.fd = -1;
+    }
+    if (strings_fd_ >= 0) ::close(strings_fd_);
+    if (reports_fd_ >= 0) ::close(reports_fd_);
+    if (lock_fd_ >= 0) ::close(lock_fd_);
+    strings_fd_ = reports_fd_ = lock_fd_ = -1;
+    open_ = false;
+}
+
+bool HistoryStore::open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    close_all();
+
+    try {
+        fs::create_directories(directory_);
+    } catch (...) {
+        return false;
+    }
+
+    auto open_file = [this](const std::string& name) {
+        return ::open((directory_ + "/" + name).c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    };
+
+    for (auto& column : columns_) {
+        column.fd = open_file(column.name + ".col");
+        if (column.fd < 0) {
+            close_all();
+            return false;
+        }
+    }
+    strings_fd_ = open_file("strings.dat");
+    reports_fd_ = open_file("reports.dat");
+    lock_fd_ = open_file("append.lock");
+    if (strings_fd_ < 0 || reports_fd_ < 0 || lock_fd_ < 0) {
+        close_all();
+        return false;
+    }
+
+    strings_.assign(1, std::string());      // id 0 = empty / unknown
+    string_ids_.clear();
+    strings_size_ = 0;
+    rows_ = 0;
+    reports_size_ = 0;
+    rows_by_serial_.clear();
+    time_ordered_ = true;
+    last_time_ = INT64_MIN;
+
+    // Trimming a torn append must not cut into another writer's append
+    bool synced;
+    {
+        AppendLock append_lock(lock_fd_);
+        synced = append_lock.held() && sync_locked();
+    }
+    if (!synced) {
+        close_all();
+        return false;
+    }
+
+    open_ = true;
+    return true;
+}
+
+bool HistoryStore::sync_locked() {
+    if (!load_new_strings()) return false;
+
+    // Committed rows = the shortest column; anything past that is a torn append
+    size_t rows = SIZE_MAX;
+    for (const auto& column : columns_) {
+        rows = std::min<size_t>(rows, file_size(column.fd) / column.width);
+    }
+
+    // Drop rows whose report did not make it to disk
+    uint64_t reports_end = file_size(reports_fd_);
+    uint64_t committed_end = 0;
+    while (rows > 0) {
+        auto offset = read_value<uint64_t>(COL_REPORT_OFFSET, rows - 1);
+        auto size = read_value<uint32_t>(COL_REPORT_SIZE, rows - 1);
+        if (!offset || !size) return false;
+        if (*offset + *size <= reports_end) {
+            committed_end = *offset + *size;
+            break;
+        }
+        --rows;
+    }
+    // Rows this instance already indexed cannot go away
+    if (rows < rows_) return false;
+
+    for (const auto& column : columns_) {
+        if (file_size(column.fd) != rows * column.width &&
+            ftruncate(column.fd, static_cast<off_t>(rows * column.width)) != 0) {
+            return false;
+        }
+    }
+    if (reports_end != committed_end && ftruncate(reports_fd_, static_cast<off_t>(committed_end)) != 0) {
+        return false;
+    }
+    reports_size_ = committed_end;
+
+    // Serial index and time ordering of the new rows, from two narrow columns
+    size_t first_new = rows_;
+    rows_ = rows;
+    for (size_t row = first_new; row < rows_; ++row) {
+        int64_t time = value_at<int64_t>(COL_TIME, row);
+        if (time < last_time_) time_ordered_ = false;
+        last_time_ = std::max(last_time_, time);
+        rows_by_serial_[value_at<uint32_t>(COL_SERIAL, row)].push_back(static_cast<uint32_t>(row));
+    }
+    return true;
+}
+
+bool HistoryStore::load_new_strings() {
+    uint64_t end = file_size(strings_fd_);
+    if (end < strings_size_) return false;
+
+    std::string content(end - strings_size_, '\0');
+    ssize_t got = pread(strings_fd_, content.data(), content.size(), static_cast<off_t>(strings_size_));
+    if (got < 0) return false;
+    content.resize(static_cast<size_t>(got));
+
+    BinaryReader reader(content);
+    size_t good = 0;
+    while (!reader.at_end()) {
+        std::string_view value = reader.str();
+        if (!reader.ok()) break;
+        string_ids_.emplace(std::string(value), static_cast<uint32_t>(strings_.size()));
+        strings_.emplace_back(value);
+        good = reader.position();
+    }
+
+    // Torn last entry: cut it so the next one starts on a boundary
+    strings_size_ += good;
+    if (strings_size_ != end) {
+        return ftruncate(strings_fd_, static_cast<off_t>(strings_size_)) == 0;
+    }
+    return true;
+}
+
+template <class T>
+std::optional<T> HistoryStore::read_value(Column column, size_t row) const {
+    T value{};
+    off_t at = static_cast<off_t>(row * sizeof(T));
+    if (pread(columns_[column].fd, &value, sizeof(T), at) != static_cast<ssize_t>(sizeof(T))) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<uint32_t> HistoryStore::intern(const std::string& value) {
+    if (value.empty()) return 0;
+
+    auto it = string_ids_.find(value);
+    if (it != string_ids_.end()) return it->second;
+
+    std::string entry;
+    BinaryWriter writer(entry);
+    writer.str(value);
+    if (!write_all(strings_fd_, entry.data(), entry.size())) {
+        // Ids are positions in the file: cut a partial entry so the next
+        // one does not shift every later id after a reopen
+        if (ftruncate(strings_fd_, static_cast<off_t>(strings_size_)) != 0) {
+            open_ = false;
+        }
+        return std::nullopt;
+    }
+    strings_size_ += entry.size();
+
+    uint32_t id = static_cast<uint32_t>(strings_.size());
+    strings_.push_back(value);
+    string_ids_.emplace(value, id);
+    return id;
+}
+
+bool HistoryStore::append(const DeviceReport& report) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!open_ || !report.device) return false;
+
+    // Ids and offsets come from the files as they are under the lock
+    AppendLock append_lock(lock_fd_);
+    if (!append_lock.held()) return false;
+    if (!sync_locked()) {
+        open_ = false;
+        return false;
+    }
+
+    auto serial_id = intern(report.serial);
+    auto fingerprint_id = intern(report.device->build_fingerprint);
+    if (!serial_id || !fingerprint_id) return false;
+
+    // Full report first: a row is only committed once all its columns exist
+    std::string encoded = encode(report);
+    uint64_t offset = reports_size_;
+    if (!write_all(reports_fd_, encoded.data(), encoded.size())) {
+        // O_APPEND writes land at the file end, so leftovers would shift offsets
+        if (ftruncate(reports_fd_, static_cast<off_t>(reports_size_)) != 0) {
+            open_ = false;
+        }
+        return false;
+    }
+    reports_size_ += encoded.size();
+
+    uint8_t root_status = report.root ? static_cast<uint8_t>(report.root->status) + 1 : 0;
+    uint8_t bootloader_status = report.bootloader ? static_cast<uint8_t>(report.bootloader->status) + 1 : 0;
+
+    bool ok = append_value<int64_t>(columns_[COL_TIME].fd, report.captured_at_ms) &&
+              append_value<uint32_t>(columns_[COL_SERIAL].fd, *serial_id) &&
+              append_value<uint32_t>(columns_[COL_FINGERPRINT].fd, *fingerprint_id) &&
+              append_value<int64_t>(columns_[COL_STORAGE_FREE].fd, report.device->storage_free_mb) &&
+              append_value<int64_t>(columns_[COL_STORAGE_TOTAL].fd, report.device->storage_total_mb) &&
+              append_value<int64_t>(columns_[COL_RAM].fd, report.device->ram_mb) &&
+              append_value<int32_t>(columns_[COL_API_LEVEL].fd, report.device->api_level) &&
+              append_value<uint8_t>(columns_[COL_ROOT_STATUS].fd, root_status) &&
+              append_value<uint8_t>(columns_[COL_BOOTLOADER_STATUS].fd, bootloader_status) &&
+              append_value<uint64_t>(columns_[COL_REPORT_OFFSET].fd, offset) &&
+              append_value<uint32_t>(columns_[COL_REPORT_SIZE].fd, static_cast<uint32_t>(encoded.size()));
+    if (!ok) {
+        // Reopen trims the partial row
+        open_ = false;
+        return false;
+    }
+
+    if (report.captured_at_ms < last_time_) time_ordered_ = false;
+    last_time_ = std::max(last_time_, report.captured_at_ms);
+    rows_by_serial_[*serial_id].push_back(static_cast<uint32_t>(rows_));
+    ++rows_;
+    return true;
+}
+
+size_t HistoryStore::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rows_;
+}
+
+std::vector<std::string> HistoryStore::serials() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> result;
+    result.reserve(rows_by_serial_.size());
+    for (const auto& entry : rows_by_serial_) {
+        result.push_back(strings_[entry.first]);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+const uint8_t* HistoryStore::column_data(Column column) const {
+    ColumnFile& file = columns_[column];
+    size_t needed = rows_ * file.width;
+    if (needed == 0) return nullptr;
+
+    if (file.mapped < needed) {
+        // Map the whole file: it already holds every committed row
+        size_t length = std::max<size_t>(needed, file_size(file.fd));
+        if (file.map) munmap(const_cast<uint8_t*>(file.map), file.mapped);
+        file.map = nullptr;
+        file.mapped = 0;
+
+        void* map = mmap(nullptr, length, PROT_READ, MAP_SHARED, file.fd, 0);
+        if (map == MAP_FAILED) return nullptr;
+        file.map = static_cast<const uint8_t*>(map);
+        file.mapped = length;
+    }
+    return file.map;
+}
+
+template <class T>
+T HistoryStore::value_at(Column column, size_t row) const {
+    T value{};
+    if (const uint8_t* data = column_data(column)) {
+        std::memcpy(&value, data + row * sizeof(T), sizeof(T));
+    }
+    return value;
+}
+
+std::vector<uint32_t> HistoryStore::rows_in_range(uint32_t serial_id, int64_t from_ms, int64_t to_ms) const {
+    auto it = rows_by_serial_.find(serial_id);
+    if (it == rows_by_serial_.end()) return {};
+    const auto& rows = it->second;
+
+    std::vector<uint32_t> result;
+    if (time_ordered_) {
+        auto first = std::lower_bound(rows.begin(), rows.end(), from_ms, [this](uint32_t row, int64_t t) {
+            return value_at<int64_t>(COL_TIME, row) < t;
+        });
+        for (auto row = first; row != rows.end() && value_at<int64_t>(COL_TIME, *row) <= to_ms; ++row) {
+            result.push_back(*row);
+        }
+    } else {
+        for (uint32_t row : rows) {
+            int64_t time = value_at<int64_t>(COL_TIME, row);
+            if (time >= from_ms && time <= to_ms) result.push_back(row);
+        }
+    }
+    return result;
+}
+
+std::vector<HistoryStore::StoragePoint> HistoryStore::storage_trend(const std::string& serial,
+                                                                    int64_t from_ms, int64_t to_ms) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto id = string_ids_.find(serial);
+    if (id == string_ids_.end()) return {};
+
+    std::vector<StoragePoint> trend;
+    for (uint32_t row : rows_in_range(id->second, from_ms, to_ms)) {
+        trend.push_back({value_at<int64_t>(COL_TIME, row),
+                         static_cast<long long>(value_at<int64_t>(COL_STORAGE_FREE, row)),
+                         static_cast<long long>(value_at<int64_t>(COL_STORAGE_TOTAL, row))});
+    }
+    return trend;
+}
+
+std::vector<HistoryStore::FingerprintChange> HistoryStore::fingerprint_changes(int64_t from_ms,
+                                                                               int64_t to_ms) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<FingerprintChange> changes;
+
+    for (const auto& [serial_id, rows] : rows_by_serial_) {
+        // In time order only the window and the scan just before it are read
+        auto first = rows.begin();
+        if (time_ordered_) {
+            first = std::lower_bound(rows.begin(), rows.end(), from_ms, [this](uint32_t row, int64_t t) {
+                return value_at<int64_t>(COL_TIME, row) < t;
+            });
+            if (first != rows.begin()) --first;
+        }
+
+        // Integer compares of fingerprint ids; strings only for actual changes
+        uint32_t previous = 0;
+        bool have_previous = false;
+        for (auto it = first; it != rows.end(); ++it) {
+            uint32_t row = *it;
+            uint32_t fingerprint = value_at<uint32_t>(COL_FINGERPRINT, row);
+            if (fingerprint == 0) continue;     // scan without a fingerprint
+
+            int64_t time = value_at<int64_t>(COL_TIME, row);
+            if (time_ordered_ && time > to_ms) break;
+            if (have_previous && fingerprint != previous && time >= from_ms && time <= to_ms) {
+                changes.push_back({strings_[serial_id], time, strings_[previous], strings_[fingerprint]});
+            }
+            previous = fingerprint;
+            have_previous = true;
+        }
+    }
+
+    std::sort(changes.begin(), changes.end(), [](const FingerprintChange& a, const FingerprintChange& b) {
+        return a.time_ms < b.time_ms;
+    });
+    return changes;
+}
+
+std::optional<DeviceReport> HistoryStore::load_locked(size_t row) const {
+    if (row >= rows_) return std::nullopt;
+
+    uint64_t offset = value_at<uint64_t>(COL_REPORT_OFFSET, row);
+    uint32_t size = value_at<uint32_t>(COL_REPORT_SIZE, row);
+    std::string buffer(size, '\0');
+    if (pread(reports_fd_, buffer.data(), size, static_cast<off_t>(offset)) != static_cast<ssize_t>(size)) {
+        return std::nullopt;
+    }
+    return decode(buffer);
+}
+
+std::optional<DeviceReport> HistoryStore::load(size_t row) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return load_locked(row);
+}
+
+std::optional<DeviceReport> HistoryStore::latest(const std::string& serial) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto id = string_ids_.find(serial);
+    if (id == string_ids_.end()) return std::nullopt;
+
+    auto it = rows_by_serial_.find(id->second);
+    if (it == rows_by_serial_.end() || it->second.empty()) return std::nullopt;
+    return load_locked(it->second.back());
+}
+
+} // namespace report
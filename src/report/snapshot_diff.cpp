@@ -0,0 +1,140 @@
+#include "report/snapshot_diff.hpp"
+#include <sstream>
+#include <algorithm>
+
+namespace report {
+
+namespace {
+
+template <class ItA, class ItB>
+std::vector<Change> collect_changes(ItA a, ItA a_end, ItB b, ItB b_end, const KeyFilter& filter) {
+    std::vector<Change> changes;
+    merge_diff(a, a_end, b, b_end,
+               [&](Change::Kind kind, std::string_view key, std::string_view before, std::string_view after) {
+        if (filter && !filter(key)) return;
+        changes.push_back({kind, std::string(key), std::string(before), std::string(after)});
+    });
+    return changes;
+}
+
+bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+bool ends_with(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+}
+
+// (key, value) views of a snapshot in key string order
+std::vector<std::pair<std::string_view, std::string_view>> sorted_views(const device::PropertySnapshot& props) {
+    std::vector<std::pair<std::string_view, std::string_view>> views;
+    views.reserve(props.size());
+    for (const auto& entry : props.entries()) {
+        views.emplace_back(props.pool().view(entry.key), props.pool().view(entry.value));
+    }
+    std::sort(views.begin(), views.end());
+    return views;
+}
+
+} // namespace
+
+std::vector<Change> diff_properties(const device::PropertySnapshot& before,
+                                    const device::PropertySnapshot& after,
+                                    const KeyFilter& filter) {
+    if (&before.pool() != &after.pool()) {
+        auto old_views = sorted_views(before);
+        auto new_views = sorted_views(after);
+        return collect_changes(old_views.begin(), old_views.end(),
+                               new_views.begin(), new_views.end(), filter);
+    }
+
+    // Same pool: merge on key ids and compare value ids; strings are only
+    // looked up for the entries that differ
+    const device::StringPool& pool = before.pool();
+    const auto& a = before.entries();
+    const auto& b = after.entries();
+    std::vector<Change> changes;
+
+    auto emit = [&](Change::Kind kind, uint32_t key, uint32_t old_value, uint32_t new_value) {
+        std::string_view name = pool.view(key);
+        if (filter && !filter(name)) return;
+        changes.push_back({kind, std::string(name),
+                           kind == Change::Kind::ADDED ? std::string() : std::string(pool.view(old_value)),
+                           kind == Change::Kind::REMOVED ? std::string() : std::string(pool.view(new_value))});
+    };
+
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        if (j == b.size() || (i < a.size() && a[i].key < b[j].key)) {
+            emit(Change::Kind::REMOVED, a[i].key, a[i].value, 0);
+            ++i;
+        } else if (i == a.size() || b[j].key < a[i].key) {
+            emit(Change::Kind::ADDED, b[j].key, 0, b[j].value);
+            ++j;
+        } else {
+            if (a[i].value != b[j].value) {
+                emit(Change::Kind::CHANGED, a[i].key, a[i].value, b[j].value);
+            }
+            ++i;
+            ++j;
+        }
+    }
+
+    // Id order is insertion order; present changes alphabetically
+    std::sort(changes.begin(), changes.end(), [](const Change& x, const Change& y) { return x.key < y.key; });
+    return changes;
+}
+
+std::vector<Change> diff_reports(const DeviceReport& before, const DeviceReport& after,
+                                 const KeyFilter& filter) {
+    auto old_fields = flatten(before);
+    auto new_fields = flatten(after);
+    return collect_changes(old_fields.begin(), old_fields.end(),
+                           new_fields.begin(), new_fields.end(), filter);
+}
+
+bool is_build_key(std::string_view key) {
+    if (!starts_with(key, "ro.")) return false;
+
+    // Per-unit values that differ on every device of a model
+    if (key.find("serialno") != std::string_view::npos ||
+        key.find("boottime") != std::string_view::npos ||
+        starts_with(key, "ro.runtime.")) {
+        return false;
+    }
+
+    return starts_with(key, "ro.build.") ||
+           key.find(".build.") != std::string_view::npos ||
+           ends_with(key, ".fingerprint") ||
+           ends_with(key, ".security_patch") ||
+           starts_with(key, "ro.bootloader") ||
+           starts_with(key, "ro.baseband") ||
+           starts_with(key, "ro.boot.verifiedbootstate") ||
+           starts_with(key, "ro.boot.vbmeta.") ||
+           starts_with(key, "ro.kernel.");
+}
+
+std::string format_changes(const std::vector<Change>& changes, size_t limit) {
+    std::ostringstream out;
+    size_t shown = 0;
+    for (const auto& change : changes) {
+        if (shown++ == limit) {
+            out << "... " << (changes.size() - limit) << " more\n";
+            break;
+        }
+        switch (change.kind) {
+            case Change::Kind::ADDED:
+                out << "+ " << change.key << " = " << change.after << "\n";
+                break;
+            case Change::Kind::REMOVED:
+                out << "- " << change.key << " (was " << change.before << ")\n";
+                break;
+            case Change::Kind::CHANGED:
+                out << "~ " << change.key << ": " << change.before << " -> " << change.after << "\n";
+                break;
+        }
+    }
+    return out.str();
+}
+
+} // namespace report
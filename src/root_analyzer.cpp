@@ -1,4 +1,57 @@
 #include "root_analyzer.h"
+#include "agent/agent_client.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <iterator>
+#include <string_view>
+
+namespace {
+
+// Common su locations: the PATH directories plus the old superuser APKs
+const char* const SU_PATHS[] = {
+    "/system/bin/su",
+    "/system/xbin/su",
+    "/sbin/su",
+    "/bin/su",
+    "/vendor/bin/su",
+    "/product/bin/su",
+    "/system_ext/bin/su",
+    "/odm/bin/su",
+    "/system/app/SuperSU/SuperSU.apk",
+    "/system/app/Superuser/Superuser.apk",
+};
+
+// Magisk binary locations (files) and its tmpfs / module directories
+const char* const MAGISK_BINARIES[] = {
+    "/sbin/magisk",
+    "/system/bin/magisk",
+    "/system/xbin/magisk",
+    "/debug_ramdisk/magisk",
+};
+const char* const MAGISK_DIRS[] = {
+    "/sbin/.magisk",
+    "/data/adb/modules",
+};
+
+const char* const SUPERSU_APK = "/system/app/SuperSU.apk";
+
+// Chainfire's SuperSU and its paid unlocker
+constexpr std::string_view SUPERSU_PACKAGES[] = {
+    "eu.chainfire.supersu",
+    "eu.chainfire.supersu.pro",
+};
+
+// Every path probed for su/Magisk/SuperSU, in the order evidence_from_modes() reads them
+std::vector<std::string> probe_paths() {
+    std::vector<std::string> paths;
+    paths.insert(paths.end(), std::begin(SU_PATHS), std::end(SU_PATHS));
+    paths.insert(paths.end(), std::begin(MAGISK_BINARIES), std::end(MAGISK_BINARIES));
+    paths.insert(paths.end(), std::begin(MAGISK_DIRS), std::end(MAGISK_DIRS));
+    paths.emplace_back(SUPERSU_APK);
+    return paths;
+}
+
+} // namespace
 
 RootAnalyzer::RootAnalyzer(const AdbAbstraction& adb) : adb(adb) {}
 
@@ -8,23 +61,53 @@ std::optional<RootInfo> RootAnalyzer::analyze(const std::string& serial) const
     info.status = RootStatus::NOT_ROOTED;
     info.method = RootMethod::NO_ROOT;
 
+    // With an agent, one query answers the path probes, the PATH lookups
+    // and the signature capture
+    auto agent_evidence = query_agent(serial);
+
+    // One capture of paths, mounts and processes names the frameworks; the
+    // checks below still run so their su/Magisk evidence is never lost
+    if (signature_engine.is_loaded()) {
+        if (agent_evidence && agent_evidence->capture) {
+            info.signatures = signature_engine.match(*agent_evidence->capture);
+        } else {
+            info.signatures = signature_engine.scan(adb, serial);
+        }
+        apply_signatures(info);
+    }
+    bool method_known = info.method != RootMethod::NO_ROOT && info.method != RootMethod::UNKNOWN_METHOD;
+
+    // Otherwise all path probes in one sync exchange when the device allows it
+    std::optional<FilesystemEvidence> evidence;
+    if (agent_evidence) {
+        evidence = agent_evidence->fs;
+    } else {
+        evidence = probe_filesystem(serial);
+    }
+    const FilesystemEvidence* fs = evidence ? &evidence.value() : nullptr;
+
     // Check for su binary
-    info.has_su = check_su_locations(serial);
+    info.has_su = check_su_locations(serial, fs) || info.has_su;
 
     // Check for Magisk
-    info.has_magisk_binary = check_magisk(serial);
+    info.has_magisk_binary = check_magisk(serial, fs) || info.has_magisk_binary;
     if (info.has_magisk_binary) {
         info.magisk_version = get_magisk_version(serial);
-        info.method = RootMethod::MAGISK;
+        if (!method_known) {
+            info.method = RootMethod::MAGISK;
+            method_known = true;
+        }
         info.status = RootStatus::ROOTED;
     }
 
     // Check for SuperSU
-    if (!info.has_magisk_binary && check_supersu(serial)) {
+    if (!method_known && check_supersu(serial, fs)) {
         info.method = RootMethod::SUPERSU;
         info.status = RootStatus::ROOTED;
     }
 
+    info.manager_apps = find_manager_apps(serial);
+
     // If su exists but no known root method detected
     if (info.has_su && info.method == RootMethod::NO_ROOT) {
         info.method = RootMethod::UNKNOWN_METHOD;
@@ -39,74 +122,226 @@ std::optional<RootInfo> RootAnalyzer::analyze(const std::string& serial) const
     return info;
 }
 
-bool RootAnalyzer::check_su_locations(const std::string& serial) const
+bool RootAnalyzer::load_signatures(const std::string& path)
 {
-    // Common su locations
-    const char* su_locations[] = {
-        "/system/bin/su",
-        "/system/xbin/su",
-        "/sbin/su",
-        "/bin/su",
-        "/system/app/SuperSU/SuperSU.apk",
-        "/system/app/Superuser/Superuser.apk",
-    };
+    return signature_engine.load_file(path);
+}
 
-    // Use which to find su
-    std::string output = adb.shell_command(serial, "which su 2>/dev/null");
-    if (!output.empty()) {
-        return true;
+void RootAnalyzer::apply_signatures(RootInfo& info) const
+{
+    for (const auto& match : info.signatures) {
+        if (match.category != "root") continue;
+
+        if (match.id == "su-binary") {
+            info.has_su = true;
+        } else if (match.id == "magisk") {
+            info.has_magisk_binary = true;
+        }
+
+        // First root framework in data file order decides the method
+        if (info.method == RootMethod::NO_ROOT || info.method == RootMethod::UNKNOWN_METHOD) {
+            if (match.id == "magisk") info.method = RootMethod::MAGISK;
+            else if (match.id == "kernelsu") info.method = RootMethod::KERNELSU;
+            else if (match.id == "apatch") info.method = RootMethod::APATCH;
+            else if (match.id == "supersu") info.method = RootMethod::SUPERSU;
+            else info.method = RootMethod::UNKNOWN_METHOD;
+        }
+        info.status = RootStatus::ROOTED;
     }
+}
 
-    // Check standard locations
-    for (const auto& loc : su_locations) {
-        std::string cmd = "test -f " + std::string(loc) + " && echo found";
-        std::string result = adb.shell_command(serial, cmd);
-        if (result.find("found") != std::string::npos) {
-            return true;
+std::optional<RootAnalyzer::FilesystemEvidence> RootAnalyzer::probe_filesystem(const std::string& serial) const
+{
+    std::vector<std::string> paths = probe_paths();
+
+    // stat() rather than lstat(): su is usually a symlink into the root framework
+    auto stats = adb.stat_paths(serial, paths, true);
+    if (!stats || stats->size() != paths.size()) {
+        return std::nullopt;
+    }
+
+    std::vector<uint32_t> modes;
+    modes.reserve(stats->size());
+    for (const adb::FileStat& stat : *stats) {
+        modes.push_back(stat.exists() ? stat.mode : 0);
+    }
+    FilesystemEvidence evidence = evidence_from_modes(modes);
+
+    // su or magisk anywhere else on PATH: one lookup for both
+    parse::for_each_line(adb.shell_command(serial, "command -v su 2>/dev/null; command -v magisk 2>/dev/null"),
+                         [&evidence](std::string_view line) {
+        std::string_view name = parse::trim(line);
+        name = name.substr(name.rfind('/') + 1);
+        if (name == "su") evidence.su = true;
+        if (name == "magisk") evidence.magisk = true;
+    });
+    return evidence;
+}
+
+RootAnalyzer::FilesystemEvidence RootAnalyzer::evidence_from_modes(const std::vector<uint32_t>& modes)
+{
+    size_t next = 0;
+    auto any_found = [&](size_t count, bool directory) {
+        bool found = false;
+        for (size_t end = next + count; next < end && next < modes.size(); ++next) {
+            if (modes[next] != 0 && ((modes[next] & 0170000) == 0040000) == directory) found = true;
         }
+        return found;
+    };
+
+    FilesystemEvidence evidence;
+    evidence.su = any_found(std::size(SU_PATHS), false);
+    evidence.magisk = any_found(std::size(MAGISK_BINARIES), false);
+    evidence.magisk = any_found(std::size(MAGISK_DIRS), true) || evidence.magisk;
+    evidence.supersu = any_found(1, false);
+    return evidence;
+}
+
+std::optional<RootAnalyzer::AgentEvidence> RootAnalyzer::query_agent(const std::string& serial) const
+{
+    if (agent_dir.empty()) {
+        return std::nullopt;
+    }
+    auto abi = adb.get_property(serial, "ro.product.cpu.abi");
+    if (!abi || abi->empty()) {
+        return std::nullopt;
+    }
+
+    agent::AgentClient client(adb, serial);
+    if (!client.deploy(agent::AgentClient::binary_for_abi(agent_dir, abi.value()))) {
+        return std::nullopt;
+    }
+
+    agent::AgentQuery query;
+    std::vector<std::string> paths = probe_paths();
+    for (const auto& path : paths) {
+        query.stat(path, true);
+    }
+    size_t which_su = query.which("su");
+    size_t which_magisk = query.which("magisk");
+    std::optional<analyzer::SignatureEngine::AgentCapture> capture;
+    if (signature_engine.is_loaded()) {
+        capture = signature_engine.add_capture(query);
     }
 
-    return false;
+    auto results = client.run(query);
+    if (!results) {
+        return std::nullopt;
+    }
+
+    std::vector<uint32_t> modes;
+    modes.reserve(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        auto stat = results->stat(i);
+        modes.push_back(stat ? stat->mode : 0);
+    }
+
+    AgentEvidence evidence;
+    evidence.fs = evidence_from_modes(modes);
+    evidence.fs.su = !results->text(which_su).value_or("").empty() || evidence.fs.su;
+    evidence.fs.magisk = !results->text(which_magisk).value_or("").empty() || evidence.fs.magisk;
+    if (capture) {
+        evidence.capture = signature_engine.capture_from(*results, *capture);
+    }
+    return evidence;
 }
 
-bool RootAnalyzer::check_magisk(const std::string& serial) const
+bool RootAnalyzer::check_su_locations(const std::string& serial, const FilesystemEvidence* fs) const
 {
-    // Check Magisk binary
-    std::string result = adb.shell_command(serial, "which magisk 2>/dev/null");
-    if (!result.empty() && result.find("magisk") != std::string::npos) {
-        return true;
+    if (fs) {
+        return fs->su;
     }
 
-    // Check for Magisk markers
-    result = adb.shell_command(serial, "test -d /sbin/.magisk && echo found");
-    if (result.find("found") != std::string::npos) {
-        return true;
+    // su on PATH or in any standard location, answered by the exit status
+    // of one command instead of one round trip per path
+    std::string cmd = "command -v su >/dev/null 2>&1 && exit 0;";
+    for (const auto& loc : SU_PATHS) {
+        cmd += " [ -f " + std::string(loc) + " ] && exit 0;";
     }
+    cmd += " exit 1";
 
-    // Check for Magisk in /data/adb
-    result = adb.shell_command(serial, "test -d /data/adb/modules && echo found");
-    if (result.find("found") != std::string::npos) {
-        return true;
+    auto result = adb.shell(serial, cmd);
+    return result && result->succeeded();
+}
+
+bool RootAnalyzer::check_magisk(const std::string& serial, const FilesystemEvidence* fs) const
+{
+    if (fs) {
+        return fs->magisk;
     }
 
-    return false;
+    // Magisk binary on PATH, its tmpfs marker, or its module directory
+    auto result = adb.shell(serial,
+        "command -v magisk >/dev/null 2>&1 || [ -d /sbin/.magisk ] || [ -d /data/adb/modules ]");
+    return result && result->succeeded();
 }
 
-bool RootAnalyzer::check_supersu(const std::string& serial) const
+bool RootAnalyzer::check_supersu(const std::string& serial, const FilesystemEvidence* fs) const
 {
-    // Check for SuperSU app
-    std::string result = adb.shell_command(serial, "pm list packages | grep -i supersu");
-    if (!result.empty()) {
-        return true;
+    // Check for the SuperSU app: index lookups, no scan over every name
+    auto inventory = get_packages(serial);
+    for (std::string_view name : SUPERSU_PACKAGES) {
+        if (inventory->contains(name)) {
+            return true;
+        }
+    }
+
+    // Check for SuperSU system app
+    return fs ? fs->supersu : adb.path_exists(serial, SUPERSU_APK);
+}
+
+std::vector<std::string> RootAnalyzer::find_manager_apps(const std::string& serial) const
+{
+    // Default package names; hidden/repackaged managers will not show up here
+    static const char* manager_packages[] = {
+        "com.topjohnwu.magisk",     // Magisk
+        "io.github.vvb2060.magisk", // Magisk Alpha
+        "me.weishu.kernelsu",       // KernelSU
+        "me.bmax.apatch",           // APatch
+        "eu.chainfire.supersu",     // SuperSU
+        "com.koushikdutta.superuser",
+    };
+
+    std::vector<std::string> found;
+    auto inventory = get_packages(serial);
+    for (const auto& name : manager_packages) {
+        if (inventory->contains(name)) {
+            found.emplace_back(name);
+        }
     }
+    return found;
+}
 
-    // Check for SuperSU binary
-    result = adb.shell_command(serial, "test -f /system/app/SuperSU.apk && echo found");
-    if (result.find("found") != std::string::npos) {
-        return true;
+std::shared_ptr<const device::PackageInventory> RootAnalyzer::get_packages(
+    const std::string& serial, std::chrono::milliseconds max_age) const
+{
+    {
+        std::lock_guard<std::mutex> lock(packages_mutex);
+        auto it = packages.find(serial);
+        if (it != packages.end() &&
+            std::chrono::steady_clock::now() - it->second->loaded_at() < max_age) {
+            return it->second;
+        }
     }
 
-    return false;
+    auto inventory = std::make_shared<device::PackageInventory>();
+    bool loaded = inventory->load(adb, serial);
+
+    // A failed or empty pm listing is retried on the next call instead of
+    // standing in for "nothing installed" until max_age runs out
+    std::lock_guard<std::mutex> lock(packages_mutex);
+    if (loaded && !inventory->empty()) {
+        packages[serial] = inventory;
+    } else {
+        packages.erase(serial);
+    }
+    return inventory;
+}
+
+void RootAnalyzer::invalidate_packages(const std::string& serial) const
+{
+    std::lock_guard<std::mutex> lock(packages_mutex);
+    packages.erase(serial);
 }
 
 bool RootAnalyzer::has_su_binary(const std::string& serial) const
@@ -156,6 +391,10 @@ std::string RootAnalyzer::method_to_string(RootMethod method) const
             return "Magisk";
         case RootMethod::SUPERSU:
             return "SuperSU";
+        case RootMethod::KERNELSU:
+            return "KernelSU";
+        case RootMethod::APATCH:
+            return "APatch";
         case RootMethod::UNKNOWN_METHOD:
             return "Unknown Method";
         case RootMethod::NO_ROOT:
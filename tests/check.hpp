@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+/**
+ * Minimal test harness (no framework dependency)
+ *   TEST(parses_empty_input) { CHECK(...); CHECK_EQ(a, b); }
+ *   int main() { return test::run_all(); }
+ * A failed check reports its location and the test carries on, so one run
+ * lists every broken expectation.
+ */
+namespace test {
+
+struct Case {
+    const char* name;
+    void (*body)();
+};
+
+inline std::vector<Case>& cases() {
+    static std::vector<Case> registered;
+    return registered;
+}
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+struct Register {
+    Register(const char* name, void (*body)()) { cases().push_back({name, body}); }
+};
+
+inline int run_all() {
+    int failed_cases = 0;
+    for (const Case& c : cases()) {
+        int before = failures();
+        c.body();
+        bool passed = failures() == before;
+        if (!passed) ++failed_cases;
+        std::printf("%s %s\n", passed ? "PASS" : "FAIL", c.name);
+    }
+    std::printf("%zu tests, %d failed\n", cases().size(), failed_cases);
+    return failed_cases == 0 ? 0 : 1;
+}
+
+} // namespace test
+
+#define TEST(name)                                                  \
+    static void name();                                             \
+    static const test::Register name##_registered(#name, name);     \
+    static void name()
+
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++test::failures();                                                             \
+        }                                                                                   \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                          \
+    do {                                                                                    \
+        if (!((actual) == (expected))) {                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed\n", __FILE__, __LINE__,    \
+                         #actual, #expected);                                               \
+            ++test::failures();                                                             \
+        }                                                                                   \
+    } while (0)
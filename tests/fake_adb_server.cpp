@@ -0,0 +1,126 @@
+#include "fake_adb_server.hpp"
+#include "net/tcp_socket.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace test {
+
+namespace {
+
+// Generous: a stuck client fails its test instead of hanging the run
+constexpr int READ_TIMEOUT_MS = 5000;
+
+bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+} // namespace
+
+// ============ Peer ============
+
+bool FakeAdbServer::Peer::read_exact(std::string& out, size_t size) {
+    out.assign(size, '\0');
+    return size == 0 || net::read_exact(fd_, out.data(), size, READ_TIMEOUT_MS);
+}
+
+std::string FakeAdbServer::Peer::read_to_eof() {
+    std::string data;
+    char buffer[4096];
+    long n;
+    while ((n = net::read_some(fd_, buffer, sizeof(buffer), READ_TIMEOUT_MS)) > 0) {
+        data.append(buffer, static_cast<size_t>(n));
+    }
+    return data;
+}
+
+void FakeAdbServer::Peer::write(std::string_view data) {
+    net::write_all(fd_, data.data(), data.size());
+}
+
+void FakeAdbServer::Peer::fail(std::string_view message) {
+    char length[5];
+    std::snprintf(length, sizeof(length), "%04zx", message.size());
+    write("FAIL");
+    write(length);
+    write(message);
+}
+
+// ============ FakeAdbServer ============
+
+FakeAdbServer::FakeAdbServer(Handler handler) : handler_(std::move(handler)) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listen_fd_, 8) != 0 ||
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        std::perror("fake adb server");
+        std::abort();
+    }
+    port_ = ntohs(address.sin_port);
+    setenv("ANDROID_ADB_SERVER_PORT", std::to_string(port_).c_str(), 1);
+    thread_ = std::thread([this]() { serve(); });
+}
+
+FakeAdbServer::~FakeAdbServer() {
+    // Wakes the blocked accept()
+    shutdown(listen_fd_, SHUT_RDWR);
+    thread_.join();
+    close(listen_fd_);
+}
+
+std::vector<std::string> FakeAdbServer::services() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return services_;
+}
+
+void FakeAdbServer::serve() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) return;
+        serve_connection(fd);
+        close(fd);
+    }
+}
+
+void FakeAdbServer::serve_connection(int fd) {
+    Peer peer(fd);
+    while (true) {
+        std::string header;
+        std::string service;
+        if (!peer.read_exact(header, 4)) return;
+        size_t length = std::strtoul(header.c_str(), nullptr, 16);
+        if (!peer.read_exact(service, length)) return;
+
+        if (starts_with(service, "host:transport:")) {
+            peer.okay();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            services_.push_back(service);
+        }
+        handler_(peer, service);
+        return;
+    }
+}
+
+std::string le32(uint32_t value) {
+    std::string bytes;
+    for (int i = 0; i < 4; ++i) {
+        bytes.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+    return bytes;
+}
+
+std::string le64(uint64_t value) {
+    return le32(static_cast<uint32_t>(value)) + le32(static_cast<uint32_t>(value >> 32));
+}
+
+} // namespace test
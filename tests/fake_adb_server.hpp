@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <cstdint>
+
+namespace test {
+
+/**
+ * Scripted adb server for the native protocol clients
+ * Listens on an ephemeral 127.0.0.1 port and points ANDROID_ADB_SERVER_PORT
+ * at it. "host:transport:" requests are accepted; the service request that
+ * follows goes to the handler, which answers OKAY/FAIL itself and then
+ * plays the device side of the service. Connections are served one at a
+ * time, in the order the client opens them.
+ */
+class FakeAdbServer {
+public:
+    // One client connection, past the transport switch
+    class Peer {
+    public:
+        explicit Peer(int fd) : fd_(fd) {}
+
+        // Exactly `size` bytes; false on EOF or timeout
+        bool read_exact(std::string& out, size_t size);
+        // Everything until the client closes
+        std::string read_to_eof();
+
+        void write(std::string_view data);
+        void okay() { write("OKAY"); }
+        void fail(std::string_view message);
+
+        // For handing the connection to a child process
+        int fd() const { return fd_; }
+
+    private:
+        int fd_;
+    };
+
+    using Handler = std::function<void(Peer& peer, const std::string& service)>;
+
+    explicit FakeAdbServer(Handler handler);
+    ~FakeAdbServer();
+
+    FakeAdbServer(const FakeAdbServer&) = delete;
+    FakeAdbServer& operator=(const FakeAdbServer&) = delete;
+
+    uint16_t port() const { return port_; }
+
+    // Every service handed to the handler, in order
+    std::vector<std::string> services() const;
+
+private:
+    Handler handler_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::vector<std::string> services_;
+
+    void serve();
+    void serve_connection(int fd);
+};
+
+// Little-endian fields of the sync and shell protocols
+std::string le32(uint32_t value);
+std::string le64(uint64_t value);
+
+} // namespace test
@@ -0,0 +1,157 @@
+// abb_exec: command translation and output validation
+
+#include "check.hpp"
+#include "fake_adb_server.hpp"
+#include "adb/abb_exec.hpp"
+
+#include <string>
+#include <vector>
+
+using adb::AbbExecClient;
+using Args = std::vector<std::string>;
+
+namespace {
+
+// The service string carries NUL-separated arguments
+std::string abb_service(const Args& args) {
+    std::string service = "abb_exec:";
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (i > 0) service += '\0';
+        service += args[i];
+    }
+    return service;
+}
+
+struct Run {
+    std::optional<bool> ok;
+    std::string output;
+    std::string error;
+    bool rejected = false;
+};
+
+// Run `args` against a service that answers with `reply` in `pieces` writes
+Run run_against(const Args& args, const std::vector<std::string>& pieces, bool refuse = false) {
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (refuse || service != abb_service(args)) return peer.fail("closed");
+        peer.okay();
+        for (const auto& piece : pieces) {
+            peer.write(piece);
+        }
+    });
+
+    AbbExecClient client("emulator-5554");
+    Run run;
+    run.ok = client.run(args, [&](std::string_view data) {
+        run.output.append(data.data(), data.size());
+        return true;
+    }, 2000);
+    run.error = client.last_error();
+    run.rejected = client.rejected();
+    return run;
+}
+
+} // namespace
+
+TEST(translate_maps_wrappers_to_services) {
+    CHECK(AbbExecClient::translate("pm list packages -f") == Args({"package", "list", "packages", "-f"}));
+    CHECK(AbbExecClient::translate("  am  get-current-user ") == Args({"activity", "get-current-user"}));
+    CHECK(AbbExecClient::translate("wm size") == Args({"window", "size"}));
+    CHECK(AbbExecClient::translate("settings get global adb_enabled") ==
+          Args({"settings", "get", "global", "adb_enabled"}));
+    CHECK(AbbExecClient::translate("cmd package list packages") == Args({"package", "list", "packages"}));
+    CHECK(AbbExecClient::translate("pm\tpath\tcom.android.shell") == Args({"package", "path", "com.android.shell"}));
+}
+
+TEST(translate_drops_a_trailing_stderr_redirect) {
+    CHECK(AbbExecClient::translate("pm list packages 2>/dev/null") == Args({"package", "list", "packages"}));
+    CHECK(AbbExecClient::translate("pm list packages\t 2>/dev/null") == Args({"package", "list", "packages"}));
+    CHECK(!AbbExecClient::translate("pm list packages2>/dev/null"));
+    CHECK(!AbbExecClient::translate("pm list packages 2>/dev/null | grep x"));
+    CHECK(!AbbExecClient::translate("2>/dev/null"));
+}
+
+TEST(translate_leaves_shell_syntax_to_the_shell) {
+    for (const char* command : {
+             "pm list packages | grep magisk",
+             "pm list packages; echo done",
+             "pm list packages && true",
+             "pm path $PACKAGE",
+             "pm path 'com.example app'",
+             "pm dump \"x\"",
+             "pm list packages > /sdcard/out",
+             "pm list packages 2>&1",
+             "settings get global `id`",
+             "pm list packages com.*",
+             "pm list packages # comment",
+         }) {
+        CHECK(!AbbExecClient::translate(command));
+    }
+}
+
+TEST(translate_only_knows_service_wrappers) {
+    CHECK(!AbbExecClient::translate("getprop ro.build.type"));
+    CHECK(!AbbExecClient::translate("dumpsys package"));
+    CHECK(!AbbExecClient::translate("pm"));
+    CHECK(!AbbExecClient::translate(""));
+    CHECK(!AbbExecClient::translate("cmd -l"));
+    CHECK(!AbbExecClient::translate("am instrument -w com.example/.Runner"));
+}
+
+TEST(output_is_delivered_whole) {
+    // First line split across writes, then a long tail
+    std::string tail(100000, 'p');
+    Run run = run_against({"package", "list", "packages"},
+                          {"package:com.and", "roid.shell\npackage:com.example\n", tail});
+    CHECK(run.ok == std::optional<bool>(true));
+    CHECK_EQ(run.output, "package:com.android.shell\npackage:com.example\n" + tail);
+}
+
+TEST(short_output_without_newline_arrives_at_eof) {
+    Run run = run_against({"settings", "get", "global", "adb_enabled"}, {"1"});
+    CHECK(run.ok == std::optional<bool>(true));
+    CHECK_EQ(run.output, "1");
+
+    Run empty = run_against({"package", "list", "packages", "-3"}, {});
+    CHECK(empty.ok == std::optional<bool>(true));
+    CHECK_EQ(empty.output, "");
+}
+
+TEST(command_errors_fail_without_output) {
+    for (const char* reply : {
+             "Error: Unknown option: -z\n",
+             "Unknown option: --bogus\n",
+             "Unknown command: frobnicate\n",
+             "Exception occurred while executing 'list':\njava.lang.IllegalArgumentException: ...\n",
+             "Security exception: Permission Denial: ...\n",
+             "Failure [DELETE_FAILED_INTERNAL_ERROR]\n",
+             "java.lang.SecurityException: Shell does not have permission\n",
+         }) {
+        Run run = run_against({"package", "list", "packages"}, {reply});
+        CHECK(run.ok == std::optional<bool>(false));
+        CHECK_EQ(run.output, "");
+        CHECK_EQ(run.error, std::string(reply).substr(0, std::string(reply).find('\n')));
+    }
+
+    // Without a trailing newline the error is still caught at EOF
+    Run run = run_against({"package", "path"}, {"Error: no package specified"});
+    CHECK(run.ok == std::optional<bool>(false));
+    CHECK_EQ(run.output, "");
+}
+
+TEST(missing_service_hands_back_to_the_shell) {
+    Run run = run_against({"window", "size"}, {"cmd: Can't find service: window\n"});
+    CHECK(!run.ok);
+    CHECK(!run.rejected);
+    CHECK_EQ(run.output, "");
+    CHECK_EQ(run.error, "cmd: Can't find service: window");
+}
+
+TEST(refused_service_is_reported_as_rejected) {
+    Run run = run_against({"package", "list", "packages"}, {}, true);
+    CHECK(!run.ok);
+    CHECK(run.rejected);
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,383 @@
+// On-device agent: wire codec, AgentClient sessions and the signature capture
+//
+// Usage: test_agent_protocol [AGENT_BINARY]
+// With a host build of lincheckroot-agent, the scripted server also runs the
+// real agent behind "exec:" (see tests/CMakeLists.txt).
+
+#include "check.hpp"
+#include "fake_adb_server.hpp"
+#include "adb_abstraction.h"
+#include "agent/agent_client.hpp"
+#include "agent/protocol.hpp"
+#include "analyzer/signature_engine.hpp"
+
+#include <cerrno>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using report::BinaryReader;
+using report::BinaryWriter;
+
+namespace {
+
+const char* agent_binary = nullptr;
+
+std::string frame(const std::function<void(BinaryWriter&)>& payload) {
+    std::string out;
+    BinaryWriter writer(out);
+    size_t at = writer.begin_length();
+    payload(writer);
+    writer.end_length(at);
+    return out;
+}
+
+std::string hello() {
+    return frame([](BinaryWriter& out) { agent::encode_hello(out); });
+}
+
+// Request frames up to and including END
+std::vector<std::string> read_requests(test::FakeAdbServer::Peer& peer) {
+    std::vector<std::string> requests;
+    std::string header, payload;
+    while (peer.read_exact(header, 4)) {
+        auto length = agent::frame_length(header + std::string(BinaryReader(header).u32(), '\0'));
+        if (!length || !peer.read_exact(payload, *length)) break;
+        requests.push_back(payload);
+        if (payload == std::string(1, static_cast<char>(agent::Op::END))) break;
+    }
+    return requests;
+}
+
+// Every proper prefix of an encoded record must fail to decode
+template <class Decode>
+void check_truncations(const std::string& encoded, Decode&& decode) {
+    for (size_t size = 0; size < encoded.size(); ++size) {
+        BinaryReader reader(std::string_view(encoded).substr(0, size));
+        decode(reader);
+        CHECK(!reader.ok());
+    }
+}
+
+} // namespace
+
+TEST(frame_length_waits_for_the_whole_frame) {
+    std::string data = frame([](BinaryWriter& out) { out.str("payload"); });
+    CHECK_EQ(data.size(), 12u);
+    for (size_t size = 0; size < data.size(); ++size) {
+        CHECK(!agent::frame_length(std::string_view(data).substr(0, size)));
+    }
+    CHECK(agent::frame_length(data) == std::optional<size_t>(8));
+    CHECK(agent::frame_length(data + "next") == std::optional<size_t>(8));
+}
+
+TEST(hello_checks_magic_and_version) {
+    std::string good;
+    BinaryWriter writer(good);
+    agent::encode_hello(writer);
+    CHECK_EQ(good, std::string("LCRA\x01", 5));
+    BinaryReader reader(good);
+    CHECK(agent::decode_hello(reader));
+
+    for (std::string bad : {std::string("LCRB\x01", 5), std::string("LCRA\x02", 5), std::string("LCR"),
+                            std::string("sh: /data/local/tmp/lincheckroot-agent: not found")}) {
+        BinaryReader bad_reader(bad);
+        CHECK(!agent::decode_hello(bad_reader));
+    }
+}
+
+TEST(records_round_trip) {
+    std::string out;
+    BinaryWriter writer(out);
+    agent::encode(writer, agent::FileInfo{0100755, 1ULL << 40, -5, 2000, 1000});
+    agent::encode(writer, agent::ProcessEntry{1234, 10057, "com.topjohnwu.magisk"});
+    agent::encode(writer, agent::SystemInfo{8, 7812345, 2345678, 118ULL << 30, 12ULL << 30});
+    agent::encode(writer, agent::MountEntry{"magisk", "/system/bin", "tmpfs", "ro,relatime"});
+
+    BinaryReader reader(out);
+    agent::FileInfo file = agent::decode_file_info(reader);
+    CHECK_EQ(file.mode, 0100755u);
+    CHECK_EQ(file.size, 1ULL << 40);
+    CHECK_EQ(file.mtime, -5);
+    CHECK_EQ(file.uid, 2000u);
+    CHECK_EQ(file.gid, 1000u);
+
+    agent::ProcessEntry process = agent::decode_process(reader);
+    CHECK_EQ(process.pid, 1234);
+    CHECK_EQ(process.uid, 10057u);
+    CHECK_EQ(process.name, "com.topjohnwu.magisk");
+
+    agent::SystemInfo system = agent::decode_system_info(reader);
+    CHECK_EQ(system.cpu_cores, 8);
+    CHECK_EQ(system.mem_total_kb, 7812345u);
+    CHECK_EQ(system.mem_available_kb, 2345678u);
+    CHECK_EQ(system.data_total_bytes, 118ULL << 30);
+    CHECK_EQ(system.data_free_bytes, 12ULL << 30);
+
+    agent::MountEntry mount = agent::decode_mount(reader);
+    CHECK_EQ(mount.source, "magisk");
+    CHECK_EQ(mount.target, "/system/bin");
+    CHECK_EQ(mount.type, "tmpfs");
+    CHECK_EQ(mount.options, "ro,relatime");
+    CHECK(reader.ok());
+}
+
+TEST(truncated_records_fail_to_decode) {
+    std::string out;
+    BinaryWriter writer(out);
+    agent::encode(writer, agent::FileInfo{0100644, 300, 1700000000, 0, 0});
+    check_truncations(out, agent::decode_file_info);
+
+    out.clear();
+    agent::encode(writer, agent::ProcessEntry{1, 0, "init"});
+    check_truncations(out, agent::decode_process);
+
+    out.clear();
+    agent::encode(writer, agent::SystemInfo{4, 1, 2, 3, 4});
+    check_truncations(out, agent::decode_system_info);
+
+    out.clear();
+    agent::encode(writer, agent::MountEntry{"/dev/block/dm-0", "/", "ext4", "ro"});
+    check_truncations(out, agent::decode_mount);
+}
+
+TEST(query_encodes_one_frame_per_request_and_end) {
+    agent::AgentQuery query;
+    CHECK(query.empty());
+    CHECK_EQ(query.property("ro.build.type"), 0u);
+    CHECK_EQ(query.stat("/sbin/su", true), 1u);
+    CHECK_EQ(query.list("/data/adb/modules"), 2u);
+    CHECK_EQ(query.size(), 3u);
+
+    std::string expected =
+        frame([](BinaryWriter& out) { out.u8(static_cast<uint8_t>(agent::Op::PROPERTY)); out.str("ro.build.type"); }) +
+        frame([](BinaryWriter& out) {
+            out.u8(static_cast<uint8_t>(agent::Op::STAT));
+            out.str("/sbin/su");
+            out.boolean(true);
+        }) +
+        frame([](BinaryWriter& out) { out.u8(static_cast<uint8_t>(agent::Op::LIST)); out.str("/data/adb/modules"); }) +
+        frame([](BinaryWriter& out) { out.u8(static_cast<uint8_t>(agent::Op::END)); });
+    CHECK(query.encoded() == expected);
+}
+
+TEST(results_reject_replies_of_the_wrong_shape) {
+    std::string names;
+    BinaryWriter writer(names);
+    writer.varint(2);
+    writer.str("riru");
+    writer.str("zygisk_lsposed");
+
+    std::vector<agent::AgentResults::Reply> replies(4);
+    replies[0] = {agent::Status::OK, 0, names};
+    replies[1] = {agent::Status::OK, 0, std::string("\x05", 1)};       // count 5, no entries
+    replies[2] = {agent::Status::ERROR, ENOENT, {}};
+    replies[3] = {agent::Status::UNKNOWN_OP, 0, {}};
+    agent::AgentResults results(std::move(replies));
+
+    auto listed = results.names(0);
+    CHECK(listed && *listed == std::vector<std::string>({"riru", "zygisk_lsposed"}));
+    CHECK(!results.names(1));
+    CHECK(!results.processes(1));
+    CHECK(!results.stat(2));
+    CHECK_EQ(results.error(2), ENOENT);
+    CHECK(!results.ok(3));
+    CHECK(results.status(3) == agent::Status::UNKNOWN_OP);
+}
+
+TEST(client_runs_a_batch_in_one_session) {
+    std::vector<std::string> requests;
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service != std::string("exec:") + agent::AgentClient::REMOTE_PATH) return peer.fail("closed");
+        peer.okay();
+        requests = read_requests(peer);
+        peer.write(hello());
+        peer.write(frame([](BinaryWriter& out) { out.u8(0); out.str("userdebug"); }));
+        peer.write(frame([](BinaryWriter& out) { out.u8(1); out.svarint(ENOENT); }));
+        peer.write(frame([](BinaryWriter& out) { out.u8(2); }));
+    });
+
+    AdbAbstraction adb("adb");
+    agent::AgentClient client(adb, "emulator-5554");
+    agent::AgentQuery query;
+    size_t type = query.property("ro.build.type");
+    size_t su = query.stat("/sbin/su");
+    size_t mounts = query.mounts();
+    auto results = client.run(query, 2000);
+    CHECK(results.has_value());
+    if (results) {
+        CHECK_EQ(results->size(), 3u);
+        CHECK(results->text(type) == std::optional<std::string>("userdebug"));
+        CHECK(!results->stat(su));
+        CHECK_EQ(results->error(su), ENOENT);
+        CHECK(results->status(mounts) == agent::Status::UNKNOWN_OP);
+    }
+    // Three requests and END, all written before the first reply
+    CHECK_EQ(requests.size(), 4u);
+}
+
+TEST(client_rejects_an_unknown_status) {
+    test::FakeAdbServer server([](test::FakeAdbServer::Peer& peer, const std::string&) {
+        peer.okay();
+        read_requests(peer);
+        peer.write(hello());
+        peer.write(frame([](BinaryWriter& out) { out.u8(0); out.str("a"); }));
+        peer.write(frame([](BinaryWriter& out) { out.u8(7); out.str("b"); }));
+    });
+
+    AdbAbstraction adb("adb");
+    agent::AgentClient client(adb, "emulator-5554");
+    agent::AgentQuery query;
+    query.property("a");
+    query.property("b");
+    CHECK(!client.run(query, 2000).has_value());
+    CHECK(client.last_error().find("Malformed") != std::string::npos);
+}
+
+TEST(client_rejects_a_truncated_error_reply) {
+    test::FakeAdbServer server([](test::FakeAdbServer::Peer& peer, const std::string&) {
+        peer.okay();
+        read_requests(peer);
+        peer.write(hello());
+        peer.write(frame([](BinaryWriter& out) { out.u8(1); }));
+    });
+
+    AdbAbstraction adb("adb");
+    agent::AgentClient client(adb, "emulator-5554");
+    agent::AgentQuery query;
+    query.stat("/sbin/su");
+    CHECK(!client.run(query, 2000).has_value());
+}
+
+TEST(client_fails_without_an_agent) {
+    for (std::string reply : {std::string("/system/bin/sh: /data/local/tmp/lincheckroot-agent: not found\n"),
+                              hello()}) {
+        test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string&) {
+            peer.okay();
+            read_requests(peer);
+            // Either a shell error where the hello belongs, or a session
+            // that ends before the replies
+            peer.write(reply);
+        });
+
+        AdbAbstraction adb("adb");
+        agent::AgentClient client(adb, "emulator-5554");
+        agent::AgentQuery query;
+        query.system_info();
+        CHECK(!client.run(query, 2000).has_value());
+    }
+}
+
+TEST(signature_capture_from_agent_replies) {
+    analyzer::SignatureEngine engine;
+    CHECK(engine.load_json(R"({
+        "probe_paths": ["/data/adb/ksu", "/data/adb/magisk"],
+        "list_dirs": ["/data/adb/modules", "/debug_ramdisk"],
+        "signatures": [
+            {"id": "kernelsu", "category": "root", "patterns": ["/data/adb/ksu"]},
+            {"id": "magisk", "category": "root", "patterns": ["/data/adb/magisk", "magisk /"]},
+            {"id": "zygisk", "category": "hooking", "patterns": ["zygisk_next"]},
+            {"id": "lsposed", "category": "hooking", "patterns": ["lspd"]}
+        ]
+    })"));
+
+    agent::AgentQuery query;
+    query.system_info();        // requests of the caller come first
+    auto capture = engine.add_capture(query);
+    CHECK_EQ(capture.first, 1u);
+    CHECK_EQ(query.size(), 7u);
+
+    auto ok = [](const std::function<void(BinaryWriter&)>& payload) {
+        std::string out;
+        BinaryWriter writer(out);
+        payload(writer);
+        return agent::AgentResults::Reply{agent::Status::OK, 0, out};
+    };
+    agent::AgentResults::Reply missing{agent::Status::ERROR, ENOENT, {}};
+    std::vector<agent::AgentResults::Reply> replies = {
+        ok([](BinaryWriter&) {}),
+        ok([](BinaryWriter& out) { agent::encode(out, agent::FileInfo{040755, 0, 0, 0, 0}); }),
+        missing,
+        ok([](BinaryWriter& out) { out.varint(1); out.str("zygisk_next"); }),
+        missing,
+        ok([](BinaryWriter& out) { out.varint(1); agent::encode(out, agent::MountEntry{"magisk", "/system/bin", "tmpfs", "ro"}); }),
+        ok([](BinaryWriter& out) { out.varint(1); agent::encode(out, agent::ProcessEntry{612, 0, "/data/adb/ksud"}); }),
+    };
+
+    auto text = engine.capture_from(agent::AgentResults(replies), capture);
+    CHECK(text.has_value());
+    if (text) {
+        CHECK_EQ(*text, "/data/adb/ksu\n"
+                        "/data/adb/modules:\nzygisk_next\n"
+                        "magisk /system/bin tmpfs ro 0 0\n"
+                        "0 612 /data/adb/ksud\n");
+        std::vector<std::string> ids;
+        for (const auto& match : engine.match(*text)) {
+            ids.push_back(match.id);
+        }
+        CHECK(ids == std::vector<std::string>({"kernelsu", "magisk", "zygisk"}));
+    }
+
+    // An agent that predates LIST sends the caller back to the shell capture
+    replies[3] = {agent::Status::UNKNOWN_OP, 0, {}};
+    CHECK(!engine.capture_from(agent::AgentResults(replies), capture));
+}
+
+TEST(real_agent_answers_a_batch) {
+    if (!agent_binary) return;
+
+    test::FakeAdbServer server([](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service != std::string("exec:") + agent::AgentClient::REMOTE_PATH) return peer.fail("closed");
+        peer.okay();
+        pid_t pid = fork();
+        if (pid == 0) {
+            dup2(peer.fd(), STDIN_FILENO);
+            dup2(peer.fd(), STDOUT_FILENO);
+            execl(agent_binary, agent_binary, static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+    });
+
+    AdbAbstraction adb("adb");
+    agent::AgentClient client(adb, "emulator-5554");
+    agent::AgentQuery query;
+    size_t system = query.system_info();
+    size_t root = query.stat("/", true);
+    size_t missing = query.stat("/nonexistent/lincheckroot");
+    size_t listing = query.list("/");
+    size_t sh = query.which("sh");
+    size_t mounts = query.mounts();
+    auto results = client.run(query, 5000);
+    CHECK(results.has_value());
+    if (!results) return;
+
+    auto info = results->system_info(system);
+    CHECK(info && info->cpu_cores > 0 && info->mem_total_kb > 0);
+    auto root_stat = results->stat(root);
+    CHECK(root_stat && S_ISDIR(root_stat->mode));
+    CHECK_EQ(results->error(missing), ENOENT);
+    auto names = results->names(listing);
+    CHECK(names && !names->empty());
+    if (names) {
+        for (const auto& name : *names) {
+            CHECK(name != "." && name != "..");
+        }
+    }
+    CHECK(!results->text(sh).value_or("").empty());
+    auto mount_list = results->mounts(mounts);
+    CHECK(mount_list && !mount_list->empty());
+    if (mount_list && !mount_list->empty()) {
+        // dump/pass are not part of the options
+        CHECK(mount_list->front().options.find(' ') == std::string::npos);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) agent_binary = argv[1];
+    return test::run_all();
+}
@@ -0,0 +1,158 @@
+// Aho-Corasick: every occurrence of overlapping, nested and duplicate patterns, against a naive search
+
+#include "check.hpp"
+#include "parse/aho_corasick.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using parse::AhoCorasick;
+
+namespace {
+
+using Hits = std::vector<std::pair<uint32_t, size_t>>;   // (pattern id, end offset)
+
+unsigned char lower(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+}
+
+// Every (pattern, end) a find() at every offset reports
+Hits naive_hits(const std::vector<std::string>& patterns, const std::string& text, bool ignore_case) {
+    Hits hits;
+    for (uint32_t id = 0; id < patterns.size(); ++id) {
+        const std::string& pattern = patterns[id];
+        if (pattern.empty() || pattern.size() > text.size()) continue;
+        for (size_t at = 0; at + pattern.size() <= text.size(); ++at) {
+            bool equal = true;
+            for (size_t i = 0; i < pattern.size() && equal; ++i) {
+                unsigned char a = static_cast<unsigned char>(text[at + i]);
+                unsigned char b = static_cast<unsigned char>(pattern[i]);
+                equal = ignore_case ? lower(a) == lower(b) : a == b;
+            }
+            if (equal) hits.emplace_back(id, at + pattern.size());
+        }
+    }
+    std::sort(hits.begin(), hits.end());
+    return hits;
+}
+
+AhoCorasick build(const std::vector<std::string>& patterns, bool ignore_case) {
+    AhoCorasick automaton(ignore_case);
+    for (const auto& pattern : patterns) automaton.add(pattern);
+    automaton.compile();
+    return automaton;
+}
+
+Hits scan_hits(const AhoCorasick& automaton, const std::string& text) {
+    Hits hits;
+    automaton.scan(text, [&hits](uint32_t id, size_t end) {
+        hits.emplace_back(id, end);
+        return true;
+    });
+    std::sort(hits.begin(), hits.end());
+    return hits;
+}
+
+std::string random_string(std::mt19937& rng, size_t size, const std::string& alphabet) {
+    std::string text;
+    for (size_t i = 0; i < size; ++i) text += alphabet[rng() % alphabet.size()];
+    return text;
+}
+
+} // namespace
+
+TEST(overlapping_and_nested_patterns) {
+    // "he" inside "she", "hers" overlapping "she", and a suffix chain through fail links
+    std::vector<std::string> patterns = {"he", "she", "his", "hers", "e"};
+    auto automaton = build(patterns, false);
+    CHECK_EQ(automaton.pattern_count(), 5u);
+
+    Hits hits = scan_hits(automaton, "ushers");
+    CHECK(hits == (Hits{{0, 4}, {1, 4}, {3, 6}, {4, 4}}));
+    CHECK(hits == naive_hits(patterns, "ushers", false));
+
+    // Self-overlapping: every start counts
+    auto repeats = build({"aa", "aaa"}, false);
+    CHECK(scan_hits(repeats, "aaaa") == (Hits{{0, 2}, {0, 3}, {0, 4}, {1, 3}, {1, 4}}));
+}
+
+TEST(duplicate_and_empty_patterns) {
+    AhoCorasick automaton;
+    CHECK_EQ(automaton.add("ksu"), 0u);
+    CHECK_EQ(automaton.add(""), 1u);
+    CHECK_EQ(automaton.add("ksu"), 2u);
+    CHECK(!automaton.compiled());
+    automaton.compile();
+    CHECK(automaton.compiled());
+
+    // Both copies report, the empty pattern never does
+    CHECK(scan_hits(automaton, "/data/adb/ksud") == (Hits{{0, 13}, {2, 13}}));
+    CHECK(automaton.find_all("ksu") == (std::vector<bool>{true, false, true}));
+    CHECK(automaton.find_all("") == (std::vector<bool>{false, false, false}));
+}
+
+TEST(ignore_case_folds_ascii_only) {
+    auto folded = build({"Magisk", "KSU /"}, true);
+    CHECK(folded.find_all("MAGISK and ksu /") == (std::vector<bool>{true, true}));
+    CHECK(folded.find_all("magis k") == (std::vector<bool>{false, false}));
+
+    auto exact = build({"Magisk"}, false);
+    CHECK(exact.find_all("magisk") == std::vector<bool>{false});
+    CHECK(exact.find_all("Magisk") == std::vector<bool>{true});
+
+    // Bytes above 0x7f are compared as they are
+    auto high = build({"\xc3\xa9t\xc3\xa9"}, true);
+    CHECK(high.find_all("\xc3\x89T\xc3\x89") == std::vector<bool>{false});
+    CHECK(high.find_all("x\xc3\xa9T\xc3\xa9") == std::vector<bool>{true});
+}
+
+TEST(scan_stops_when_the_callback_does) {
+    auto automaton = build({"a"}, false);
+    size_t calls = 0;
+    automaton.scan("aaaa", [&calls](uint32_t, size_t) { return ++calls < 2; });
+    CHECK_EQ(calls, 2u);
+
+    // Nothing is reported before compile()
+    AhoCorasick uncompiled;
+    uncompiled.add("a");
+    calls = 0;
+    uncompiled.scan("aaaa", [&calls](uint32_t, size_t) { return ++calls > 0; });
+    CHECK_EQ(calls, 0u);
+}
+
+TEST(random_patterns_match_the_naive_search) {
+    // A small alphabet makes overlaps, shared prefixes and fail chains common
+    std::mt19937 rng(35);
+    for (int round = 0; round < 300; ++round) {
+        bool ignore_case = round % 2 == 1;
+        std::vector<std::string> patterns;
+        size_t count = 1 + rng() % 12;
+        for (size_t i = 0; i < count; ++i) patterns.push_back(random_string(rng, rng() % 6, "abAB/"));
+        std::string text = random_string(rng, rng() % 300, "abAB/x");
+
+        auto automaton = build(patterns, ignore_case);
+        if (scan_hits(automaton, text) != naive_hits(patterns, text, ignore_case)) {
+            CHECK(scan_hits(automaton, text) == naive_hits(patterns, text, ignore_case));
+            return;
+        }
+    }
+}
+
+TEST(adding_after_compile_needs_a_recompile) {
+    AhoCorasick automaton;
+    automaton.add("su");
+    automaton.compile();
+    size_t states = automaton.state_count();
+    automaton.add("supersu");
+    CHECK(!automaton.compiled());
+    automaton.compile();
+    CHECK(automaton.state_count() > states);
+    CHECK(automaton.find_all("eu.chainfire.supersu") == (std::vector<bool>{true, true}));
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,113 @@
+// Boot profiler: timeline from ro.boottime.* and the boot_progress_* event log
+
+#include "check.hpp"
+#include "actions/boot_profiler.hpp"
+
+#include <string>
+#include <vector>
+
+using actions::BootPhase;
+using actions::BootProfile;
+using actions::BootProfiler;
+
+namespace {
+
+// The getprop part of the batch, as the grep leaves it
+const char* PROPS =
+    "[ro.boot.boottime]: [1BLL:62,1BLE:611,KL:0,KD:0,SW:10225,ODT:0,AVB:159]\n"
+    "[ro.boottime.adbd]: [5402000000]\n"
+    "[ro.boottime.init]: [1287000000]\n"
+    "[ro.boottime.init.first_stage]: [640]\n"
+    "[ro.boottime.init.selinux]: [112]\n"
+    "[ro.boottime.zygote]: [4221000000]\n"
+    "[ro.boottime.zygote64]: [4230000000]\n";
+
+// "logcat -b events -d | grep boot_progress_"; the buffer still holds the end
+// of the previous boot
+const char* EVENTS =
+    "06-12 10:11:40.101   735   735 I boot_progress_system_run: 99000\n"
+    "06-12 10:11:58.900  1432  1432 I boot_progress_enable_screen: 120000\n"
+    "06-12 10:15:02.345   735   735 I boot_progress_start: 4330\n"
+    "06-12 10:15:02.512   735   735 I boot_progress_preload_start: 4500\n"
+    "06-12 10:15:04.018  1432  1432 I boot_progress_system_run: 6012\n"
+    "06-12 10:15:05.200  1432  1432 I boot_progress_pms_start: 7190\n"
+    "06-12 10:15:11.990  1432  1432 I boot_progress_ams_ready: 12000\n"
+    "06-12 10:15:14.513  1432  1432 I boot_progress_enable_screen: 14511\n";
+
+bool same(const std::vector<BootPhase>& actual, const std::vector<BootPhase>& expected) {
+    if (actual.size() != expected.size()) return false;
+    for (size_t i = 0; i < actual.size(); ++i) {
+        if (actual[i].name != expected[i].name || actual[i].start_ms != expected[i].start_ms ||
+            actual[i].duration_ms != expected[i].duration_ms) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(full_timeline_from_props_and_events) {
+    BootProfile profile;
+    profile.completed = true;
+    profile.completed_uptime_ms = 16000;
+    BootProfiler::parse_timeline(PROPS, EVENTS, profile);
+
+    // SW (waiting on the user) is not bootloader time
+    CHECK(same(profile.phases, {
+        {"bootloader", -832, 832},
+        {"kernel", 0, 1287},
+        {"init", 1287, 2934},
+        {"zygote", 4221, 1791},
+        {"system_server", 6012, 8499},
+        {"boot complete", 14511, 1489},
+    }));
+
+    CHECK_EQ(profile.boottime_props.size(), 6u);
+    CHECK_EQ(profile.boottime_props["ro.boottime.init.first_stage"], 640);
+    CHECK(profile.boottime_props.count("ro.boot.boottime") == 0);
+    // The latest boot's values win
+    CHECK_EQ(profile.boot_progress["boot_progress_system_run"], 6012);
+    CHECK_EQ(profile.boot_progress["boot_progress_enable_screen"], 14511);
+    CHECK_EQ(profile.boot_progress.size(), 6u);
+
+    auto text = BootProfiler::format_profile(profile);
+    CHECK(text.find("system_server       8499 ms   (at 6012 ms)") != std::string::npos);
+}
+
+TEST(missing_marks_are_bridged) {
+    // No bootloader times, no zygote property, completion not seen
+    BootProfile profile;
+    BootProfiler::parse_timeline(
+        "[ro.boottime.init]: [1500000000]\n",
+        "06-12 10:15:02.345   735   735 I boot_progress_start: 4000\n"
+        "06-12 10:15:11.990  1432  1432 I boot_progress_ams_ready: 11000\n",
+        profile);
+
+    // zygote falls back to boot_progress_start and runs to the next known mark
+    CHECK(same(profile.phases, {
+        {"kernel", 0, 1500},
+        {"init", 1500, 2500},
+        {"zygote", 4000, 7000},
+    }));
+}
+
+TEST(empty_batch_leaves_only_the_kernel_mark) {
+    BootProfile profile;
+    profile.completed = true;
+    profile.completed_uptime_ms = 9000;
+    BootProfiler::parse_timeline("", "", profile);
+    CHECK(same(profile.phases, {{"kernel", 0, 9000}}));
+
+    // Garbage lines are skipped, not parsed as marks
+    BootProfile garbage;
+    BootProfiler::parse_timeline("ro.boottime.init=5\nnot a property\n",
+                                 "--------- beginning of events\nboot_progress_start without colon\n", garbage);
+    CHECK(garbage.boottime_props.empty());
+    CHECK(garbage.boot_progress.empty());
+    CHECK(garbage.phases.empty());
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,266 @@
+// Capability probe: feature intersection, codec choice, transport ids and the cache
+
+#include "check.hpp"
+#include "fake_adb_server.hpp"
+#include "adb/capabilities.hpp"
+#include "adb/shell_v2.hpp"
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+using adb::CapabilityCache;
+using adb::Compression;
+using adb::Feature;
+using adb::ShellPacketParser;
+
+namespace {
+
+constexpr const char* SERIAL = "R58M123";
+
+const char* ALL_DEVICE_FEATURES =
+    "shell_v2,cmd,stat_v2,ls_v2,fixed_push_mkdir,apex,abb,fixed_push_symlink_timestamp,abb_exec,"
+    "remount_shell,track_app,sendrecv_v2,sendrecv_v2_brotli,sendrecv_v2_lz4,sendrecv_v2_zstd,"
+    "sendrecv_v2_dry_run_send,openscreen_mdns";
+
+// A neighbour whose serial starts with SERIAL comes first
+const char* DEVICES_L =
+    "R58M1234\tdevice usb:1-2 product:a51nsxx model:SM_A515F device:a51 transport_id:9\n"
+    "R58M123\tdevice usb:1-1 product:beyond1ltexx model:SM_G973F device:beyond1 transport_id:3\n";
+
+const char* PROBE_OUTPUT = "34\n--\nbase64 cat chmod\nls md5sum\nstat\n";
+
+std::string length_prefixed(const std::string& body) {
+    char length[5];
+    std::snprintf(length, sizeof(length), "%04zx", body.size());
+    return length + body;
+}
+
+struct Script {
+    std::string device_features = ALL_DEVICE_FEATURES;
+    std::string host_features = ALL_DEVICE_FEATURES;
+    bool old_server = false;            // no host:features
+    bool device_reachable = true;
+    std::string devices_l = DEVICES_L;
+    std::string probe_output = PROBE_OUTPUT;
+};
+
+// Host requests of the probe plus its one shell call (v2 or legacy)
+test::FakeAdbServer::Handler play_probe(const Script& script) {
+    return [script](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == std::string("host-serial:") + SERIAL + ":features") {
+            if (!script.device_reachable) return peer.fail("device '" + std::string(SERIAL) + "' not found");
+            peer.okay();
+            peer.write(length_prefixed(script.device_features));
+        } else if (service == "host:features") {
+            if (script.old_server) return peer.fail("unknown host service");
+            peer.okay();
+            peer.write(length_prefixed(script.host_features));
+        } else if (service == "host:devices-l") {
+            peer.okay();
+            peer.write(length_prefixed(script.devices_l));
+        } else if (service.rfind("shell,v2,raw:", 0) == 0) {
+            peer.okay();
+            std::string close_stdin;
+            peer.read_exact(close_stdin, 5);
+            peer.write(ShellPacketParser::encode(ShellPacketParser::ID_STDOUT, script.probe_output));
+            peer.write(ShellPacketParser::encode(ShellPacketParser::ID_EXIT, std::string(1, '\0')));
+        } else if (service.rfind("shell:", 0) == 0) {
+            peer.okay();
+            peer.write(script.probe_output + "\n\x1f__lcr_exit:0\n");
+        } else {
+            peer.fail("unexpected service");
+        }
+    };
+}
+
+// Codec the build would pick from `preferred` down to NONE
+Compression first_available(std::initializer_list<Compression> preferred) {
+    for (Compression method : preferred) {
+        if (adb::compression_available(method)) return method;
+    }
+    return Compression::NONE;
+}
+
+} // namespace
+
+TEST(probe_intersects_host_and_device_features) {
+    Script script;
+    // An older server: no abb, no zstd/brotli
+    script.host_features = "shell_v2,cmd,stat_v2,ls_v2,fixed_push_mkdir,sendrecv_v2,sendrecv_v2_lz4";
+    test::FakeAdbServer server(play_probe(script));
+
+    auto caps = CapabilityCache::probe(SERIAL);
+    CHECK(caps != nullptr);
+    if (!caps) return;
+    CHECK_EQ(caps->serial, SERIAL);
+    CHECK(caps->has(Feature::SHELL_V2));
+    CHECK(caps->has(Feature::CMD));
+    CHECK(caps->has(Feature::STAT_V2));
+    CHECK(caps->has(Feature::LS_V2));
+    CHECK(caps->has(Feature::SENDRECV_V2));
+    CHECK(!caps->has(Feature::ABB));
+    CHECK(!caps->has(Feature::ABB_EXEC));
+    CHECK_EQ(caps->host_features.size(), 7u);
+    CHECK_EQ(caps->device_features.size(), 17u);
+
+    // Zstd is preferred, but only the device has it
+    CHECK(caps->sync_compression == first_available({Compression::LZ4}));
+
+    CHECK_EQ(caps->transport_id, 3);
+    CHECK_EQ(caps->sdk, 34);
+    CHECK(caps->applets_probed);
+    CHECK_EQ(caps->applets.size(), 6u);
+    CHECK(caps->has_applet("md5sum"));
+    CHECK(!caps->has_applet("getprop"));
+
+    // The shell call went over shell v2, after the three host requests
+    auto services = server.services();
+    CHECK_EQ(services.size(), 4u);
+    if (services.size() == 4) {
+        CHECK_EQ(services[3], "shell,v2,raw:getprop ro.build.version.sdk; echo --; toybox 2>/dev/null");
+    }
+}
+
+TEST(codec_choice_follows_preference) {
+    Script script;
+    test::FakeAdbServer server(play_probe(script));
+    auto caps = CapabilityCache::probe(SERIAL);
+    CHECK(caps && caps->sync_compression ==
+                      first_available({Compression::ZSTD, Compression::LZ4, Compression::BROTLI}));
+}
+
+TEST(codecs_need_sendrecv_v2) {
+    Script script;
+    script.host_features = "shell_v2,cmd,sendrecv_v2_zstd,sendrecv_v2_lz4,sendrecv_v2_brotli";
+    test::FakeAdbServer server(play_probe(script));
+    auto caps = CapabilityCache::probe(SERIAL);
+    CHECK(caps != nullptr);
+    if (!caps) return;
+    CHECK(!caps->has(Feature::SENDRECV_V2));
+    CHECK(caps->sync_compression == Compression::NONE);
+}
+
+TEST(old_server_supports_nothing_new) {
+    Script script;
+    script.old_server = true;
+    script.devices_l = "R58M123\tdevice usb:1-1 product:beyond1ltexx\n";     // no transport_id either
+    test::FakeAdbServer server(play_probe(script));
+
+    auto caps = CapabilityCache::probe(SERIAL);
+    CHECK(caps != nullptr);
+    if (!caps) return;
+    CHECK_EQ(caps->features, 0u);
+    CHECK(caps->host_features.empty());
+    CHECK(caps->sync_compression == Compression::NONE);
+    CHECK_EQ(caps->transport_id, -1);
+    // The probe still runs, over the legacy shell
+    CHECK_EQ(caps->sdk, 34);
+    auto services = server.services();
+    CHECK(!services.empty() && services.back().rfind("shell:", 0) == 0);
+}
+
+TEST(unreachable_device_is_not_cached) {
+    Script script;
+    script.device_reachable = false;
+    test::FakeAdbServer server(play_probe(script));
+
+    CapabilityCache cache;
+    CHECK(cache.get(SERIAL) == nullptr);
+    CHECK(cache.peek(SERIAL) == nullptr);
+}
+
+TEST(parse_probe_output_with_and_without_separator) {
+    adb::DeviceCapabilities caps;
+    CapabilityCache::parse_probe_output("30\r\n--\r\nls cat\r\n", caps);
+    CHECK_EQ(caps.sdk, 30);
+    CHECK(caps.applets_probed);
+    CHECK_EQ(caps.applets.size(), 2u);
+    CHECK(caps.has_applet("cat"));
+
+    // Empty getprop: the first applet must not become the SDK level
+    adb::DeviceCapabilities empty_sdk;
+    CapabilityCache::parse_probe_output("\n--\n1 ls\n", empty_sdk);
+    CHECK_EQ(empty_sdk.sdk, 0);
+    CHECK(empty_sdk.has_applet("1"));
+
+    // No toybox: the separator but no applets
+    adb::DeviceCapabilities no_toybox;
+    CapabilityCache::parse_probe_output("23\n--\n", no_toybox);
+    CHECK_EQ(no_toybox.sdk, 23);
+    CHECK(no_toybox.applets_probed);
+    CHECK(no_toybox.applets.empty());
+
+    // Not the probe's output: both stay unknown
+    adb::DeviceCapabilities garbage;
+    CapabilityCache::parse_probe_output("34\nls cat\n", garbage);
+    CHECK_EQ(garbage.sdk, 0);
+    CHECK(!garbage.applets_probed);
+    CHECK(garbage.applets.empty());
+}
+
+TEST(retain_drops_reconnected_and_gone_devices) {
+    Script script;
+    test::FakeAdbServer server(play_probe(script));
+
+    CapabilityCache cache;
+    auto entry = cache.get(SERIAL);
+    CHECK(entry != nullptr);
+    CHECK(cache.get(SERIAL) == entry);                  // cached, no second probe
+    CHECK_EQ(server.services().size(), 4u);
+
+    cache.retain({{SERIAL, 3}});
+    CHECK(cache.peek(SERIAL) == entry);
+    // Transport id not reported this time: nothing says it reconnected
+    cache.retain({{SERIAL, -1}});
+    CHECK(cache.peek(SERIAL) == entry);
+    // Same serial on a new transport: probed afresh on next use
+    cache.retain({{SERIAL, 4}});
+    CHECK(cache.peek(SERIAL) == nullptr);
+
+    CHECK(cache.get(SERIAL) != nullptr);
+    CHECK_EQ(server.services().size(), 8u);
+    cache.retain({{"emulator-5554", 1}});
+    CHECK(cache.peek(SERIAL) == nullptr);
+}
+
+TEST(revoke_updates_a_copy_of_the_entry) {
+    Script script;
+    test::FakeAdbServer server(play_probe(script));
+
+    CapabilityCache cache;
+    auto before = cache.get(SERIAL);
+    CHECK(before != nullptr);
+    if (!before) return;
+
+    cache.revoke(SERIAL, Feature::SENDRECV_V2);
+    auto after = cache.peek(SERIAL);
+    CHECK(after != nullptr && after != before);
+    if (after) {
+        CHECK(!after->has(Feature::SENDRECV_V2));
+        CHECK(after->sync_compression == Compression::NONE);
+        CHECK(after->has(Feature::STAT_V2));
+    }
+    // Holders of the old snapshot see no change
+    CHECK(before->has(Feature::SENDRECV_V2));
+
+    // Other features keep the codec
+    cache.invalidate(SERIAL);
+    cache.get(SERIAL);
+    cache.revoke(SERIAL, Feature::ABB_EXEC);
+    auto abb_revoked = cache.peek(SERIAL);
+    CHECK(abb_revoked && !abb_revoked->has(Feature::ABB_EXEC) &&
+          abb_revoked->sync_compression == before->sync_compression);
+
+    cache.revoke_applet(SERIAL, "md5sum");
+    auto no_md5 = cache.peek(SERIAL);
+    CHECK(no_md5 && !no_md5->has_applet("md5sum") && no_md5->has_applet("stat"));
+
+    // Unknown serials are ignored
+    cache.revoke("emulator-5554", Feature::SHELL_V2);
+    CHECK(cache.peek("emulator-5554") == nullptr);
+}
+
+int main() {
+    return test::run_all();
+}
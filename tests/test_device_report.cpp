@@ -0,0 +1,189 @@
+// DeviceReport binary form: round trips, truncation and values from newer versions
+
+#include "check.hpp"
+#include "report/binary_codec.hpp"
+#include "report/device_report.hpp"
+
+#include <string>
+
+using report::DeviceReport;
+
+namespace {
+
+// Every section present, every field off its default
+DeviceReport full_report() {
+    DeviceReport report;
+    report.serial = "R58M123ABC";
+    report.captured_at_ms = 1718000000123;
+
+    DeviceInfo device;
+    device.manufacturer = "samsung";
+    device.model = "SM-G973F";
+    device.codename = "beyond1";
+    device.android_version = "12";
+    device.api_level = 31;
+    device.build_fingerprint = "samsung/beyond1ltexx/beyond1:12/SP1A.210812.016/G973FXXSGHWC2:user/release-keys";
+    device.cpu_abi = "arm64-v8a";
+    device.cpu_abi2 = "armeabi-v7a";
+    device.cpu_cores = 8;
+    device.ram_mb = 7680;
+    device.storage_total_mb = 118000;
+    device.storage_free_mb = -1;                // negative values go through zigzag
+    device.kernel_version = "#1 SMP PREEMPT Mon Mar 6 2023";
+    device.kernel_release = "4.14.190-25818860-abG973FXXSGHWC2";
+    device.arch = "aarch64";
+    device.build_type = "user";
+    device.build_date = "Mon Mar  6 12:00:00 KST 2023";
+    device.build_id = "SP1A.210812.016";
+    device.build_host = "21DJB715";
+    report.device = device;
+
+    RootInfo root{};
+    root.status = RootStatus::ROOTED;
+    root.method = RootMethod::KERNELSU;
+    root.has_su = true;
+    root.manager_apps = {"me.weishu.kernelsu", "io.github.vvb2060.magisk"};
+    root.signatures = {{"kernelsu", "KernelSU", "root", {"/data/adb/ksud"}},
+                       {"lsposed", "LSPosed", "hooking", {"org.lsposed.manager", "/data/adb/lspd"}}};
+    report.root = root;
+
+    BootloaderInfo bootloader{};
+    bootloader.status = BootloaderStatus::UNLOCKED;
+    bootloader.status_string = "Unlocked";
+    bootloader.fastboot_available = true;
+    bootloader.fastboot_path = "/usr/bin/fastboot";
+    bootloader.slot_count = 2;
+    bootloader.current_slot = "b";
+    bootloader.variables = {{"unlocked", "yes"}, {"partition-size:boot_a", "0x4000000"}};
+    bootloader.from_properties = true;
+    bootloader.confidence = LockConfidence::MEDIUM;
+    bootloader.evidence = {"ro.boot.verifiedbootstate=orange"};
+    report.bootloader = bootloader;
+
+    RomInfo rom{};
+    rom.codename = "beyond1lte";
+    rom.supported = true;
+    rom.latest_version = "21.0";
+    rom.available_versions = {"20.0", "21.0"};
+    report.rom = rom;
+
+    report::AnalyzerResults analyzers;
+    analyzers.selinux_status = "Enforcing";
+    analyzers.verified_boot_state = "orange";
+    analyzers.current_slot = "_b";
+    analyzers.has_ab = true;
+    report.analyzers = analyzers;
+    return report;
+}
+
+// Header of a hand-built report, up to its first section
+void header(report::BinaryWriter& writer) {
+    writer.raw("LCRR", 4);
+    writer.varint(report::REPORT_FORMAT_VERSION);
+    writer.str("R58M123ABC");
+    writer.svarint(1000);
+}
+
+} // namespace
+
+TEST(reencode_is_byte_identical) {
+    std::string bytes = report::encode(full_report());
+    auto decoded = report::decode(bytes);
+    CHECK(decoded.has_value());
+    if (!decoded) return;
+    CHECK(report::encode(*decoded) == bytes);
+    CHECK(report::flatten(*decoded) == report::flatten(full_report()));
+
+    // Absent sections stay absent
+    DeviceReport bare;
+    bare.serial = "emulator-5554";
+    std::string bare_bytes = report::encode(bare);
+    auto bare_decoded = report::decode(bare_bytes);
+    CHECK(bare_decoded.has_value());
+    if (bare_decoded) {
+        CHECK(!bare_decoded->device && !bare_decoded->root && !bare_decoded->analyzers);
+        CHECK(report::encode(*bare_decoded) == bare_bytes);
+    }
+}
+
+TEST(json_round_trip_keeps_every_field) {
+    auto from_json = report::from_json(report::to_json(full_report()));
+    CHECK(from_json.has_value());
+    if (from_json) CHECK(report::encode(*from_json) == report::encode(full_report()));
+}
+
+TEST(every_truncated_prefix_is_rejected) {
+    std::string bytes = report::encode(full_report());
+    size_t decoded = 0;
+    for (size_t length = 0; length < bytes.size(); ++length) {
+        if (report::decode(std::string_view(bytes).substr(0, length))) ++decoded;
+    }
+    CHECK_EQ(decoded, 0u);
+}
+
+TEST(bad_magic_and_version_are_rejected) {
+    std::string bytes = report::encode(full_report());
+    std::string magic = bytes;
+    magic[3] = 'X';
+    CHECK(!report::decode(magic).has_value());
+
+    std::string newer = bytes;
+    newer[4] = static_cast<char>(report::REPORT_FORMAT_VERSION + 1);
+    CHECK(!report::decode(newer).has_value());
+}
+
+TEST(enum_values_from_a_newer_version_decode_as_unknown) {
+    std::string bytes;
+    report::BinaryWriter writer(bytes);
+    header(writer);
+    writer.u8(2);                               // root section
+    size_t root_at = writer.begin_length();
+    writer.varint(7);                           // status
+    writer.varint(42);                          // method
+    writer.end_length(root_at);
+    writer.u8(3);                               // bootloader section
+    size_t bootloader_at = writer.begin_length();
+    writer.varint(9);                           // status, then the rest left at defaults
+    writer.end_length(bootloader_at);
+    writer.u8(0);
+
+    auto decoded = report::decode(bytes);
+    CHECK(decoded.has_value());
+    if (!decoded) return;
+    CHECK(decoded->root.has_value() && decoded->bootloader.has_value());
+    if (decoded->root) {
+        CHECK(decoded->root->status == RootStatus::UNKNOWN);
+        // Not NO_ROOT: an unknown method is still some kind of root
+        CHECK(decoded->root->method == RootMethod::UNKNOWN_METHOD);
+    }
+    if (decoded->bootloader) CHECK(decoded->bootloader->status == BootloaderStatus::UNKNOWN);
+}
+
+TEST(newer_sections_are_skipped) {
+    std::string bytes;
+    report::BinaryWriter writer(bytes);
+    header(writer);
+    writer.u8(200);
+    size_t at = writer.begin_length();
+    writer.str("from the future");
+    writer.end_length(at);
+    writer.u8(5);                               // analyzers section
+    size_t analyzers_at = writer.begin_length();
+    writer.str("Permissive");
+    writer.end_length(analyzers_at);
+    writer.u8(0);
+
+    auto decoded = report::decode(bytes);
+    CHECK(decoded.has_value());
+    if (!decoded) return;
+    CHECK_EQ(decoded->serial, "R58M123ABC");
+    CHECK(decoded->analyzers.has_value());
+    if (decoded->analyzers) {
+        CHECK_EQ(decoded->analyzers->selinux_status, "Permissive");
+        CHECK_EQ(decoded->analyzers->verified_boot_state, "Unknown");
+    }
+}
+
+int main() {
+    return test::run_all();
+}
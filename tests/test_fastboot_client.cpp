@@ -0,0 +1,261 @@
+// Fastboot over TCP: FB01 handshake, 8-byte packet framing and getvar parsing
+
+#include "check.hpp"
+#include "fastboot/fastboot_client.hpp"
+#include "net/tcp_socket.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using fastboot::Variable;
+
+namespace {
+
+constexpr int READ_TIMEOUT_MS = 5000;
+
+// Big-endian 64-bit length, then the payload
+std::string packet(std::string_view payload) {
+    std::string bytes(8, '\0');
+    uint64_t length = payload.size();
+    for (int i = 7; i >= 0; --i) {
+        bytes[i] = static_cast<char>(length & 0xff);
+        length >>= 8;
+    }
+    return bytes + std::string(payload);
+}
+
+/**
+ * Scripted fastboot device on 127.0.0.1
+ * Serves one connection: answers the handshake with `handshake`, then hands
+ * every command packet to the handler, which writes the replies.
+ */
+class FakeFastbootServer {
+public:
+    using Handler = std::function<void(int fd, const std::string& command)>;
+
+    explicit FakeFastbootServer(Handler handler, std::string handshake = "FB01")
+        : handler_(std::move(handler)), handshake_(std::move(handshake)) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listen_fd_, 1) != 0 ||
+            getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            std::perror("fake fastboot server");
+            std::abort();
+        }
+        port_ = ntohs(address.sin_port);
+        thread_ = std::thread([this]() { serve(); });
+    }
+
+    ~FakeFastbootServer() {
+        shutdown(listen_fd_, SHUT_RDWR);
+        if (thread_.joinable()) thread_.join();
+        close(listen_fd_);
+    }
+
+    uint16_t port() const { return port_; }
+
+    // Handshake and command packets exactly as the client sent them;
+    // waits for the client to hang up
+    const std::string& received() {
+        if (thread_.joinable()) thread_.join();
+        return received_;
+    }
+
+private:
+    Handler handler_;
+    std::string handshake_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    std::thread thread_;
+    std::string received_;
+
+    void serve() {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        char hello[4];
+        if (net::read_exact(fd, hello, sizeof(hello), READ_TIMEOUT_MS)) {
+            received_.append(hello, sizeof(hello));
+            net::write_all(fd, handshake_.data(), handshake_.size());
+
+            unsigned char header[8];
+            while (net::read_exact(fd, header, sizeof(header), READ_TIMEOUT_MS)) {
+                received_.append(reinterpret_cast<char*>(header), sizeof(header));
+                uint64_t length = 0;
+                for (unsigned char byte : header) length = (length << 8) | byte;
+                std::string command(length, '\0');
+                if (length > 0 && !net::read_exact(fd, command.data(), length, READ_TIMEOUT_MS)) break;
+                received_ += command;
+                handler_(fd, command);
+            }
+        }
+        close(fd);
+    }
+};
+
+void reply(int fd, std::string_view payload) {
+    std::string bytes = packet(payload);
+    net::write_all(fd, bytes.data(), bytes.size());
+}
+
+bool same(const std::vector<Variable>& actual, const std::vector<Variable>& expected) {
+    if (actual.size() != expected.size()) return false;
+    for (size_t i = 0; i < actual.size(); ++i) {
+        if (actual[i].name != expected[i].name || actual[i].value != expected[i].value) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(getvar_all_collects_info_lines) {
+    FakeFastbootServer server([](int fd, const std::string& command) {
+        if (command != "getvar:all") return reply(fd, "FAILunknown command");
+        reply(fd, "INFOversion-bootloader:slider-1.2-9152140");
+        reply(fd, "INFOunlocked:yes");
+        reply(fd, "INFOpartition-size:boot_a: 0x4000000");
+        reply(fd, "INFOpartition-type:system_a:ext4");
+        reply(fd, "INFO");                              // blank line
+        reply(fd, "INFOno separator here");             // garbage
+        reply(fd, "TEXT:nameless");
+        reply(fd, "INFOslot-count: 2");
+        reply(fd, "OKAY");
+    });
+
+    fastboot::FastbootClient client;
+    CHECK(client.connect_tcp("127.0.0.1", server.port()));
+    auto variables = client.getvar_all();
+    CHECK(variables.has_value());
+    if (variables) {
+        CHECK(same(*variables, {
+            {"version-bootloader", "slider-1.2-9152140"},
+            {"unlocked", "yes"},
+            {"partition-size:boot_a", "0x4000000"},
+            {"partition-type:system_a", "ext4"},
+            {"slot-count", "2"},
+        }));
+    }
+    client.disconnect();
+
+    // Handshake, then one packet with a big-endian length
+    CHECK_EQ(server.received(), std::string("FB01") + packet("getvar:all"));
+}
+
+TEST(getvar_returns_the_okay_payload) {
+    FakeFastbootServer server([](int fd, const std::string& command) {
+        if (command == "getvar:product") {
+            reply(fd, "OKAYoriole");
+        } else if (command == "getvar:secure") {
+            reply(fd, "INFOchecking");
+            reply(fd, "OKAY");
+        } else {
+            reply(fd, "FAILGetVar Variable Not found");
+        }
+    });
+
+    fastboot::FastbootClient client;
+    CHECK(client.connect_tcp("127.0.0.1", server.port()));
+    CHECK(client.getvar("product") == std::optional<std::string>("oriole"));
+    CHECK(client.getvar("secure") == std::optional<std::string>(""));
+
+    // FAIL ends the command, not the session
+    CHECK(!client.getvar("nope").has_value());
+    CHECK_EQ(client.last_error(), "Device replied FAIL: GetVar Variable Not found");
+    CHECK(client.getvar("product") == std::optional<std::string>("oriole"));
+}
+
+TEST(unexpected_replies_are_errors) {
+    FakeFastbootServer server([](int fd, const std::string& command) {
+        if (command == "getvar:short") {
+            reply(fd, "OK");
+        } else if (command == "getvar:status") {
+            reply(fd, "DATA00001000");
+        } else {
+            // Length past the status-packet limit
+            std::string header("\x00\x00\x00\x00\x00\x01\x00\x01", 8);
+            net::write_all(fd, header.data(), header.size());
+        }
+    });
+
+    fastboot::FastbootClient client;
+    CHECK(client.connect_tcp("127.0.0.1", server.port()));
+    CHECK(!client.getvar("short").has_value());
+    CHECK_EQ(client.last_error(), "Malformed fastboot response");
+    CHECK(!client.getvar("status").has_value());
+    CHECK_EQ(client.last_error(), "Unexpected fastboot response: DATA");
+    CHECK(!client.getvar("huge").has_value());
+    CHECK_EQ(client.last_error(), "Oversized fastboot packet");
+}
+
+TEST(bad_handshake_is_rejected) {
+    FakeFastbootServer server([](int, const std::string&) {}, "XX01");
+    fastboot::FastbootClient client;
+    CHECK(!client.connect_tcp("127.0.0.1", server.port()));
+    CHECK(!client.is_connected());
+    CHECK_EQ(client.last_error(), "Invalid fastboot handshake");
+    CHECK(!client.getvar("product").has_value());
+    CHECK_EQ(client.last_error(), "Not connected");
+}
+
+TEST(parse_variable_line_forms) {
+    auto parsed = [](std::string_view line) {
+        auto var = fastboot::parse_variable_line(line);
+        return var ? var->name + "=" + var->value : std::string("<none>");
+    };
+    // Device form and fastbootd form
+    CHECK_EQ(parsed("unlocked:yes"), "unlocked=yes");
+    CHECK_EQ(parsed("unlocked: yes"), "unlocked=yes");
+    // fastboot tool form
+    CHECK_EQ(parsed("(bootloader) unlocked: yes"), "unlocked=yes");
+    CHECK_EQ(parsed("  (bootloader)   current-slot:a  "), "current-slot=a");
+    // Partition-scoped names keep their argument
+    CHECK_EQ(parsed("partition-size:boot_a: 0x4000000"), "partition-size:boot_a=0x4000000");
+    CHECK_EQ(parsed("(bootloader) partition-size:userdata: 0x1AC6FFB000"), "partition-size:userdata=0x1AC6FFB000");
+    CHECK_EQ(parsed("partition-type:system_a:ext4"), "partition-type:system_a=ext4");
+    CHECK_EQ(parsed("version-baseband:"), "version-baseband=");
+    // Blank and garbage lines
+    CHECK_EQ(parsed(""), "<none>");
+    CHECK_EQ(parsed("   "), "<none>");
+    CHECK_EQ(parsed("(bootloader)"), "<none>");
+    CHECK_EQ(parsed("garbage without separator"), "<none>");
+    CHECK_EQ(parsed(": value"), "<none>");
+}
+
+TEST(parse_getvar_all_output_keeps_device_lines) {
+    // "fastboot getvar all" writes everything to stderr in this form
+    std::string_view output =
+        "(bootloader) max-download-size:0x10000000\n"
+        "(bootloader) partition-size:boot_a: 0x4000000\n"
+        "(bootloader) partition-type:boot_a:raw\r\n"
+        "\n"
+        "(bootloader) is-userspace:no\n"
+        "(bootloader) garbage\n"
+        "< waiting for any device >\n"
+        "all:\n"
+        "Finished. Total time: 0.120s\n"
+        "(bootloader) unlocked: no";
+    CHECK(same(fastboot::parse_getvar_all_output(output), {
+        {"max-download-size", "0x10000000"},
+        {"partition-size:boot_a", "0x4000000"},
+        {"partition-type:boot_a", "raw"},
+        {"is-userspace", "no"},
+        {"unlocked", "no"},
+    }));
+    CHECK(fastboot::parse_getvar_all_output("").empty());
+    CHECK(fastboot::parse_getvar_all_output("\n\n").empty());
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,208 @@
+// Scan history: queries, torn-append trimming on open and two writers on one directory
+
+#include "check.hpp"
+#include "report/history_store.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Fresh store directory, removed again at the end of the test
+class TempDirectory {
+public:
+    TempDirectory() {
+        char pattern[] = "/tmp/lincheckroot-history-XXXXXX";
+        path_ = mkdtemp(pattern);
+    }
+    ~TempDirectory() { fs::remove_all(path_); }
+
+    const std::string& path() const { return path_; }
+    std::string file(const std::string& name) const { return path_ + "/" + name; }
+
+private:
+    std::string path_;
+};
+
+report::DeviceReport scan(const std::string& serial, int64_t time_ms, long long free_mb,
+                          const std::string& fingerprint = "google/oriole/oriole:14/UQ1A/1:user/release-keys") {
+    report::DeviceReport report;
+    report.serial = serial;
+    report.captured_at_ms = time_ms;
+    DeviceInfo info;
+    info.model = "Pixel 6";
+    info.api_level = 34;
+    info.build_fingerprint = fingerprint;
+    info.storage_total_mb = 128000;
+    info.storage_free_mb = free_mb;
+    info.ram_mb = 8000;
+    report.device = info;
+    return report;
+}
+
+void append_bytes(const std::string& path, const std::string& bytes) {
+    std::ofstream(path, std::ios::binary | std::ios::app) << bytes;
+}
+
+} // namespace
+
+TEST(queries_by_serial_and_time) {
+    TempDirectory dir;
+    report::HistoryStore store(dir.path());
+    CHECK(store.open());
+    CHECK(store.append(scan("AAA", 1000, 50000)));
+    CHECK(store.append(scan("BBB", 1500, 9000)));
+    CHECK(store.append(scan("AAA", 2000, 49000)));
+    CHECK(store.append(scan("AAA", 3000, 48000, "google/oriole/oriole:15/AP3A/2:user/release-keys")));
+    CHECK(!store.append(report::DeviceReport{}));     // no device section
+
+    CHECK_EQ(store.size(), 4u);
+    CHECK(store.serials() == (std::vector<std::string>{"AAA", "BBB"}));
+
+    auto trend = store.storage_trend("AAA", 1500, 3000);
+    CHECK_EQ(trend.size(), 2u);
+    if (trend.size() == 2) {
+        CHECK_EQ(trend[0].time_ms, 2000);
+        CHECK_EQ(trend[0].free_mb, 49000);
+        CHECK_EQ(trend[1].free_mb, 48000);
+        CHECK_EQ(trend[1].total_mb, 128000);
+    }
+    CHECK(store.storage_trend("CCC", 0, 5000).empty());
+
+    auto changes = store.fingerprint_changes(0, 5000);
+    CHECK_EQ(changes.size(), 1u);
+    if (changes.size() == 1) {
+        CHECK_EQ(changes[0].serial, "AAA");
+        CHECK_EQ(changes[0].time_ms, 3000);
+        CHECK_EQ(changes[0].after, "google/oriole/oriole:15/AP3A/2:user/release-keys");
+    }
+    // The change happened before this window
+    CHECK(store.fingerprint_changes(3001, 5000).empty());
+
+    auto latest = store.latest("BBB");
+    CHECK(latest.has_value());
+    if (latest) {
+        CHECK_EQ(latest->captured_at_ms, 1500);
+        CHECK(latest->device.has_value() && latest->device->storage_free_mb == 9000);
+    }
+    CHECK(!store.latest("CCC").has_value());
+}
+
+TEST(reopen_keeps_committed_rows) {
+    TempDirectory dir;
+    {
+        report::HistoryStore store(dir.path());
+        CHECK(store.open());
+        CHECK(store.append(scan("AAA", 1000, 50000)));
+        CHECK(store.append(scan("BBB", 2000, 9000)));
+    }
+    report::HistoryStore store(dir.path());
+    CHECK(store.open());
+    CHECK_EQ(store.size(), 2u);
+    CHECK(store.serials() == (std::vector<std::string>{"AAA", "BBB"}));
+    auto latest = store.latest("AAA");
+    CHECK(latest.has_value() && latest->captured_at_ms == 1000);
+}
+
+TEST(open_trims_a_ragged_column) {
+    TempDirectory dir;
+    {
+        report::HistoryStore store(dir.path());
+        CHECK(store.open());
+        CHECK(store.append(scan("AAA", 1000, 50000)));
+    }
+    // A crash after the first columns of the next row
+    append_bytes(dir.file("time.col"), std::string(8, '\x7f'));
+    append_bytes(dir.file("serial.col"), std::string(4, '\x01'));
+
+    report::HistoryStore store(dir.path());
+    CHECK(store.open());
+    CHECK_EQ(store.size(), 1u);
+    CHECK_EQ(fs::file_size(dir.file("time.col")), 8u);
+    CHECK_EQ(fs::file_size(dir.file("serial.col")), 4u);
+
+    // The next row lands where the torn one started
+    CHECK(store.append(scan("BBB", 2000, 9000)));
+    auto latest = store.latest("BBB");
+    CHECK(latest.has_value() && latest->captured_at_ms == 2000);
+}
+
+TEST(open_drops_a_row_without_its_report) {
+    TempDirectory dir;
+    uintmax_t first_report_end = 0;
+    {
+        report::HistoryStore store(dir.path());
+        CHECK(store.open());
+        CHECK(store.append(scan("AAA", 1000, 50000)));
+        first_report_end = fs::file_size(dir.file("reports.dat"));
+        CHECK(store.append(scan("AAA", 2000, 49000)));
+    }
+    fs::resize_file(dir.file("reports.dat"), fs::file_size(dir.file("reports.dat")) - 1);
+
+    report::HistoryStore store(dir.path());
+    CHECK(store.open());
+    CHECK_EQ(store.size(), 1u);
+    CHECK_EQ(fs::file_size(dir.file("reports.dat")), first_report_end);
+    auto latest = store.latest("AAA");
+    CHECK(latest.has_value() && latest->captured_at_ms == 1000);
+}
+
+TEST(open_cuts_a_torn_string) {
+    TempDirectory dir;
+    {
+        report::HistoryStore store(dir.path());
+        CHECK(store.open());
+        CHECK(store.append(scan("AAA", 1000, 50000)));
+    }
+    // Length 10, three bytes of it written
+    append_bytes(dir.file("strings.dat"), std::string("\x0a" "BBB", 4));
+    {
+        report::HistoryStore store(dir.path());
+        CHECK(store.open());
+        CHECK(store.append(scan("CCC", 2000, 9000)));
+    }
+    report::HistoryStore store(dir.path());
+    CHECK(store.open());
+    CHECK(store.serials() == (std::vector<std::string>{"AAA", "CCC"}));
+    auto latest = store.latest("CCC");
+    CHECK(latest.has_value() && latest->captured_at_ms == 2000);
+}
+
+TEST(two_writers_on_one_directory) {
+    TempDirectory dir;
+    report::HistoryStore gui(dir.path());
+    report::HistoryStore headless(dir.path());
+    CHECK(gui.open());
+    CHECK(headless.open());
+
+    // Both opened an empty store; ids and offsets must still not collide
+    CHECK(gui.append(scan("AAA", 1000, 50000)));
+    CHECK(headless.append(scan("BBB", 2000, 9000)));
+    CHECK(gui.append(scan("AAA", 3000, 48000)));
+    // The writer sees the other's rows once it has appended again
+    CHECK_EQ(gui.size(), 3u);
+
+    report::HistoryStore store(dir.path());
+    CHECK(store.open());
+    CHECK_EQ(store.size(), 3u);
+    CHECK(store.serials() == (std::vector<std::string>{"AAA", "BBB"}));
+    CHECK_EQ(store.storage_trend("AAA", 0, 5000).size(), 2u);
+    CHECK_EQ(store.storage_trend("BBB", 0, 5000).size(), 1u);
+
+    auto bbb = store.latest("BBB");
+    CHECK(bbb.has_value());
+    if (bbb) {
+        CHECK_EQ(bbb->serial, "BBB");
+        CHECK(bbb->device.has_value() && bbb->device->storage_free_mb == 9000);
+    }
+    auto aaa = store.latest("AAA");
+    CHECK(aaa.has_value() && aaa->captured_at_ms == 3000);
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,172 @@
+// Byte scanning and line splitting: every alignment and vector tail, random chunking
+
+#include "check.hpp"
+#include "parse/line_scanner.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Past two 64-byte AVX2 iterations, so every loop and tail is reached
+constexpr size_t MAX_LENGTH = 130;
+
+// Lines as a plain split on '\n' sees them: one trailing '\r' dropped, a
+// last unterminated line kept
+std::vector<std::string> reference_lines(const std::string& text) {
+    std::vector<std::string> lines;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t nl = text.find('\n', start);
+        size_t end = nl == std::string::npos ? text.size() : nl;
+        std::string line = text.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        lines.push_back(line);
+        if (nl == std::string::npos) break;
+        start = nl + 1;
+    }
+    return lines;
+}
+
+// Short lines, blank lines, CRLF, lone CRs and a line longer than a vector
+std::string random_text(std::mt19937& rng, size_t size) {
+    const char alphabet[] = "ab \t\r\n\n\n:=";
+    std::string text;
+    while (text.size() < size) {
+        if (rng() % 16 == 0) {
+            text.append(rng() % 200, 'x');
+        } else {
+            text += alphabet[rng() % (sizeof(alphabet) - 1)];
+        }
+    }
+    return text;
+}
+
+std::vector<std::string> split_in_chunks(const std::string& text, const std::vector<size_t>& cuts) {
+    std::vector<std::string> lines;
+    auto collect = [&](std::string_view line) {
+        lines.emplace_back(line);
+        return true;
+    };
+    parse::LineSplitter splitter;
+    size_t start = 0;
+    for (size_t cut : cuts) {
+        splitter.feed(std::string_view(text).substr(start, cut - start), collect);
+        start = cut;
+    }
+    splitter.feed(std::string_view(text).substr(start), collect);
+    splitter.finish(collect);
+    return lines;
+}
+
+} // namespace
+
+TEST(find_byte_at_every_alignment_and_length) {
+    std::printf("scanner: %s\n", parse::scanner_isa());
+    // Needles just outside [begin, end) catch reads past either bound
+    std::vector<char> buffer(32 + MAX_LENGTH + 32, 'n');
+    size_t failures = 0;
+    for (size_t offset = 0; offset < 32; ++offset) {
+        const char* begin = buffer.data() + offset;
+        for (size_t length = 0; length <= MAX_LENGTH; ++length) {
+            const char* end = begin + length;
+            std::fill(buffer.begin(), buffer.end(), 'n');
+            for (size_t i = 0; i < length; ++i) buffer[offset + i] = 'a';
+            if (parse::find_byte(begin, end, 'n') != end) ++failures;
+
+            // The first hit at each position, with a second one after it
+            for (size_t at = 0; at < length; ++at) {
+                buffer[offset + at] = 'n';
+                if (at + 3 < length) buffer[offset + at + 3] = 'n';
+                if (parse::find_byte(begin, end, 'n') != begin + at) ++failures;
+                buffer[offset + at] = 'a';
+                if (at + 3 < length) buffer[offset + at + 3] = 'a';
+            }
+        }
+    }
+    CHECK_EQ(failures, 0u);
+}
+
+TEST(count_byte_at_every_alignment_and_length) {
+    std::mt19937 rng(26);
+    std::vector<char> buffer(32 + MAX_LENGTH + 32);
+    size_t failures = 0;
+    for (size_t offset = 0; offset < 32; ++offset) {
+        for (size_t length = 0; length <= MAX_LENGTH; ++length) {
+            for (char& c : buffer) c = rng() % 3 == 0 ? '\n' : 'a';
+            const char* begin = buffer.data() + offset;
+            size_t expected = 0;
+            for (size_t i = 0; i < length; ++i) expected += begin[i] == '\n';
+            if (parse::count_byte(begin, begin + length, '\n') != expected) ++failures;
+        }
+    }
+    CHECK_EQ(failures, 0u);
+
+    // All matches, none, and a high-bit needle (signed char compare)
+    std::string all(100, '\n');
+    CHECK_EQ(parse::count_byte(all.data(), all.data() + all.size(), '\n'), 100u);
+    CHECK_EQ(parse::count_byte(all.data(), all.data() + all.size(), 'x'), 0u);
+    std::string high = std::string(70, 'a') + "\xff" + std::string(40, '\xff');
+    CHECK_EQ(parse::count_byte(high.data(), high.data() + high.size(), '\xff'), 41u);
+    CHECK(parse::find_byte(high.data(), high.data() + high.size(), '\xff') == high.data() + 70);
+}
+
+TEST(line_scanner_matches_the_reference) {
+    std::mt19937 rng(1);
+    for (int round = 0; round < 200; ++round) {
+        std::string text = random_text(rng, rng() % 600);
+        std::vector<std::string> lines;
+        parse::for_each_line(text, [&](std::string_view line) { lines.emplace_back(line); });
+        if (lines != reference_lines(text)) {
+            CHECK(lines == reference_lines(text));
+            return;
+        }
+    }
+}
+
+TEST(splitter_with_random_chunking_matches_the_reference) {
+    std::mt19937 rng(2);
+    for (int round = 0; round < 500; ++round) {
+        std::string text = random_text(rng, rng() % 600);
+        std::vector<size_t> cuts;
+        for (size_t at = rng() % 8; at < text.size(); at += rng() % 40) cuts.push_back(at);
+        if (split_in_chunks(text, cuts) != reference_lines(text)) {
+            CHECK(split_in_chunks(text, cuts) == reference_lines(text));
+            return;
+        }
+    }
+}
+
+TEST(splitter_joins_a_crlf_split_across_chunks) {
+    // CR at the end of one chunk, LF at the start of the next
+    CHECK(split_in_chunks("first\r\nsecond\r\n", {6}) == (std::vector<std::string>{"first", "second"}));
+    // A line spread over several chunks, one byte each
+    CHECK(split_in_chunks("ab\r\ncd", {1, 2, 3, 4, 5}) == (std::vector<std::string>{"ab", "cd"}));
+    // Empty chunks change nothing
+    CHECK(split_in_chunks("ab\n\ncd\r", {0, 0, 2, 2, 3}) == (std::vector<std::string>{"ab", "", "cd"}));
+}
+
+TEST(splitter_stops_when_the_callback_does) {
+    parse::LineSplitter splitter;
+    std::vector<std::string> lines;
+    auto until_stop = [&](std::string_view line) {
+        lines.emplace_back(line);
+        return line != "stop";
+    };
+    CHECK(splitter.feed("one\nst", until_stop));
+    CHECK(!splitter.feed("op\nlost\n", until_stop));
+    CHECK(lines == (std::vector<std::string>{"one", "stop"}));
+
+    // The partial line was consumed with the stop; nothing is left over
+    lines.clear();
+    CHECK(splitter.feed("next\n", until_stop));
+    CHECK(splitter.finish(until_stop));
+    CHECK(lines == (std::vector<std::string>{"next"}));
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,121 @@
+// Process hotspots: /proc/<pid>/stat parsing, CPU% and RSS deltas across two ticks
+
+#include "check.hpp"
+#include "analyzer/process_hotspots.hpp"
+
+#include <string>
+#include <vector>
+
+using analyzer::ProcessHotspotAnalyzer;
+
+namespace {
+
+// Two cores; the first tick of "grep '^cpu' /proc/stat; cat /proc/[0-9]*/stat"
+// from a device, after the page size line of the first command
+const std::vector<std::string> FIRST_TICK = {
+    "16384",
+    "cpu  100000 2000 50000 800000 3000 0 1000 0 0 0",
+    "cpu0 50000 1000 25000 400000 1500 0 500 0 0 0",
+    "cpu1 50000 1000 25000 400000 1500 0 500 0 0 0",
+    "1 (init) S 0 0 0 0 -1 4194560 27046 1262374 196 2147 1203 2401 12765 7350 20 0 1 0 30 "
+    "10938789888 1040 18446744073709551615 1 1 0 0 0 0 0 1 1073775864 0 0 0 17 3 0 0 0 0 0 0 0 0 0 0 0 0 0",
+    "1432 (system_server) S 735 735 0 0 -1 1077952832 2836453 0 9472 0 90000 30000 0 0 18 -2 213 0 2800 "
+    "19349725184 98304 18446744073709551615 1 1 0 0 0 0 4612 1 1073775864 0 0 0 17 5 0 0 0 0 0 0 0 0 0 0 0 0 0",
+    "2210 (Jit thread pool) R 1432 735 0 0 -1 1077952576 1120 0 0 0 400 100 0 0 20 0 1 0 3100 "
+    "19349725184 2048 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 1 0 0 0 0 0 0 0 0 0 0 0 0 0",
+    // A name with ") " in it ends at the last ')'
+    "3377 (odd) name) S 1 3377 0 0 -1 4194560 10 0 0 0 10 10 0 0 20 0 1 0 4000 "
+    "1000000 100 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0 0 0 0",
+    "4100 (logcat) S 1 4100 0 0 -1 4194560 10 0 0 0 500 500 0 0 20 0 1 0 5000 "
+    "1000000 200 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0 0 0 0",
+    "5000 (old_service) S 1 5000 0 0 -1 4194560 10 0 0 0 100 100 0 0 20 0 1 0 6000 "
+    "1000000 300 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0 0 0 0",
+};
+
+// 2000 jiffies per core later: logcat has exited, PID 5000 belongs to a new process
+const std::vector<std::string> SECOND_TICK = {
+    "cpu  102000 2000 51000 801000 3000 0 1000 0 0 0",
+    "cpu0 51000 1000 25500 400500 1500 0 500 0 0 0",
+    "cpu1 51000 1000 25500 400500 1500 0 500 0 0 0",
+    "1 (init) S 0 0 0 0 -1 4194560 27046 1262374 196 2147 1203 2401 12765 7350 20 0 1 0 30 "
+    "10938789888 1040 18446744073709551615 1 1 0 0 0 0 0 1 1073775864 0 0 0 17 3 0 0 0 0 0 0 0 0 0 0 0 0 0",
+    "1432 (system_server) S 735 735 0 0 -1 1077952832 2836453 0 9472 0 90700 30300 0 0 18 -2 215 0 2800 "
+    "19349725184 98560 18446744073709551615 1 1 0 0 0 0 4612 1 1073775864 0 0 0 17 5 0 0 0 0 0 0 0 0 0 0 0 0 0",
+    "2210 (Jit thread pool) R 1432 735 0 0 -1 1077952576 1120 0 0 0 2000 500 0 0 20 0 1 0 3100 "
+    "19349725184 1536 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 1 0 0 0 0 0 0 0 0 0 0 0 0 0",
+    "3377 (odd) name) S 1 3377 0 0 -1 4194560 10 0 0 0 30 10 0 0 20 0 1 0 4000 "
+    "1000000 100 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0 0 0 0",
+    "5000 (new_service) S 1 5000 0 0 -1 4194560 10 0 0 0 9000 9000 0 0 20 0 1 0 9000 "
+    "1000000 300 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0 0 0 0",
+};
+
+void tick(ProcessHotspotAnalyzer& sampler, const std::vector<std::string>& lines) {
+    for (const auto& line : lines) sampler.parse_line(line);
+    sampler.finish_tick();
+}
+
+} // namespace
+
+TEST(first_tick_has_no_hotspots) {
+    ProcessHotspotAnalyzer sampler("adb", "emulator-5554", 3);
+    tick(sampler, FIRST_TICK);
+    CHECK_EQ(sampler.process_count(), 6u);
+    CHECK(sampler.get_hotspots().empty());
+}
+
+TEST(second_tick_ranks_by_cpu) {
+    ProcessHotspotAnalyzer sampler("adb", "emulator-5554", 3);
+    tick(sampler, FIRST_TICK);
+    tick(sampler, SECOND_TICK);
+
+    // logcat is gone; the new PID 5000 has no delta yet
+    CHECK_EQ(sampler.process_count(), 5u);
+    const auto& hotspots = sampler.get_hotspots();
+    CHECK_EQ(hotspots.size(), 3u);
+    if (hotspots.size() != 3) return;
+
+    // 2000 jiffies of Jit thread pool over 2000 per core
+    CHECK_EQ(hotspots[0].pid, 2210);
+    CHECK_EQ(hotspots[0].name, "Jit thread pool");
+    CHECK(hotspots[0].cpu_percent > 99.9 && hotspots[0].cpu_percent < 100.1);
+    CHECK_EQ(hotspots[0].state, 'R');
+    CHECK_EQ(hotspots[0].ppid, 1432);
+    CHECK_EQ(hotspots[0].rss_kb, 1536u * 16);
+    CHECK_EQ(hotspots[0].rss_delta_kb, -512 * 16);
+
+    CHECK_EQ(hotspots[1].pid, 1432);
+    CHECK_EQ(hotspots[1].name, "system_server");
+    CHECK(hotspots[1].cpu_percent > 49.9 && hotspots[1].cpu_percent < 50.1);
+    CHECK_EQ(hotspots[1].threads, 215u);
+    CHECK_EQ(hotspots[1].rss_delta_kb, 256 * 16);
+
+    CHECK_EQ(hotspots[2].pid, 3377);
+    CHECK_EQ(hotspots[2].name, "odd) name");
+    CHECK(hotspots[2].cpu_percent > 0.9 && hotspots[2].cpu_percent < 1.1);
+
+    auto table = ProcessHotspotAnalyzer::format_hotspots(hotspots);
+    CHECK(table.find("Jit thread pool") != std::string::npos);
+    CHECK(table.find("+4096") != std::string::npos);
+}
+
+TEST(top_and_ps_output_is_not_a_process) {
+    ProcessHotspotAnalyzer sampler("adb", "emulator-5554", 3);
+    tick(sampler, {
+        // toybox top -b -n 1
+        "Tasks: 812 total,   1 running, 811 sleeping,   0 stopped,   0 zombie",
+        "  Mem:  7634680K total,  7402132K used,   232548K free,    61440K buffers",
+        "800%cpu  12%user   0%nice  15%sys 773%idle   0%iow   0%irq   0%sirq   0%host",
+        "  PID USER         PR  NI VIRT  RES  SHR S[%CPU] %MEM     TIME+ ARGS",
+        " 1432 system       18  -2  18G 384M 262M S 12.3   4.9  45:12.34 system_server",
+        // ps -A -o PID,PPID,NAME and -o PID,ARGS
+        "  PID  PPID NAME",
+        " 4567   735 com.android.chrome",
+        "  612     1 /system/bin/sh (deleted)",
+    });
+    CHECK_EQ(sampler.process_count(), 0u);
+    CHECK(sampler.get_hotspots().empty());
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,238 @@
+// Property snapshots: the on-device hash short-circuit and the PropertyCache around it
+
+#include "check.hpp"
+#include "device/property_snapshot.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using device::PropertySnapshot;
+using LoadResult = PropertySnapshot::LoadResult;
+
+namespace {
+
+constexpr const char* SERIAL = "emulator-5554";
+
+const char* PROPS_V1 =
+    "[ro.build.fingerprint]: [google/sdk_gphone64_x86_64/emu64xa:14/UE1A/1:userdebug/dev-keys]\n"
+    "[ro.build.version.sdk]: [34]\n"
+    "[sys.boot_completed]: [1]\n";
+
+const char* PROPS_V2 =
+    "[ro.build.fingerprint]: [google/sdk_gphone64_x86_64/emu64xa:15/AE3A/2:userdebug/dev-keys]\n"
+    "[ro.build.version.sdk]: [35]\n"
+    "[sys.boot_completed]: [1]\n";
+
+/**
+ * An adb binary that runs the shell command on the host, with a getprop
+ * that prints props.txt; every command is logged. `with_md5sum` = false
+ * shadows md5sum with one that prints nothing, like a device without it.
+ */
+class FakeDevice {
+public:
+    explicit FakeDevice(bool with_md5sum = true) {
+        char pattern[] = "/tmp/lincheckroot-props-XXXXXX";
+        dir_ = mkdtemp(pattern);
+        script("getprop", "cat '" + dir_ + "/props.txt'\n");
+        if (!with_md5sum) script("md5sum", "cat >/dev/null; exit 127\n");
+        // adb -s SERIAL shell COMMAND
+        script("adb", "printf '%s\\n' \"$4\" >> '" + dir_ + "/commands.log'\n"
+                      "PATH='" + dir_ + "':$PATH exec sh -c \"$4\"\n");
+        set_properties(PROPS_V1);
+    }
+    ~FakeDevice() { fs::remove_all(dir_); }
+
+    std::string adb_path() const { return dir_ + "/adb"; }
+    void set_properties(const std::string& text) { std::ofstream(dir_ + "/props.txt") << text; }
+
+    std::vector<std::string> commands() const {
+        std::vector<std::string> lines;
+        std::ifstream log(dir_ + "/commands.log");
+        for (std::string line; std::getline(log, line);) lines.push_back(line);
+        return lines;
+    }
+
+private:
+    std::string dir_;
+
+    void script(const std::string& name, const std::string& body) {
+        std::string path = dir_ + "/" + name;
+        std::ofstream(path) << "#!/bin/sh\n" << body;
+        fs::permissions(path, fs::perms::owner_all);
+    }
+};
+
+bool is_hex32(const std::string& text) {
+    return text.size() == 32 && text.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+
+} // namespace
+
+TEST(first_load_records_the_device_hash) {
+    FakeDevice device;
+    AdbAbstraction adb(device.adb_path());
+
+    PropertySnapshot snapshot;
+    CHECK(snapshot.load_if_changed(adb, SERIAL, "") == LoadResult::LOADED);
+    CHECK_EQ(snapshot.size(), 3u);
+    CHECK(snapshot.get("ro.build.version.sdk") == std::optional<std::string>("34"));
+    CHECK(is_hex32(snapshot.content_hash()));
+    // The hash line is not a property
+    CHECK(!snapshot.has(snapshot.content_hash()));
+
+    auto commands = device.commands();
+    CHECK_EQ(commands.size(), 1u);
+    if (!commands.empty()) CHECK_EQ(commands[0], "getprop | md5sum 2>/dev/null; getprop");
+}
+
+TEST(matching_hash_skips_the_dump) {
+    FakeDevice device;
+    AdbAbstraction adb(device.adb_path());
+
+    PropertySnapshot snapshot;
+    CHECK(snapshot.load(adb, SERIAL));
+    std::string hash = snapshot.content_hash();
+    auto entries = snapshot.entries().size();
+
+    CHECK(snapshot.load_if_changed(adb, SERIAL, hash) == LoadResult::UNCHANGED);
+    // Left exactly as it was
+    CHECK_EQ(snapshot.entries().size(), entries);
+    CHECK_EQ(snapshot.content_hash(), hash);
+    CHECK(snapshot.get("ro.build.version.sdk") == std::optional<std::string>("34"));
+
+    auto commands = device.commands();
+    CHECK_EQ(commands.size(), 2u);
+    if (commands.size() == 2) CHECK(commands[1].find("grep -q '^" + hash + " '") != std::string::npos);
+}
+
+TEST(changed_hash_reloads) {
+    FakeDevice device;
+    AdbAbstraction adb(device.adb_path());
+
+    PropertySnapshot snapshot;
+    CHECK(snapshot.load(adb, SERIAL));
+    std::string old_hash = snapshot.content_hash();
+
+    device.set_properties(PROPS_V2);
+    CHECK(snapshot.load_if_changed(adb, SERIAL, old_hash) == LoadResult::LOADED);
+    CHECK(snapshot.get("ro.build.version.sdk") == std::optional<std::string>("35"));
+    CHECK(is_hex32(snapshot.content_hash()));
+    CHECK(snapshot.content_hash() != old_hash);
+    CHECK_EQ(snapshot.size(), 3u);
+}
+
+TEST(without_md5sum_the_first_line_is_a_property) {
+    FakeDevice device(false);
+    AdbAbstraction adb(device.adb_path());
+
+    PropertySnapshot snapshot;
+    CHECK(snapshot.load_if_changed(adb, SERIAL, "") == LoadResult::LOADED);
+    CHECK_EQ(snapshot.size(), 3u);
+    CHECK(snapshot.get("ro.build.fingerprint").has_value());
+    CHECK(snapshot.content_hash().empty());
+}
+
+TEST(non_hex_known_hash_never_reaches_the_command) {
+    FakeDevice device;
+    AdbAbstraction adb(device.adb_path());
+
+    const std::vector<std::string> bad_hashes = {
+        "x'; touch /tmp/owned; echo '",
+        "D41D8CD98F00B204E9800998ECF8427E",     // md5sum prints lowercase
+        "d41d8cd98f00b204e9800998ecf8427",      // 31 digits
+        "d41d8cd98f00b204e9800998ecf8427e ",
+    };
+    for (const auto& hash : bad_hashes) {
+        PropertySnapshot snapshot;
+        CHECK(snapshot.load_if_changed(adb, SERIAL, hash) == LoadResult::LOADED);
+    }
+    for (const auto& command : device.commands()) {
+        CHECK_EQ(command, "getprop | md5sum 2>/dev/null; getprop");
+    }
+    CHECK_EQ(device.commands().size(), bad_hashes.size());
+}
+
+TEST(empty_reply_is_a_failed_load) {
+    FakeDevice device;
+    device.set_properties("");
+    AdbAbstraction adb(device.adb_path());
+
+    PropertySnapshot snapshot;
+    // The hash of nothing arrives, but no property does
+    CHECK(snapshot.load_if_changed(adb, SERIAL, "") == LoadResult::FAILED);
+    CHECK(snapshot.empty());
+    CHECK(snapshot.content_hash().empty());
+}
+
+TEST(cache_returns_the_same_snapshot_while_unchanged) {
+    FakeDevice device;
+    AdbAbstraction adb(device.adb_path());
+    device::PropertyCache cache(adb);
+
+    auto first = cache.get(SERIAL);
+    CHECK(first != nullptr && first->size() == 3);
+
+    // Within max_age: no round trip at all
+    CHECK(cache.get(SERIAL) == first);
+    CHECK_EQ(device.commands().size(), 1u);
+
+    // Stale: the device is asked, answers with the hash alone
+    auto again = cache.get(SERIAL, std::chrono::milliseconds(0));
+    CHECK(again == first);
+    CHECK_EQ(device.commands().size(), 2u);
+
+    auto stats = cache.stats();
+    CHECK_EQ(stats.loads, 1u);
+    CHECK_EQ(stats.unchanged, 1u);
+}
+
+TEST(cache_reloads_a_changed_device) {
+    FakeDevice device;
+    AdbAbstraction adb(device.adb_path());
+    device::PropertyCache cache(adb);
+
+    auto first = cache.get(SERIAL);
+    device.set_properties(PROPS_V2);
+    auto second = cache.get(SERIAL, std::chrono::milliseconds(0));
+    CHECK(second != nullptr && second != first);
+    if (second) CHECK(second->get("ro.build.version.sdk") == std::optional<std::string>("35"));
+    // Holders of the old snapshot keep theirs
+    if (first) CHECK(first->get("ro.build.version.sdk") == std::optional<std::string>("34"));
+    CHECK_EQ(cache.stats().loads, 2u);
+    CHECK_EQ(cache.stats().unchanged, 0u);
+}
+
+TEST(invalidate_keeps_the_hash) {
+    FakeDevice device;
+    AdbAbstraction adb(device.adb_path());
+    device::PropertyCache cache(adb);
+
+    auto first = cache.get(SERIAL);
+    CHECK(first != nullptr);
+    if (!first) return;
+    cache.invalidate(SERIAL);
+
+    // Checked again despite the default max_age, but still by hash
+    CHECK(cache.get(SERIAL) == first);
+    auto commands = device.commands();
+    CHECK_EQ(commands.size(), 2u);
+    if (commands.size() == 2) {
+        CHECK(commands[1].find("grep -q '^" + first->content_hash() + " '") != std::string::npos);
+    }
+    CHECK_EQ(cache.stats().unchanged, 1u);
+
+    // clear() forgets it: a full load again
+    cache.clear();
+    CHECK(cache.get(SERIAL) != nullptr);
+    commands = device.commands();
+    CHECK(commands.size() == 3 && commands[2] == "getprop | md5sum 2>/dev/null; getprop");
+}
+
+int main() {
+    return test::run_all();
+}
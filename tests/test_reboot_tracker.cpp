@@ -0,0 +1,194 @@
+// Reboot tracking: track-devices parsing and the mode transitions of one reboot
+
+#include "check.hpp"
+#include "fake_adb_server.hpp"
+#include "device/reboot_tracker.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using device::DeviceMode;
+using device::RebootTracker;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr const char* SERIAL = "R58M123ABC";
+
+// One track-devices message: "%04x" + "serial\tstate\n" lines
+std::string device_list(const std::string& state) {
+    std::string body = state.empty() ? "" : std::string(SERIAL) + "\t" + state + "\n";
+    char length[5];
+    std::snprintf(length, sizeof(length), "%04zx", body.size());
+    return length + body;
+}
+
+// Plays host:track-devices: the initial list, then each later list after a pause
+test::FakeAdbServer::Handler track_devices(std::vector<std::string> states) {
+    return [states](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service != "host:track-devices") return peer.fail("unexpected service");
+        peer.okay();
+        for (size_t i = 0; i < states.size(); ++i) {
+            if (i > 0) std::this_thread::sleep_for(30ms);
+            peer.write(device_list(states[i]));
+        }
+        // Stay subscribed until the tracker hangs up
+        peer.read_to_eof();
+    };
+}
+
+/**
+ * A `fastboot` on PATH that lists SERIAL in `state` (empty = no device),
+ * for the fastboot polls of the tracker
+ */
+class FakeFastboot {
+public:
+    explicit FakeFastboot(const std::string& state) {
+        char pattern[] = "/tmp/lincheckroot-fastboot-XXXXXX";
+        dir_ = mkdtemp(pattern);
+        std::string script = dir_ + "/fastboot";
+        std::ofstream(script) << "#!/bin/sh\n"
+                              << (state.empty() ? "" : "printf '" + std::string(SERIAL) + "\\t" + state + "\\n'\n");
+        std::filesystem::permissions(script, std::filesystem::perms::owner_all);
+
+        const char* path = std::getenv("PATH");
+        saved_path_ = path ? path : "";
+        setenv("PATH", (dir_ + ":" + saved_path_).c_str(), 1);
+    }
+    ~FakeFastboot() {
+        setenv("PATH", saved_path_.c_str(), 1);
+        std::filesystem::remove_all(dir_);
+    }
+
+private:
+    std::string dir_;
+    std::string saved_path_;
+};
+
+std::vector<DeviceMode> modes(const device::RebootResult& result) {
+    std::vector<DeviceMode> seen;
+    for (const auto& phase : result.phases) seen.push_back(phase.mode);
+    return seen;
+}
+
+} // namespace
+
+TEST(mode_in_device_list_reads_one_serial) {
+    std::string list = "emulator-5554\tdevice\nR58M123ABC\trecovery\n0123456789ABCDEF\toffline\n";
+    CHECK(RebootTracker::mode_in_device_list(list, "R58M123ABC") == DeviceMode::RECOVERY);
+    CHECK(RebootTracker::mode_in_device_list(list, "emulator-5554") == DeviceMode::SYSTEM);
+    CHECK(RebootTracker::mode_in_device_list(list, "0123456789ABCDEF") == DeviceMode::OFFLINE);
+    CHECK(RebootTracker::mode_in_device_list("R58M123ABC\tunauthorized\r\n", "R58M123ABC") ==
+          DeviceMode::UNAUTHORIZED);
+    CHECK(RebootTracker::mode_in_device_list("R58M123ABC\tsideload\n", "R58M123ABC") == DeviceMode::SIDELOAD);
+
+    // Absent, a serial prefix, an empty list and a line without a state
+    CHECK(RebootTracker::mode_in_device_list(list, "R58M") == DeviceMode::DISCONNECTED);
+    CHECK(RebootTracker::mode_in_device_list("", "R58M123ABC") == DeviceMode::DISCONNECTED);
+    CHECK(RebootTracker::mode_in_device_list("R58M123ABC\n", "R58M123ABC") == DeviceMode::DISCONNECTED);
+}
+
+TEST(target_for_reboot_type) {
+    CHECK(RebootTracker::target_for_reboot_type("") == DeviceMode::SYSTEM);
+    CHECK(RebootTracker::target_for_reboot_type("system") == DeviceMode::SYSTEM);
+    CHECK(RebootTracker::target_for_reboot_type("bootloader") == DeviceMode::BOOTLOADER);
+    CHECK(RebootTracker::target_for_reboot_type("fastboot") == DeviceMode::FASTBOOTD);
+    CHECK(RebootTracker::target_for_reboot_type("recovery") == DeviceMode::RECOVERY);
+    CHECK(RebootTracker::target_for_reboot_type("sideload-auto-reboot") == DeviceMode::SIDELOAD);
+    CHECK(RebootTracker::target_for_reboot_type("download") == DeviceMode::DISCONNECTED);
+}
+
+TEST(system_to_recovery_passes_every_phase) {
+    FakeFastboot fastboot("");
+    test::FakeAdbServer server(track_devices({"device", "offline", "", "recovery"}));
+
+    RebootTracker tracker;
+    auto result = tracker.track(SERIAL, DeviceMode::RECOVERY, 5s).get();
+    CHECK(result.reached);
+    CHECK(!result.unconfirmed);
+    CHECK(!result.timed_out);
+    CHECK(result.final_mode == DeviceMode::RECOVERY);
+    CHECK(modes(result) == (std::vector<DeviceMode>{DeviceMode::SYSTEM, DeviceMode::OFFLINE,
+                                                     DeviceMode::DISCONNECTED, DeviceMode::RECOVERY}));
+    CHECK(result.error.empty());
+}
+
+TEST(reboot_to_system_needs_to_leave_first) {
+    FakeFastboot fastboot("");
+    test::FakeAdbServer server(track_devices({"device", "device", "", "device"}));
+
+    RebootTracker tracker;
+    auto result = tracker.track(SERIAL, DeviceMode::SYSTEM, 5s).get();
+    CHECK(result.reached);
+    CHECK(modes(result) == (std::vector<DeviceMode>{DeviceMode::SYSTEM, DeviceMode::DISCONNECTED,
+                                                     DeviceMode::SYSTEM}));
+}
+
+TEST(bootloader_is_found_by_polling_fastboot) {
+    FakeFastboot fastboot("fastboot");
+    test::FakeAdbServer server(track_devices({"device", ""}));
+
+    RebootTracker tracker;
+    auto result = tracker.track(SERIAL, DeviceMode::BOOTLOADER, 5s).get();
+    CHECK(result.reached);
+    CHECK(result.final_mode == DeviceMode::BOOTLOADER);
+    CHECK(modes(result) == (std::vector<DeviceMode>{DeviceMode::SYSTEM, DeviceMode::DISCONNECTED,
+                                                     DeviceMode::BOOTLOADER}));
+}
+
+TEST(fastbootd_target_accepts_either_fastboot_mode) {
+    FakeFastboot fastboot("fastboot");
+    test::FakeAdbServer server(track_devices({"device", ""}));
+
+    RebootTracker tracker;
+    auto result = tracker.track(SERIAL, DeviceMode::FASTBOOTD, 5s).get();
+    CHECK(result.reached);
+    CHECK(result.final_mode == DeviceMode::BOOTLOADER);
+}
+
+TEST(download_mode_is_unconfirmed) {
+    FakeFastboot fastboot("");
+    test::FakeAdbServer server(track_devices({"device", "offline", ""}));
+
+    RebootTracker tracker;
+    auto result = tracker.track(SERIAL, DeviceMode::DISCONNECTED, 5s).get();
+    CHECK(!result.reached);
+    CHECK(result.unconfirmed);
+    CHECK(!result.timed_out);
+    CHECK(result.final_mode == DeviceMode::DISCONNECTED);
+}
+
+TEST(staying_in_system_times_out) {
+    FakeFastboot fastboot("");
+    test::FakeAdbServer server(track_devices({"device"}));
+
+    RebootTracker tracker;
+    auto result = tracker.track(SERIAL, DeviceMode::RECOVERY, 400ms).get();
+    CHECK(!result.reached);
+    CHECK(result.timed_out);
+    CHECK(result.final_mode == DeviceMode::SYSTEM);
+    CHECK(result.total >= 400ms);
+}
+
+TEST(cancel_ends_the_watch) {
+    FakeFastboot fastboot("");
+    test::FakeAdbServer server(track_devices({"device"}));
+
+    RebootTracker tracker;
+    auto future = tracker.track(SERIAL, DeviceMode::RECOVERY, 5s);
+    tracker.cancel();
+    auto result = future.get();
+    CHECK(!result.reached);
+    CHECK(!result.timed_out);
+    CHECK_EQ(result.error, "Tracking cancelled");
+}
+
+int main() {
+    return test::run_all();
+}
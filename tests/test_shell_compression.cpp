@@ -0,0 +1,152 @@
+// Gzip'd shell output: GzipDecoder and the per-command-class policy
+
+#include "check.hpp"
+#include "adb/shell_compression.hpp"
+
+#include <string>
+
+#ifdef LINECHECK_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+using adb::ShellCompressionPolicy;
+
+namespace {
+
+std::string dumpsys_like() {
+    std::string text;
+    for (int i = 0; text.size() < 200 * 1024; ++i) {
+        text += "  Package [com.example.app" + std::to_string(i) + "] (" + std::to_string(i * 2654435761u) +
+                "):\n    versionCode=" + std::to_string(i % 400) + " minSdk=26 targetSdk=34\n";
+    }
+    return text;
+}
+
+#ifdef LINECHECK_HAVE_ZLIB
+// What `gzip -1` on the device writes: one gzip member
+std::string gzip(std::string_view input) {
+    z_stream stream{};
+    deflateInit2(&stream, 1, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, input.size()) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+#endif
+
+// Inflate `compressed` fed `step` bytes at a time
+bool inflate_all(std::string_view compressed, size_t step, std::string& out, bool& finished) {
+    auto decoder = adb::create_gzip_decoder();
+    for (size_t i = 0; i < compressed.size(); i += step) {
+        if (!decoder->feed(compressed.substr(i, step), [&](std::string_view chunk) {
+                out.append(chunk.data(), chunk.size());
+                return true;
+            })) {
+            return false;
+        }
+    }
+    finished = decoder->finished();
+    return true;
+}
+
+} // namespace
+
+#ifdef LINECHECK_HAVE_ZLIB
+
+TEST(gzip_member_inflates_in_any_piece_size) {
+    std::string original = dumpsys_like();
+    std::string compressed = gzip(original);
+    for (size_t step : {size_t{1}, size_t{3}, size_t{1000}, compressed.size()}) {
+        std::string out;
+        bool finished = false;
+        CHECK(inflate_all(compressed, step, out, finished));
+        CHECK(finished);
+        CHECK(out == original);
+    }
+}
+
+TEST(back_to_back_members_are_one_stream) {
+    std::string compressed = gzip("first\n") + gzip("") + gzip("second\n");
+    std::string out;
+    bool finished = false;
+    CHECK(inflate_all(compressed, compressed.size(), out, finished));
+    CHECK(finished);
+    CHECK_EQ(out, "first\nsecond\n");
+}
+
+TEST(truncated_output_is_not_finished) {
+    std::string compressed = gzip(dumpsys_like());
+    compressed.resize(compressed.size() - 4);     // part of the trailer (ISIZE)
+    std::string out;
+    bool finished = true;
+    CHECK(inflate_all(compressed, 4096, out, finished));
+    CHECK(!finished);
+}
+
+TEST(plain_text_is_rejected) {
+    // What arrives when the device has no gzip: the shell's complaint
+    std::string out;
+    bool finished = false;
+    CHECK(!inflate_all("/system/bin/sh: gzip: inaccessible or not found\n", 64, out, finished));
+}
+
+TEST(sink_stop_ends_the_feed) {
+    std::string compressed = gzip(dumpsys_like());
+    auto decoder = adb::create_gzip_decoder();
+    int calls = 0;
+    CHECK(!decoder->feed(compressed, [&](std::string_view) { ++calls; return false; }));
+    CHECK_EQ(calls, 1);
+}
+
+#else
+
+TEST(decoder_needs_zlib) {
+    CHECK(adb::create_gzip_decoder() == nullptr);
+}
+
+#endif
+
+TEST(gzip_command_keeps_the_command_status) {
+    CHECK_EQ(adb::gzip_command("logcat -d"),
+             "(set -o pipefail) 2>/dev/null && set -o pipefail; (logcat -d) | gzip -1");
+}
+
+TEST(command_class_is_program_and_first_argument) {
+    CHECK_EQ(ShellCompressionPolicy::command_class("dumpsys package com.example"), "dumpsys package");
+    CHECK_EQ(ShellCompressionPolicy::command_class("pm list packages -f"), "pm list");
+    CHECK_EQ(ShellCompressionPolicy::command_class("logcat -d"), "logcat");
+    CHECK_EQ(ShellCompressionPolicy::command_class("(ps -A || ps) 2>/dev/null"), "ps");
+    CHECK_EQ(ShellCompressionPolicy::command_class("cat /proc/mounts;ls"), "cat /proc/mounts");
+    CHECK_EQ(ShellCompressionPolicy::command_class("  "), "");
+}
+
+TEST(policy_follows_the_last_output_size) {
+    ShellCompressionPolicy policy(1000);
+    CHECK(!policy.should_compress("logcat"));
+
+    policy.record_plain("logcat", 5000, 40);
+    CHECK(policy.should_compress("logcat"));
+    CHECK(!policy.should_compress("pm list"));
+
+    policy.record_gzip("logcat", 800, 100, 10);
+    CHECK(!policy.should_compress("logcat"));
+
+    policy.record_plain("logcat", 1000, 8);
+    policy.set_threshold(0);
+    CHECK(!policy.should_compress("logcat"));
+
+    auto stats = policy.stats().at("logcat");
+    CHECK_EQ(stats.plain_runs, 2u);
+    CHECK_EQ(stats.gzip_runs, 1u);
+    CHECK_EQ(stats.bytes_saved(), 700u);
+    CHECK_EQ(stats.plain_mean_ms(), 24.0);
+}
+
+int main() {
+    return test::run_all();
+}
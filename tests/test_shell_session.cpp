@@ -0,0 +1,129 @@
+// Persistent shell: end-marker framing, exit codes, early stop and recovery after a timeout
+
+#include "check.hpp"
+#include "adb/shell_session.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using adb::ShellSession;
+
+namespace {
+
+constexpr const char* SERIAL = "emulator-5554";
+
+// An adb binary whose "shell" is a host sh reading commands from stdin
+class FakeAdb {
+public:
+    FakeAdb() {
+        char pattern[] = "/tmp/lincheckroot-shell-XXXXXX";
+        dir_ = mkdtemp(pattern);
+        std::ofstream(path()) << "#!/bin/sh\nexec sh\n";
+        std::filesystem::permissions(path(), std::filesystem::perms::owner_all);
+    }
+    ~FakeAdb() { std::filesystem::remove_all(dir_); }
+
+    std::string path() const { return dir_ + "/adb"; }
+
+private:
+    std::string dir_;
+};
+
+std::vector<std::string> lines_of(ShellSession& session, const std::string& command,
+                                  std::optional<int>* exit_code = nullptr) {
+    std::vector<std::string> lines;
+    auto code = session.run_lines(command, [&](std::string_view line) {
+        lines.emplace_back(line);
+        return true;
+    }, 5000);
+    if (exit_code) *exit_code = code;
+    return lines;
+}
+
+} // namespace
+
+TEST(marker_ends_each_command) {
+    FakeAdb adb;
+    ShellSession session(adb.path(), SERIAL);
+
+    std::optional<int> code;
+    CHECK(lines_of(session, "echo one; echo two", &code) == (std::vector<std::string>{"one", "two"}));
+    CHECK(code == std::optional<int>(0));
+
+    // No final newline: the marker still starts on its own line
+    CHECK(lines_of(session, "printf abc", &code) == std::vector<std::string>{"abc"});
+
+    // Blank lines the command printed are kept; only the one added before the marker goes
+    CHECK(lines_of(session, "printf 'a\\n\\n'") == (std::vector<std::string>{"a", ""}));
+    CHECK(lines_of(session, "printf '\\n'") == std::vector<std::string>{""});
+    CHECK(lines_of(session, "true").empty());
+
+    // Exit status of the command, not of the shell
+    lines_of(session, "false", &code);
+    CHECK(code == std::optional<int>(1));
+    lines_of(session, "sh -c 'exit 42'", &code);
+    CHECK(code == std::optional<int>(42));
+    CHECK(session.is_open());
+}
+
+TEST(other_markers_are_ordinary_output) {
+    FakeAdb adb;
+    ShellSession session(adb.path(), SERIAL);
+    lines_of(session, "true");
+
+    // This is command 2: markers of 1 and 10 must not end it
+    std::optional<int> code;
+    auto lines = lines_of(session, "echo __LCR_END_1__ 7; echo __LCR_END_10__ 8; echo ' __LCR_END_2__ 9'", &code);
+    CHECK(lines == (std::vector<std::string>{"__LCR_END_1__ 7", "__LCR_END_10__ 8", " __LCR_END_2__ 9"}));
+    CHECK(code == std::optional<int>(0));
+}
+
+TEST(large_output_spans_many_reads) {
+    FakeAdb adb;
+    ShellSession session(adb.path(), SERIAL);
+    auto lines = lines_of(session, "seq 1 50000");
+    CHECK_EQ(lines.size(), 50000u);
+    if (!lines.empty()) CHECK_EQ(lines.back(), "50000");
+
+    auto result = session.run("seq 1 3");
+    CHECK(result.has_value() && result->output == "1\n2\n3\n" && result->exit_code == 0);
+}
+
+TEST(stopping_early_keeps_the_session_in_sync) {
+    FakeAdb adb;
+    ShellSession session(adb.path(), SERIAL);
+    std::vector<std::string> lines;
+    auto code = session.run_lines("seq 1 1000; (exit 5)", [&](std::string_view line) {
+        lines.emplace_back(line);
+        return lines.size() < 3;
+    });
+    CHECK_EQ(lines.size(), 3u);
+    CHECK(code == std::optional<int>(5));
+    CHECK(lines_of(session, "echo next") == std::vector<std::string>{"next"});
+}
+
+TEST(timeout_closes_and_the_next_command_reopens) {
+    FakeAdb adb;
+    ShellSession session(adb.path(), SERIAL);
+    CHECK(!session.run_lines("printf 'half a li'; sleep 2", [](std::string_view) { return true; }, 200));
+    CHECK(!session.is_open());
+
+    // A new shell, and nothing left over from the cut-off line
+    std::optional<int> code;
+    CHECK(lines_of(session, "echo fresh", &code) == std::vector<std::string>{"fresh"});
+    CHECK(code == std::optional<int>(0));
+}
+
+TEST(missing_adb_fails_cleanly) {
+    ShellSession session("/nonexistent/adb", SERIAL);
+    CHECK(!session.run("echo hi", 1000).has_value());
+    CHECK(!session.is_open());
+}
+
+int main() {
+    return test::run_all();
+}
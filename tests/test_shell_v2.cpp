@@ -0,0 +1,150 @@
+// Shell protocol v2: packet framing and ShellV2Client against a scripted server
+
+#include "check.hpp"
+#include "fake_adb_server.hpp"
+#include "adb/shell_v2.hpp"
+#include "adb_abstraction.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using adb::ShellPacketParser;
+using Packets = std::vector<std::pair<uint8_t, std::string>>;
+
+namespace {
+
+std::string packet(uint8_t id, std::string_view payload) {
+    return std::string(1, static_cast<char>(id)) + test::le32(static_cast<uint32_t>(payload.size())) +
+           std::string(payload);
+}
+
+// Feed `stream` in pieces of `step` bytes and collect every packet
+Packets parse(std::string_view stream, size_t step) {
+    ShellPacketParser parser;
+    Packets packets;
+    for (size_t i = 0; i < stream.size(); i += step) {
+        bool ok = parser.feed(stream.substr(i, step), [&](uint8_t id, std::string_view payload) {
+            packets.emplace_back(id, std::string(payload));
+            return true;
+        });
+        CHECK(ok);
+    }
+    return packets;
+}
+
+} // namespace
+
+TEST(encode_writes_id_and_le32_length) {
+    CHECK_EQ(ShellPacketParser::encode(ShellPacketParser::ID_STDIN, "abc"), std::string("\x00\x03\x00\x00\x00" "abc", 8));
+    CHECK_EQ(ShellPacketParser::encode(ShellPacketParser::ID_CLOSE_STDIN, {}), std::string("\x04\x00\x00\x00\x00", 5));
+
+    std::string large(0x10203, 'x');
+    std::string encoded = ShellPacketParser::encode(ShellPacketParser::ID_STDOUT, large);
+    CHECK_EQ(encoded.substr(0, 5), std::string("\x01\x03\x02\x01\x00", 5));
+    CHECK_EQ(encoded.size(), large.size() + 5);
+}
+
+TEST(packets_split_at_every_byte_boundary) {
+    std::string stream = packet(ShellPacketParser::ID_STDOUT, "hello\n") +
+                         packet(ShellPacketParser::ID_STDERR, "") +
+                         packet(ShellPacketParser::ID_STDERR, "warning\n") +
+                         packet(ShellPacketParser::ID_EXIT, std::string(1, '\x7f'));
+    Packets expected = {
+        {ShellPacketParser::ID_STDOUT, "hello\n"},
+        {ShellPacketParser::ID_STDERR, ""},
+        {ShellPacketParser::ID_STDERR, "warning\n"},
+        {ShellPacketParser::ID_EXIT, "\x7f"},
+    };
+
+    for (size_t step = 1; step <= stream.size(); ++step) {
+        CHECK(parse(stream, step) == expected);
+    }
+}
+
+TEST(incomplete_packet_waits_for_more_data) {
+    ShellPacketParser parser;
+    int calls = 0;
+    auto count = [&](uint8_t, std::string_view) { ++calls; return true; };
+
+    std::string stream = packet(ShellPacketParser::ID_STDOUT, "0123456789");
+    CHECK(parser.feed(stream.substr(0, 4), count));
+    CHECK(parser.feed(stream.substr(4, 8), count));
+    CHECK_EQ(calls, 0);
+    CHECK(parser.feed(stream.substr(12), count));
+    CHECK_EQ(calls, 1);
+}
+
+TEST(callback_stop_ends_the_feed) {
+    ShellPacketParser parser;
+    std::string stream = packet(ShellPacketParser::ID_STDOUT, "a") + packet(ShellPacketParser::ID_STDOUT, "b");
+    int calls = 0;
+    CHECK(!parser.feed(stream, [&](uint8_t, std::string_view) { ++calls; return false; }));
+    CHECK_EQ(calls, 1);
+
+    // Nothing of the abandoned read is replayed
+    CHECK(parser.feed({}, [&](uint8_t, std::string_view) { ++calls; return true; }));
+    CHECK_EQ(calls, 1);
+}
+
+TEST(client_separates_streams_and_reads_exit_status) {
+    std::string stdin_seen;
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service != "shell,v2,raw:id -u") return peer.fail("unexpected service");
+        peer.okay();
+        peer.read_exact(stdin_seen, 5);
+        std::string reply = packet(ShellPacketParser::ID_STDOUT, "2000\n") +
+                            packet(ShellPacketParser::ID_STDERR, "note\n") +
+                            packet(ShellPacketParser::ID_EXIT, "\x03");
+        // Split inside a header, as a short socket read would
+        peer.write(reply.substr(0, 3));
+        peer.write(reply.substr(3));
+    });
+
+    adb::ShellV2Client client("emulator-5554");
+    auto result = client.run("id -u", 2000);
+    CHECK(result.has_value());
+    if (result) {
+        CHECK_EQ(result->out, "2000\n");
+        CHECK_EQ(result->err, "note\n");
+        CHECK_EQ(result->exit_code, 3);
+        CHECK(result->protocol_v2);
+    }
+    CHECK_EQ(stdin_seen, ShellPacketParser::encode(ShellPacketParser::ID_CLOSE_STDIN, {}));
+}
+
+TEST(client_falls_back_to_legacy_shell) {
+    test::FakeAdbServer server([](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service.rfind("shell,v2", 0) == 0) return peer.fail("closed");
+        peer.okay();
+        // PTY output: CRLF line ends, then the exit status marker line
+        peer.write("line 1\r\nline 2\r\n\r\n\x1f__lcr_exit:1\r\n");
+    });
+
+    adb::ShellV2Client client("emulator-5554");
+    auto result = client.run("cat /missing", 2000);
+    CHECK(result.has_value());
+    if (result) {
+        CHECK_EQ(result->out, "line 1\nline 2\n");
+        CHECK_EQ(result->exit_code, 1);
+        CHECK(!result->protocol_v2);
+    }
+    CHECK(!client.uses_v2());
+
+    auto services = server.services();
+    CHECK_EQ(services.size(), 2u);
+    if (services.size() == 2) {
+        CHECK_EQ(services[1], "shell:(cat /missing); printf '\\n%s%d\\n' '\x1f__lcr_exit:' $?");
+    }
+}
+
+TEST(shell_quote_survives_single_quotes) {
+    CHECK_EQ(AdbAbstraction::shell_quote("/data/adb/magisk"), "'/data/adb/magisk'");
+    CHECK_EQ(AdbAbstraction::shell_quote("it's"), "'it'\\''s'");
+    CHECK_EQ(AdbAbstraction::shell_quote(""), "''");
+    CHECK_EQ(AdbAbstraction::shell_quote("$HOME `id`"), "'$HOME `id`'");
+}
+
+int main() {
+    return test::run_all();
+}
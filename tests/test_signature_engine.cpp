@@ -0,0 +1,139 @@
+// Signature engine: loading the data file, matching a capture, evidence in file order
+
+#include "check.hpp"
+#include "analyzer/signature_engine.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using analyzer::SignatureEngine;
+using analyzer::SignatureMatch;
+
+namespace {
+
+// data/root_signatures.json, passed in by ctest
+const char* signatures_file = nullptr;
+
+const char* SMALL_DB = R"({
+  "probe_paths": ["/data/adb/ksu", "/data/adb/it's"],
+  "list_dirs": ["/data/adb/modules"],
+  "signatures": [
+    { "id": "kernelsu", "name": "KernelSU", "category": "root",
+      "patterns": ["/data/adb/ksu", "me.weishu.kernelsu"] },
+    { "id": "nopatterns", "patterns": [] },
+    { "name": "no id", "patterns": ["anything"] },
+    { "id": "zygisk", "category": "hooking", "patterns": ["zygiskd", "ZYGISK_NEXT"] }
+  ]
+})";
+
+std::vector<std::string> ids(const std::vector<SignatureMatch>& matches) {
+    std::vector<std::string> result;
+    for (const auto& match : matches) result.push_back(match.id);
+    return result;
+}
+
+} // namespace
+
+TEST(load_keeps_usable_signatures_only) {
+    SignatureEngine engine;
+    CHECK(!engine.is_loaded());
+    CHECK(engine.match("/data/adb/ksu").empty());
+
+    CHECK(engine.load_json(SMALL_DB));
+    CHECK_EQ(engine.signature_count(), 2u);
+    CHECK_EQ(engine.signatures()[1].id, "zygisk");
+    // name defaults to the id, category to "root"
+    CHECK_EQ(engine.signatures()[1].name, "zygisk");
+    CHECK_EQ(engine.signatures()[0].category, "root");
+    CHECK_EQ(engine.signatures()[1].category, "hooking");
+}
+
+TEST(bad_input_changes_nothing) {
+    SignatureEngine engine;
+    CHECK(engine.load_json(SMALL_DB));
+
+    CHECK(!engine.load_json("{ not json"));
+    CHECK(!engine.load_json(R"({"probe_paths": ["/x"]})"));
+    CHECK(!engine.load_json(R"({"signatures": [{"id": "x", "patterns": [1]}]})"));
+    CHECK(!engine.load_file("/nonexistent/root_signatures.json"));
+
+    CHECK_EQ(engine.signature_count(), 2u);
+    CHECK(ids(engine.match("zygiskd")) == std::vector<std::string>{"zygisk"});
+    CHECK(engine.capture_command().find("/data/adb/modules") != std::string::npos);
+}
+
+TEST(match_reports_evidence_in_file_order) {
+    SignatureEngine engine;
+    CHECK(engine.load_json(SMALL_DB));
+
+    // Later patterns seen first, case folded, one signature reported once
+    auto matches = engine.match(
+        "root 612 zygisk_next\n"
+        "u0_a123 4567 me.weishu.kernelsu\n"
+        "/data/adb/ksud\n"
+        "root 613 zygiskd\n");
+    CHECK(ids(matches) == (std::vector<std::string>{"kernelsu", "zygisk"}));
+    if (matches.size() != 2) return;
+    CHECK_EQ(matches[0].name, "KernelSU");
+    CHECK(matches[0].evidence == (std::vector<std::string>{"/data/adb/ksu", "me.weishu.kernelsu"}));
+    CHECK(matches[1].evidence == (std::vector<std::string>{"zygiskd", "ZYGISK_NEXT"}));
+
+    CHECK(engine.match("").empty());
+    CHECK(engine.match("/data/adb/ks\nzygisk\n").empty());
+}
+
+TEST(capture_command_quotes_every_path) {
+    SignatureEngine engine;
+    CHECK(engine.load_json(SMALL_DB));
+    CHECK_EQ(engine.capture_command(),
+             "ls -d '/data/adb/ksu' '/data/adb/it'\\''s' 2>/dev/null; "
+             "ls -a '/data/adb/modules' 2>/dev/null; "
+             "cat /proc/mounts 2>/dev/null; ps -A 2>/dev/null || ps");
+}
+
+TEST(shipped_signature_file) {
+    if (!signatures_file) return;
+    SignatureEngine engine;
+    CHECK(engine.load_file(signatures_file));
+    CHECK(engine.signature_count() >= 10);
+
+    // Every pattern of every signature finds its own signature
+    size_t missed = 0;
+    for (const auto& signature : engine.signatures()) {
+        for (const auto& pattern : signature.patterns) {
+            auto found = ids(engine.match(pattern));
+            if (std::find(found.begin(), found.end(), signature.id) == found.end()) ++missed;
+        }
+    }
+    CHECK_EQ(missed, 0u);
+
+    // A capture from a stock device: mounts and processes that must not match anything
+    auto stock = engine.match(
+        "/dev/block/dm-4 / ext4 ro,seclabel,relatime 0 0\n"
+        "tmpfs /dev tmpfs rw,seclabel,nosuid,relatime,mode=755 0 0\n"
+        "/dev/block/by-name/userdata /data f2fs rw,lazytime,seclabel,nosuid,nodev 0 0\n"
+        "root 1 init\n"
+        "root 512 ueventd\n"
+        "system 1432 system_server\n"
+        "u0_a88 4567 com.google.android.gms.persistent\n"
+        "shell 9001 ps\n");
+    CHECK(stock.empty());
+
+    // A rooted one
+    auto rooted = engine.match(
+        "/data/adb/ksu\n"
+        "/data/adb/modules:\n"
+        ".\n..\nzygisksu\nshamiko\ntricky_store\n"
+        "root 701 ksud\n"
+        "root 702 zygiskd64\n");
+    auto found = ids(rooted);
+    for (const char* id : {"kernelsu", "zygisk", "shamiko", "trickystore"}) {
+        CHECK(std::find(found.begin(), found.end(), id) != found.end());
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) signatures_file = argv[1];
+    return test::run_all();
+}
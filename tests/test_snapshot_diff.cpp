@@ -0,0 +1,194 @@
+// Snapshot diff: id merge on a shared pool against string merge across pools, build key filter
+
+#include "check.hpp"
+#include "report/snapshot_diff.hpp"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using device::PropertySnapshot;
+using device::StringPool;
+using report::Change;
+
+namespace {
+
+const char* BEFORE =
+    "[ro.build.fingerprint]: [google/panther/panther:14/UQ1A.240205.004/1:user/release-keys]\n"
+    "[ro.build.version.security_patch]: [2024-02-05]\n"
+    "[ro.serialno]: [28021FDH2001AB]\n"
+    "[sys.boot_completed]: [1]\n"
+    "[persist.sys.timezone]: [Europe/Berlin]\n";
+
+const char* AFTER =
+    "[ro.build.fingerprint]: [google/panther/panther:14/UQ1A.240305.002/2:user/release-keys]\n"
+    "[ro.build.version.security_patch]: [2024-03-05]\n"
+    "[ro.serialno]: [28021FDH2001AB]\n"
+    "[sys.boot_completed]: [1]\n"
+    "[dev.bootcomplete]: [1]\n";
+
+PropertySnapshot parsed(std::string_view text, std::shared_ptr<StringPool> pool) {
+    PropertySnapshot snapshot(std::move(pool));
+    snapshot.parse(text);
+    return snapshot;
+}
+
+bool same(const std::vector<Change>& a, const std::vector<Change>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].kind != b[i].kind || a[i].key != b[i].key || a[i].before != b[i].before ||
+            a[i].after != b[i].after) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// getprop output over a small key space, so keys are often shared and values often equal
+std::string random_props(std::mt19937& rng) {
+    std::string text;
+    for (int key = 0; key < 40; ++key) {
+        if (rng() % 3 == 0) continue;
+        text += "[k" + std::to_string((key * 7919) % 40) + "]: [v" + std::to_string(rng() % 3) + "]\n";
+    }
+    return text;
+}
+
+} // namespace
+
+TEST(shared_pool_and_separate_pools_agree) {
+    auto pool = std::make_shared<StringPool>();
+    auto before = parsed(BEFORE, pool);
+    auto after = parsed(AFTER, pool);
+    auto by_id = report::diff_properties(before, after);
+
+    // Alphabetical, although dev.bootcomplete was interned last
+    CHECK(same(by_id, {
+        {Change::Kind::ADDED, "dev.bootcomplete", "", "1"},
+        {Change::Kind::REMOVED, "persist.sys.timezone", "Europe/Berlin", ""},
+        {Change::Kind::CHANGED, "ro.build.fingerprint",
+         "google/panther/panther:14/UQ1A.240205.004/1:user/release-keys",
+         "google/panther/panther:14/UQ1A.240305.002/2:user/release-keys"},
+        {Change::Kind::CHANGED, "ro.build.version.security_patch", "2024-02-05", "2024-03-05"},
+    }));
+
+    auto by_string = report::diff_properties(parsed(BEFORE, std::make_shared<StringPool>()),
+                                             parsed(AFTER, std::make_shared<StringPool>()));
+    CHECK(same(by_id, by_string));
+
+    // The filter sees every key that differs, on both paths
+    auto build_only = report::diff_properties(before, after, report::is_build_key);
+    CHECK_EQ(build_only.size(), 2u);
+    CHECK(same(build_only, report::diff_properties(PropertySnapshot(before, std::make_shared<StringPool>()),
+                                                   after, report::is_build_key)));
+
+    CHECK(report::diff_properties(before, before).empty());
+    CHECK(report::diff_properties(before, PropertySnapshot(before, std::make_shared<StringPool>())).empty());
+}
+
+TEST(random_snapshots_agree_across_pools) {
+    std::mt19937 rng(39);
+    for (int round = 0; round < 200; ++round) {
+        std::string old_text = random_props(rng);
+        std::string new_text = random_props(rng);
+
+        auto pool = std::make_shared<StringPool>();
+        // Strings interned in an order unrelated to either snapshot
+        parsed(random_props(rng), pool);
+        auto by_id = report::diff_properties(parsed(old_text, pool), parsed(new_text, pool));
+        auto by_string = report::diff_properties(parsed(old_text, std::make_shared<StringPool>()),
+                                                 parsed(new_text, std::make_shared<StringPool>()));
+        if (!same(by_id, by_string)) {
+            CHECK(same(by_id, by_string));
+            return;
+        }
+        for (size_t i = 1; i < by_id.size(); ++i) {
+            if (!(by_id[i - 1].key < by_id[i].key)) {
+                CHECK(by_id[i - 1].key < by_id[i].key);
+                return;
+            }
+        }
+    }
+}
+
+TEST(report_fields_diff_by_section) {
+    report::DeviceReport before;
+    before.serial = "R58M123ABC";
+    DeviceInfo device;
+    device.model = "SM-G973F";
+    device.storage_free_mb = 1000;
+    before.device = device;
+    report::AnalyzerResults analyzers;
+    analyzers.selinux_status = "Enforcing";
+    before.analyzers = analyzers;
+
+    report::DeviceReport after = before;
+    after.captured_at_ms = 1718000000123;       // not a field
+    after.device->storage_free_mb = 900;
+    after.analyzers.reset();
+    RomInfo rom{};
+    rom.codename = "beyond1lte";
+    after.rom = rom;
+
+    auto changes = report::diff_reports(before, after);
+    size_t added = 0, removed = 0, changed = 0;
+    for (const auto& change : changes) {
+        if (change.kind == Change::Kind::ADDED) {
+            ++added;
+            CHECK(change.key.rfind("rom.", 0) == 0);
+        } else if (change.kind == Change::Kind::REMOVED) {
+            ++removed;
+            CHECK(change.key.rfind("analyzers.", 0) == 0);
+        } else {
+            ++changed;
+            CHECK_EQ(change.key, "device.storage_free_mb");
+            CHECK_EQ(change.before, "1000");
+            CHECK_EQ(change.after, "900");
+        }
+    }
+    CHECK(added > 0);
+    CHECK(removed > 0);
+    CHECK_EQ(changed, 1u);
+    CHECK(report::diff_reports(before, before).empty());
+
+    auto device_only = report::diff_reports(before, after, [](std::string_view key) {
+        return key.substr(0, 7) == "device.";
+    });
+    CHECK_EQ(device_only.size(), 1u);
+}
+
+TEST(build_keys_include_and_exclude) {
+    for (const char* key : {"ro.build.fingerprint", "ro.build.version.incremental", "ro.vendor.build.fingerprint",
+                            "ro.system.build.date.utc", "ro.bootimage.build.fingerprint",
+                            "ro.vendor.build.security_patch", "ro.product.fingerprint",
+                            "ro.bootloader", "ro.baseband", "ro.boot.verifiedbootstate",
+                            "ro.boot.vbmeta.digest", "ro.kernel.version"}) {
+        if (!report::is_build_key(key)) CHECK_EQ(std::string(key), "a build key");
+    }
+
+    // Per-unit values, runtime state and keys outside ro.* never count
+    for (const char* key : {"ro.serialno", "ro.boot.serialno", "ro.build.serialno",
+                            "ro.boottime.init", "ro.boottime.build.x", "ro.runtime.firstboot",
+                            "ro.runtime.build.fingerprint", "ro.product.model", "ro.boot.hardware",
+                            "ro.boot.vbmeta_state", "ro.builder", "persist.sys.fingerprint",
+                            "sys.build.fingerprint", "build.fingerprint", ""}) {
+        if (report::is_build_key(key)) CHECK_EQ(std::string(key), "not a build key");
+    }
+}
+
+TEST(format_changes_caps_the_lines) {
+    std::vector<Change> changes = {
+        {Change::Kind::ADDED, "a", "", "1"},
+        {Change::Kind::REMOVED, "b", "2", ""},
+        {Change::Kind::CHANGED, "c", "3", "4"},
+    };
+    CHECK_EQ(report::format_changes(changes), "+ a = 1\n- b (was 2)\n~ c: 3 -> 4\n");
+    CHECK_EQ(report::format_changes(changes, 1), "+ a = 1\n... 2 more\n");
+    CHECK_EQ(report::format_changes(changes, 3), "+ a = 1\n- b (was 2)\n~ c: 3 -> 4\n");
+    CHECK_EQ(report::format_changes({}), "");
+}
+
+int main() {
+    return test::run_all();
+}
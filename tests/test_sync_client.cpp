@@ -0,0 +1,511 @@
+// Sync service: stat_v2/ls_v2 record decoding, pipelining, the v1 fallback and file pulls
+
+#include "check.hpp"
+#include "fake_adb_server.hpp"
+#include "adb/sync_client.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+
+using test::le32;
+using test::le64;
+
+namespace {
+
+struct DeviceFile {
+    uint32_t error = 0;
+    uint32_t mode = 0;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint32_t uid = 0;
+    uint32_t gid = 0;
+    uint64_t ino = 0;
+    uint32_t nlink = 0;
+};
+
+// struct sync_stat_v2 after the id: error, dev, ino, mode, nlink, uid, gid,
+// size, atime, mtime, ctime
+std::string stat_v2_body(const DeviceFile& file) {
+    return le32(file.error) + le64(0xdeadbeef) + le64(file.ino) + le32(file.mode) + le32(file.nlink) +
+           le32(file.uid) + le32(file.gid) + le64(file.size) + le64(1) +
+           le64(static_cast<uint64_t>(file.mtime)) + le64(2);
+}
+
+// struct sync_stat / sync_dent (v1) after the id: mode, size, mtime
+std::string stat_v1_body(const DeviceFile& file) {
+    return le32(file.mode) + le32(static_cast<uint32_t>(file.size)) + le32(static_cast<uint32_t>(file.mtime));
+}
+
+const std::map<std::string, DeviceFile> FILES = {
+    {"/system/bin/sh", {0, 0100755, 315848, 1230768000, 0, 2000, 1234567890123ULL, 1}},
+    {"/data/adb", {0, 040700, 3452, 1700000000, 0, 0, 42, 5}},
+    {"/data/adb/magisk.db", {0, 0100600, 1ULL << 33, 1700000001, 0, 0, 43, 1}},
+    {"/sbin/su", {2, 0, 0, 0, 0, 0, 0, 0}},         // ENOENT
+};
+
+const std::map<std::string, std::vector<std::string>> DIRECTORIES = {
+    {"/data/adb", {".", "..", "magisk.db"}},
+};
+
+// Device side of "sync:"; records every request id/path and answers in order.
+// `v2` = false plays an adbd that rejects STA2/LST2/LIS2.
+void play_sync(test::FakeAdbServer::Peer& peer, bool v2, std::vector<std::string>& requests) {
+    peer.okay();
+    while (true) {
+        std::string header, path;
+        if (!peer.read_exact(header, 8)) return;
+        std::string id = header.substr(0, 4);
+        auto* p = reinterpret_cast<const unsigned char*>(header.data() + 4);
+        uint32_t length = p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+        if (!peer.read_exact(path, length)) return;
+        requests.push_back(id + " " + path);
+        if (id == "QUIT") return;
+
+        bool v2_request = id == "STA2" || id == "LST2" || id == "LIS2";
+        if (v2_request && !v2) {
+            peer.fail("unknown command");
+            return;
+        }
+
+        if (id == "STA2" || id == "LST2" || id == "STAT") {
+            auto it = FILES.find(path);
+            DeviceFile file = it != FILES.end() ? it->second : DeviceFile{2};
+            if (id == "STAT" && file.error != 0) file = DeviceFile{};
+            peer.write(id + (v2 ? stat_v2_body(file) : stat_v1_body(file)));
+        } else if (id == "LIS2" || id == "LIST") {
+            auto dir = DIRECTORIES.find(path);
+            if (dir != DIRECTORIES.end()) {
+                for (const auto& name : dir->second) {
+                    auto it = FILES.find(name == "." || name == ".." ? path : path + "/" + name);
+                    DeviceFile file = it != FILES.end() ? it->second : DeviceFile{0, 040755};
+                    std::string body = v2 ? stat_v2_body(file) : stat_v1_body(file);
+                    peer.write((v2 ? "DNT2" : "DENT") + body + le32(static_cast<uint32_t>(name.size())) + name);
+                }
+            }
+            // The end marker is an all-zero entry
+            peer.write("DONE" + std::string(v2 ? 72 : 16, '\0'));
+        } else {
+            peer.fail("unexpected request");
+            return;
+        }
+    }
+}
+
+
+// ============ File pulls ============
+
+struct RemoteFile {
+    std::string content;
+    int64_t stat_size = -1;         // size STAT reports; -1 = the real one
+    size_t abort_after = SIZE_MAX;  // connection drops after this many payload bytes
+};
+
+// Random bytes: any mix-up of offsets shows in the comparison
+std::string random_bytes(size_t size, unsigned seed) {
+    std::mt19937 random(seed);
+    std::string bytes(size, '\0');
+    for (char& byte : bytes) byte = static_cast<char>(random());
+    return bytes;
+}
+
+// Three full DATA chunks and a short one
+const std::string LARGE_FILE = random_bytes(3 * 64 * 1024 + 12345, 1);
+
+// Device side of STAT (v1) and RECV. `prefetch` answers the RECV of that
+// path right behind the STAT reply, before the request arrives, so the
+// client reads part of the payload while reading the STAT reply.
+void play_transfer(test::FakeAdbServer::Peer& peer, const std::map<std::string, RemoteFile>& files,
+                   const std::string& prefetch = "") {
+    auto file_reply = [&](const RemoteFile& file) {
+        std::string reply;
+        size_t sent = 0;
+        for (size_t i = 0; i < file.content.size(); i += 64 * 1024) {
+            std::string chunk = file.content.substr(i, 64 * 1024);
+            if (sent + chunk.size() > file.abort_after) {
+                // Half a DATA message, then the connection drops
+                return reply + "DATA" + le32(static_cast<uint32_t>(chunk.size())) +
+                       chunk.substr(0, file.abort_after - sent);
+            }
+            reply += "DATA" + le32(static_cast<uint32_t>(chunk.size())) + chunk;
+            sent += chunk.size();
+        }
+        return reply + "DONE" + le32(0);
+    };
+    // Requests still pipelined behind the last one are read before the
+    // close; closing on unread data resets the connection and the client
+    // would lose the replies it has not read yet
+    auto hang_up = [&]() {
+        shutdown(peer.fd(), SHUT_WR);
+        peer.read_to_eof();
+    };
+    // Inside a sync session FAIL carries a little-endian length
+    auto sync_fail = [&](const std::string& message) {
+        peer.write("FAIL" + le32(static_cast<uint32_t>(message.size())) + message);
+        hang_up();
+    };
+
+    peer.okay();
+    while (true) {
+        std::string header, path;
+        if (!peer.read_exact(header, 8)) return;
+        std::string id = header.substr(0, 4);
+        auto* p = reinterpret_cast<const unsigned char*>(header.data() + 4);
+        uint32_t length = p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+        if (!peer.read_exact(path, length) || id == "QUIT") return;
+
+        auto it = files.find(path);
+        if (id == "STAT") {
+            DeviceFile stat{};
+            if (it != files.end()) {
+                stat.mode = 0100644;
+                stat.size = it->second.stat_size >= 0 ? static_cast<uint64_t>(it->second.stat_size)
+                                                      : it->second.content.size();
+            }
+            std::string reply = "STAT" + stat_v1_body(stat);
+            if (path == prefetch && it != files.end()) reply += file_reply(it->second);
+            peer.write(reply);
+        } else if (id == "RECV") {
+            if (it == files.end()) {
+                // adbd ends the session after a FAIL
+                return sync_fail("No such file or directory");
+            }
+            if (path == prefetch) continue;
+            std::string reply = file_reply(it->second);
+            peer.write(reply);
+            if (it->second.abort_after != SIZE_MAX) return hang_up();
+        } else {
+            return sync_fail("unexpected request");
+        }
+    }
+}
+
+// Fresh local directory, removed again at the end of the test
+class LocalDirectory {
+public:
+    LocalDirectory() {
+        char pattern[] = "/tmp/lincheckroot-pull-XXXXXX";
+        path_ = mkdtemp(pattern);
+    }
+    ~LocalDirectory() { std::filesystem::remove_all(path_); }
+
+    std::string file(const std::string& name) const { return path_ + "/" + name; }
+
+    // Names in the directory (a leftover partial file shows up here)
+    std::vector<std::string> names() const {
+        std::vector<std::string> found;
+        for (const auto& entry : std::filesystem::directory_iterator(path_)) {
+            found.push_back(entry.path().filename().string());
+        }
+        return found;
+    }
+
+private:
+    std::string path_;
+};
+
+std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void write_file(const std::string& path, const std::string& content) {
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+const adb::PullMode PULL_MODES[] = {adb::PullMode::BUFFERED, adb::PullMode::SPLICE, adb::PullMode::MMAP};
+
+} // namespace
+
+TEST(stat_v2_decodes_every_field) {
+    std::vector<std::string> requests;
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_sync(peer, true, requests);
+    });
+
+    adb::SyncClient client("emulator-5554");
+    auto stats = client.stat({"/system/bin/sh", "/data/adb", "/data/adb/magisk.db", "/sbin/su"});
+    CHECK(stats.has_value());
+    if (!stats) return;
+    CHECK_EQ(stats->size(), 4u);
+    CHECK(client.uses_v2());
+
+    const adb::FileStat& sh = (*stats)[0];
+    CHECK(sh.exists());
+    CHECK(sh.is_regular());
+    CHECK_EQ(sh.mode, 0100755u);
+    CHECK_EQ(sh.size, 315848u);
+    CHECK_EQ(sh.mtime, 1230768000);
+    CHECK_EQ(sh.gid, 2000u);
+    CHECK_EQ(sh.ino, 1234567890123ULL);
+    CHECK_EQ(sh.nlink, 1u);
+
+    CHECK((*stats)[1].is_directory());
+    CHECK_EQ((*stats)[1].nlink, 5u);
+    // 64-bit size, which the v1 record cannot carry
+    CHECK_EQ((*stats)[2].size, 1ULL << 33);
+
+    CHECK(!(*stats)[3].exists());
+    CHECK_EQ((*stats)[3].error, 2u);
+
+    client.close();
+    // One pipelined batch of lstat requests, then QUIT
+    std::vector<std::string> expected = {
+        "LST2 /system/bin/sh", "LST2 /data/adb", "LST2 /data/adb/magisk.db", "LST2 /sbin/su", "QUIT ",
+    };
+    CHECK(requests == expected);
+}
+
+TEST(follow_links_uses_sta2) {
+    std::vector<std::string> requests;
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_sync(peer, true, requests);
+    });
+
+    adb::SyncClient client("emulator-5554");
+    CHECK(client.stat({"/data/adb"}, true).has_value());
+    CHECK(!requests.empty() && requests[0] == "STA2 /data/adb");
+}
+
+TEST(list_v2_skips_dot_entries) {
+    std::vector<std::string> requests;
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_sync(peer, true, requests);
+    });
+
+    adb::SyncClient client("emulator-5554");
+    auto listings = client.list({"/data/adb", "/missing"});
+    CHECK(listings.has_value());
+    if (!listings) return;
+    CHECK_EQ(listings->size(), 2u);
+
+    const auto& entries = (*listings)[0];
+    CHECK_EQ(entries.size(), 1u);
+    if (entries.size() == 1) {
+        CHECK_EQ(entries[0].name, "magisk.db");
+        CHECK_EQ(entries[0].stat.size, 1ULL << 33);
+        CHECK_EQ(entries[0].stat.ino, 43u);
+    }
+    CHECK((*listings)[1].empty());
+}
+
+TEST(rejected_v2_falls_back_to_v1) {
+    std::vector<std::string> requests;
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_sync(peer, false, requests);
+    });
+
+    adb::SyncClient client("emulator-5554");
+    auto stats = client.stat({"/system/bin/sh", "/sbin/su"});
+    CHECK(stats.has_value());
+    CHECK(!client.uses_v2());
+    if (stats && stats->size() == 2) {
+        CHECK_EQ((*stats)[0].mode, 0100755u);
+        CHECK_EQ((*stats)[0].size, 315848u);
+        CHECK_EQ((*stats)[0].mtime, 1230768000);
+        CHECK(!(*stats)[1].exists());
+    }
+
+    auto listings = client.list({"/data/adb"});
+    CHECK(listings.has_value());
+    if (listings && listings->size() == 1) {
+        CHECK_EQ((*listings)[0].size(), 1u);
+    }
+    CHECK(!requests.empty() && requests[0] == "LST2 /system/bin/sh");
+}
+
+TEST(lost_session_is_not_a_v1_device) {
+    test::FakeAdbServer server([](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service != "sync:") return;
+        peer.okay();
+        std::string header;
+        peer.read_exact(header, 8);
+        // Half a reply, then the connection drops
+        peer.write("LST2" + le32(0));
+    });
+
+    adb::SyncClient client("emulator-5554");
+    CHECK(!client.stat({"/system/bin/sh"}).has_value());
+    CHECK(client.uses_v2());
+}
+
+TEST(pull_to_file_in_every_mode) {
+    std::map<std::string, RemoteFile> files = {
+        {"/proc/large", {LARGE_FILE}},
+        {"/proc/empty", {""}},
+    };
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_transfer(peer, files);
+    });
+
+    LocalDirectory dir;
+    for (adb::PullMode mode : PULL_MODES) {
+        adb::SyncClient client("emulator-5554");
+        auto stats = client.pull_to_file("/proc/large", dir.file("large"), mode);
+        CHECK(stats.has_value());
+        if (stats) {
+            CHECK_EQ(stats->bytes, LARGE_FILE.size());
+            CHECK_EQ(stats->wire_bytes, LARGE_FILE.size());
+        }
+        CHECK(read_file(dir.file("large")) == LARGE_FILE);
+
+        // Replaces what was there, on the same session
+        write_file(dir.file("empty"), "old content");
+        CHECK(client.pull_to_file("/proc/empty", dir.file("empty"), mode).has_value());
+        CHECK_EQ(std::filesystem::file_size(dir.file("empty")), 0u);
+        CHECK_EQ(dir.names().size(), 2u);
+    }
+}
+
+TEST(mmap_pull_follows_a_stale_stat_size) {
+    // The file grew and shrank between the STAT and the RECV
+    std::map<std::string, RemoteFile> files = {
+        {"/proc/grew", {LARGE_FILE, 1000}},
+        {"/proc/shrank", {LARGE_FILE, static_cast<int64_t>(LARGE_FILE.size() * 3)}},
+        {"/proc/appeared", {LARGE_FILE, 0}},
+    };
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_transfer(peer, files);
+    });
+
+    LocalDirectory dir;
+    adb::SyncClient client("emulator-5554");
+    for (const auto& [remote, file] : files) {
+        std::string local = dir.file(remote.substr(6));
+        CHECK(client.pull_to_file(remote, local, adb::PullMode::MMAP).has_value());
+        CHECK(read_file(local) == LARGE_FILE);
+    }
+}
+
+TEST(payload_read_ahead_of_a_splice_is_written_first) {
+    std::map<std::string, RemoteFile> files = {{"/proc/large", {LARGE_FILE}}};
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_transfer(peer, files, "/proc/large");
+    });
+
+    LocalDirectory dir;
+    adb::SyncClient client("emulator-5554", false);
+    // A buffered read that may take part of the next reply with it
+    CHECK(client.stat({"/proc/large"}).has_value());
+    CHECK(client.pull_to_file("/proc/large", dir.file("large"), adb::PullMode::SPLICE).has_value());
+    CHECK(read_file(dir.file("large")) == LARGE_FILE);
+}
+
+TEST(failed_pull_keeps_the_existing_file) {
+    std::map<std::string, RemoteFile> files = {
+        {"/proc/cut", {LARGE_FILE, -1, 64 * 1024 + 100}},
+        {"/proc/cut_at_header", {LARGE_FILE, -1, 2 * 64 * 1024}},
+    };
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_transfer(peer, files);
+    });
+
+    LocalDirectory dir;
+    for (adb::PullMode mode : PULL_MODES) {
+        for (const char* remote : {"/proc/cut", "/proc/cut_at_header", "/proc/missing"}) {
+            write_file(dir.file("kept"), "previous pull");
+            adb::SyncClient client("emulator-5554");
+            CHECK(!client.pull_to_file(remote, dir.file("kept"), mode).has_value());
+            CHECK(!client.last_error().empty());
+            CHECK_EQ(read_file(dir.file("kept")), "previous pull");
+            // No partial file left behind
+            CHECK(dir.names() == std::vector<std::string>{"kept"});
+        }
+    }
+
+    // Nothing is created for a pull that never completes
+    adb::SyncClient client("emulator-5554");
+    CHECK(!client.pull_to_file("/proc/cut", dir.file("new"), adb::PullMode::MMAP).has_value());
+    CHECK(!std::filesystem::exists(dir.file("new")));
+}
+
+TEST(bundle_resends_the_rest_after_an_unreadable_file) {
+    std::map<std::string, RemoteFile> files = {
+        {"/proc/version", {"Linux version 5.15.110\n"}},
+        {"/proc/large", {LARGE_FILE}},
+        {"/system/build.prop", {"ro.build.id=UQ1A\n"}},
+    };
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_transfer(peer, files);
+    });
+
+    std::vector<std::string> remotes = {"/proc/version", "/proc/large", "/proc/secret", "/system/build.prop"};
+    std::vector<std::string> received(remotes.size());
+    std::vector<size_t> order;
+    adb::SyncClient client("emulator-5554");
+    auto manifest = client.pull_bundle(remotes, [&](size_t index, std::string_view chunk) {
+        if (order.empty() || order.back() != index) order.push_back(index);
+        received[index].append(chunk.data(), chunk.size());
+        return true;
+    });
+    CHECK(manifest.has_value());
+    if (!manifest) return;
+
+    CHECK_EQ(manifest->sessions, 2u);
+    CHECK_EQ(server.services().size(), 2u);
+    CHECK_EQ(manifest->entries.size(), 4u);
+    for (size_t i = 0; i < remotes.size(); ++i) {
+        CHECK_EQ(manifest->entries[i].remote, remotes[i]);
+        CHECK_EQ(manifest->entries[i].ok, i != 2);
+        CHECK_EQ(manifest->entries[i].error.empty(), i != 2);
+    }
+    CHECK_EQ(manifest->entries[2].error, "Sync request failed: No such file or directory");
+    CHECK(order == (std::vector<size_t>{0, 1, 3}));
+    CHECK_EQ(received[0], files["/proc/version"].content);
+    CHECK(received[1] == LARGE_FILE);
+    CHECK(received[2].empty());
+    CHECK_EQ(received[3], files["/system/build.prop"].content);
+    CHECK_EQ(manifest->entries[1].stats.bytes, LARGE_FILE.size());
+    CHECK_EQ(manifest->total_bytes, LARGE_FILE.size() + received[0].size() + received[3].size());
+}
+
+TEST(bundle_marks_the_rest_after_a_lost_connection) {
+    std::map<std::string, RemoteFile> files = {
+        {"/proc/version", {"Linux version 5.15.110\n"}},
+        {"/proc/large", {LARGE_FILE, -1, 100000}},
+        {"/system/build.prop", {"ro.build.id=UQ1A\n"}},
+    };
+    test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service == "sync:") play_transfer(peer, files);
+    });
+
+    std::vector<std::string> remotes = {"/proc/version", "/proc/large", "/system/build.prop", "/proc/cmdline"};
+    std::vector<size_t> delivered(remotes.size());
+    adb::SyncClient client("emulator-5554");
+    auto manifest = client.pull_bundle(remotes, [&](size_t index, std::string_view chunk) {
+        delivered[index] += chunk.size();
+        return true;
+    });
+    CHECK(manifest.has_value());
+    if (!manifest) return;
+
+    // No second session: the connection itself is gone
+    CHECK_EQ(manifest->sessions, 1u);
+    CHECK(manifest->entries[0].ok);
+    CHECK(!manifest->entries[1].ok);
+    CHECK_EQ(manifest->entries[1].error, "Sync session closed by device");
+    for (size_t i = 2; i < remotes.size(); ++i) {
+        CHECK(!manifest->entries[i].ok);
+        CHECK_EQ(manifest->entries[i].error, manifest->entries[1].error);
+        CHECK_EQ(delivered[i], 0u);
+    }
+    CHECK_EQ(manifest->total_bytes, files["/proc/version"].content.size());
+}
+
+TEST(bundle_without_a_server_is_nullopt) {
+    test::FakeAdbServer server([](test::FakeAdbServer::Peer& peer, const std::string&) {
+        peer.fail("device offline");
+    });
+    adb::SyncClient client("emulator-5554");
+    CHECK(!client.pull_bundle({"/proc/version"}, nullptr).has_value());
+}
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,288 @@
+// Sync v2 compression: codec streams and RCV2/SND2 framing
+
+#include "check.hpp"
+#include "fake_adb_server.hpp"
+#include "adb/sync_client.hpp"
+#include "adb/sync_compression.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using adb::Compression;
+using test::le32;
+
+namespace {
+
+constexpr Compression CODECS[] = {Compression::ZSTD, Compression::LZ4, Compression::BROTLI};
+
+// Compressible but not trivially so: log-like lines with varying numbers
+std::string sample_file() {
+    std::string text;
+    for (int i = 0; text.size() < 300 * 1024; ++i) {
+        text += "I/ActivityManager( " + std::to_string(1000 + i % 97) + "): Start proc " +
+                std::to_string(i * 7919 % 100003) + ":com.example.app" + std::to_string(i % 13) + "\n";
+    }
+    return text;
+}
+
+std::string compress(Compression method, std::string_view input) {
+    std::string out;
+    auto sink = [&](std::string_view chunk) { out.append(chunk.data(), chunk.size()); return true; };
+    auto encoder = adb::StreamEncoder::create(method);
+    // Uneven input pieces, as file reads would deliver them
+    for (size_t i = 0; i < input.size(); i += 12345) {
+        encoder->feed(input.substr(i, 12345), sink);
+    }
+    encoder->finish(sink);
+    return out;
+}
+
+uint32_t word(const std::string& bytes) {
+    auto* p = reinterpret_cast<const unsigned char*>(bytes.data());
+    return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+// One sync message: id plus its 4-byte word (a length for most ids)
+bool read_message(test::FakeAdbServer::Peer& peer, std::string& id, uint32_t& value) {
+    std::string header;
+    if (!peer.read_exact(header, 8)) return false;
+    id = header.substr(0, 4);
+    value = word(header.substr(4));
+    return true;
+}
+
+std::string read_path(test::FakeAdbServer::Peer& peer, uint32_t length) {
+    std::string path;
+    peer.read_exact(path, length);
+    return path;
+}
+
+// DATA messages of at most SYNC_DATA_MAX bytes, then DONE
+std::string data_messages(std::string_view payload) {
+    std::string out;
+    for (size_t i = 0; i < payload.size(); i += 64 * 1024) {
+        std::string_view chunk = payload.substr(i, 64 * 1024);
+        out += "DATA" + le32(static_cast<uint32_t>(chunk.size())) + std::string(chunk);
+    }
+    return out + "DONE" + le32(0);
+}
+
+} // namespace
+
+TEST(negotiation_prefers_zstd_and_needs_sendrecv_v2) {
+    CHECK(adb::negotiate_compression({"sendrecv_v2_zstd", "sendrecv_v2_lz4"}) == Compression::NONE);
+    CHECK(adb::negotiate_compression({"sendrecv_v2"}) == Compression::NONE);
+
+    std::vector<std::string> features = {"shell_v2", "sendrecv_v2", "sendrecv_v2_brotli", "sendrecv_v2_lz4",
+                                         "sendrecv_v2_zstd"};
+    Compression expected = Compression::NONE;
+    for (Compression method : {Compression::BROTLI, Compression::LZ4, Compression::ZSTD}) {
+        if (adb::compression_available(method)) expected = method;
+    }
+    CHECK(adb::negotiate_compression(features) == expected);
+}
+
+TEST(codec_streams_round_trip_in_any_piece_size) {
+    std::string original = sample_file();
+    for (Compression method : CODECS) {
+        if (!adb::compression_available(method)) continue;
+        std::string compressed = compress(method, original);
+        CHECK(compressed.size() < original.size() / 2);
+
+        for (size_t step : {size_t{1}, size_t{7}, size_t{4096}, compressed.size()}) {
+            // Byte-at-a-time is slow on 300 KB of output; a prefix exercises the same paths
+            std::string_view input = step == 1 ? std::string_view(compressed).substr(0, 2048) : compressed;
+            auto decoder = adb::StreamDecoder::create(method);
+            std::string decoded;
+            bool ok = true;
+            for (size_t i = 0; i < input.size() && ok; i += step) {
+                ok = decoder->feed(input.substr(i, step), [&](std::string_view chunk) {
+                    decoded.append(chunk.data(), chunk.size());
+                    return true;
+                });
+            }
+            CHECK(ok);
+            if (step == 1) {
+                CHECK(!decoder->finished());
+                CHECK_EQ(decoded, original.substr(0, decoded.size()));
+            } else {
+                CHECK(decoder->finished());
+                CHECK(decoded == original);
+            }
+        }
+    }
+}
+
+TEST(corrupt_stream_is_rejected) {
+    std::string original = sample_file();
+    for (Compression method : CODECS) {
+        if (!adb::compression_available(method)) continue;
+        std::string compressed = compress(method, original);
+        for (size_t i = 0; i < 64; ++i) {
+            compressed[i] = static_cast<char>(compressed[i] ^ 0x5a);
+        }
+        auto decoder = adb::StreamDecoder::create(method);
+        bool ok = decoder->feed(compressed, [](std::string_view) { return true; });
+        CHECK(!ok || !decoder->finished());
+    }
+}
+
+TEST(rcv2_pull_decodes_data_messages) {
+    std::string original = sample_file();
+    for (Compression method : CODECS) {
+        if (!adb::compression_available(method)) continue;
+        std::string compressed = compress(method, original);
+        std::vector<std::string> requests;
+
+        test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+            if (service != "sync:") return;
+            peer.okay();
+            std::string id;
+            uint32_t value;
+            while (read_message(peer, id, value)) {
+                if (id == "QUIT") return;
+                if (id != "RCV2") return peer.fail("unexpected request");
+                // RCV2 <path>, then RCV2 <compression flags>
+                std::string path = read_path(peer, value);
+                if (!read_message(peer, id, value)) return;
+                requests.push_back(path + " " + id + " " + std::to_string(value));
+                peer.write(data_messages(compressed));
+            }
+        });
+
+        adb::SyncClient client("emulator-5554");
+        client.set_compression(method);
+        std::string received;
+        auto stats = client.pull("/sdcard/log.txt", [&](std::string_view chunk) {
+            received.append(chunk.data(), chunk.size());
+            return true;
+        });
+        CHECK(stats.has_value());
+        CHECK(received == original);
+        if (stats) {
+            CHECK_EQ(stats->bytes, original.size());
+            CHECK_EQ(stats->wire_bytes, compressed.size());
+            CHECK(stats->compression == method);
+        }
+        CHECK(requests.size() == 1 &&
+              requests[0] == "/sdcard/log.txt RCV2 " + std::to_string(static_cast<uint32_t>(method)));
+    }
+}
+
+TEST(truncated_rcv2_stream_fails_the_pull) {
+    std::string original = sample_file();
+    for (Compression method : CODECS) {
+        if (!adb::compression_available(method)) continue;
+        std::string compressed = compress(method, original);
+        compressed.resize(compressed.size() - 16);
+
+        test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+            if (service != "sync:") return;
+            peer.okay();
+            std::string id;
+            uint32_t value;
+            if (!read_message(peer, id, value)) return;
+            read_path(peer, value);
+            read_message(peer, id, value);
+            peer.write(data_messages(compressed));
+            peer.read_to_eof();
+        });
+
+        adb::SyncClient client("emulator-5554");
+        client.set_compression(method);
+        CHECK(!client.pull("/sdcard/log.txt", [](std::string_view) { return true; }).has_value());
+        CHECK(client.last_error().find("Truncated") != std::string::npos);
+    }
+}
+
+TEST(rejected_rcv2_retries_as_recv) {
+    Compression method = adb::negotiate_compression({"sendrecv_v2", "sendrecv_v2_zstd", "sendrecv_v2_lz4",
+                                                     "sendrecv_v2_brotli"});
+    if (method == Compression::NONE) return;
+
+    test::FakeAdbServer server([](test::FakeAdbServer::Peer& peer, const std::string& service) {
+        if (service != "sync:") return;
+        peer.okay();
+        std::string id;
+        uint32_t value;
+        if (!read_message(peer, id, value)) return;
+        read_path(peer, value);
+        if (id == "RCV2") return peer.fail("compression not supported");
+        peer.write(data_messages("plain"));
+        peer.read_to_eof();
+    });
+
+    adb::SyncClient client("emulator-5554");
+    client.set_compression(method);
+    std::string received;
+    auto stats = client.pull("/sdcard/a", [&](std::string_view chunk) {
+        received.append(chunk.data(), chunk.size());
+        return true;
+    });
+    CHECK(stats.has_value());
+    CHECK_EQ(received, "plain");
+    CHECK(client.compression() == Compression::NONE);
+    CHECK_EQ(server.services().size(), 2u);
+}
+
+TEST(snd2_push_frames_a_compressed_stream) {
+    std::string original = sample_file();
+    char local[] = "/tmp/lincheckroot-push-XXXXXX";
+    int fd = mkstemp(local);
+    CHECK(fd >= 0);
+    if (fd < 0) return;
+    CHECK_EQ(write(fd, original.data(), original.size()), static_cast<ssize_t>(original.size()));
+    close(fd);
+
+    for (Compression method : CODECS) {
+        if (!adb::compression_available(method)) continue;
+        std::string header;
+        std::string payload;
+        uint32_t largest_data = 0;
+
+        test::FakeAdbServer server([&](test::FakeAdbServer::Peer& peer, const std::string& service) {
+            if (service != "sync:") return;
+            peer.okay();
+            // SND2 <path>, SND2 <mode> <flags>, DATA..., DONE <mtime>
+            std::string id, flags;
+            uint32_t value;
+            if (!read_message(peer, id, value)) return;
+            header = id + " " + read_path(peer, value);
+            if (!read_message(peer, id, value) || !peer.read_exact(flags, 4)) return;
+            header += " " + id + " " + std::to_string(value) + " " + std::to_string(word(flags));
+            while (read_message(peer, id, value) && id == "DATA") {
+                largest_data = std::max(largest_data, value);
+                payload += read_path(peer, value);
+            }
+            if (id != "DONE") return peer.fail("expected DONE");
+            peer.write("OKAY" + le32(0));
+            peer.read_to_eof();
+        });
+
+        adb::SyncClient client("emulator-5554");
+        client.set_compression(method);
+        auto stats = client.push(local, "/data/local/tmp/pushed", 0644);
+        client.close();
+        CHECK(stats.has_value());
+        CHECK_EQ(header, "SND2 /data/local/tmp/pushed SND2 " + std::to_string(0100644) + " " +
+                         std::to_string(static_cast<uint32_t>(method)));
+        CHECK(largest_data <= 64 * 1024);
+        if (stats) CHECK_EQ(stats->wire_bytes, payload.size());
+
+        auto decoder = adb::StreamDecoder::create(method);
+        std::string decoded;
+        CHECK(decoder->feed(payload, [&](std::string_view chunk) {
+            decoded.append(chunk.data(), chunk.size());
+            return true;
+        }));
+        CHECK(decoder->finished());
+        CHECK(decoded == original);
+    }
+    unlink(local);
+}
+
+int main() {
+    return test::run_all();
+}
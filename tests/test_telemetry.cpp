@@ -0,0 +1,156 @@
+// Telemetry: parsing of the tagged sample lines and stopping without waiting on a sample
+
+#include "check.hpp"
+#include "monitor/telemetry.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using monitor::TelemetryMonitor;
+using monitor::TelemetrySample;
+using monitor::TelemetrySampler;
+using namespace std::chrono_literals;
+
+namespace {
+
+constexpr const char* SERIAL = "emulator-5554";
+
+/**
+ * An adb binary whose "shell" is `body`: "exec sh" samples the host's own
+ * /proc, "exec sleep 3" is a device that never answers
+ */
+class FakeAdb {
+public:
+    explicit FakeAdb(const std::string& body) {
+        char pattern[] = "/tmp/lincheckroot-telemetry-XXXXXX";
+        dir_ = mkdtemp(pattern);
+        std::ofstream(path()) << "#!/bin/sh\n" << body << "\n";
+        std::filesystem::permissions(path(), std::filesystem::perms::owner_all);
+    }
+    ~FakeAdb() { std::filesystem::remove_all(dir_); }
+
+    std::string path() const { return dir_ + "/adb"; }
+
+private:
+    std::string dir_;
+};
+
+// One tick as the sample command prints it
+void feed(TelemetrySampler& sampler, const std::vector<std::string>& lines, TelemetrySample& out) {
+    out = TelemetrySample();
+    for (const auto& line : lines) sampler.parse_line(line, out);
+    sampler.finish_sample(out);
+}
+
+template <class Predicate>
+bool wait_for(Predicate done, std::chrono::milliseconds limit) {
+    auto deadline = std::chrono::steady_clock::now() + limit;
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(10ms);
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(parse_line_reads_every_source) {
+    TelemetrySampler sampler("adb", SERIAL);
+    TelemetrySample first, second;
+    feed(sampler, {
+        "/proc/stat:cpu  100 0 50 800 50 0 0 0 0 0",
+        "/proc/meminfo:MemTotal:        7864320 kB",
+        "/proc/meminfo:MemAvailable:    3932160 kB",
+        "/proc/pressure/cpu:some avg10=1.25 avg60=0.80 avg300=0.50 total=123456",
+        "/proc/pressure/memory:some avg10=0.00 avg60=0.00 avg300=0.00 total=0",
+        "/proc/pressure/memory:full avg10=9.00 avg60=0.00 avg300=0.00 total=0",
+        "/proc/pressure/io:some avg10=12.50 avg60=3.10 avg300=1.00 total=99",
+        "/sys/class/thermal/thermal_zone0/temp:42500",
+        "/sys/class/thermal/thermal_zone3/temp:-273000",     // disabled zone
+        "/sys/class/thermal/thermal_zone5/temp:38",          // whole degrees
+        "/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq:1804800",
+        "/sys/devices/system/cpu/cpu4/cpufreq/scaling_cur_freq:2400000",
+        "/sys/devices/system/cpu/cpu7/cpufreq/scaling_cur_freq:0",   // offline
+        "no tag on this line",
+    }, first);
+
+    // The first tick only primes the CPU counters
+    CHECK(first.cpu_percent < 0);
+    CHECK(first.mem_used_percent > 49.9f && first.mem_used_percent < 50.1f);
+    CHECK_EQ(first.mem_available_kb, 3932160u);
+    CHECK(first.psi_cpu > 1.24f && first.psi_cpu < 1.26f);
+    CHECK(first.psi_memory == 0.0f);
+    CHECK(first.psi_io > 12.49f && first.psi_io < 12.51f);
+    CHECK(first.max_temp_c > 42.49f && first.max_temp_c < 42.51f);
+    CHECK(first.avg_freq_mhz > 2102.3f && first.avg_freq_mhz < 2102.5f);
+    CHECK(first.max_freq_mhz > 2399.9f && first.max_freq_mhz < 2400.1f);
+
+    // 150 jiffies later, 50 of them idle or iowait
+    feed(sampler, {"/proc/stat:cpu  150 0 100 850 50 0 0 0 0 0"}, second);
+    CHECK(second.cpu_percent > 66.6f && second.cpu_percent < 66.7f);
+    // Sources missing from a tick stay "not available"
+    CHECK(second.psi_cpu < 0);
+    CHECK(second.max_temp_c < 0);
+    CHECK(second.avg_freq_mhz < 0);
+}
+
+TEST(monitor_samples_a_live_shell) {
+    FakeAdb adb("exec sh");
+    TelemetryMonitor monitor(adb.path(), 100);
+    monitor.start(SERIAL, 20);
+    CHECK(monitor.is_running(SERIAL));
+    CHECK(monitor.devices() == std::vector<std::string>{SERIAL});
+
+    std::vector<TelemetrySample> series;
+    CHECK(wait_for([&]() { return monitor.copy_series(SERIAL, series) && series.size() >= 3; }, 5000ms));
+    if (series.size() >= 3) {
+        CHECK(series.back().mem_used_percent > 0);
+        CHECK(series.back().cpu_percent >= 0);
+        CHECK(series.back().time_s > series.front().time_s);
+    }
+    monitor.stop(SERIAL);
+    CHECK(!monitor.is_running(SERIAL));
+    CHECK(monitor.devices().empty());
+    // The series outlives the worker
+    CHECK(monitor.copy_series(SERIAL, series) && !series.empty());
+}
+
+TEST(restart_right_after_stop_keeps_sampling) {
+    FakeAdb adb("exec sh");
+    TelemetryMonitor monitor(adb.path(), 100);
+    monitor.start(SERIAL, 20);
+    monitor.stop(SERIAL);
+    monitor.start(SERIAL, 20);
+    CHECK(monitor.is_running(SERIAL));
+
+    std::vector<TelemetrySample> series;
+    monitor.copy_series(SERIAL, series);
+    size_t before = series.size();
+    CHECK(wait_for([&]() { return monitor.copy_series(SERIAL, series) && series.size() >= before + 2; }, 5000ms));
+}
+
+TEST(stop_does_not_wait_for_a_sample_in_flight) {
+    FakeAdb adb("exec sleep 3");
+    auto monitor = std::make_unique<TelemetryMonitor>(adb.path());
+    monitor->start(SERIAL, 10);
+    monitor->start("0123456789ABCDEF", 10);
+    std::this_thread::sleep_for(100ms);
+
+    // Both workers are blocked reading a device that never answers
+    auto started = std::chrono::steady_clock::now();
+    monitor->stop(SERIAL);
+    CHECK(!monitor->is_running(SERIAL));
+    CHECK(monitor->is_running("0123456789ABCDEF"));
+    monitor.reset();
+    CHECK(std::chrono::steady_clock::now() - started < 500ms);
+}
+
+int main() {
+    return test::run_all();
+}
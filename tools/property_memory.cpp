@@ -0,0 +1,120 @@
+// property_memory: per-device footprint of cached property snapshots
+//
+// Simulates a fleet of devices with getprop dumps shaped like real ones
+// (1200 properties, keys shared by every device, 10% of the values unique
+// per device, 2% changing on every refresh) and prints:
+//   - heap per device for std::map<std::string, std::string> snapshots
+//   - heap per device for PropertyCache snapshots sharing one StringPool
+//   - pool size while the fleet is refreshed, showing that the rebuilds
+//     keep it bounded however many refreshes run
+//
+// Usage: property_memory [DEVICES...] [--refreshes N]   (default 1000 10000, 20)
+
+#include "adb_abstraction.h"
+#include "device/property_snapshot.hpp"
+#include "parse/line_scanner.hpp"
+#include "parse/properties.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <malloc.h>
+
+namespace {
+
+constexpr int PROPERTIES = 1200;
+
+size_t heap_in_use() {
+    return mallinfo2().uordblks;
+}
+
+// One device's getprop output for refresh `round`
+std::string getprop_output(int device, int round) {
+    std::string out;
+    out.reserve(PROPERTIES * 64);
+    for (int key = 0; key < PROPERTIES; ++key) {
+        out += "[ro.vendor.simulated.property." + std::to_string(key) + "]: [";
+        if (key % 50 == 0) {
+            // Uptime-style values: new on every refresh
+            out += "dynamic-" + std::to_string(device) + "-" + std::to_string(round) + "-" + std::to_string(key);
+        } else if (key % 10 == 0) {
+            out += "unique-" + std::to_string(device) + "-" + std::to_string(key);
+        } else {
+            out += "common-value-" + std::to_string(key % 97) + "-variant-" + std::to_string(device % 3);
+        }
+        out += "]\n";
+    }
+    return out;
+}
+
+void measure_maps(int devices) {
+    size_t before = heap_in_use();
+    {
+        std::vector<std::map<std::string, std::string>> maps(devices);
+        for (int device = 0; device < devices; ++device) {
+            std::string output = getprop_output(device, 0);
+            parse::for_each_line(output, [&](std::string_view line) {
+                std::string_view key, value;
+                if (parse::parse_property_line(line, key, value)) {
+                    maps[device].emplace(std::string(key), std::string(value));
+                }
+            });
+        }
+        size_t used = heap_in_use() - before;
+        std::printf("%6d devices  std::map       %8zu B/device  %8.1f MB\n",
+                    devices, used / devices, used / 1048576.0);
+    }
+}
+
+void measure_cache(const AdbAbstraction& adb, int devices, int refreshes) {
+    size_t before = heap_in_use();
+    device::PropertyCache cache(adb);
+    for (int device = 0; device < devices; ++device) {
+        cache.put("sim-" + std::to_string(device), getprop_output(device, 0));
+    }
+    size_t used = heap_in_use() - before;
+    auto stats = cache.stats();
+    std::printf("%6d devices  PropertyCache  %8zu B/device  %8.1f MB  (%zu pooled strings)\n",
+                devices, used / devices, used / 1048576.0, stats.pool_strings);
+
+    for (int round = 1; round <= refreshes; ++round) {
+        for (int device = 0; device < devices; ++device) {
+            cache.put("sim-" + std::to_string(device), getprop_output(device, round));
+        }
+        stats = cache.stats();
+        if (round % 5 == 0 || round == refreshes) {
+            std::printf("        refresh %3d: %8.1f MB heap, %zu pooled strings, %llu rebuilds\n",
+                        round, (heap_in_use() - before) / 1048576.0, stats.pool_strings,
+                        static_cast<unsigned long long>(stats.compactions));
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::vector<int> fleet;
+    int refreshes = 20;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--refreshes") == 0 && i + 1 < argc) {
+            refreshes = std::atoi(argv[++i]);
+        } else if (std::atoi(argv[i]) > 0) {
+            fleet.push_back(std::atoi(argv[i]));
+        } else {
+            std::fprintf(stderr, "Usage: %s [DEVICES...] [--refreshes N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (fleet.empty()) fleet = {1000, 10000};
+
+    // Never used to reach a device: snapshots are fed with put()
+    AdbAbstraction adb("adb");
+    for (int devices : fleet) {
+        measure_maps(devices);
+        measure_cache(adb, devices, refreshes);
+    }
+    return 0;
+}